@@ -13,11 +13,16 @@
 #include <string.h>
 #include <strings.h>
 #include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
 #include <sys/time.h>
+#include <time.h>
 
 #define _GNU_SOURCE
 
 #include "audio_ctl.h"
+#include "audio_sink.h"
+#include "pcm_cache.h"
 
 #define USING_SIMULATOR_AUDIO 1
 #ifndef AUDIO_DEBUG
@@ -33,8 +38,32 @@
 
 // Functions
 static uint32_t estimate_mp3_duration(off_t file_size);
-static void* monitor_thread_func(void* arg);
-static void* playback_simulation_thread(void* arg) __attribute__((unused));
+static int read_exact(int fd, void* buf, size_t len);
+static int probe_wav(int fd, wav_s* info);
+static int probe_mp3(int fd, wav_s* info);
+static int decode_open_file(audioctl_s* ctl);
+static int ring_alloc(audio_ring_s* ring, uint32_t capacity, bool lock_memory);
+static void ring_free(audio_ring_s* ring);
+static int ring_resize_locked(audio_ring_s* ring, uint32_t new_size);
+static uint32_t ring_write_locked(audio_ring_s* ring, const uint8_t* src, uint32_t len);
+static uint32_t ring_read_locked(audio_ring_s* ring, uint8_t* dst, uint32_t len);
+static void ring_flush_locked(audio_ring_s* ring, uint32_t stream_pos);
+static void ring_adapt_locked(audioctl_s* ctl, bool underrun);
+static void playback_output(audioctl_s* ctl, const uint8_t* data, uint32_t len, bool* resync);
+static void stats_record_decode_locked(audioctl_s* ctl, uint32_t len, uint32_t elapsed_us);
+static void stats_record_fill_locked(audioctl_s* ctl);
+static void stats_report(audioctl_s* ctl);
+static void* decode_thread_func(void* arg);
+static void* playback_thread_func(void* arg);
+static int thread_create(audioctl_s* ctl, pthread_t* thread, void* (*func)(void*), int priority, const char* name);
+
+/* MPEG audio Layer III bitrates in kbps, indexed by [MPEG-1 ? 0 : 1][index] */
+static const uint16_t mp3_bitrates[2][16] = {
+    { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 },
+    { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 },
+};
+
+static const uint32_t mp3_sample_rates[3] = { 44100, 48000, 32000 };
 
 /* Estimate MP3 duration based on file size */
 static uint32_t estimate_mp3_duration(off_t file_size)
@@ -49,65 +78,763 @@ static uint32_t estimate_mp3_duration(off_t file_size)
     return 240; // Default 4 minutes
 }
 
-/* Playback monitoring thread */
-static void* monitor_thread_func(void* arg)
+static int read_exact(int fd, void* buf, size_t len)
+{
+    uint8_t* p = (uint8_t*)buf;
+
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static uint32_t le32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t le16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/* Walk RIFF chunks until "fmt " and "data" have been found */
+static int probe_wav(int fd, wav_s* info)
+{
+    uint8_t hdr[16];
+    uint32_t pos = 12;
+    bool have_fmt = false;
+
+    if (lseek(fd, 0, SEEK_SET) != 0 || read_exact(fd, hdr, 12) < 0 ||
+        memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0) {
+        AUDIO_LOG("Not a RIFF/WAVE file");
+        return -1;
+    }
+
+    while (read_exact(fd, hdr, 8) == 0) {
+        uint32_t chunk_size = le32(hdr + 4);
+        pos += 8;
+
+        if (memcmp(hdr, "fmt ", 4) == 0 && chunk_size >= 16) {
+            if (read_exact(fd, hdr, 16) < 0) {
+                return -1;
+            }
+            info->num_channels = le16(hdr + 2);
+            info->sample_rate = le32(hdr + 4);
+            info->byte_rate = le32(hdr + 8);
+            info->bits_per_sample = le16(hdr + 14);
+            have_fmt = true;
+            chunk_size -= 16;
+            pos += 16;
+        } else if (memcmp(hdr, "data", 4) == 0) {
+            if (!have_fmt || info->byte_rate == 0) {
+                AUDIO_LOG("WAV data chunk before fmt chunk");
+                return -1;
+            }
+            info->data_offset = pos;
+            info->data_size = chunk_size;
+            return 0;
+        }
+
+        // Chunks are word aligned
+        chunk_size += chunk_size & 1;
+        if (lseek(fd, chunk_size, SEEK_CUR) < 0) {
+            return -1;
+        }
+        pos += chunk_size;
+    }
+
+    AUDIO_LOG("WAV data chunk not found");
+    return -1;
+}
+
+/* Skip ID3v2 tag and read stream parameters from the first frame header */
+static int probe_mp3(int fd, wav_s* info)
+{
+    uint8_t buf[512];
+    struct stat st;
+    uint32_t offset = 0;
+
+    if (fstat(fd, &st) != 0 || lseek(fd, 0, SEEK_SET) != 0 || read_exact(fd, buf, 10) < 0) {
+        return -1;
+    }
+
+    if (memcmp(buf, "ID3", 3) == 0) {
+        // Syncsafe tag size, plus optional footer
+        offset = 10 + (((uint32_t)buf[6] & 0x7F) << 21 | ((uint32_t)buf[7] & 0x7F) << 14 |
+                       ((uint32_t)buf[8] & 0x7F) << 7 | ((uint32_t)buf[9] & 0x7F));
+        if (buf[5] & 0x10) {
+            offset += 10;
+        }
+    }
+
+    // Defaults used when no valid frame header is found
+    info->sample_rate = 44100;
+    info->num_channels = 2;
+    info->bits_per_sample = 16;
+    info->byte_rate = 128000 / 8;
+    info->data_offset = offset;
+    info->data_size = st.st_size > offset ? (uint32_t)(st.st_size - offset) : 0;
+
+    if (lseek(fd, offset, SEEK_SET) != (off_t)offset) {
+        return -1;
+    }
+
+    ssize_t n = read(fd, buf, sizeof(buf));
+    for (ssize_t i = 0; i + 3 < n; i++) {
+        uint8_t version = (buf[i + 1] >> 3) & 0x03;   // 3 = MPEG-1, 2 = MPEG-2, 0 = MPEG-2.5
+        uint8_t layer = (buf[i + 1] >> 1) & 0x03;     // 1 = Layer III
+        uint8_t bitrate_index = buf[i + 2] >> 4;
+        uint8_t rate_index = (buf[i + 2] >> 2) & 0x03;
+
+        if (buf[i] != 0xFF || (buf[i + 1] & 0xE0) != 0xE0 || version == 1 ||
+            layer != 1 || bitrate_index == 0 || bitrate_index == 15 || rate_index == 3) {
+            continue;
+        }
+
+        info->byte_rate = mp3_bitrates[version == 3 ? 0 : 1][bitrate_index] * 1000 / 8;
+        info->sample_rate = mp3_sample_rates[rate_index] >> (version == 3 ? 0 : (version == 2 ? 1 : 2));
+        info->num_channels = (buf[i + 3] >> 6) == 3 ? 1 : 2;
+        info->data_offset = offset + (uint32_t)i;
+        info->data_size -= (uint32_t)i;
+        return 0;
+    }
+
+    AUDIO_LOG("No MP3 frame header found, assuming 128kbps");
+    return 0;
+}
+
+/* Open the stream file and parse its header, called from the decode thread */
+static int decode_open_file(audioctl_s* ctl)
+{
+    wav_s info;
+
+    ctl->fd = open(ctl->file_path, O_RDONLY);
+    if (ctl->fd < 0) {
+        AUDIO_LOG("Open failed: %s, errno: %d", ctl->file_path, errno);
+        return -1;
+    }
+
+    if (audio_ctl_probe_stream(ctl->fd, ctl->audio_format, &info) != 0) {
+        close(ctl->fd);
+        ctl->fd = -1;
+        return -1;
+    }
+
+    pthread_mutex_lock(&ctl->control_mutex);
+    ctl->wav = info;
+    pthread_mutex_unlock(&ctl->control_mutex);
+    return 0;
+}
+
+/* Allocate ring storage once per start, pinned in RAM when lock_memory is set.
+ * Adapting the size later never allocates, so the playback thread stays off the heap */
+static int ring_alloc(audio_ring_s* ring, uint32_t capacity, bool lock_memory)
+{
+    ring->data = malloc(capacity);
+    if (!ring->data) {
+        ring->capacity = 0;
+        ring->locked = false;
+        return -1;
+    }
+
+    ring->capacity = capacity;
+    ring->locked = lock_memory;
+    if (lock_memory && mlock(ring->data, capacity) != 0) {
+        AUDIO_LOG("mlock of %lu byte ring buffer failed: %s, continuing unlocked",
+                  (unsigned long)capacity, strerror(errno));
+        ring->locked = false;
+    }
+    return 0;
+}
+
+static void ring_free(audio_ring_s* ring)
+{
+    if (ring->data && ring->locked) {
+        munlock(ring->data, ring->capacity);
+    }
+    free(ring->data);
+    ring->data = NULL;
+    ring->capacity = 0;
+    ring->locked = false;
+}
+
+/* Ring buffer helpers, caller holds ring->lock */
+static int ring_resize_locked(audio_ring_s* ring, uint32_t new_size)
+{
+    // Only the fill limit moves; queued bytes above a smaller limit drain normally
+    if (new_size == 0 || new_size > ring->capacity) {
+        return -1;
+    }
+
+    ring->size = new_size;
+    return 0;
+}
+
+static uint32_t ring_write_locked(audio_ring_s* ring, const uint8_t* src, uint32_t len)
+{
+    uint32_t space = ring->size > ring->fill ? ring->size - ring->fill : 0;
+    if (len > space) {
+        len = space;
+    }
+
+    uint32_t first = ring->capacity - ring->head;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(ring->data + ring->head, src, first);
+    memcpy(ring->data, src + first, len - first);
+
+    ring->head = (ring->head + len) % ring->capacity;
+    ring->fill += len;
+    return len;
+}
+
+static uint32_t ring_read_locked(audio_ring_s* ring, uint8_t* dst, uint32_t len)
+{
+    if (len > ring->fill) {
+        len = ring->fill;
+    }
+
+    uint32_t first = ring->capacity - ring->tail;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(dst, ring->data + ring->tail, first);
+    memcpy(dst + first, ring->data, len - first);
+
+    ring->tail = (ring->tail + len) % ring->capacity;
+    ring->fill -= len;
+    ring->read_pos += len;
+    return len;
+}
+
+static void ring_flush_locked(audio_ring_s* ring, uint32_t stream_pos)
+{
+    ring->head = 0;
+    ring->tail = 0;
+    ring->fill = 0;
+    ring->read_pos = stream_pos;
+    ring->eof = false;
+    ring->epoch++;
+}
+
+/* Grow after an underrun, shrink after a stable period; caller holds ring->lock */
+static void ring_adapt_locked(audioctl_s* ctl, bool underrun)
+{
+    audio_ring_s* ring = &ctl->ring;
+    const audio_buffer_limits_s* limits = &ctl->buffer_limits;
+    uint32_t new_size;
+
+    if (underrun) {
+        new_size = ring->size * 2;
+        if (new_size > limits->max_size) {
+            new_size = limits->max_size;
+        }
+        if (new_size > ring->capacity) {
+            new_size = ring->capacity;
+        }
+    } else {
+        new_size = ring->size / 2;
+        if (new_size < limits->min_size) {
+            new_size = limits->min_size;
+        }
+    }
+
+    if (new_size == ring->size) {
+        return;
+    }
+
+    uint32_t old_size = ring->size;
+    if (ring_resize_locked(ring, new_size) == 0) {
+        AUDIO_LOG("Ring buffer resized %lu -> %lu bytes (%s, %lu underruns)",
+                  (unsigned long)old_size, (unsigned long)new_size,
+                  underrun ? "underrun" : "stable", (unsigned long)ctl->stats.underrun_count);
+    }
+}
+
+/* Account decode time of one buffer against its playback duration; caller holds ring.lock */
+static void stats_record_decode_locked(audioctl_s* ctl, uint32_t len, uint32_t elapsed_us)
+{
+    audio_ctl_stats_s* stats = &ctl->stats;
+    uint32_t deadline_us = (uint32_t)((uint64_t)len * 1000000 / ctl->wav.byte_rate);
+
+    stats->decode_count++;
+    stats->decode_time_total_us += elapsed_us;
+    if (elapsed_us > stats->decode_time_max_us) {
+        stats->decode_time_max_us = elapsed_us;
+    }
+
+    uint32_t headroom = 0;
+    if (elapsed_us >= deadline_us) {
+        stats->decode_late_count++;
+    } else if (deadline_us > 0) {
+        headroom = (deadline_us - elapsed_us) * 100 / deadline_us;
+    }
+    if (stats->decode_count == 1 || headroom < stats->decode_headroom_min_pct) {
+        stats->decode_headroom_min_pct = headroom;
+    }
+}
+
+/* Sample the ring fill level; caller holds ring.lock */
+static void stats_record_fill_locked(audioctl_s* ctl)
+{
+    audio_ctl_stats_s* stats = &ctl->stats;
+    audio_ring_s* ring = &ctl->ring;
+
+    uint32_t bucket = (uint32_t)((uint64_t)ring->fill * AUDIO_CTL_FILL_BUCKETS / ring->size);
+    if (bucket >= AUDIO_CTL_FILL_BUCKETS) {
+        bucket = AUDIO_CTL_FILL_BUCKETS - 1;
+    }
+    stats->fill_histogram[bucket]++;
+
+    uint32_t buffered_ms = (uint32_t)((uint64_t)ring->fill * 1000 / ctl->wav.byte_rate);
+    if (buffered_ms > stats->buffered_ms_max) {
+        stats->buffered_ms_max = buffered_ms;
+    }
+    if (buffered_ms > AUDIO_CTL_LATENCY_TARGET_MS) {
+        stats->latency_over_target_count++;
+    }
+}
+
+/* Log a stats summary every AUDIO_CTL_STATS_INTERVAL_MS, called from the decode thread */
+static void stats_report(audioctl_s* ctl)
+{
+    audio_ctl_stats_s stats;
+    uint64_t now = audio_ctl_clock_us();
+
+    if (now - ctl->stats_reported_us < (uint64_t)AUDIO_CTL_STATS_INTERVAL_MS * 1000) {
+        return;
+    }
+    ctl->stats_reported_us = now;
+
+    if (audio_ctl_get_stats(ctl, &stats) != 0) {
+        return;
+    }
+
+    AUDIO_LOG("Stats: decode avg %lu us max %lu us late %lu/%lu headroom min %lu%%",
+              (unsigned long)(stats.decode_count ? stats.decode_time_total_us / stats.decode_count : 0),
+              (unsigned long)stats.decode_time_max_us, (unsigned long)stats.decode_late_count,
+              (unsigned long)stats.decode_count, (unsigned long)stats.decode_headroom_min_pct);
+    AUDIO_LOG("Stats: wakeup jitter avg %lu us max %lu us | underruns %lu, flushes %lu | buffered max %lu ms (%lu over %d ms)",
+              (unsigned long)(stats.wakeup_count ? stats.wakeup_jitter_total_us / stats.wakeup_count : 0),
+              (unsigned long)stats.wakeup_jitter_max_us, (unsigned long)stats.underrun_count,
+              (unsigned long)stats.flush_count,
+              (unsigned long)stats.buffered_ms_max, (unsigned long)stats.latency_over_target_count,
+              AUDIO_CTL_LATENCY_TARGET_MS);
+    AUDIO_LOG("Stats: ring fill histogram %lu %lu %lu %lu %lu %lu %lu %lu",
+              (unsigned long)stats.fill_histogram[0], (unsigned long)stats.fill_histogram[1],
+              (unsigned long)stats.fill_histogram[2], (unsigned long)stats.fill_histogram[3],
+              (unsigned long)stats.fill_histogram[4], (unsigned long)stats.fill_histogram[5],
+              (unsigned long)stats.fill_histogram[6], (unsigned long)stats.fill_histogram[7]);
+}
+
+/* Hand one chunk to the sink, which blocks until it has been accepted */
+static void playback_output(audioctl_s* ctl, const uint8_t* data, uint32_t len, bool* resync)
+{
+    audio_sink_s* sink = ctl->sink;
+
+    uint64_t now = audio_ctl_clock_us();
+    if (ctl->first_sample_us == 0) {
+        ctl->first_sample_us = now;
+        AUDIO_LOG("First sample after %llu us (%s)",
+                  (unsigned long long)(now - ctl->start_time_us), ctl->cache_hit ? "cached" : "file");
+    }
+
+    if (!sink->opened && audio_sink_open(sink, ctl->audio_format, &ctl->wav) != 0) {
+        // Keep the clock running rather than spinning through the stream
+        AUDIO_LOG("Failed to open %s sink, falling back to null output", sink->ops->name);
+        audio_sink_s* fallback = audio_sink_create(AUDIO_SINK_NULL, NULL);
+        if (!fallback) {
+            return;
+        }
+        fallback->volume = sink->volume;
+        audio_sink_destroy(sink);
+        ctl->sink = sink = fallback;
+        if (audio_sink_open(sink, ctl->audio_format, &ctl->wav) != 0) {
+            return;
+        }
+    }
+
+    // Discontinuity after start, pause, underrun or seek
+    if (*resync) {
+        audio_sink_flush(sink);
+        *resync = false;
+    }
+
+    if (audio_sink_write(sink, data, len) != 0) {
+        AUDIO_LOG("Sink write failed: %s", strerror(errno));
+        return;
+    }
+
+    // Wakeup lateness of the audio thread
+    if (sink->wakeup_late_us >= 0) {
+        uint32_t jitter = (uint32_t)sink->wakeup_late_us;
+        pthread_mutex_lock(&ctl->ring.lock);
+        ctl->stats.wakeup_count++;
+        ctl->stats.wakeup_jitter_total_us += jitter;
+        if (jitter > ctl->stats.wakeup_jitter_max_us) {
+            ctl->stats.wakeup_jitter_max_us = jitter;
+        }
+        pthread_mutex_unlock(&ctl->ring.lock);
+    }
+}
+
+/* Decode thread - serves the prefetched start from RAM, then streams the file into the ring */
+static void* decode_thread_func(void* arg)
 {
     audioctl_s* ctl = (audioctl_s*)arg;
-    if (!ctl) {
-        AUDIO_LOG("Monitor thread: null parameter");
-        return NULL;
+    audio_ring_s* ring = &ctl->ring;
+    uint8_t buffer[AUDIO_CTL_CHUNK_SIZE];
+    pcm_cache_entry_s* cached = NULL;
+    bool opened = false;
+
+    AUDIO_LOG("Decode thread started: %s", ctl->file_path);
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PCM_CACHE
+    cached = pcm_cache_acquire(ctl->file_path);
+#endif
+
+    if (cached) {
+        pthread_mutex_lock(&ctl->control_mutex);
+        ctl->wav = cached->info;
+        ctl->cache_hit = true;
+        pthread_mutex_unlock(&ctl->control_mutex);
+    } else if (decode_open_file(ctl) == 0) {
+        opened = true;
+    } else {
+        // Nothing to play: stop as a finished track does, and say why
+        AUDIO_LOG("Playback failed: %s cannot be opened", ctl->file_path);
+        pthread_mutex_lock(&ctl->control_mutex);
+        ctl->should_stop = true;
+        ctl->failed = true;
+        ctl->is_playing = false;
+        ctl->state = AUDIO_CTL_STATE_STOP;
+        pthread_mutex_unlock(&ctl->control_mutex);
     }
-    
-    AUDIO_LOG("Monitor thread started");
-    
-    while (ctl->monitor_running) {
-        usleep(100000); // Check every 100ms
-        
+
+    pthread_mutex_lock(&ring->lock);
+    ring_flush_locked(ring, ctl->wav.data_offset);
+    ctl->file_position = ctl->wav.data_offset;
+    pthread_cond_broadcast(&ring->cond);
+    pthread_mutex_unlock(&ring->lock);
+
+    while (!ctl->should_stop) {
         pthread_mutex_lock(&ctl->control_mutex);
-        
-        if (ctl->is_playing && !ctl->is_paused) {
-            ctl->current_position_ms += 100;
-            
-            if (ctl->current_position_ms >= ctl->total_duration_ms * 1000) {
-                AUDIO_LOG("Playback completed");
-                ctl->is_playing = false;
-                ctl->state = AUDIO_CTL_STATE_STOP;
+        if (ctl->seek) {
+            uint64_t offset = (uint64_t)ctl->seek_position * ctl->wav.byte_rate / 1000;
+            uint32_t align = ctl->wav.num_channels * ctl->wav.bits_per_sample / 8;
+            if (ctl->audio_format == AUDIO_FORMAT_WAV && align > 0) {
+                offset -= offset % align;
             }
+            ctl->file_position = ctl->wav.data_offset + (uint32_t)offset;
+            ctl->seek = 0;
+
+            pthread_mutex_lock(&ring->lock);
+            ring_flush_locked(ring, ctl->file_position);
+            pthread_cond_broadcast(&ring->cond);
+            pthread_mutex_unlock(&ring->lock);
         }
-        
+        uint32_t position = ctl->file_position;
+        uint32_t data_end = ctl->wav.data_offset + ctl->wav.data_size;
         pthread_mutex_unlock(&ctl->control_mutex);
+
+        const uint8_t* data = NULL;
+        uint32_t len = 0;
+        uint64_t decode_start_us = audio_ctl_clock_us();
+
+        if (cached && position >= cached->info.data_offset &&
+            position < cached->info.data_offset + cached->size) {
+            uint32_t index = position - cached->info.data_offset;
+            data = cached->data + index;
+            len = cached->size - index;
+            if (len > AUDIO_CTL_CHUNK_SIZE) {
+                len = AUDIO_CTL_CHUNK_SIZE;
+            }
+        } else if (position < data_end) {
+            if (ctl->fd < 0) {
+                break;
+            }
+            len = data_end - position;
+            if (len > sizeof(buffer)) {
+                len = sizeof(buffer);
+            }
+            ssize_t n = -1;
+            if (lseek(ctl->fd, position, SEEK_SET) == (off_t)position) {
+                n = read(ctl->fd, buffer, len);
+            }
+            if (n <= 0) {
+                AUDIO_LOG("Read failed at %lu", (unsigned long)position);
+                break;
+            }
+            data = buffer;
+            len = (uint32_t)n;
+        }
+
+        if (len == 0) {
+            AUDIO_LOG("Decode reached end of stream");
+            break;
+        }
+
+        uint32_t decode_us = (uint32_t)(audio_ctl_clock_us() - decode_start_us);
+
+        // Queue the chunk, dropping it if a seek arrives while waiting for space
+        pthread_mutex_lock(&ring->lock);
+        stats_record_decode_locked(ctl, len, decode_us);
+        uint32_t written = 0;
+        while (written < len && !ctl->should_stop && !ctl->seek) {
+            if (ring->fill >= ring->size) {
+                pthread_cond_wait(&ring->cond, &ring->lock);
+                continue;
+            }
+            written += ring_write_locked(ring, data + written, len - written);
+            pthread_cond_broadcast(&ring->cond);
+        }
+        pthread_mutex_unlock(&ring->lock);
+
+        pthread_mutex_lock(&ctl->control_mutex);
+        if (!ctl->seek) {
+            ctl->file_position = position + written;
+        }
+        pthread_mutex_unlock(&ctl->control_mutex);
+
+        stats_report(ctl);
+
+        // Open the file while the cached start is still playing
+        if (cached && !opened) {
+            opened = true;
+            if (decode_open_file(ctl) != 0) {
+                AUDIO_LOG("Stream open failed, playing cached start only");
+            }
+        }
     }
-    
-    AUDIO_LOG("Monitor thread exited");
+
+    pthread_mutex_lock(&ring->lock);
+    ring->eof = true;
+    pthread_cond_broadcast(&ring->cond);
+    pthread_mutex_unlock(&ring->lock);
+
+    pcm_cache_release(cached);
+
+    if (ctl->fd >= 0) {
+        close(ctl->fd);
+        ctl->fd = -1;
+    }
+
+    AUDIO_LOG("Decode thread exited");
     return NULL;
 }
 
-/* Playback simulation thread */
-static void* playback_simulation_thread(void* arg)
+/* Playback thread - drains the ring at real-time rate and adapts its size */
+static void* playback_thread_func(void* arg)
 {
     audioctl_s* ctl = (audioctl_s*)arg;
-    if (!ctl) {
-        return NULL;
-    }
-    
-    AUDIO_LOG("Simulation thread started: %s", ctl->file_path);
-    
-    while (ctl->is_playing && !ctl->should_stop) {
-        usleep(1000000); // Update every second
-        
+    audio_ring_s* ring = &ctl->ring;
+    uint8_t buffer[AUDIO_CTL_CHUNK_SIZE];
+    bool resync = true;
+    uint64_t stable_since_us = audio_ctl_clock_us();
+    bool primed = false;
+    bool completed = false;
+    uint32_t seen_epoch = 0;
+
+    AUDIO_LOG("Playback thread started");
+
+    while (!ctl->should_stop) {
+        if (ctl->is_paused) {
+            usleep(10000);
+            resync = true;
+            continue;
+        }
+
+        pthread_mutex_lock(&ring->lock);
+
+        // A flush (track start or seek) empties the ring on purpose: prime again
+        // instead of taking the empty ring for an underrun
+        if (ring->epoch != seen_epoch) {
+            seen_epoch = ring->epoch;
+            primed = false;
+            ctl->stats.flush_count++;
+        }
+
+        // Wait for half a buffer before (re)starting output
+        if (!primed) {
+            if (ring->fill < ring->size / 2 && !ring->eof) {
+                struct timespec ts;
+                clock_gettime(CLOCK_MONOTONIC, &ts);
+                ts.tv_nsec += 10 * 1000000;
+                if (ts.tv_nsec >= 1000000000) {
+                    ts.tv_sec++;
+                    ts.tv_nsec -= 1000000000;
+                }
+                pthread_cond_timedwait(&ring->cond, &ring->lock, &ts);
+                pthread_mutex_unlock(&ring->lock);
+                continue;
+            }
+            primed = true;
+            resync = true;
+        }
+
+        if (ring->fill == 0) {
+            if (ring->eof) {
+                pthread_mutex_unlock(&ring->lock);
+                completed = true;
+                break;
+            }
+
+            audio_ctl_stats_s* stats = &ctl->stats;
+            stats->underrun_time_us[stats->underrun_count % AUDIO_CTL_UNDERRUN_HISTORY] = audio_ctl_clock_us();
+            stats->underrun_count++;
+            AUDIO_LOG("Underrun #%lu at %lu ms", (unsigned long)stats->underrun_count,
+                      (unsigned long)ctl->current_position_ms);
+            ring_adapt_locked(ctl, true);
+            stable_since_us = audio_ctl_clock_us();
+            primed = false;
+            pthread_mutex_unlock(&ring->lock);
+            continue;
+        }
+
+        stats_record_fill_locked(ctl);
+
+        uint32_t epoch = ring->epoch;
+        uint32_t len = ring_read_locked(ring, buffer, sizeof(buffer));
+        uint32_t read_pos = ring->read_pos;
+        pthread_cond_broadcast(&ring->cond);
+
+        uint64_t now = audio_ctl_clock_us();
+        if (now - stable_since_us >= (uint64_t)ctl->buffer_limits.stable_ms * 1000) {
+            ring_adapt_locked(ctl, false);
+            stable_since_us = now;
+        }
+
+        pthread_mutex_unlock(&ring->lock);
+
+        playback_output(ctl, buffer, len, &resync);
+
+        // Report what is audible: bytes handed to the sink minus its latency
+        uint64_t played_ms = (uint64_t)(read_pos - ctl->wav.data_offset) * 1000 / ctl->wav.byte_rate;
+        uint32_t latency_ms = audio_sink_latency_us(ctl->sink) / 1000;
+        played_ms = played_ms > latency_ms ? played_ms - latency_ms : 0;
+
         pthread_mutex_lock(&ctl->control_mutex);
-        if (ctl->is_playing && !ctl->is_paused) {
-            // Simulate audio output processing
+        if (epoch == ring->epoch && !ctl->seek) {
+            ctl->current_position_ms = (uint32_t)played_ms;
         }
         pthread_mutex_unlock(&ctl->control_mutex);
     }
-    
-    AUDIO_LOG("Simulation thread ended");
+
+    if (completed) {
+        audio_sink_drain(ctl->sink);
+    }
+    audio_sink_close(ctl->sink);
+
+    if (completed) {
+        AUDIO_LOG("Playback completed");
+        pthread_mutex_lock(&ctl->control_mutex);
+        ctl->is_playing = false;
+        ctl->state = AUDIO_CTL_STATE_STOP;
+        pthread_mutex_unlock(&ctl->control_mutex);
+    }
+
+    AUDIO_LOG("Playback thread exited");
     return NULL;
 }
 
+/* Create an engine thread with the configured scheduling, falling back to
+ * inherited attributes when the process may not use real-time policies */
+static int thread_create(audioctl_s* ctl, pthread_t* thread, void* (*func)(void*), int priority, const char* name)
+{
+    const audio_thread_config_s* config = &ctl->thread_config;
+    struct sched_param param;
+    pthread_attr_t attr;
+    int ret;
+
+    pthread_attr_init(&attr);
+    if (config->stack_size > 0) {
+        pthread_attr_setstacksize(&attr, config->stack_size);
+    }
+
+#ifdef CONFIG_SMP
+    if (config->cpu_mask != 0) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        for (int cpu = 0; cpu < CONFIG_SMP_NCPUS && cpu < 32; cpu++) {
+            if (config->cpu_mask & (1u << cpu)) {
+                CPU_SET(cpu, &cpuset);
+            }
+        }
+        if (pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset) != 0) {
+            AUDIO_LOG("%s thread: CPU mask 0x%lx rejected", name, (unsigned long)config->cpu_mask);
+        }
+    }
+#endif
+
+    if (!ctl->sched_fallback) {
+        int min = sched_get_priority_min(config->policy);
+        int max = sched_get_priority_max(config->policy);
+
+        param.sched_priority = priority < min ? min : (priority > max ? max : priority);
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, config->policy);
+        pthread_attr_setschedparam(&attr, &param);
+    }
+
+    ret = pthread_create(thread, &attr, func, ctl);
+    if (ret == EPERM && !ctl->sched_fallback) {
+        AUDIO_LOG("%s thread: no permission for policy %d priority %d, using inherited scheduling",
+                  name, config->policy, priority);
+        ctl->sched_fallback = true;
+        pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+        ret = pthread_create(thread, &attr, func, ctl);
+    }
+
+    pthread_attr_destroy(&attr);
+
+    if (ret == 0) {
+        AUDIO_LOG("%s thread created: policy %d priority %d stack %lu%s", name,
+                  ctl->sched_fallback ? -1 : config->policy,
+                  ctl->sched_fallback ? -1 : param.sched_priority,
+                  (unsigned long)config->stack_size, ctl->sched_fallback ? " (inherited)" : "");
+    }
+    return ret;
+}
+
 /* Public API Functions */
 
+/* Parse stream header for the given format */
+int audio_ctl_probe_stream(int fd, int format, wav_s *info)
+{
+    if (fd < 0 || !info) {
+        return -1;
+    }
+
+    memset(info, 0, sizeof(*info));
+
+    switch (format) {
+    case AUDIO_FORMAT_WAV:
+        return probe_wav(fd, info);
+    case AUDIO_FORMAT_MP3:
+        return probe_mp3(fd, info);
+    default:
+        return -1;
+    }
+}
+
+/* Monotonic time in microseconds */
+uint64_t audio_ctl_clock_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 /* Detect audio file format by extension */
 int audio_ctl_detect_format(const char *path)
 {
@@ -152,55 +879,111 @@ audioctl_s *audio_ctl_init_nxaudio(const char *path)
         return NULL;
     }
     
-    strncpy(ctl->file_path, path, sizeof(ctl->file_path) - 1);
-    ctl->file_path[sizeof(ctl->file_path) - 1] = '\0';
-    
-    ctl->audio_format = audio_ctl_detect_format(path);
-    if (ctl->audio_format == AUDIO_FORMAT_UNKNOWN) {
-        AUDIO_LOG("Unsupported audio format");
-        free(ctl);
-        return NULL;
+    ctl->sink = audio_sink_create(AUDIO_SINK_DEFAULT, NULL);
+    if (!ctl->sink && AUDIO_SINK_DEFAULT != AUDIO_SINK_NULL) {
+        AUDIO_LOG("Default sink unavailable, using null output");
+        ctl->sink = audio_sink_create(AUDIO_SINK_NULL, NULL);
     }
-    
-    struct stat st;
-    if (stat(path, &st) == 0) {
-        ctl->file_size = st.st_size;
-        AUDIO_LOG("File size: %lld bytes", (long long)ctl->file_size);
-        
-        if (ctl->audio_format == AUDIO_FORMAT_MP3) {
-            uint32_t duration_sec = estimate_mp3_duration(ctl->file_size);
-            ctl->total_duration_ms = duration_sec * 1000;
-            AUDIO_LOG("Estimated MP3 duration: %lu seconds", (unsigned long)duration_sec);
-        } else {
-            ctl->total_duration_ms = 240 * 1000; // Default 4 minutes
-        }
-    } else {
-        AUDIO_LOG("Cannot get file info: %s", strerror(errno));
+    if (!ctl->sink) {
+        AUDIO_LOG("Failed to create output sink");
         free(ctl);
         return NULL;
     }
     
-    ctl->nxplayer = (struct nxplayer_s*)0x12345678; // Simulator mock pointer
-    AUDIO_LOG("Created virtual NxPlayer instance: %p", ctl->nxplayer);
-    
     if (pthread_mutex_init(&ctl->control_mutex, NULL) != 0) {
         AUDIO_LOG("Failed to init mutex");
+        audio_sink_destroy(ctl->sink);
         free(ctl);
         return NULL;
     }
 
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    if (pthread_mutex_init(&ctl->ring.lock, NULL) != 0 ||
+        pthread_cond_init(&ctl->ring.cond, &cond_attr) != 0) {
+        AUDIO_LOG("Failed to init ring buffer lock");
+        pthread_condattr_destroy(&cond_attr);
+        pthread_mutex_destroy(&ctl->control_mutex);
+        audio_sink_destroy(ctl->sink);
+        free(ctl);
+        return NULL;
+    }
+    pthread_condattr_destroy(&cond_attr);
+
+    ctl->buffer_limits.min_size = AUDIO_CTL_BUFFER_MIN;
+    ctl->buffer_limits.target_size = AUDIO_CTL_BUFFER_TARGET;
+    ctl->buffer_limits.max_size = AUDIO_CTL_BUFFER_MAX;
+    ctl->buffer_limits.stable_ms = AUDIO_CTL_BUFFER_STABLE_MS;
+
+    ctl->thread_config.policy = AUDIO_CTL_THREAD_POLICY;
+    ctl->thread_config.priority = AUDIO_CTL_THREAD_PRIORITY;
+    ctl->thread_config.cpu_mask = AUDIO_CTL_THREAD_CPU_MASK;
+    ctl->thread_config.stack_size = AUDIO_CTL_THREAD_STACKSIZE;
+    ctl->thread_config.lock_memory = AUDIO_CTL_THREAD_MLOCK;
+
     // Initialize state
     ctl->state = AUDIO_CTL_STATE_STOP;
     ctl->is_playing = false;
     ctl->is_paused = false;
     ctl->should_stop = false;
     ctl->current_position_ms = 0;
-    ctl->monitor_running = 0;
+    ctl->playback_running = 0;
+    ctl->fd = -1;
+    
+    if (audio_ctl_set_source(ctl, path) != 0) {
+        audio_ctl_uninit_nxaudio(ctl);
+        return NULL;
+    }
     
     AUDIO_LOG("Audio controller initialized");
     return ctl;
 }
 
+/* Switch to another file, keeping sink, volume, ring size and statistics */
+int audio_ctl_set_source(audioctl_s *ctl, const char *path)
+{
+    if (!ctl || !path) {
+        AUDIO_LOG("Set source failed: null controller or path");
+        return -1;
+    }
+    
+    int format = audio_ctl_detect_format(path);
+    if (format == AUDIO_FORMAT_UNKNOWN) {
+        AUDIO_LOG("Unsupported audio format");
+        return -1;
+    }
+    
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        AUDIO_LOG("Cannot get file info: %s", strerror(errno));
+        return -1;
+    }
+    
+    // Threads read the path and stream fields without locking
+    audio_ctl_stop(ctl);
+    
+    pthread_mutex_lock(&ctl->control_mutex);
+    strncpy(ctl->file_path, path, sizeof(ctl->file_path) - 1);
+    ctl->file_path[sizeof(ctl->file_path) - 1] = '\0';
+    ctl->audio_format = format;
+    ctl->file_size = st.st_size;
+    AUDIO_LOG("File size: %lld bytes", (long long)ctl->file_size);
+    
+    if (format == AUDIO_FORMAT_MP3) {
+        uint32_t duration_sec = estimate_mp3_duration(ctl->file_size);
+        ctl->total_duration_ms = duration_sec * 1000;
+        AUDIO_LOG("Estimated MP3 duration: %lu seconds", (unsigned long)duration_sec);
+    } else {
+        ctl->total_duration_ms = 240 * 1000; // Default 4 minutes
+    }
+    memset(&ctl->wav, 0, sizeof(ctl->wav));
+    pthread_mutex_unlock(&ctl->control_mutex);
+    
+    AUDIO_LOG("Audio source: %s", ctl->file_path);
+    return 0;
+}
+
 /* Start audio playback */
 int audio_ctl_start(audioctl_s *ctl)
 {
@@ -209,8 +992,8 @@ int audio_ctl_start(audioctl_s *ctl)
         return -1;
     }
     
-    if (!ctl->nxplayer) {
-        AUDIO_LOG("Start failed: null NxPlayer");
+    if (!ctl->sink) {
+        AUDIO_LOG("Start failed: null sink");
         return -1;
     }
 
@@ -219,10 +1002,11 @@ int audio_ctl_start(audioctl_s *ctl)
     
     pthread_mutex_lock(&ctl->control_mutex);
     
-    if (ctl->is_playing) {
+    if (ctl->playback_running || ctl->decode_running) {
         AUDIO_LOG("Stopping current playback");
-        ctl->is_playing = false;
-        ctl->should_stop = true;
+        pthread_mutex_unlock(&ctl->control_mutex);
+        audio_ctl_stop(ctl);
+        pthread_mutex_lock(&ctl->control_mutex);
     }
     
     if (access(ctl->file_path, R_OK) != 0) {
@@ -231,37 +1015,78 @@ int audio_ctl_start(audioctl_s *ctl)
         return -1;
     }
     
-    AUDIO_LOG("File access OK, starting simulation...");
+    AUDIO_LOG("File access OK, starting playback thread...");
     
-    // Simulate successful playback
     ctl->state = AUDIO_CTL_STATE_START;
     ctl->is_playing = true;
     ctl->is_paused = false;
     ctl->should_stop = false;
+    ctl->failed = false;
+    ctl->seek = 0;
     ctl->current_position_ms = 0;
+    ctl->cache_hit = false;
+    ctl->first_sample_us = 0;
+    ctl->start_time_us = audio_ctl_clock_us();
+    ctl->stats_reported_us = ctl->start_time_us;
     
-    // Start monitoring thread
-    if (!ctl->monitor_running) {
-        ctl->monitor_running = 1;
-        if (pthread_create(&ctl->monitor_thread, NULL, monitor_thread_func, ctl) != 0) {
-            AUDIO_LOG("Failed to create monitoring thread");
-            // Continue, not a fatal error
-        } else {
-            AUDIO_LOG("Monitoring thread started");
-        }
+    // Keep the size learned from earlier underruns across tracks, target_size is only the first guess
+    pthread_mutex_lock(&ctl->ring.lock);
+    uint32_t ring_size = ctl->ring.data ? ctl->ring.size : ctl->buffer_limits.target_size;
+    if (ring_size < ctl->buffer_limits.min_size) {
+        ring_size = ctl->buffer_limits.min_size;
+    } else if (ring_size > ctl->buffer_limits.max_size) {
+        ring_size = ctl->buffer_limits.max_size;
+    }
+    // Storage for the largest size, so underruns and stable periods only move the fill limit
+    if (!ctl->ring.data || ctl->ring.capacity != ctl->buffer_limits.max_size ||
+        ctl->ring.locked != ctl->thread_config.lock_memory) {
+        ring_free(&ctl->ring);
+        ring_alloc(&ctl->ring, ctl->buffer_limits.max_size, ctl->thread_config.lock_memory);
+    }
+    ctl->ring.size = ctl->ring.data ? ring_size : 0;
+    ring_flush_locked(&ctl->ring, 0);
+    pthread_mutex_unlock(&ctl->ring.lock);
+    
+    if (!ctl->ring.data) {
+        AUDIO_LOG("Failed to allocate %lu byte ring buffer", (unsigned long)ctl->buffer_limits.max_size);
+        ctl->is_playing = false;
+        ctl->state = AUDIO_CTL_STATE_STOP;
+        pthread_mutex_unlock(&ctl->control_mutex);
+        return -1;
+    }
+    
+    ctl->decode_running = 1;
+    if (thread_create(ctl, &ctl->decode_thread, decode_thread_func,
+                      ctl->thread_config.priority - 1, "Decode") != 0) {
+        AUDIO_LOG("Failed to create decode thread");
+        ctl->decode_running = 0;
+        ctl->is_playing = false;
+        ctl->state = AUDIO_CTL_STATE_STOP;
+        pthread_mutex_unlock(&ctl->control_mutex);
+        return -1;
+    }
+    
+    ctl->playback_running = 1;
+    if (thread_create(ctl, &ctl->playback_thread, playback_thread_func,
+                      ctl->thread_config.priority, "Playback") != 0) {
+        AUDIO_LOG("Failed to create playback thread");
+        ctl->playback_running = 0;
+        pthread_mutex_unlock(&ctl->control_mutex);
+        audio_ctl_stop(ctl);
+        return -1;
     }
     
     pthread_mutex_unlock(&ctl->control_mutex);
     
-    AUDIO_LOG("Simulation playback started successfully");
+    AUDIO_LOG("Playback started successfully");
     return 0; // Success
 }
 
 // Pause playback
 int audio_ctl_pause(audioctl_s *ctl)
 {
-    if (!ctl || !ctl->nxplayer) {
-        AUDIO_LOG("Pause failed: controller or NxPlayer is null");
+    if (!ctl || !ctl->sink) {
+        AUDIO_LOG("Pause failed: controller or sink is null");
         return -1;
     }
     
@@ -286,8 +1111,8 @@ int audio_ctl_pause(audioctl_s *ctl)
 // Resume playback
 int audio_ctl_resume(audioctl_s *ctl)
 {
-    if (!ctl || !ctl->nxplayer) {
-        AUDIO_LOG("Resume playback failed: controller or NxPlayer is null");
+    if (!ctl || !ctl->sink) {
+        AUDIO_LOG("Resume playback failed: controller or sink is null");
         return -1;
     }
     
@@ -312,8 +1137,8 @@ int audio_ctl_resume(audioctl_s *ctl)
 // Stop playback
 int audio_ctl_stop(audioctl_s *ctl)
 {
-    if (!ctl || !ctl->nxplayer) {
-        AUDIO_LOG("Stop playback failed: controller or NxPlayer is null");
+    if (!ctl || !ctl->sink) {
+        AUDIO_LOG("Stop playback failed: controller or sink is null");
         return -1;
     }
     
@@ -321,18 +1146,27 @@ int audio_ctl_stop(audioctl_s *ctl)
     
     pthread_mutex_lock(&ctl->control_mutex);
     
-    // Stop monitoring thread
-    if (ctl->monitor_running) {
-        ctl->monitor_running = 0;
+    // Stop decode and playback threads
+    if (ctl->playback_running || ctl->decode_running) {
+        int decode_running = ctl->decode_running;
+        int playback_running = ctl->playback_running;
+        ctl->decode_running = 0;
+        ctl->playback_running = 0;
         ctl->should_stop = true;
         pthread_mutex_unlock(&ctl->control_mutex);
         
-        // Wait for monitoring thread to end
-        if (ctl->monitor_thread != 0) {
-            pthread_join(ctl->monitor_thread, NULL);
-            ctl->monitor_thread = 0;
-            AUDIO_LOG("Monitoring thread stopped");
+        // Wake threads blocked on the ring buffer
+        pthread_mutex_lock(&ctl->ring.lock);
+        pthread_cond_broadcast(&ctl->ring.cond);
+        pthread_mutex_unlock(&ctl->ring.lock);
+        
+        if (decode_running) {
+            pthread_join(ctl->decode_thread, NULL);
+        }
+        if (playback_running) {
+            pthread_join(ctl->playback_thread, NULL);
         }
+        AUDIO_LOG("Decode and playback threads stopped");
         
         pthread_mutex_lock(&ctl->control_mutex);
     }
@@ -350,8 +1184,8 @@ int audio_ctl_stop(audioctl_s *ctl)
 // Set volume
 int audio_ctl_set_volume(audioctl_s *ctl, uint16_t vol)
 {
-    if (!ctl || !ctl->nxplayer) {
-        AUDIO_LOG("Set volume failed: controller or NxPlayer is null");
+    if (!ctl || !ctl->sink) {
+        AUDIO_LOG("Set volume failed: controller or sink is null");
         return -1;
     }
     
@@ -360,8 +1194,8 @@ int audio_ctl_set_volume(audioctl_s *ctl, uint16_t vol)
         vol = 100;
     }
     
-    AUDIO_LOG("Set simulation volume: %d", vol);
-    return 0;
+    AUDIO_LOG("Set volume: %d", vol);
+    return audio_sink_set_volume(ctl->sink, vol);
 }
 
 // Get current playback position
@@ -392,6 +1226,13 @@ int audio_ctl_seek(audioctl_s *ctl, unsigned ms)
     
     if (ms <= ctl->total_duration_ms) {
         ctl->current_position_ms = ms;
+        ctl->seek_position = ms;
+        ctl->seek = 1;
+        
+        // Wake the decode thread if it is waiting for ring space
+        pthread_mutex_lock(&ctl->ring.lock);
+        pthread_cond_broadcast(&ctl->ring.cond);
+        pthread_mutex_unlock(&ctl->ring.lock);
         AUDIO_LOG("Simulation position update successful: %lu ms", (unsigned long)ms);
     } else {
         AUDIO_LOG("Seek position exceeds file length: %lu ms > %lu ms", (unsigned long)ms, (unsigned long)ctl->total_duration_ms);
@@ -403,6 +1244,137 @@ int audio_ctl_seek(audioctl_s *ctl, unsigned ms)
     return 0;
 }
 
+// Set output buffer limits
+int audio_ctl_set_buffer_limits(audioctl_s *ctl, const audio_buffer_limits_s *limits)
+{
+    if (!ctl || !limits || limits->min_size < AUDIO_CTL_CHUNK_SIZE ||
+        limits->min_size > limits->target_size || limits->target_size > limits->max_size) {
+        AUDIO_LOG("Invalid buffer limits");
+        return -1;
+    }
+    
+    pthread_mutex_lock(&ctl->ring.lock);
+    ctl->buffer_limits = *limits;
+    
+    // Clamp a running buffer into the new range, within what is allocated
+    if (ctl->ring.data && (ctl->ring.size < limits->min_size || ctl->ring.size > limits->max_size)) {
+        uint32_t size = ctl->ring.size < limits->min_size ? limits->min_size : limits->max_size;
+        if (size > ctl->ring.capacity) {
+            size = ctl->ring.capacity;
+        }
+        if (ring_resize_locked(&ctl->ring, size) == 0) {
+            AUDIO_LOG("Ring buffer resized to %lu bytes (limits changed)", (unsigned long)size);
+        }
+    }
+    pthread_mutex_unlock(&ctl->ring.lock);
+    
+    AUDIO_LOG("Buffer limits: min %lu, target %lu, max %lu bytes, shrink after %lu ms",
+              (unsigned long)limits->min_size, (unsigned long)limits->target_size,
+              (unsigned long)limits->max_size, (unsigned long)limits->stable_ms);
+    return 0;
+}
+
+// Replace output sink
+int audio_ctl_set_sink(audioctl_s *ctl, int type, const char *path)
+{
+    if (!ctl) {
+        return -1;
+    }
+    
+    audio_sink_s *sink = audio_sink_create(type, path);
+    if (!sink) {
+        AUDIO_LOG("Set sink failed: type %d unavailable", type);
+        return -1;
+    }
+    
+    // Threads use the sink without locking, so swap it only while stopped
+    audio_ctl_stop(ctl);
+    
+    if (ctl->sink) {
+        sink->volume = ctl->sink->volume;
+        audio_sink_destroy(ctl->sink);
+    }
+    ctl->sink = sink;
+    
+    AUDIO_LOG("Output sink: %s", sink->ops->name);
+    return 0;
+}
+
+// Set engine thread scheduling
+int audio_ctl_set_thread_config(audioctl_s *ctl, const audio_thread_config_s *config)
+{
+    if (!ctl || !config || (config->policy != SCHED_FIFO && config->policy != SCHED_RR &&
+                            config->policy != SCHED_OTHER)) {
+        AUDIO_LOG("Invalid thread config");
+        return -1;
+    }
+    
+    pthread_mutex_lock(&ctl->control_mutex);
+    ctl->thread_config = *config;
+    ctl->sched_fallback = false;  // Retry the requested policy on the next start
+    pthread_mutex_unlock(&ctl->control_mutex);
+    
+    AUDIO_LOG("Thread config: policy %d, priority %d, CPU mask 0x%lx, stack %lu, mlock %d",
+              config->policy, config->priority, (unsigned long)config->cpu_mask,
+              (unsigned long)config->stack_size, config->lock_memory);
+    return 0;
+}
+
+// Get engine statistics
+int audio_ctl_get_stats(audioctl_s *ctl, audio_ctl_stats_s *stats)
+{
+    if (!ctl || !stats) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&ctl->ring.lock);
+    *stats = ctl->stats;
+    pthread_mutex_unlock(&ctl->ring.lock);
+    return 0;
+}
+
+// Get output ring fill level
+int audio_ctl_get_ring_level(audioctl_s *ctl, uint32_t *fill, uint32_t *size)
+{
+    if (!ctl || !fill || !size) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&ctl->ring.lock);
+    *fill = ctl->ring.fill;
+    *size = ctl->ring.size;
+    pthread_mutex_unlock(&ctl->ring.lock);
+    return 0;
+}
+
+// Reset engine statistics
+void audio_ctl_reset_stats(audioctl_s *ctl)
+{
+    if (!ctl) {
+        return;
+    }
+    
+    pthread_mutex_lock(&ctl->ring.lock);
+    memset(&ctl->stats, 0, sizeof(ctl->stats));
+    pthread_mutex_unlock(&ctl->ring.lock);
+}
+
+// Get start latency
+uint64_t audio_ctl_get_start_latency_us(audioctl_s *ctl)
+{
+    if (!ctl || ctl->first_sample_us == 0) {
+        return 0;
+    }
+    
+    return ctl->first_sample_us - ctl->start_time_us;
+}
+
+// Check for a stream that could not be played
+bool audio_ctl_failed(audioctl_s *ctl)
+{
+    return ctl && ctl->failed;
+}
+
 // Release audio controller
 int audio_ctl_uninit_nxaudio(audioctl_s *ctl)
 {
@@ -415,8 +1387,14 @@ int audio_ctl_uninit_nxaudio(audioctl_s *ctl)
     // Stop playback
     audio_ctl_stop(ctl);
     
-    // No need to release real NxPlayer in simulator environment
-    ctl->nxplayer = NULL;
+    // Release output sink
+    audio_sink_destroy(ctl->sink);
+    ctl->sink = NULL;
+    
+    // Release ring buffer
+    ring_free(&ctl->ring);
+    pthread_cond_destroy(&ctl->ring.cond);
+    pthread_mutex_destroy(&ctl->ring.lock);
     
     // Destroy mutex
     pthread_mutex_destroy(&ctl->control_mutex);
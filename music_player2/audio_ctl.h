@@ -29,55 +29,187 @@ extern "C" {
 #define AUDIO_CTL_STATE_START 1
 #define AUDIO_CTL_STATE_PAUSE 2
 
+/* Bytes handed to the output per playback iteration */
+#define AUDIO_CTL_CHUNK_SIZE  2048
+
+/* Output ring buffer defaults, see audio_ctl_set_buffer_limits() */
+#ifdef CONFIG_LVX_MUSIC_PLAYER_MP3_BUFFER_SIZE
+#define AUDIO_CTL_BUFFER_TARGET    CONFIG_LVX_MUSIC_PLAYER_MP3_BUFFER_SIZE
+#else
+#define AUDIO_CTL_BUFFER_TARGET    8192
+#endif
+#define AUDIO_CTL_BUFFER_MIN       4096
+#define AUDIO_CTL_BUFFER_MAX       65536
+#define AUDIO_CTL_BUFFER_STABLE_MS 30000
+
+/* Engine thread scheduling defaults, see audio_ctl_set_thread_config() */
+#if defined(CONFIG_LVX_MUSIC_PLAYER_AUDIO_SCHED_RR)
+#define AUDIO_CTL_THREAD_POLICY    SCHED_RR
+#elif defined(CONFIG_LVX_MUSIC_PLAYER_AUDIO_SCHED_OTHER)
+#define AUDIO_CTL_THREAD_POLICY    SCHED_OTHER
+#else
+#define AUDIO_CTL_THREAD_POLICY    SCHED_FIFO
+#endif
+#ifdef CONFIG_LVX_MUSIC_PLAYER_AUDIO_PRIORITY
+#define AUDIO_CTL_THREAD_PRIORITY  CONFIG_LVX_MUSIC_PLAYER_AUDIO_PRIORITY
+#else
+#define AUDIO_CTL_THREAD_PRIORITY  110   // Above the UI task (PRIORITY = 100)
+#endif
+#ifdef CONFIG_LVX_MUSIC_PLAYER_AUDIO_CPU_MASK
+#define AUDIO_CTL_THREAD_CPU_MASK  CONFIG_LVX_MUSIC_PLAYER_AUDIO_CPU_MASK
+#else
+#define AUDIO_CTL_THREAD_CPU_MASK  0
+#endif
+#ifdef CONFIG_LVX_MUSIC_PLAYER_AUDIO_STACKSIZE
+#define AUDIO_CTL_THREAD_STACKSIZE CONFIG_LVX_MUSIC_PLAYER_AUDIO_STACKSIZE
+#else
+#define AUDIO_CTL_THREAD_STACKSIZE 8192
+#endif
+#ifdef CONFIG_LVX_MUSIC_PLAYER_AUDIO_MLOCK
+#define AUDIO_CTL_THREAD_MLOCK     true
+#else
+#define AUDIO_CTL_THREAD_MLOCK     false
+#endif
+
+/* Instrumentation */
+#define AUDIO_CTL_LATENCY_TARGET_MS   50     // Kconfig performance target
+#define AUDIO_CTL_STATS_INTERVAL_MS   10000  // Period of the AUDIO_LOG stats report
+#define AUDIO_CTL_FILL_BUCKETS        8      // Ring fill histogram resolution
+#define AUDIO_CTL_UNDERRUN_HISTORY    16     // Most recent underrun timestamps kept
+
 /*********************
  *      TYPEDEFS
  *********************/
 
-/* WAV file information structure */
+/* Stream information structure (WAV header or first MP3 frame header) */
 typedef struct {
     uint32_t sample_rate;
     uint16_t num_channels;
     uint16_t bits_per_sample;
     uint32_t data_size;
     uint32_t data_offset;
+    uint32_t byte_rate;    // Payload bytes per second of playback
 } wav_s;
 
-/* Forward declaration of NxPlayer structure */
-struct nxplayer_s;
+/* Runtime size limits of the output ring buffer */
+typedef struct {
+    uint32_t min_size;     // Floor when shrinking after stable playback
+    uint32_t target_size;  // Size allocated for the first playback, later starts keep the adapted size
+    uint32_t max_size;     // Ceiling when growing after underruns, allocated up front
+    uint32_t stable_ms;    // Underrun-free time before halving the buffer
+} audio_buffer_limits_s;
+
+/* Scheduling of the decode and playback threads */
+typedef struct {
+    int policy;          // SCHED_FIFO, SCHED_RR or SCHED_OTHER
+    int priority;        // Playback thread priority, the decode thread runs one below
+    uint32_t cpu_mask;   // Allowed CPUs (CONFIG_SMP only), 0 for no affinity
+    size_t stack_size;   // 0 keeps the system default
+    bool lock_memory;    // mlock() the ring buffer
+} audio_thread_config_s;
+
+/* Output ring buffer between the decode and playback threads */
+typedef struct {
+    uint8_t *data;
+    uint32_t capacity;     // Allocated bytes (max_size at start), indices wrap here
+    uint32_t size;         // Current fill limit in bytes, adapted within the buffer limits
+    uint32_t head;         // Write index
+    uint32_t tail;         // Read index
+    uint32_t fill;         // Queued bytes
+    uint32_t read_pos;     // Stream offset of the byte at tail
+    uint32_t epoch;        // Bumped on flush so stale reads are ignored
+    bool eof;              // Decoder reached end of stream
+    bool locked;           // data is mlock()ed
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} audio_ring_s;
+
+/* Engine timing statistics, see audio_ctl_get_stats(). They cover the
+ * controller's whole session, across audio_ctl_set_source() and restarts,
+ * and are cleared only by audio_ctl_reset_stats() */
+typedef struct {
+    // Decode time per buffer versus its playback duration (the deadline)
+    uint32_t decode_count;
+    uint32_t decode_late_count;           // Buffers that took longer to decode than to play
+    uint64_t decode_time_total_us;
+    uint32_t decode_time_max_us;
+    uint32_t decode_headroom_min_pct;     // Smallest (deadline - decode) / deadline seen
+
+    // Ring fill level sampled at every output, bucket i covers [i, i+1) / AUDIO_CTL_FILL_BUCKETS
+    uint32_t fill_histogram[AUDIO_CTL_FILL_BUCKETS];
+    uint32_t buffered_ms_max;             // Worst queued audio, i.e. output latency added by the ring
+    uint32_t latency_over_target_count;   // Outputs with more than AUDIO_CTL_LATENCY_TARGET_MS queued
+
+    // Underruns with monotonic timestamps (microseconds), newest at underrun_count - 1.
+    // Only a ring that ran dry while playing counts; flushes for a seek or a track start don't
+    uint32_t underrun_count;
+    uint64_t underrun_time_us[AUDIO_CTL_UNDERRUN_HISTORY];
+    uint32_t flush_count;                 // Ring flushes seen by the playback thread
 
-/* Audio controller structure - NxPlayer based */
+    // Playback thread wakeup lateness against its absolute deadline
+    uint32_t wakeup_count;
+    uint64_t wakeup_jitter_total_us;
+    uint32_t wakeup_jitter_max_us;
+} audio_ctl_stats_s;
+
+/* Output sink, see audio_sink.h */
+struct audio_sink;
+
+/* Audio controller structure - output goes through an audio_sink */
 typedef struct audioctl {
     // File information
     char file_path[512];
     int audio_format;
     off_t file_size;
     
-    // NxPlayer instance - Vela system audio player
-    struct nxplayer_s *nxplayer;
+    // Output sink - NxPlayer on the device, null/capture/fast sinks on a host
+    struct audio_sink *sink;
     
     // Playback state control
     volatile int state;
     volatile int is_playing;
     volatile int is_paused;
     volatile int should_stop;
+    volatile int failed;     // The stream could not be opened, playback stopped by itself
     pthread_mutex_t control_mutex;
     
     // Playback position information
     uint32_t current_position_ms;
     uint32_t total_duration_ms;
     
-    // Monitor thread
-    pthread_t monitor_thread;
-    int monitor_running;
+    // Decode thread - reads the stream into the ring buffer
+    pthread_t decode_thread;
+    int decode_running;
+    
+    // Playback thread - drains the ring buffer at real-time rate
+    pthread_t playback_thread;
+    int playback_running;
+    
+    // Thread scheduling, applied by audio_ctl_start()
+    audio_thread_config_s thread_config;
+    bool sched_fallback;     // Threads run with inherited scheduling (no privileges)
+    
+    // Adaptive output buffer
+    audio_ring_s ring;
+    audio_buffer_limits_s buffer_limits;
     
-    // WAV specific information (WAV format only)
+    // Timing statistics, protected by ring.lock
+    audio_ctl_stats_s stats;
+    uint64_t stats_reported_us;
+    
+    // Stream information, filled by audio_ctl_probe_stream()
     wav_s wav;
-    int fd;  // File descriptor for WAV format only
+    int fd;  // Track file, opened, read and closed by the decode thread
+    
+    // Start latency measurement (monotonic microseconds)
+    uint64_t start_time_us;
+    uint64_t first_sample_us;
+    bool cache_hit;
     
     // Compatibility fields
-    int seek;
-    uint32_t seek_position;
-    uint32_t file_position;
+    int seek;                // Pending seek request for the playback thread
+    uint32_t seek_position;  // Pending seek target (milliseconds)
+    uint32_t file_position;  // Stream offset of the next byte to decode
     pthread_t pid;
 } audioctl_s;
 
@@ -92,6 +224,21 @@ typedef struct audioctl {
  */
 int audio_ctl_detect_format(const char *path);
 
+/**
+ * Parse stream header and locate the audio payload
+ * @param fd Open file descriptor, positioned anywhere
+ * @param format Audio format (AUDIO_FORMAT_*)
+ * @param info Output stream information
+ * @return 0 on success, -1 on failure
+ */
+int audio_ctl_probe_stream(int fd, int format, wav_s *info);
+
+/**
+ * Get monotonic clock used for audio timing
+ * @return Current time in microseconds
+ */
+uint64_t audio_ctl_clock_us(void);
+
 /**
  * Initialize audio controller (using NxPlayer)
  * @param path Audio file path
@@ -99,6 +246,16 @@ int audio_ctl_detect_format(const char *path);
  */
 audioctl_s *audio_ctl_init_nxaudio(const char *path);
 
+/**
+ * @brief Switch the controller to another file, stopping playback first
+ * @note Sink, volume, thread config, ring buffer size and statistics are kept,
+ *       so one controller can serve a whole listening session
+ * @param ctl Audio controller pointer
+ * @param path Audio file path
+ * @return 0 on success, other values on failure (the previous file stays selected)
+ */
+int audio_ctl_set_source(audioctl_s *ctl, const char *path);
+
 /**
  * Start audio playback
  * @param ctl Audio controller pointer
@@ -150,6 +307,70 @@ int audio_ctl_get_position(audioctl_s *ctl);
  */
 int audio_ctl_seek(audioctl_s *ctl, unsigned ms);
 
+/**
+ * @brief Set runtime output buffer limits
+ * @note The ring is allocated at max_size when playback starts, a larger
+ *       max_size takes effect from the next audio_ctl_start()
+ * @param ctl Audio controller pointer
+ * @param limits New limits, min_size <= target_size <= max_size
+ * @return 0 on success, other values on failure
+ */
+int audio_ctl_set_buffer_limits(audioctl_s *ctl, const audio_buffer_limits_s *limits);
+
+/**
+ * @brief Replace the output sink, stopping playback first
+ * @param ctl Audio controller pointer
+ * @param type Sink type (AUDIO_SINK_*)
+ * @param path Capture file for AUDIO_SINK_WAV, NULL for the default
+ * @return 0 on success, other values on failure
+ */
+int audio_ctl_set_sink(audioctl_s *ctl, int type, const char *path);
+
+/**
+ * @brief Set scheduling of the engine threads, takes effect on the next audio_ctl_start()
+ * @param ctl Audio controller pointer
+ * @param config Thread configuration
+ * @return 0 on success, other values on failure
+ */
+int audio_ctl_set_thread_config(audioctl_s *ctl, const audio_thread_config_s *config);
+
+/**
+ * @brief Get a consistent copy of the engine timing statistics
+ * @param ctl Audio controller pointer
+ * @param stats Output statistics
+ * @return 0 on success, other values on failure
+ */
+int audio_ctl_get_stats(audioctl_s *ctl, audio_ctl_stats_s *stats);
+
+/**
+ * @brief Get the fill level of the output ring buffer
+ * @param ctl Audio controller pointer
+ * @param fill Queued bytes
+ * @param size Current capacity in bytes, 0 before playback starts
+ * @return 0 on success, other values on failure
+ */
+int audio_ctl_get_ring_level(audioctl_s *ctl, uint32_t *fill, uint32_t *size);
+
+/**
+ * @brief Clear the engine timing statistics
+ * @param ctl Audio controller pointer
+ */
+void audio_ctl_reset_stats(audioctl_s *ctl);
+
+/**
+ * @brief Get time from audio_ctl_start() to the first sample reaching the output
+ * @param ctl Audio controller pointer
+ * @return Latency in microseconds, 0 if no sample has been output yet
+ */
+uint64_t audio_ctl_get_start_latency_us(audioctl_s *ctl);
+
+/**
+ * @brief Whether the last audio_ctl_start() stopped because its stream could not be opened
+ * @param ctl Audio controller pointer
+ * @return true once the engine gave up, the state is then AUDIO_CTL_STATE_STOP
+ */
+bool audio_ctl_failed(audioctl_s *ctl);
+
 /**
  * @brief Release audio controller
  * @param ctl Audio controller pointer
@@ -0,0 +1,546 @@
+/**
+ * Audio Output Sink
+ * NxPlayer device output plus host sinks: real-time null output,
+ * WAV file capture and an unpaced sink for throughput benchmarks
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <syslog.h>
+#include <sys/stat.h>
+
+#ifdef CONFIG_SYSTEM_NXPLAYER
+#include <nuttx/audio/audio.h>
+#include <system/nxplayer.h>
+#endif
+
+#include "audio_sink.h"
+
+#define SINK_LOG(fmt, ...) syslog(LOG_INFO, "[SINK] " fmt, ##__VA_ARGS__)
+
+#define WAV_HEADER_SIZE 44
+
+// Functions
+static int write_all(int fd, const uint8_t *data, uint32_t len);
+static int null_open(audio_sink_s *sink);
+static int null_write(audio_sink_s *sink, const uint8_t *data, uint32_t len);
+static void null_flush(audio_sink_s *sink);
+static int null_drain(audio_sink_s *sink);
+static int fast_write(audio_sink_s *sink, const uint8_t *data, uint32_t len);
+static void wav_capture_name(const audio_sink_s *sink, char *name, size_t size);
+static int wav_open(audio_sink_s *sink);
+static int wav_write(audio_sink_s *sink, const uint8_t *data, uint32_t len);
+static void wav_close(audio_sink_s *sink);
+#ifdef CONFIG_SYSTEM_NXPLAYER
+static int nxplayer_sink_open(audio_sink_s *sink);
+static int nxplayer_sink_write(audio_sink_s *sink, const uint8_t *data, uint32_t len);
+static int nxplayer_sink_drain(audio_sink_s *sink);
+static uint32_t nxplayer_sink_latency_us(audio_sink_s *sink);
+static int nxplayer_sink_set_volume(audio_sink_s *sink, uint16_t vol);
+static void nxplayer_sink_close(audio_sink_s *sink);
+#endif
+
+// Variables
+static const audio_sink_ops_s null_ops = {
+    .name = "null",
+    .open = null_open,
+    .write = null_write,
+    .flush = null_flush,
+    .drain = null_drain,
+};
+
+static const audio_sink_ops_s fast_ops = {
+    .name = "fast",
+    .write = fast_write,
+};
+
+static const audio_sink_ops_s wav_ops = {
+    .name = "wav",
+    .open = wav_open,
+    .write = wav_write,
+    .close = wav_close,
+};
+
+#ifdef CONFIG_SYSTEM_NXPLAYER
+static const audio_sink_ops_s nxplayer_ops = {
+    .name = "nxplayer",
+    .open = nxplayer_sink_open,
+    .write = nxplayer_sink_write,
+    .drain = nxplayer_sink_drain,
+    .latency_us = nxplayer_sink_latency_us,
+    .set_volume = nxplayer_sink_set_volume,
+    .close = nxplayer_sink_close,
+};
+#endif
+
+static const char *const sink_names[] = { "nxplayer", "null", "wav", "fast" };
+
+static int write_all(int fd, const uint8_t *data, uint32_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/*********************
+ * NULL SINK
+ *********************/
+
+static int null_open(audio_sink_s *sink)
+{
+    sink->deadline_us = 0;
+    return 0;
+}
+
+/* Consume the chunk at real-time rate from the monotonic clock */
+static int null_write(audio_sink_s *sink, const uint8_t *data, uint32_t len)
+{
+    (void)data;
+
+    uint64_t now = audio_ctl_clock_us();
+
+    // Restart the clock after a gap (start, pause, underrun or seek)
+    if (sink->deadline_us == 0) {
+        sink->deadline_us = now;
+    }
+
+    sink->deadline_us += (uint64_t)len * 1000000 / sink->format.byte_rate;
+    sink->wakeup_late_us = -1;
+
+    if (sink->deadline_us > now) {
+        struct timespec ts;
+        ts.tv_sec = sink->deadline_us / 1000000;
+        ts.tv_nsec = (sink->deadline_us % 1000000) * 1000;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+        uint64_t woke = audio_ctl_clock_us();
+        sink->wakeup_late_us = woke > sink->deadline_us ? (int32_t)(woke - sink->deadline_us) : 0;
+    }
+    return 0;
+}
+
+static void null_flush(audio_sink_s *sink)
+{
+    sink->deadline_us = 0;
+}
+
+static int null_drain(audio_sink_s *sink)
+{
+    uint64_t now = audio_ctl_clock_us();
+
+    if (sink->deadline_us > now) {
+        usleep(sink->deadline_us - now);
+    }
+    return 0;
+}
+
+/*********************
+ * FAST SINK
+ *********************/
+
+static int fast_write(audio_sink_s *sink, const uint8_t *data, uint32_t len)
+{
+    (void)data;
+    (void)len;
+
+    sink->wakeup_late_us = -1;
+    return 0;
+}
+
+/*********************
+ * WAV CAPTURE SINK
+ *********************/
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = v >> 24;
+}
+
+static void wav_fill_header(uint8_t *h, const wav_s *format, uint32_t data_size)
+{
+    uint16_t block_align = format->num_channels * format->bits_per_sample / 8;
+
+    memcpy(h, "RIFF", 4);
+    put_le32(h + 4, 36 + data_size);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put_le32(h + 16, 16);
+    put_le16(h + 20, 1);  // PCM
+    put_le16(h + 22, format->num_channels);
+    put_le32(h + 24, format->sample_rate);
+    put_le32(h + 28, format->sample_rate * block_align);
+    put_le16(h + 32, block_align);
+    put_le16(h + 34, format->bits_per_sample);
+    memcpy(h + 36, "data", 4);
+    put_le32(h + 40, data_size);
+}
+
+/* Number of the current capture before the extension: capture.wav -> capture-001.wav */
+static void wav_capture_name(const audio_sink_s *sink, char *name, size_t size)
+{
+    const char *base = strrchr(sink->path, '/');
+    const char *ext = strrchr(base ? base : sink->path, '.');
+    int stem = ext ? (int)(ext - sink->path) : (int)strlen(sink->path);
+
+    snprintf(name, size, "%.*s-%03lu%s", stem, sink->path, (unsigned long)sink->captures, ext ? ext : "");
+}
+
+/* One file per stream, so a track start never overwrites the previous track.
+ * PCM streams get a WAV header, compressed streams are captured as is */
+static int wav_open(audio_sink_s *sink)
+{
+    char name[sizeof(sink->path) + 16];
+
+    sink->captures++;
+    wav_capture_name(sink, name, sizeof(name));
+    sink->fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (sink->fd < 0) {
+        SINK_LOG("Cannot create capture file %s: %s", name, strerror(errno));
+        return -1;
+    }
+
+    if (sink->audio_format == AUDIO_FORMAT_WAV) {
+        uint8_t header[WAV_HEADER_SIZE];
+        wav_fill_header(header, &sink->format, 0);
+        if (write_all(sink->fd, header, sizeof(header)) != 0) {
+            close(sink->fd);
+            sink->fd = -1;
+            return -1;
+        }
+    }
+
+    SINK_LOG("Capturing to %s", name);
+    return 0;
+}
+
+static int wav_write(audio_sink_s *sink, const uint8_t *data, uint32_t len)
+{
+    sink->wakeup_late_us = -1;
+    return write_all(sink->fd, data, len);
+}
+
+static void wav_close(audio_sink_s *sink)
+{
+    char name[sizeof(sink->path) + 16];
+
+    if (sink->fd < 0) {
+        return;
+    }
+
+    // Patch the sizes now that the length is known
+    if (sink->audio_format == AUDIO_FORMAT_WAV && lseek(sink->fd, 0, SEEK_SET) == 0) {
+        uint8_t header[WAV_HEADER_SIZE];
+        wav_fill_header(header, &sink->format, (uint32_t)sink->bytes_written);
+        write_all(sink->fd, header, sizeof(header));
+    }
+
+    close(sink->fd);
+    sink->fd = -1;
+    wav_capture_name(sink, name, sizeof(name));
+    SINK_LOG("Captured %llu bytes to %s", (unsigned long long)sink->bytes_written, name);
+}
+
+/*********************
+ * NXPLAYER SINK
+ *********************/
+
+#ifdef CONFIG_SYSTEM_NXPLAYER
+
+#ifdef CONFIG_DEV_FIFO_SIZE
+#define NXPLAYER_SINK_FIFO_BYTES CONFIG_DEV_FIFO_SIZE
+#else
+#define NXPLAYER_SINK_FIFO_BYTES 1024
+#endif
+
+#if defined(CONFIG_AUDIO_NUM_BUFFERS) && defined(CONFIG_AUDIO_BUFFER_NUMBYTES)
+#define NXPLAYER_SINK_DEVICE_BYTES (CONFIG_AUDIO_NUM_BUFFERS * CONFIG_AUDIO_BUFFER_NUMBYTES)
+#else
+#define NXPLAYER_SINK_DEVICE_BYTES 8192
+#endif
+
+/* NxPlayer reads the stream from a FIFO, so writes block at device rate */
+static int nxplayer_sink_open(audio_sink_s *sink)
+{
+    int ret;
+
+    unlink(sink->path);
+    if (mkfifo(sink->path, 0666) != 0) {
+        SINK_LOG("mkfifo %s failed: %s", sink->path, strerror(errno));
+        return -1;
+    }
+
+    // O_RDWR keeps the open from blocking until NxPlayer opens the read side
+    sink->fd = open(sink->path, O_RDWR);
+    if (sink->fd < 0) {
+        SINK_LOG("Cannot open FIFO %s: %s", sink->path, strerror(errno));
+        unlink(sink->path);
+        return -1;
+    }
+
+    if (sink->audio_format == AUDIO_FORMAT_MP3) {
+        ret = nxplayer_playfile(sink->player, sink->path, AUDIO_FMT_MP3, 0);
+    } else {
+        ret = nxplayer_playraw(sink->player, sink->path, sink->format.num_channels,
+                               sink->format.bits_per_sample, sink->format.sample_rate, 0);
+    }
+
+    if (ret != OK) {
+        SINK_LOG("NxPlayer failed to start: %d", ret);
+        close(sink->fd);
+        sink->fd = -1;
+        unlink(sink->path);
+        return -1;
+    }
+
+    nxplayer_sink_set_volume(sink, sink->volume);
+    return 0;
+}
+
+static int nxplayer_sink_write(audio_sink_s *sink, const uint8_t *data, uint32_t len)
+{
+    sink->wakeup_late_us = -1;
+    return write_all(sink->fd, data, len);
+}
+
+static int nxplayer_sink_drain(audio_sink_s *sink)
+{
+    usleep(nxplayer_sink_latency_us(sink));
+    return 0;
+}
+
+static uint32_t nxplayer_sink_latency_us(audio_sink_s *sink)
+{
+    if (sink->format.byte_rate == 0) {
+        return 0;
+    }
+    return (uint32_t)((uint64_t)(NXPLAYER_SINK_FIFO_BYTES + NXPLAYER_SINK_DEVICE_BYTES) *
+                      1000000 / sink->format.byte_rate);
+}
+
+static int nxplayer_sink_set_volume(audio_sink_s *sink, uint16_t vol)
+{
+#ifndef CONFIG_AUDIO_EXCLUDE_VOLUME
+    // NxPlayer volume is in tenths of a percent
+    return nxplayer_setvolume(sink->player, vol * 10) == OK ? 0 : -1;
+#else
+    (void)sink;
+    (void)vol;
+    return 0;
+#endif
+}
+
+static void nxplayer_sink_close(audio_sink_s *sink)
+{
+#ifndef CONFIG_AUDIO_EXCLUDE_STOP
+    nxplayer_stop(sink->player);
+#endif
+    if (sink->fd >= 0) {
+        close(sink->fd);
+        sink->fd = -1;
+    }
+    unlink(sink->path);
+}
+
+#endif /* CONFIG_SYSTEM_NXPLAYER */
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+audio_sink_s *audio_sink_create(int type, const char *path)
+{
+    const audio_sink_ops_s *ops;
+
+    switch (type) {
+#ifdef CONFIG_SYSTEM_NXPLAYER
+    case AUDIO_SINK_NXPLAYER:
+        ops = &nxplayer_ops;
+        path = AUDIO_SINK_FIFO_PATH;
+        break;
+#endif
+    case AUDIO_SINK_NULL:
+        ops = &null_ops;
+        break;
+    case AUDIO_SINK_WAV:
+        ops = &wav_ops;
+        if (!path || path[0] == '\0') {
+            path = AUDIO_SINK_CAPTURE_PATH;
+        }
+        break;
+    case AUDIO_SINK_FAST:
+        ops = &fast_ops;
+        break;
+    default:
+        SINK_LOG("Sink type %d not available", type);
+        return NULL;
+    }
+
+    audio_sink_s *sink = calloc(1, sizeof(audio_sink_s));
+    if (!sink) {
+        return NULL;
+    }
+
+    sink->ops = ops;
+    sink->type = type;
+    sink->fd = -1;
+    sink->volume = 50;
+    sink->wakeup_late_us = -1;
+    if (path) {
+        strncpy(sink->path, path, sizeof(sink->path) - 1);
+    }
+
+#ifdef CONFIG_SYSTEM_NXPLAYER
+    if (type == AUDIO_SINK_NXPLAYER) {
+        sink->player = nxplayer_create();
+        if (!sink->player) {
+            SINK_LOG("nxplayer_create failed");
+            free(sink);
+            return NULL;
+        }
+    }
+#endif
+
+    SINK_LOG("Created %s sink", ops->name);
+    return sink;
+}
+
+void audio_sink_destroy(audio_sink_s *sink)
+{
+    if (!sink) {
+        return;
+    }
+
+    audio_sink_close(sink);
+
+#ifdef CONFIG_SYSTEM_NXPLAYER
+    if (sink->player) {
+        nxplayer_release(sink->player);
+    }
+#endif
+
+    free(sink);
+}
+
+int audio_sink_type_from_name(const char *name)
+{
+    if (!name) {
+        return -1;
+    }
+
+    for (int i = 0; i < (int)(sizeof(sink_names) / sizeof(sink_names[0])); i++) {
+        if (strcasecmp(name, sink_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int audio_sink_open(audio_sink_s *sink, int audio_format, const wav_s *format)
+{
+    if (!sink || !format || format->byte_rate == 0) {
+        return -1;
+    }
+
+    if (sink->opened) {
+        audio_sink_close(sink);
+    }
+
+    sink->audio_format = audio_format;
+    sink->format = *format;
+    sink->bytes_written = 0;
+    sink->wakeup_late_us = -1;
+
+    if (sink->ops->open && sink->ops->open(sink) != 0) {
+        return -1;
+    }
+
+    sink->opened = true;
+    SINK_LOG("%s sink opened: %lu Hz, %u ch, %u bit", sink->ops->name,
+             (unsigned long)format->sample_rate, format->num_channels, format->bits_per_sample);
+    return 0;
+}
+
+int audio_sink_write(audio_sink_s *sink, const uint8_t *data, uint32_t len)
+{
+    if (!sink || !sink->opened) {
+        return -1;
+    }
+
+    if (sink->ops->write(sink, data, len) != 0) {
+        return -1;
+    }
+
+    sink->bytes_written += len;
+    return 0;
+}
+
+void audio_sink_flush(audio_sink_s *sink)
+{
+    if (sink && sink->opened && sink->ops->flush) {
+        sink->ops->flush(sink);
+    }
+}
+
+int audio_sink_drain(audio_sink_s *sink)
+{
+    if (!sink || !sink->opened) {
+        return -1;
+    }
+    return sink->ops->drain ? sink->ops->drain(sink) : 0;
+}
+
+uint32_t audio_sink_latency_us(audio_sink_s *sink)
+{
+    if (!sink || !sink->opened || !sink->ops->latency_us) {
+        return 0;
+    }
+    return sink->ops->latency_us(sink);
+}
+
+int audio_sink_set_volume(audio_sink_s *sink, uint16_t vol)
+{
+    if (!sink) {
+        return -1;
+    }
+
+    sink->volume = vol > 100 ? 100 : vol;
+    if (sink->opened && sink->ops->set_volume) {
+        return sink->ops->set_volume(sink, sink->volume);
+    }
+    return 0;
+}
+
+void audio_sink_close(audio_sink_s *sink)
+{
+    if (!sink || !sink->opened) {
+        return;
+    }
+
+    if (sink->ops->close) {
+        sink->ops->close(sink);
+    }
+    sink->opened = false;
+}
@@ -0,0 +1,177 @@
+/**
+ * Audio Output Sink Header
+ * Destination of the PCM stream produced by the audio engine, so the
+ * same pipeline runs on the device (NxPlayer) and on a plain host
+ */
+
+#ifndef AUDIO_SINK_H
+#define AUDIO_SINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "audio_ctl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Sink types */
+#define AUDIO_SINK_NXPLAYER 0   // Device output through NxPlayer
+#define AUDIO_SINK_NULL     1   // Discards data at real-time rate
+#define AUDIO_SINK_WAV      2   // Captures the stream to a file
+#define AUDIO_SINK_FAST     3   // Discards data as fast as possible
+
+/* Default sink selected by Kconfig */
+#if defined(CONFIG_LVX_MUSIC_PLAYER_SINK_NULL)
+#define AUDIO_SINK_DEFAULT AUDIO_SINK_NULL
+#elif defined(CONFIG_LVX_MUSIC_PLAYER_SINK_WAV)
+#define AUDIO_SINK_DEFAULT AUDIO_SINK_WAV
+#elif defined(CONFIG_LVX_MUSIC_PLAYER_SINK_FAST)
+#define AUDIO_SINK_DEFAULT AUDIO_SINK_FAST
+#elif defined(CONFIG_SYSTEM_NXPLAYER)
+#define AUDIO_SINK_DEFAULT AUDIO_SINK_NXPLAYER
+#else
+#define AUDIO_SINK_DEFAULT AUDIO_SINK_NULL
+#endif
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SINK_CAPTURE_PATH
+#define AUDIO_SINK_CAPTURE_PATH CONFIG_LVX_MUSIC_PLAYER_SINK_CAPTURE_PATH
+#else
+#define AUDIO_SINK_CAPTURE_PATH "/tmp/music_player_capture.wav"
+#endif
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SINK_FIFO_PATH
+#define AUDIO_SINK_FIFO_PATH CONFIG_LVX_MUSIC_PLAYER_SINK_FIFO_PATH
+#else
+#define AUDIO_SINK_FIFO_PATH "/tmp/music_player.fifo"
+#endif
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+typedef struct audio_sink audio_sink_s;
+
+/* Sink operations, write blocks until the data has been accepted */
+typedef struct {
+    const char *name;
+    int (*open)(audio_sink_s *sink);
+    int (*write)(audio_sink_s *sink, const uint8_t *data, uint32_t len);
+    void (*flush)(audio_sink_s *sink);                  // Discontinuity: pause, seek or underrun
+    int (*drain)(audio_sink_s *sink);                   // Wait until queued data has been played
+    uint32_t (*latency_us)(audio_sink_s *sink);         // Audio accepted but not yet audible
+    int (*set_volume)(audio_sink_s *sink, uint16_t vol);
+    void (*close)(audio_sink_s *sink);
+} audio_sink_ops_s;
+
+/* Output sink instance */
+struct audio_sink {
+    const audio_sink_ops_s *ops;
+    int type;
+
+    // Stream format, valid while opened
+    int audio_format;
+    wav_s format;
+    bool opened;
+    uint16_t volume;           // 0-100, applied on open
+
+    // Accounting
+    uint64_t bytes_written;
+    int32_t wakeup_late_us;    // Lateness of the last paced write, -1 if it did not wait
+
+    // Implementation state
+    char path[256];            // Capture file or NxPlayer FIFO
+    int fd;
+    uint32_t captures;         // Capture files written, each open starts the next one
+    uint64_t deadline_us;      // Real-time clock of the null sink, 0 after a flush
+    struct nxplayer_s *player;
+};
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Create an output sink
+ * @param type Sink type (AUDIO_SINK_*)
+ * @param path Capture file for AUDIO_SINK_WAV, NULL for the default; each
+ *             stream goes to its own file, numbered before the extension
+ * @return Sink pointer on success, NULL if the type is not available
+ */
+audio_sink_s *audio_sink_create(int type, const char *path);
+
+/**
+ * @brief Close and free a sink
+ * @param sink Sink pointer
+ */
+void audio_sink_destroy(audio_sink_s *sink);
+
+/**
+ * @brief Map a sink name ("nxplayer", "null", "wav", "fast") to its type
+ * @param name Sink name
+ * @return Sink type, -1 if unknown
+ */
+int audio_sink_type_from_name(const char *name);
+
+/**
+ * @brief Prepare the sink for a stream
+ * @param sink Sink pointer
+ * @param audio_format Stream format (AUDIO_FORMAT_*)
+ * @param format Stream information
+ * @return 0 on success, -1 on failure
+ */
+int audio_sink_open(audio_sink_s *sink, int audio_format, const wav_s *format);
+
+/**
+ * @brief Queue stream data, blocking while the sink is full
+ * @param sink Sink pointer
+ * @param data Stream bytes
+ * @param len Number of bytes
+ * @return 0 on success, -1 on failure
+ */
+int audio_sink_write(audio_sink_s *sink, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief Signal a discontinuity in the stream
+ * @param sink Sink pointer
+ */
+void audio_sink_flush(audio_sink_s *sink);
+
+/**
+ * @brief Wait until everything written has been played
+ * @param sink Sink pointer
+ * @return 0 on success, -1 on failure
+ */
+int audio_sink_drain(audio_sink_s *sink);
+
+/**
+ * @brief Get the output latency of the sink
+ * @param sink Sink pointer
+ * @return Latency in microseconds
+ */
+uint32_t audio_sink_latency_us(audio_sink_s *sink);
+
+/**
+ * @brief Set output volume
+ * @param sink Sink pointer
+ * @param vol Volume (0-100)
+ * @return 0 on success, -1 on failure
+ */
+int audio_sink_set_volume(audio_sink_s *sink, uint16_t vol);
+
+/**
+ * @brief Finish the current stream
+ * @param sink Sink pointer
+ */
+void audio_sink_close(audio_sink_s *sink);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* AUDIO_SINK_H */
@@ -0,0 +1,466 @@
+/**
+ * Cover Art
+ * Every layer around the cover is round, so the ring is a function of
+ * the distance to the centre: it is computed once into a radius table
+ * and painted, then each track only rewrites the square of the cover.
+ * Layers follow the widget styles they replace: ring shadow, ring
+ * background and border, cover shadow, cover and cover border.
+ * Rotation resamples the kept cover into the disc square; the inside of
+ * the disc is a plain bilinear copy, only the antialiased edge and the
+ * border (a few thousand pixels) go through the layer blending.
+ * The image is allocated with the first cover and the kept copy only
+ * exists while the disc turns, and for a moment after it stops so a
+ * track switch (stop, then play) keeps it; otherwise the cover is drawn
+ * straight from the caller's pixels.
+ * Pixels are 32-bit words 0xAARRGGBB, the lv_color32_t layout on the
+ * little-endian targets the player runs on
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "cover_art.h"
+
+#define ART_STRIDE      (COVER_ART_SIZE * 4)
+
+#define RING_SHADOW_COLOR   0x000000
+#define RING_SHADOW_OPA     0.7f
+#define RING_SHADOW_WIDTH   30.0f
+#define RING_SHADOW_SPREAD  8.0f
+#define RING_BG_COLOR       0x0F0F0F
+#define RING_BG_OPA         0.3f
+#define RING_BORDER_COLOR   0x1A1A1A
+#define RING_BORDER_WIDTH   8.0f
+#define COVER_SHADOW_COLOR  0x3B82F6
+#define COVER_SHADOW_OPA    0.3f
+#define COVER_SHADOW_WIDTH  25.0f
+#define COVER_SHADOW_SPREAD 5.0f
+#define COVER_BORDER_COLOR  0x3B82F6
+#define COVER_BORDER_OPA    0.8f
+#define COVER_BORDER_WIDTH  6.0f
+
+#define COPY_RELEASE_DELAY 1000     // ms a stopped disc keeps its cover copy
+
+#define RADIUS_STEPS    4            // Radius table entries per pixel
+#define RADIUS_ENTRIES  (COVER_ART_SIZE * 3 / 4 * RADIUS_STEPS)   // Past the half diagonal
+
+/* Pixel being layered, premultiplied */
+typedef struct {
+    float a;
+    float r;
+    float g;
+    float b;
+} layer_px_s;
+
+/* Disc pixels of one row of the cover square */
+typedef struct {
+    uint16_t x0;                     // Covered by the disc, at least partly
+    uint16_t x1;
+    uint16_t inner_x0;               // Fully covered and clear of the border
+    uint16_t inner_x1;
+} disc_row_s;
+
+// Variables
+static struct {
+    lv_image_dsc_t image;
+    uint8_t *pixels;                 // NULL until the first cover
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_ROTATION
+    uint32_t *cover;                 // Unrotated cover, alpha forced for XRGB8888 sources
+    lv_timer_t *release_timer;       // Frees the copy once the disc stayed stopped
+#endif
+    int32_t angle;                   // 0.1 degree, clockwise
+    bool spinning;                   // Compose keeps the cover copy
+    bool ready;                      // Tables built
+    uint32_t ring[RADIUS_ENTRIES];   // Ring layers by radius
+    disc_row_s rows[COVER_ART_COVER];
+} art;
+
+// Functions
+static float coverage(float r, float radius);
+static float soft_coverage(float r, float radius, float width);
+static void layer_over(layer_px_s *px, uint32_t color, float opa);
+static uint32_t layer_pack(const layer_px_s *px);
+static layer_px_s layer_unpack(uint32_t argb);
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_ROTATION
+static void copy_release_timer_cb(lv_timer_t *timer);
+#endif
+static uint32_t ring_at(float r);
+static void ring_build(void);
+static void rows_build(void);
+static int pixels_alloc(void);
+static uint32_t lerp_px(uint32_t a, uint32_t b, uint32_t f);
+static uint32_t sample(const uint32_t *src, uint32_t stride, int32_t u, int32_t v);
+static void disc_render(const uint32_t *src, uint32_t stride, uint32_t opaque);
+
+/* Antialiased coverage of a circle, pixel centre at distance r */
+static float coverage(float r, float radius)
+{
+    float c = radius + 0.5f - r;
+    return c < 0.0f ? 0.0f : c > 1.0f ? 1.0f : c;
+}
+
+/* Blurred circle edge of the given width, as a shadow */
+static float soft_coverage(float r, float radius, float width)
+{
+    float t = (r - (radius - width / 2.0f)) / width;
+    t = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+    return 1.0f - t * t * (3.0f - 2.0f * t);
+}
+
+static void layer_over(layer_px_s *px, uint32_t color, float opa)
+{
+    px->r = ((color >> 16) & 0xff) * opa + px->r * (1.0f - opa);
+    px->g = ((color >> 8) & 0xff) * opa + px->g * (1.0f - opa);
+    px->b = (color & 0xff) * opa + px->b * (1.0f - opa);
+    px->a = opa + px->a * (1.0f - opa);
+}
+
+/* Straight alpha, as LVGL expects for ARGB8888 */
+static uint32_t layer_pack(const layer_px_s *px)
+{
+    if (px->a <= 0.0f) {
+        return 0;
+    }
+
+    uint32_t a = (uint32_t)(px->a * 255.0f + 0.5f);
+    uint32_t r = (uint32_t)(px->r / px->a + 0.5f);
+    uint32_t g = (uint32_t)(px->g / px->a + 0.5f);
+    uint32_t b = (uint32_t)(px->b / px->a + 0.5f);
+    return a << 24 | (r > 255 ? 255 : r) << 16 | (g > 255 ? 255 : g) << 8 | (b > 255 ? 255 : b);
+}
+
+static layer_px_s layer_unpack(uint32_t argb)
+{
+    layer_px_s px;
+    px.a = (argb >> 24) / 255.0f;
+    px.r = ((argb >> 16) & 0xff) * px.a;
+    px.g = ((argb >> 8) & 0xff) * px.a;
+    px.b = (argb & 0xff) * px.a;
+    return px;
+}
+
+static uint32_t ring_at(float r)
+{
+    int i = (int)(r * RADIUS_STEPS + 0.5f);
+    return art.ring[i < RADIUS_ENTRIES ? i : RADIUS_ENTRIES - 1];
+}
+
+static void ring_build(void)
+{
+    const float ring = COVER_ART_RING / 2.0f;
+    const float cover = COVER_ART_COVER / 2.0f;
+
+    for (int i = 0; i < RADIUS_ENTRIES; i++) {
+        float r = (float)i / RADIUS_STEPS;
+        layer_px_s px = { 0 };
+
+        layer_over(&px, RING_SHADOW_COLOR,
+                   RING_SHADOW_OPA * soft_coverage(r, ring + RING_SHADOW_SPREAD, RING_SHADOW_WIDTH));
+        layer_over(&px, RING_BG_COLOR, RING_BG_OPA * coverage(r, ring));
+        layer_over(&px, RING_BORDER_COLOR, coverage(r, ring) * (1.0f - coverage(r, ring - RING_BORDER_WIDTH)));
+        layer_over(&px, COVER_SHADOW_COLOR,
+                   COVER_SHADOW_OPA * soft_coverage(r, cover + COVER_SHADOW_SPREAD, COVER_SHADOW_WIDTH));
+        art.ring[i] = layer_pack(&px);
+    }
+}
+
+static void rows_build(void)
+{
+    const float radius = COVER_ART_COVER / 2.0f;
+
+    for (uint32_t y = 0; y < COVER_ART_COVER; y++) {
+        disc_row_s *row = &art.rows[y];
+        float dy = y + 0.5f - radius;
+
+        // Both spans are centred, the left half is enough
+        row->x0 = row->inner_x0 = COVER_ART_COVER / 2;
+        for (uint32_t x = 0; x < COVER_ART_COVER / 2; x++) {
+            float dx = x + 0.5f - radius;
+            float r = sqrtf(dx * dx + dy * dy);
+            if (row->x0 == COVER_ART_COVER / 2 && coverage(r, radius) > 0.0f) {
+                row->x0 = x;
+            }
+            if (row->inner_x0 == COVER_ART_COVER / 2 && coverage(r, radius - COVER_BORDER_WIDTH) >= 1.0f) {
+                row->inner_x0 = x;
+            }
+        }
+        row->x1 = COVER_ART_COVER - row->x0;
+        row->inner_x1 = COVER_ART_COVER - row->inner_x0;
+    }
+}
+
+/* Allocate the image and paint the ring, the disc is drawn by the caller */
+static int pixels_alloc(void)
+{
+    uint32_t start = lv_tick_get();
+
+    art.pixels = malloc(ART_STRIDE * COVER_ART_SIZE);
+    if (!art.pixels) {
+        LV_LOG_ERROR("Cover art: out of memory");
+        return -1;
+    }
+    art.image.data = art.pixels;
+
+    const float center = COVER_ART_SIZE / 2.0f;
+    for (uint32_t y = 0; y < COVER_ART_SIZE; y++) {
+        uint32_t *dst = (uint32_t *)(art.pixels + y * ART_STRIDE);
+        float dy = y + 0.5f - center;
+        for (uint32_t x = 0; x < COVER_ART_SIZE; x++) {
+            float dx = x + 0.5f - center;
+            dst[x] = ring_at(sqrtf(dx * dx + dy * dy));
+        }
+    }
+
+    LV_LOG_INFO("Cover art ring painted in %lu ms", (unsigned long)lv_tick_elaps(start));
+    LV_UNUSED(start);
+    return 0;
+}
+
+/* Blend of two pixels, two channels per multiply; f is the weight of b, 0 to 256 */
+static uint32_t lerp_px(uint32_t a, uint32_t b, uint32_t f)
+{
+    uint32_t rb = (((a & 0xff00ff) * (256 - f) + (b & 0xff00ff) * f) >> 8) & 0xff00ff;
+    uint32_t ag = (((a >> 8) & 0xff00ff) * (256 - f) + ((b >> 8) & 0xff00ff) * f) & 0xff00ff00;
+    return rb | ag;
+}
+
+/* Bilinear cover sample, u and v in 16.16 cover pixels, pixel centres at .5; stride in pixels */
+static uint32_t sample(const uint32_t *src, uint32_t stride, int32_t u, int32_t v)
+{
+    const int32_t max = (COVER_ART_COVER - 1) << 16;
+
+    u -= 0x8000;
+    v -= 0x8000;
+    u = u < 0 ? 0 : u > max ? max : u;
+    v = v < 0 ? 0 : v > max ? max : v;
+
+    uint32_t x = u >> 16;
+    uint32_t y = v >> 16;
+    uint32_t fx = (u >> 8) & 0xff;
+    uint32_t fy = (v >> 8) & 0xff;
+    const uint32_t *p = src + y * stride + x;
+    uint32_t dx = x + 1 < COVER_ART_COVER ? 1 : 0;
+    uint32_t dy = y + 1 < COVER_ART_COVER ? stride : 0;
+
+    uint32_t top = lerp_px(p[0], p[dx], fx);
+    uint32_t bottom = lerp_px(p[dy], p[dy + dx], fx);
+    return lerp_px(top, bottom, fy);
+}
+
+/* Draw a cover at the current angle into the disc square, NULL for an empty disc */
+static void disc_render(const uint32_t *src, uint32_t stride, uint32_t opaque)
+{
+    const float radius = COVER_ART_COVER / 2.0f;
+    const int32_t centre = COVER_ART_COVER << 15;
+    float rad = art.angle * 3.14159265f / 1800.0f;
+    int32_t c = (int32_t)(cosf(rad) * 65536.0f);
+    int32_t s = (int32_t)(sinf(rad) * 65536.0f);
+
+    for (uint32_t y = 0; y < COVER_ART_COVER; y++) {
+        const disc_row_s *row = &art.rows[y];
+        uint32_t *dst = (uint32_t *)(art.pixels + (y + COVER_ART_DISC_OFFSET) * ART_STRIDE) + COVER_ART_DISC_OFFSET;
+        int32_t dy = ((int32_t)y << 16) + 0x8000 - centre;
+        int32_t dx = ((int32_t)row->x0 << 16) + 0x8000 - centre;
+
+        // Cover position of the pixel centre, turned back by the angle, then stepped along the row
+        int32_t u = (int32_t)(((int64_t)c * dx + (int64_t)s * dy) >> 16) + centre;
+        int32_t v = (int32_t)(((int64_t)c * dy - (int64_t)s * dx) >> 16) + centre;
+
+        for (uint32_t x = row->x0; x < row->x1; x++, u += c, v -= s) {
+            uint32_t px = src ? sample(src, stride, u, v) | opaque : 0;
+            uint32_t opa = px >> 24;
+
+            if (x >= row->inner_x0 && x < row->inner_x1 && opa == 0xff) {
+                dst[x] = px;
+                continue;
+            }
+
+            // Edge, border or transparent cover pixel: layered over the ring
+            float fx = x + 0.5f - radius;
+            float fy = y + 0.5f - radius;
+            float r = sqrtf(fx * fx + fy * fy);
+            float disc = coverage(r, radius);
+            layer_px_s layer = layer_unpack(ring_at(r));
+
+            if (opa > 0) {
+                layer_over(&layer, px & 0xffffff, disc * opa / 255.0f);
+            }
+            layer_over(&layer, COVER_BORDER_COLOR,
+                       COVER_BORDER_OPA * disc * (1.0f - coverage(r, radius - COVER_BORDER_WIDTH)));
+            dst[x] = layer_pack(&layer);
+        }
+    }
+
+    // Same source pointer, LVGL must not draw what it cached of the previous pixels
+    lv_image_cache_drop(&art.image);
+}
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_ROTATION
+static void copy_release_timer_cb(lv_timer_t *timer)
+{
+    lv_timer_pause(timer);
+    if (!art.spinning) {
+        free(art.cover);
+        art.cover = NULL;
+    }
+}
+#endif
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+int cover_art_init(void)
+{
+    if (art.ready) {
+        return 0;
+    }
+
+    art.image.header.magic = LV_IMAGE_HEADER_MAGIC;
+    art.image.header.cf = LV_COLOR_FORMAT_ARGB8888;
+    art.image.header.w = COVER_ART_SIZE;
+    art.image.header.h = COVER_ART_SIZE;
+    art.image.header.stride = ART_STRIDE;
+    art.image.data_size = ART_STRIDE * COVER_ART_SIZE;
+
+    ring_build();
+    rows_build();
+    art.ready = true;
+    return 0;
+}
+
+void cover_art_deinit(void)
+{
+    if (!art.ready) {
+        return;
+    }
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_ROTATION
+    if (art.release_timer) {
+        lv_timer_delete(art.release_timer);
+        art.release_timer = NULL;
+    }
+    free(art.cover);
+    art.cover = NULL;
+    art.spinning = false;
+#endif
+    if (art.pixels) {
+        lv_image_cache_drop(&art.image);
+        free(art.pixels);
+    }
+    memset(&art.image, 0, sizeof(art.image));
+    art.pixels = NULL;
+    art.angle = 0;
+    art.ready = false;
+}
+
+int cover_art_compose(const lv_image_dsc_t *cover)
+{
+    if (!art.ready) {
+        return -1;
+    }
+
+    if (cover && (cover->header.w != COVER_ART_COVER || cover->header.h != COVER_ART_COVER ||
+                  (cover->header.cf != LV_COLOR_FORMAT_XRGB8888 && cover->header.cf != LV_COLOR_FORMAT_ARGB8888))) {
+        return -1;
+    }
+
+    if (!art.pixels && pixels_alloc() != 0) {
+        return -1;
+    }
+
+    uint32_t start = lv_tick_get();
+    const uint32_t *src = cover ? (const uint32_t *)cover->data : NULL;
+    uint32_t stride = cover ? cover->header.stride / 4 : 0;
+    uint32_t opaque = cover && cover->header.cf == LV_COLOR_FORMAT_XRGB8888 ? 0xff000000 : 0;
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_ROTATION
+    // Kept for the turns; without memory the disc still shows the cover, standing still
+    if (art.spinning && !art.cover) {
+        art.cover = malloc(COVER_ART_COVER * COVER_ART_COVER * sizeof(uint32_t));
+    }
+    if (art.cover) {
+        if (!src) {
+            // Transparent, the ring shows through the border
+            memset(art.cover, 0, COVER_ART_COVER * COVER_ART_COVER * sizeof(uint32_t));
+        } else {
+            for (uint32_t y = 0; y < COVER_ART_COVER; y++) {
+                const uint32_t *line = src + y * stride;
+                uint32_t *dst = art.cover + y * COVER_ART_COVER;
+                for (uint32_t x = 0; x < COVER_ART_COVER; x++) {
+                    dst[x] = line[x] | opaque;
+                }
+            }
+        }
+        src = art.cover;
+        stride = COVER_ART_COVER;
+        opaque = 0;
+    }
+#endif
+
+    disc_render(src, stride, opaque);
+
+    LV_LOG_INFO("Cover disc composited in %lu ms", (unsigned long)lv_tick_elaps(start));
+    LV_UNUSED(start);
+    return 0;
+}
+
+int cover_art_rotate(int32_t angle)
+{
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_ROTATION
+    if (!art.pixels || !art.cover) {
+        return -1;
+    }
+
+    angle %= 3600;
+    if (angle < 0) {
+        angle += 3600;
+    }
+    if (angle == art.angle) {
+        return 0;
+    }
+
+    art.angle = angle;
+    disc_render(art.cover, COVER_ART_COVER, 0);
+    return 0;
+#else
+    LV_UNUSED(angle);
+    return -1;
+#endif
+}
+
+void cover_art_set_spinning(bool spinning)
+{
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_ROTATION
+    art.spinning = spinning;
+    if (spinning) {
+        if (art.release_timer) {
+            lv_timer_pause(art.release_timer);
+        }
+        return;
+    }
+
+    // Not freed at once: a track switch stops and restarts the disc and would composite twice
+    if (!art.cover) {
+        return;
+    }
+    if (!art.release_timer) {
+        art.release_timer = lv_timer_create(copy_release_timer_cb, COPY_RELEASE_DELAY, NULL);
+        if (!art.release_timer) {
+            free(art.cover);
+            art.cover = NULL;
+            return;
+        }
+    }
+    lv_timer_reset(art.release_timer);
+    lv_timer_resume(art.release_timer);
+#else
+    LV_UNUSED(spinning);
+#endif
+}
+
+const lv_image_dsc_t *cover_art_image(void)
+{
+    return art.pixels ? &art.image : NULL;
+}
@@ -0,0 +1,90 @@
+/**
+ * Cover Art Header
+ * The cover disc of the player page (vinyl ring, shadows, round cover
+ * and its border) rendered into one ARGB8888 image. The ring is painted
+ * once, only the cover disc is composited again on a track change or
+ * when the disc turns, and LVGL then draws a single image without masks,
+ * shadows or transforms
+ */
+
+#ifndef COVER_ART_H
+#define COVER_ART_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <lvgl.h>
+
+#include "cover_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define COVER_ART_COVER  COVER_CACHE_SIZE        // Diameter of the cover disc
+#define COVER_ART_RING   320                     // Outer diameter of the vinyl ring
+#define COVER_ART_MARGIN 24                      // Room around the ring for its shadow
+#define COVER_ART_SIZE   (COVER_ART_RING + 2 * COVER_ART_MARGIN)
+#define COVER_ART_DISC_OFFSET ((COVER_ART_SIZE - COVER_ART_COVER) / 2)   // Disc square in the image
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Prepare the ring and disc tables
+ * @note Nothing is allocated yet: the image (about 540 KB) comes with the first
+ *       cover_art_compose(), and an unrotated copy of the cover (about 310 KB)
+ *       is kept only while cover_art_set_spinning() is on
+ * @return 0
+ */
+int cover_art_init(void);
+
+/**
+ * @brief Free the image and the cover copy
+ * @note The image must no longer be shown
+ */
+void cover_art_deinit(void);
+
+/**
+ * @brief Composite a cover into the disc, once per track, at the current angle
+ * @note LVGL thread only. The cover is not referenced afterwards, it may be released.
+ *       Widgets showing the image must be invalidated
+ * @param cover COVER_ART_COVER square in XRGB8888 or ARGB8888, NULL for an empty disc
+ * @return 0 on success, -1 if not initialized, out of memory or the cover format is not supported
+ */
+int cover_art_compose(const lv_image_dsc_t *cover);
+
+/**
+ * @brief Turn the cover inside the disc, the ring stays as painted
+ * @note LVGL thread only. Only the COVER_ART_COVER square at COVER_ART_DISC_OFFSET
+ *       changes, widgets showing the image must invalidate it
+ * @param angle Clockwise, in 0.1 degree as lv_image_set_rotation()
+ * @return 0 on success, -1 without a cover copy (not spinning when the cover was
+ *         composited, or built without rotation): cover_art_compose() it again first
+ */
+int cover_art_rotate(int32_t angle);
+
+/**
+ * @brief Keep a copy of the cover for cover_art_rotate() from the next compose on
+ * @note LVGL thread only. Turning it off frees the copy after a second unless the disc
+ *       turns again first, the image keeps the cover at its current angle
+ * @param spinning Whether the disc is about to turn
+ */
+void cover_art_set_spinning(bool spinning);
+
+/**
+ * @brief Get the composited image
+ * @return Image source for lv_image, NULL before the first cover
+ */
+const lv_image_dsc_t *cover_art_image(void);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* COVER_ART_H */
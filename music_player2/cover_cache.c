@@ -0,0 +1,630 @@
+/**
+ * Cover Cache
+ * Fixed-size slots, one scaled cover each, so the byte budget is a slot
+ * count. Only the LVGL thread claims and evicts slots; the worker fills
+ * pending ones. Scaling crops the centre square and averages every
+ * source pixel into its destination pixel, one source row at a time
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <syslog.h>
+
+#include "cover_cache.h"
+
+#if LV_USE_OS == LV_OS_NONE
+#error "The cover cache worker decodes through LVGL and needs lv_lock(), set LV_USE_OS"
+#endif
+
+#define COVER_LOG(fmt, ...) syslog(LOG_INFO, "[COVERCACHE] " fmt, ##__VA_ARGS__)
+
+/* Slot states */
+#define SLOT_EMPTY   0
+#define SLOT_PENDING 1
+#define SLOT_LOADING 2
+#define SLOT_READY   3
+#define SLOT_FAILED  4
+
+/* One scaled cover */
+typedef struct {
+    char path[COVER_CACHE_PATH_MAX];
+    lv_image_dsc_t image;    // Valid when ready, its address is the LVGL image source
+    uint8_t *pixels;
+    int priority;            // Index in the last prefetch request, -1 if stale
+    int refs;                // Pins held by the UI
+    int state;
+    uint32_t last_used;      // LRU stamp
+    uint32_t generation;     // Bumped when the slot is reassigned
+} cover_slot_s;
+
+/* Box filter state for one cover, fed source rows top to bottom */
+typedef struct {
+    uint32_t side;           // Square cropped from the source
+    uint32_t ox;
+    uint32_t oy;
+    uint32_t src_y;          // Next source row
+    uint32_t dst_y;          // Destination row being accumulated
+    uint32_t x0[COVER_CACHE_SIZE];   // Source columns of each destination column
+    uint32_t x1[COVER_CACHE_SIZE];
+    uint32_t row[COVER_CACHE_SIZE][4];   // Current source row reduced to destination columns
+    uint32_t row_count[COVER_CACHE_SIZE];
+    uint32_t acc[COVER_CACHE_SIZE][4];   // Sums of the destination row, B G R A
+    uint32_t acc_count[COVER_CACHE_SIZE];
+    lv_color_format_t dst_cf;
+    uint8_t *dst;
+    uint32_t dst_stride;
+} scaler_s;
+
+// Variables
+static struct {
+    cover_slot_s slots[COVER_CACHE_SLOTS_MAX];
+    int slot_count;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t worker;
+    lv_color_format_t cf;
+    uint32_t stride;
+    uint32_t clock;          // LRU time, bumped on every use
+    bool running;
+} cache;
+
+// Functions
+static bool src_cf_supported(lv_color_format_t cf);
+static void read_pixel(const uint8_t *row, uint32_t x, lv_color_format_t cf, uint32_t px[4]);
+static void write_pixel(uint8_t *row, uint32_t x, lv_color_format_t cf, const uint32_t px[4]);
+static void scaler_init(scaler_s *scaler, uint32_t w, uint32_t h, lv_color_format_t dst_cf,
+                        uint8_t *dst, uint32_t dst_stride);
+static void scaler_push_row(scaler_s *scaler, const uint8_t *row, lv_color_format_t cf);
+static void scaler_emit_row(scaler_s *scaler);
+static uint8_t *decode_cover(const char *path, lv_color_format_t cf, uint32_t stride);
+static void image_init(lv_image_dsc_t *image, uint8_t *pixels, lv_color_format_t cf, uint32_t stride);
+static void slot_reset(cover_slot_s *slot);
+static cover_slot_s *slot_find(const char *path);
+static cover_slot_s *slot_claim(void);
+static cover_slot_s *slot_next_pending(void);
+static void slot_load(cover_slot_s *slot);
+static void *worker_thread_func(void *arg);
+
+static bool src_cf_supported(lv_color_format_t cf)
+{
+    return cf == LV_COLOR_FORMAT_RGB565 || cf == LV_COLOR_FORMAT_RGB888 ||
+           cf == LV_COLOR_FORMAT_XRGB8888 || cf == LV_COLOR_FORMAT_ARGB8888;
+}
+
+/* B G R A of a pixel, LVGL stores the blue byte first */
+static void read_pixel(const uint8_t *row, uint32_t x, lv_color_format_t cf, uint32_t px[4])
+{
+    switch (cf) {
+    case LV_COLOR_FORMAT_RGB565: {
+        uint16_t v = (uint16_t)(row[x * 2] | row[x * 2 + 1] << 8);
+        uint32_t b = v & 0x1f;
+        uint32_t g = (v >> 5) & 0x3f;
+        uint32_t r = v >> 11;
+        px[0] = (b << 3) | (b >> 2);
+        px[1] = (g << 2) | (g >> 4);
+        px[2] = (r << 3) | (r >> 2);
+        px[3] = 0xff;
+        break;
+    }
+    case LV_COLOR_FORMAT_RGB888:
+        px[0] = row[x * 3];
+        px[1] = row[x * 3 + 1];
+        px[2] = row[x * 3 + 2];
+        px[3] = 0xff;
+        break;
+    case LV_COLOR_FORMAT_ARGB8888:
+        px[0] = row[x * 4];
+        px[1] = row[x * 4 + 1];
+        px[2] = row[x * 4 + 2];
+        px[3] = row[x * 4 + 3];
+        break;
+    default:
+        px[0] = row[x * 4];
+        px[1] = row[x * 4 + 1];
+        px[2] = row[x * 4 + 2];
+        px[3] = 0xff;
+        break;
+    }
+}
+
+static void write_pixel(uint8_t *row, uint32_t x, lv_color_format_t cf, const uint32_t px[4])
+{
+    switch (cf) {
+    case LV_COLOR_FORMAT_RGB565: {
+        uint16_t v = (uint16_t)((px[2] >> 3) << 11 | (px[1] >> 2) << 5 | (px[0] >> 3));
+        row[x * 2] = v & 0xff;
+        row[x * 2 + 1] = v >> 8;
+        break;
+    }
+    case LV_COLOR_FORMAT_RGB888:
+        row[x * 3] = px[0];
+        row[x * 3 + 1] = px[1];
+        row[x * 3 + 2] = px[2];
+        break;
+    case LV_COLOR_FORMAT_ARGB8888:
+        row[x * 4] = px[0];
+        row[x * 4 + 1] = px[1];
+        row[x * 4 + 2] = px[2];
+        row[x * 4 + 3] = px[3];
+        break;
+    default:
+        row[x * 4] = px[0];
+        row[x * 4 + 1] = px[1];
+        row[x * 4 + 2] = px[2];
+        row[x * 4 + 3] = 0xff;
+        break;
+    }
+}
+
+static void scaler_init(scaler_s *scaler, uint32_t w, uint32_t h, lv_color_format_t dst_cf,
+                        uint8_t *dst, uint32_t dst_stride)
+{
+    memset(scaler, 0, sizeof(*scaler));
+    scaler->side = w < h ? w : h;
+    scaler->ox = (w - scaler->side) / 2;
+    scaler->oy = (h - scaler->side) / 2;
+    scaler->dst_cf = dst_cf;
+    scaler->dst = dst;
+    scaler->dst_stride = dst_stride;
+
+    // Downscaling splits the columns between destination pixels, upscaling repeats them
+    for (uint32_t x = 0; x < COVER_CACHE_SIZE; x++) {
+        uint32_t x0 = scaler->ox + x * scaler->side / COVER_CACHE_SIZE;
+        uint32_t x1 = scaler->ox + (x + 1) * scaler->side / COVER_CACHE_SIZE;
+        scaler->x0[x] = x0;
+        scaler->x1[x] = x1 > x0 ? x1 : x0 + 1;
+    }
+}
+
+static void scaler_push_row(scaler_s *scaler, const uint8_t *row, lv_color_format_t cf)
+{
+    uint32_t sy = scaler->src_y++;
+    bool reduced = false;
+
+    if (sy < scaler->oy) {
+        return;
+    }
+
+    while (scaler->dst_y < COVER_CACHE_SIZE) {
+        uint32_t y0 = scaler->oy + scaler->dst_y * scaler->side / COVER_CACHE_SIZE;
+        uint32_t y1 = scaler->oy + (scaler->dst_y + 1) * scaler->side / COVER_CACHE_SIZE;
+        if (y1 <= y0) {
+            y1 = y0 + 1;
+        }
+        if (sy < y0) {
+            break;
+        }
+
+        // Each source row is reduced once, even when it feeds several destination rows
+        if (!reduced) {
+            for (uint32_t x = 0; x < COVER_CACHE_SIZE; x++) {
+                uint32_t sum[4] = { 0 };
+                for (uint32_t sx = scaler->x0[x]; sx < scaler->x1[x]; sx++) {
+                    uint32_t px[4];
+                    read_pixel(row, sx, cf, px);
+                    sum[0] += px[0];
+                    sum[1] += px[1];
+                    sum[2] += px[2];
+                    sum[3] += px[3];
+                }
+                memcpy(scaler->row[x], sum, sizeof(sum));
+                scaler->row_count[x] = scaler->x1[x] - scaler->x0[x];
+            }
+            reduced = true;
+        }
+
+        for (uint32_t x = 0; x < COVER_CACHE_SIZE; x++) {
+            for (int c = 0; c < 4; c++) {
+                scaler->acc[x][c] += scaler->row[x][c];
+            }
+            scaler->acc_count[x] += scaler->row_count[x];
+        }
+
+        if (sy + 1 < y1) {
+            break;
+        }
+        scaler_emit_row(scaler);
+    }
+}
+
+static void scaler_emit_row(scaler_s *scaler)
+{
+    uint8_t *dst = scaler->dst + scaler->dst_y * scaler->dst_stride;
+
+    for (uint32_t x = 0; x < COVER_CACHE_SIZE; x++) {
+        uint32_t n = scaler->acc_count[x];
+        uint32_t px[4];
+        for (int c = 0; c < 4; c++) {
+            px[c] = (scaler->acc[x][c] + n / 2) / n;
+        }
+        write_pixel(dst, x, scaler->dst_cf, px);
+    }
+
+    memset(scaler->acc, 0, sizeof(scaler->acc));
+    memset(scaler->acc_count, 0, sizeof(scaler->acc_count));
+    scaler->dst_y++;
+}
+
+/* Decode and scale one cover, the worker calls it without the cache lock.
+ * Decoder calls run under the LVGL lock, scaling runs outside it */
+static uint8_t *decode_cover(const char *path, lv_color_format_t cf, uint32_t stride)
+{
+    lv_image_decoder_dsc_t dsc;
+    lv_image_decoder_args_t args;
+    lv_result_t res;
+
+    memset(&args, 0, sizeof(args));
+    args.no_cache = true;
+    lv_lock();
+    res = lv_image_decoder_open(&dsc, path, &args);
+    lv_unlock();
+    if (res != LV_RESULT_OK) {
+        return NULL;
+    }
+
+    uint32_t w = dsc.header.w;
+    uint32_t h = dsc.header.h;
+    uint8_t *pixels = malloc(stride * COVER_CACHE_SIZE);
+    scaler_s *scaler = malloc(sizeof(scaler_s));
+    bool ok = pixels && scaler && w > 0 && h > 0;
+
+    if (ok) {
+        scaler_init(scaler, w, h, cf, pixels, stride);
+    }
+
+    if (ok && dsc.decoded) {
+        // Whole image decoded at once (PNG, most JPEG decoders)
+        const lv_draw_buf_t *decoded = dsc.decoded;
+        ok = src_cf_supported(decoded->header.cf);
+        for (uint32_t y = 0; ok && y < h && scaler->dst_y < COVER_CACHE_SIZE; y++) {
+            scaler_push_row(scaler, decoded->data + y * decoded->header.stride, decoded->header.cf);
+        }
+    } else if (ok) {
+        // Decoded in strips, which must span the full width and come in order
+        lv_area_t full = { 0, 0, (int32_t)w - 1, (int32_t)h - 1 };
+        lv_area_t part;
+        part.y1 = LV_COORD_MIN;
+        while (ok && scaler->dst_y < COVER_CACHE_SIZE) {
+            lv_lock();
+            res = lv_image_decoder_get_area(&dsc, &full, &part);
+            lv_unlock();
+            if (res != LV_RESULT_OK) {
+                break;
+            }
+
+            const lv_draw_buf_t *decoded = dsc.decoded;
+            ok = decoded && src_cf_supported(decoded->header.cf) && part.x1 == 0 && part.x2 == (int32_t)w - 1 &&
+                 (uint32_t)part.y1 == scaler->src_y;
+            for (int32_t y = 0; ok && y <= part.y2 - part.y1; y++) {
+                scaler_push_row(scaler, decoded->data + y * decoded->header.stride, decoded->header.cf);
+            }
+        }
+    }
+
+    ok = ok && scaler->dst_y == COVER_CACHE_SIZE;
+    lv_lock();
+    lv_image_decoder_close(&dsc);
+    lv_unlock();
+    free(scaler);
+
+    if (!ok) {
+        free(pixels);
+        return NULL;
+    }
+    return pixels;
+}
+
+static void image_init(lv_image_dsc_t *image, uint8_t *pixels, lv_color_format_t cf, uint32_t stride)
+{
+    memset(image, 0, sizeof(*image));
+    image->header.magic = LV_IMAGE_HEADER_MAGIC;
+    image->header.cf = cf;
+    image->header.w = COVER_CACHE_SIZE;
+    image->header.h = COVER_CACHE_SIZE;
+    image->header.stride = stride;
+    image->data_size = stride * COVER_CACHE_SIZE;
+    image->data = pixels;
+}
+
+/* Drop a cover, LVGL thread with the lock held */
+static void slot_reset(cover_slot_s *slot)
+{
+    if (slot->pixels) {
+        // The slot address is reused as image source, LVGL must not keep what it cached for it
+        lv_image_cache_drop(&slot->image);
+        free(slot->pixels);
+    }
+    memset(&slot->image, 0, sizeof(slot->image));
+    slot->pixels = NULL;
+    slot->path[0] = '\0';
+    slot->priority = -1;
+    slot->state = SLOT_EMPTY;
+    slot->generation++;
+}
+
+static cover_slot_s *slot_find(const char *path)
+{
+    for (int i = 0; i < cache.slot_count; i++) {
+        cover_slot_s *slot = &cache.slots[i];
+        if (slot->state != SLOT_EMPTY && strcmp(slot->path, path) == 0) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+/* Empty slot first, then the least recently used one that is stale and unpinned */
+static cover_slot_s *slot_claim(void)
+{
+    cover_slot_s *lru = NULL;
+
+    for (int i = 0; i < cache.slot_count; i++) {
+        cover_slot_s *slot = &cache.slots[i];
+        if (slot->state == SLOT_EMPTY) {
+            return slot;
+        }
+        if (slot->priority < 0 && slot->refs == 0 && slot->state != SLOT_LOADING &&
+            (!lru || slot->last_used < lru->last_used)) {
+            lru = slot;
+        }
+    }
+
+    if (lru) {
+        slot_reset(lru);
+    }
+    return lru;
+}
+
+static cover_slot_s *slot_next_pending(void)
+{
+    cover_slot_s *best = NULL;
+
+    for (int i = 0; i < cache.slot_count; i++) {
+        cover_slot_s *slot = &cache.slots[i];
+        if (slot->state == SLOT_PENDING && (!best || slot->priority < best->priority)) {
+            best = slot;
+        }
+    }
+    return best;
+}
+
+/* Decode the cover of a slot, called without the lock held */
+static void slot_load(cover_slot_s *slot)
+{
+    char path[COVER_CACHE_PATH_MAX];
+    uint32_t generation;
+
+    pthread_mutex_lock(&cache.lock);
+    strcpy(path, slot->path);
+    generation = slot->generation;
+    pthread_mutex_unlock(&cache.lock);
+
+    uint8_t *pixels = decode_cover(path, cache.cf, cache.stride);
+
+    pthread_mutex_lock(&cache.lock);
+
+    if (slot->generation != generation) {
+        // Slot was reassigned while decoding
+        free(pixels);
+    } else if (!pixels) {
+        COVER_LOG("Cover decode failed: %s", path);
+        slot->state = SLOT_FAILED;
+    } else {
+        slot->pixels = pixels;
+        image_init(&slot->image, pixels, cache.cf, cache.stride);
+        slot->state = SLOT_READY;
+    }
+
+    pthread_mutex_unlock(&cache.lock);
+}
+
+/* Decode worker - services pending slots in priority order */
+static void *worker_thread_func(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&cache.lock);
+
+    while (cache.running) {
+        cover_slot_s *slot = slot_next_pending();
+        if (!slot) {
+            pthread_cond_wait(&cache.cond, &cache.lock);
+            continue;
+        }
+
+        slot->state = SLOT_LOADING;
+        pthread_mutex_unlock(&cache.lock);
+        slot_load(slot);
+        pthread_mutex_lock(&cache.lock);
+    }
+
+    pthread_mutex_unlock(&cache.lock);
+    return NULL;
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+int cover_cache_init(size_t budget_bytes, lv_color_format_t cf)
+{
+    if (cache.running) {
+        return 0;
+    }
+
+    memset(&cache, 0, sizeof(cache));
+    for (int i = 0; i < COVER_CACHE_SLOTS_MAX; i++) {
+        cache.slots[i].priority = -1;
+    }
+
+    cache.cf = src_cf_supported(cf) ? cf : LV_COLOR_FORMAT_XRGB8888;
+    cache.stride = COVER_CACHE_SIZE * lv_color_format_get_size(cache.cf);
+
+    // Every cover has the same size, the budget is a number of slots
+    size_t per_cover = (size_t)cache.stride * COVER_CACHE_SIZE;
+    size_t slots = budget_bytes / per_cover;
+    cache.slot_count = slots < 2 ? 2 : slots > COVER_CACHE_SLOTS_MAX ? COVER_CACHE_SLOTS_MAX : (int)slots;
+
+    if (pthread_mutex_init(&cache.lock, NULL) != 0) {
+        return -1;
+    }
+    if (pthread_cond_init(&cache.cond, NULL) != 0) {
+        pthread_mutex_destroy(&cache.lock);
+        return -1;
+    }
+
+    cache.running = true;
+    if (pthread_create(&cache.worker, NULL, worker_thread_func, NULL) != 0) {
+        COVER_LOG("Failed to create cover worker");
+        cache.running = false;
+        pthread_cond_destroy(&cache.cond);
+        pthread_mutex_destroy(&cache.lock);
+        return -1;
+    }
+
+    COVER_LOG("Cover cache started, %d covers of %lu bytes", cache.slot_count, (unsigned long)per_cover);
+    return 0;
+}
+
+void cover_cache_deinit(void)
+{
+    if (!cache.running) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache.lock);
+    cache.running = false;
+    pthread_cond_signal(&cache.cond);
+    pthread_mutex_unlock(&cache.lock);
+
+    pthread_join(cache.worker, NULL);
+
+    for (int i = 0; i < cache.slot_count; i++) {
+        slot_reset(&cache.slots[i]);
+    }
+
+    pthread_cond_destroy(&cache.cond);
+    pthread_mutex_destroy(&cache.lock);
+}
+
+bool cover_cache_running(void)
+{
+    return cache.running;
+}
+
+void cover_cache_prefetch(const char *const paths[], int count)
+{
+    if (!cache.running || !paths) {
+        return;
+    }
+
+    if (count > COVER_CACHE_REQUEST_MAX) {
+        count = COVER_CACHE_REQUEST_MAX;
+    }
+
+    pthread_mutex_lock(&cache.lock);
+
+    // Everything not named again becomes an eviction candidate
+    for (int i = 0; i < cache.slot_count; i++) {
+        cache.slots[i].priority = -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (!paths[i] || paths[i][0] == '\0') {
+            continue;
+        }
+
+        cover_slot_s *slot = slot_find(paths[i]);
+        if (slot) {
+            if (slot->priority < 0) {
+                slot->priority = i;
+            }
+            slot->last_used = ++cache.clock;
+            continue;
+        }
+
+        slot = slot_claim();
+        if (!slot) {
+            COVER_LOG("No free slot for %s", paths[i]);
+            continue;
+        }
+
+        snprintf(slot->path, sizeof(slot->path), "%s", paths[i]);
+        slot->priority = i;
+        slot->last_used = ++cache.clock;
+        slot->state = SLOT_PENDING;
+    }
+
+    pthread_cond_signal(&cache.cond);
+    pthread_mutex_unlock(&cache.lock);
+}
+
+int cover_cache_acquire(const char *path, const lv_image_dsc_t **image)
+{
+    int ret = -1;
+
+    if (!cache.running || !path) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&cache.lock);
+    cover_slot_s *slot = slot_find(path);
+    if (slot && slot->state == SLOT_READY) {
+        slot->refs++;
+        slot->last_used = ++cache.clock;
+        *image = &slot->image;
+        ret = 1;
+    } else if (slot && (slot->state == SLOT_PENDING || slot->state == SLOT_LOADING)) {
+        ret = 0;
+    }
+    pthread_mutex_unlock(&cache.lock);
+
+    return ret;
+}
+
+void cover_cache_release(const lv_image_dsc_t *image)
+{
+    if (!image || !cache.running) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache.lock);
+    for (int i = 0; i < cache.slot_count; i++) {
+        cover_slot_s *slot = &cache.slots[i];
+        if (&slot->image == image && slot->refs > 0) {
+            slot->refs--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache.lock);
+}
+
+int cover_cache_load(const char *path, lv_color_format_t cf, lv_image_dsc_t *image)
+{
+    if (!path || !image) {
+        return -1;
+    }
+
+    cf = src_cf_supported(cf) ? cf : LV_COLOR_FORMAT_XRGB8888;
+    uint32_t stride = COVER_CACHE_SIZE * lv_color_format_get_size(cf);
+    uint8_t *pixels = decode_cover(path, cf, stride);
+    if (!pixels) {
+        return -1;
+    }
+
+    image_init(image, pixels, cf, stride);
+    return 0;
+}
+
+void cover_cache_free(lv_image_dsc_t *image)
+{
+    if (!image || !image->data) {
+        return;
+    }
+
+    lv_image_cache_drop(image);
+    free((void *)image->data);
+    memset(image, 0, sizeof(*image));
+}
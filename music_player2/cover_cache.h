@@ -0,0 +1,101 @@
+/**
+ * Cover Cache Header
+ * Album covers decoded by a background worker and scaled to the size
+ * they are shown at, in the display color format, so a track switch
+ * only points the image widget at pixels that are already there
+ */
+
+#ifndef COVER_CACHE_H
+#define COVER_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <lvgl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define COVER_CACHE_SIZE        280  // Covers are scaled to this square, the album cover widget size
+#define COVER_CACHE_REQUEST_MAX 3    // Current, next and previous entry
+#define COVER_CACHE_SLOTS_MAX   16
+#define COVER_CACHE_PATH_MAX    256
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Start the decode worker
+ * @note Decoding goes through the LVGL image decoders off the LVGL thread, as the
+ *       threaded software renderer does; the decoders are opened without the image cache
+ * @param budget_bytes Upper bound for all scaled covers, at least two covers are kept
+ * @param cf Color format of the display, covers are converted to it
+ *           (RGB565, RGB888, XRGB8888 or ARGB8888, others fall back to XRGB8888)
+ * @return 0 on success, -1 on failure
+ */
+int cover_cache_init(size_t budget_bytes, lv_color_format_t cf);
+
+/**
+ * @brief Stop the worker and free every cover
+ * @note Covers still shown must be replaced first. Call it outside LVGL
+ *       callbacks, the worker may be waiting for lv_lock()
+ */
+void cover_cache_deinit(void);
+
+/**
+ * @brief Whether the worker is running
+ * @return true after a successful cover_cache_init()
+ */
+bool cover_cache_running(void);
+
+/**
+ * @brief Request covers to be decoded, least recently used ones make room
+ * @note LVGL thread only, evicted covers are dropped from the LVGL image cache here
+ * @param paths Cover paths ordered by priority (current, next, previous), NULL or "" skipped
+ * @param count Number of paths, at most COVER_CACHE_REQUEST_MAX
+ */
+void cover_cache_prefetch(const char *const paths[], int count);
+
+/**
+ * @brief Pin a decoded cover for display
+ * @param path Cover path, requested by cover_cache_prefetch()
+ * @param image Set to the scaled cover on success
+ * @return 1 when ready, 0 while it is being decoded, -1 if decoding failed or the path
+ *         is not in the cache
+ */
+int cover_cache_acquire(const char *path, const lv_image_dsc_t **image);
+
+/**
+ * @brief Release a cover obtained from cover_cache_acquire()
+ * @param image Scaled cover, NULL is ignored
+ */
+void cover_cache_release(const lv_image_dsc_t *image);
+
+/**
+ * @brief Decode and scale a cover on the calling thread, for images kept for the whole run
+ *        or when the worker is not running
+ * @param path Image path
+ * @param cf Color format of the result, as for cover_cache_init()
+ * @param image Filled on success, free with cover_cache_free()
+ * @return 0 on success, -1 if the image cannot be decoded
+ */
+int cover_cache_load(const char *path, lv_color_format_t cf, lv_image_dsc_t *image);
+
+/**
+ * @brief Free a cover obtained from cover_cache_load()
+ * @param image Scaled cover, emptied
+ */
+void cover_cache_free(lv_image_dsc_t *image);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* COVER_CACHE_H */
@@ -0,0 +1,96 @@
+/**
+ * Frame Timing
+ * A refresh renders only when LV_EVENT_RENDER_START comes between
+ * REFR_START and REFR_READY, so each subscriber decides whether idle
+ * refreshes count. Subscribers are called in order from REFR_READY
+ */
+
+#include <string.h>
+
+#include "frame_timing.h"
+#include "audio_ctl.h"
+
+/* One subscription */
+typedef struct {
+    frame_timing_cb_t cb;
+    void *user_data;
+} frame_timing_sub_s;
+
+// Variables
+static struct {
+    lv_display_t *disp;
+    bool rendered;                   // The current refresh drew something
+    uint64_t refresh_start_us;
+    int count;
+    frame_timing_sub_s subs[FRAME_TIMING_SUBSCRIBERS_MAX];
+} ft;
+
+// Functions
+static void display_event_cb(lv_event_t *e);
+
+static void display_event_cb(lv_event_t *e)
+{
+    switch (lv_event_get_code(e)) {
+    case LV_EVENT_REFR_START:
+        ft.refresh_start_us = audio_ctl_clock_us();
+        ft.rendered = false;
+        break;
+    case LV_EVENT_RENDER_START:
+        ft.rendered = true;
+        break;
+    case LV_EVENT_REFR_READY: {
+        uint32_t us = (uint32_t)(audio_ctl_clock_us() - ft.refresh_start_us);
+        for (int i = 0; i < ft.count; i++) {
+            ft.subs[i].cb(us, ft.rendered, ft.subs[i].user_data);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+int frame_timing_subscribe(lv_display_t *disp, frame_timing_cb_t cb, void *user_data)
+{
+    if (!disp) {
+        disp = lv_display_get_default();
+    }
+    if (!disp || !cb || ft.count >= FRAME_TIMING_SUBSCRIBERS_MAX ||
+        (ft.count > 0 && ft.disp != disp)) {
+        return -1;
+    }
+
+    if (ft.count == 0) {
+        ft.disp = disp;
+        ft.rendered = false;
+        ft.refresh_start_us = audio_ctl_clock_us();
+        lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_REFR_START, NULL);
+        lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_RENDER_START, NULL);
+        lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_REFR_READY, NULL);
+    }
+
+    ft.subs[ft.count].cb = cb;
+    ft.subs[ft.count].user_data = user_data;
+    ft.count++;
+    return 0;
+}
+
+void frame_timing_unsubscribe(frame_timing_cb_t cb, void *user_data)
+{
+    for (int i = 0; i < ft.count; i++) {
+        if (ft.subs[i].cb == cb && ft.subs[i].user_data == user_data) {
+            memmove(&ft.subs[i], &ft.subs[i + 1], (ft.count - i - 1) * sizeof(ft.subs[0]));
+            ft.count--;
+            break;
+        }
+    }
+
+    if (ft.count == 0 && ft.disp) {
+        lv_display_remove_event_cb_with_user_data(ft.disp, display_event_cb, NULL);
+        ft.disp = NULL;
+    }
+}
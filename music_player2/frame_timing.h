@@ -0,0 +1,66 @@
+/**
+ * Frame Timing Header
+ * One set of display event handlers times every refresh, from
+ * LV_EVENT_REFR_START to LV_EVENT_REFR_READY, and hands the result to
+ * the modules that measure frames: the performance monitor, the render
+ * profile governor, the UI profiler and the benchmark
+ */
+
+#ifndef FRAME_TIMING_H
+#define FRAME_TIMING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <lvgl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define FRAME_TIMING_SUBSCRIBERS_MAX  4
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**
+ * Called at LV_EVENT_REFR_READY of every refresh
+ * @param us Refresh time, audio_ctl_clock_us() from REFR_START to REFR_READY
+ * @param rendered The refresh drew something (LV_EVENT_RENDER_START came); idle
+ *                 refreshes are not frames and would hide slow ones in an average
+ * @param user_data As given to frame_timing_subscribe()
+ */
+typedef void (*frame_timing_cb_t)(uint32_t us, bool rendered, void *user_data);
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Get the time of every refresh of a display
+ * @note LVGL thread only. The first subscriber installs the display event
+ *       handlers, all subscribers must use the same display
+ * @param disp Display to time, NULL for the default display
+ * @param cb Callback, called in subscription order
+ * @param user_data Passed to the callback, with cb it identifies the subscription
+ * @return 0 on success, -1 when full, on another display or without a display
+ */
+int frame_timing_subscribe(lv_display_t *disp, frame_timing_cb_t cb, void *user_data);
+
+/**
+ * @brief Stop a subscription, the last one removes the display event handlers
+ * @param cb Callback given to frame_timing_subscribe()
+ * @param user_data User data given to frame_timing_subscribe()
+ */
+void frame_timing_unsubscribe(frame_timing_cb_t cb, void *user_data);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* FRAME_TIMING_H */
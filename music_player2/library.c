@@ -0,0 +1,416 @@
+/**
+ * Music Library
+ * Snapshots are swapped under a mutex that also guards the reference
+ * counts; the lock is never held while a library is loaded, saved or
+ * freed. Reloads and index saves run on one background worker
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <lvgl.h>
+
+#include "library.h"
+#include "library_index.h"
+#include "track_order.h"
+#include "manifest_parser.h"
+
+/* Manifest sink state */
+typedef struct {
+    track_store_s *tracks;
+    uint32_t total;
+} manifest_load_s;
+
+// Variables
+static struct {
+    library_config_s config;
+    char manifest_path[TRACK_ROOT_MAX + 16];
+
+    pthread_mutex_t lock;
+    library_snapshot_s *current;
+    uint32_t last_version;
+
+    // Background worker, guarded by lock
+    bool worker_running;
+    bool reload_requested;
+    bool save_requested;
+} library = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+// Functions
+static bool track_store_add_entry(const manifest_entry_s *entry, void *user_data);
+static bool load_from_manifest(track_store_s *tracks);
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_SCAN
+static bool track_store_add_scanned(const library_scan_track_s *track, void *user_data);
+static bool load_from_scan(track_store_s *tracks);
+#endif
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_INDEX
+static void save_current(void);
+#endif
+static int worker_start_locked(void);
+static void *worker_thread_func(void *arg);
+
+/* Streaming manifest sink: append each entry to the track store as it is parsed */
+static bool track_store_add_entry(const manifest_entry_s *entry, void *user_data)
+{
+    manifest_load_s *load = user_data;
+    load->total++;
+
+    // Safety check
+    if (!(entry->fields & MANIFEST_FIELD_PATH) || !(entry->fields & MANIFEST_FIELD_NAME)) {
+        // Album missing necessary information
+        return true;
+    }
+
+    track_info_s info = {
+        .path = entry->path,
+        .name = entry->name,
+        .artist = (entry->fields & MANIFEST_FIELD_ARTIST) ? entry->artist : "Unknown Artist",
+        .album = entry->album,
+        .cover = entry->cover,
+        .duration_ms = entry->total_time >= 1 ? (uint32_t)entry->total_time : 1,
+    };
+
+    if (entry->fields & MANIFEST_FIELD_COLOR) {
+        info.color = strtoul(entry->color[0] == '#' ? entry->color + 1 : entry->color, NULL, 16);
+    }
+
+    // Stop on allocation failure, keeping what was loaded
+    return track_store_add(load->tracks, &info) != TRACK_ID_INVALID;
+}
+
+static bool load_from_manifest(track_store_s *tracks)
+{
+    /* Load music config - streamed in fixed-size chunks, no JSON tree */
+    manifest_load_s load = { tracks, 0 };
+    bool complete = manifest_parse_file(library.manifest_path, track_store_add_entry, &load) >= 0;
+    if (!complete) {
+        // Keep the entries read before the error
+        LV_LOG_WARN("Music manifest incomplete, %lu tracks loaded", (unsigned long)tracks->count);
+    }
+
+    LV_LOG_USER("Found %lu albums in JSON, loaded %lu", (unsigned long)load.total, (unsigned long)tracks->count);
+    return complete;
+}
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_SCAN
+static bool track_store_add_scanned(const library_scan_track_s *track, void *user_data)
+{
+    track_info_s info;
+    library_track_info(track, &info);
+
+    // Stop on allocation failure, keeping what was loaded
+    return track_store_add(user_data, &info) != TRACK_ID_INVALID;
+}
+
+/* Build the library from the files themselves when there is no manifest */
+static bool load_from_scan(track_store_s *tracks)
+{
+    library_scan_config_s config = {
+        .root = library.config.root,
+        .workers = CONFIG_LVX_MUSIC_PLAYER_LIBRARY_SCAN_WORKERS,
+        .formats = LIBRARY_FORMATS,
+    };
+
+    int found = library_scan_run(&config, track_store_add_scanned, tracks);
+    LV_LOG_USER("Scanned %d files, loaded %lu", found, (unsigned long)tracks->count);
+    return found >= 0 && (uint32_t)found == tracks->count;
+}
+#endif
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_INDEX
+/* Write the current snapshot to the index, called on the worker */
+static void save_current(void)
+{
+    library_snapshot_s *snapshot = library_acquire();
+    if (!snapshot) {
+        return;
+    }
+
+    library_index_source_s source;
+    if (library_index_stat_source(&source, library.manifest_path, library.config.root) == 0) {
+        library_index_save(&snapshot->tracks, library.config.index_path, &source);
+    }
+    library_release(snapshot);
+}
+#endif
+
+/* Start the worker unless it is running, caller holds library.lock */
+static int worker_start_locked(void)
+{
+    if (library.worker_running) {
+        return 0;
+    }
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, LIBRARY_RELOAD_STACKSIZE);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int ret = pthread_create(&thread, &attr, worker_thread_func, NULL);
+    pthread_attr_destroy(&attr);
+
+    if (ret != 0) {
+        LV_LOG_ERROR("Cannot start library worker: %d", ret);
+        return -1;
+    }
+    library.worker_running = true;
+    return 0;
+}
+
+static void *worker_thread_func(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&library.lock);
+    while (library.reload_requested || library.save_requested) {
+        bool reload = library.reload_requested;
+        bool save = library.save_requested;
+        library.reload_requested = false;
+        library.save_requested = false;
+        pthread_mutex_unlock(&library.lock);
+
+        if (reload) {
+            library_snapshot_s *snapshot = library_load();
+            if (snapshot) {
+                library_publish(snapshot, LIBRARY_VERSION_ANY);
+            }
+        }
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_INDEX
+        if (save) {
+            save_current();
+        }
+#endif
+        LV_UNUSED(save);
+
+        pthread_mutex_lock(&library.lock);
+    }
+    library.worker_running = false;
+    pthread_mutex_unlock(&library.lock);
+    return NULL;
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+void library_init(const library_config_s *config)
+{
+    library.config = *config;
+    snprintf(library.manifest_path, sizeof(library.manifest_path), "%s/manifest.json", config->root);
+}
+
+library_snapshot_s *library_snapshot_create(void)
+{
+    library_snapshot_s *snapshot = malloc(sizeof(library_snapshot_s));
+    if (!snapshot) {
+        return NULL;
+    }
+
+    if (track_store_init(&snapshot->tracks, library.config.root) != 0) {
+        free(snapshot);
+        return NULL;
+    }
+    snapshot->version = 0;
+    snapshot->refs = 1;
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SEARCH
+    memset(&snapshot->search, 0, sizeof(snapshot->search));
+    snapshot->search_ready = false;
+#endif
+    return snapshot;
+}
+
+library_snapshot_s *library_snapshot_copy(const library_snapshot_s *snapshot)
+{
+    library_snapshot_s *copy = malloc(sizeof(library_snapshot_s));
+    if (!copy) {
+        return NULL;
+    }
+
+    if (track_store_copy(&copy->tracks, &snapshot->tracks) != 0) {
+        free(copy);
+        return NULL;
+    }
+    copy->version = 0;
+    copy->refs = 1;
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SEARCH
+    memset(&copy->search, 0, sizeof(copy->search));
+    copy->search_ready = false;
+#endif
+    return copy;
+}
+
+library_snapshot_s *library_load(void)
+{
+    uint32_t start = lv_tick_get();
+    LV_LOG_USER("Starting to reload music configuration...");
+
+    library_snapshot_s *snapshot = library_snapshot_create();
+    if (!snapshot) {
+        return NULL;
+    }
+    track_store_s *tracks = &snapshot->tracks;
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_INDEX
+    /* Use the prebuilt index in place while the sources are unchanged */
+    library_index_source_s source;
+    bool have_source = library_index_stat_source(&source, library.manifest_path, library.config.root) == 0;
+    if (have_source && library_index_load(tracks, library.config.index_path, &source) == 0) {
+        LV_LOG_USER("Library ready from index: %lu tracks in %lu ms",
+                    (unsigned long)tracks->count, (unsigned long)lv_tick_elaps(start));
+        return snapshot;
+    }
+#endif
+
+    /* A hand-written manifest takes precedence over scanning */
+    bool complete;
+    const char *origin = "manifest";
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_SCAN
+    if (access(library.manifest_path, F_OK) != 0) {
+        origin = "scan";
+        complete = load_from_scan(tracks);
+    } else
+#endif
+    {
+        complete = load_from_manifest(tracks);
+    }
+    track_store_shrink(tracks);
+
+    // Sorted once here and saved with the index, browsing only walks the orders
+    track_order_build(tracks);
+
+    LV_LOG_USER("Library ready from %s: %lu tracks in %lu ms (%lu bytes, %lu strings)",
+                origin, (unsigned long)tracks->count, (unsigned long)lv_tick_elaps(start),
+                (unsigned long)track_store_memory(tracks), (unsigned long)tracks->intern_count);
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_INDEX
+    /* A partial library is not worth caching, the next start retries */
+    if (have_source && complete) {
+        library_index_save(tracks, library.config.index_path, &source);
+    }
+#endif
+    LV_UNUSED(start);
+    LV_UNUSED(origin);
+    LV_UNUSED(complete);
+    return snapshot;
+}
+
+int library_reload_async(void)
+{
+    pthread_mutex_lock(&library.lock);
+    library.reload_requested = true;
+    int ret = worker_start_locked();
+    if (ret != 0) {
+        library.reload_requested = false;
+    }
+    pthread_mutex_unlock(&library.lock);
+    return ret;
+}
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_INDEX
+int library_save_async(void)
+{
+    pthread_mutex_lock(&library.lock);
+    library.save_requested = true;
+    int ret = worker_start_locked();
+    if (ret != 0) {
+        library.save_requested = false;
+    }
+    pthread_mutex_unlock(&library.lock);
+    return ret;
+}
+#endif
+
+int library_publish(library_snapshot_s *snapshot, uint32_t base_version)
+{
+    pthread_mutex_lock(&library.lock);
+    library_snapshot_s *old = library.current;
+    if (base_version != LIBRARY_VERSION_ANY && old && old->version != base_version) {
+        // Derived from a version that has been replaced meanwhile
+        pthread_mutex_unlock(&library.lock);
+        library_release(snapshot);
+        return -1;
+    }
+
+    snapshot->version = ++library.last_version;
+    library.current = snapshot;
+    pthread_mutex_unlock(&library.lock);
+
+    // Readers still holding the old version keep it alive
+    library_release(old);
+    return 0;
+}
+
+library_snapshot_s *library_acquire(void)
+{
+    pthread_mutex_lock(&library.lock);
+    library_snapshot_s *snapshot = library.current;
+    if (snapshot) {
+        snapshot->refs++;
+    }
+    pthread_mutex_unlock(&library.lock);
+    return snapshot;
+}
+
+void library_release(library_snapshot_s *snapshot)
+{
+    if (!snapshot) {
+        return;
+    }
+
+    pthread_mutex_lock(&library.lock);
+    bool last = --snapshot->refs == 0;
+    pthread_mutex_unlock(&library.lock);
+
+    if (last) {
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SEARCH
+        track_search_deinit(&snapshot->search);
+#endif
+        track_store_deinit(&snapshot->tracks);
+        free(snapshot);
+    }
+}
+
+uint32_t library_version(void)
+{
+    pthread_mutex_lock(&library.lock);
+    uint32_t version = library.current ? library.current->version : 0;
+    pthread_mutex_unlock(&library.lock);
+    return version;
+}
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SEARCH
+int library_search(library_snapshot_s *snapshot, const char *query, track_id_t *results, int max)
+{
+    if (!snapshot->search_ready) {
+        uint32_t start = lv_tick_get();
+        if (track_search_build(&snapshot->search, &snapshot->tracks) != 0) {
+            LV_LOG_ERROR("No memory to index %lu tracks for search", (unsigned long)snapshot->tracks.count);
+            return -1;
+        }
+        snapshot->search_ready = true;
+
+        LV_LOG_USER("Search index of %lu tracks built in %lu ms (%lu bytes)",
+                    (unsigned long)snapshot->tracks.count, (unsigned long)lv_tick_elaps(start),
+                    (unsigned long)track_search_memory(&snapshot->search));
+        LV_UNUSED(start);
+    }
+
+    return track_search_query(&snapshot->search, query, results, max);
+}
+#endif
+
+void library_track_info(const library_scan_track_s *track, track_info_s *info)
+{
+    *info = (track_info_s) {
+        .path = track->path,
+        .name = track->title,
+        .artist = track->artist[0] ? track->artist : "Unknown Artist",
+        .album = track->album,
+        .cover = track->cover,
+        .duration_ms = track->duration_ms > 0 ? track->duration_ms : 1,
+    };
+}
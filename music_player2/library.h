@@ -0,0 +1,157 @@
+/**
+ * Music Library Header
+ * The library as immutable, reference counted snapshots: readers pin the
+ * version they use, a reload builds the next one on a background thread
+ * and publishes it with a single pointer swap
+ */
+
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "track_store.h"
+#include "track_search.h"
+#include "library_scan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define LIBRARY_VERSION_ANY       0      // library_publish() without a version check
+#define LIBRARY_RELOAD_STACKSIZE  8192
+
+/* Formats listed by scans and the watcher */
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_SCAN_ALL_FORMATS
+#define LIBRARY_FORMATS           LIBRARY_SCAN_FORMATS_ALL
+#else
+#define LIBRARY_FORMATS           LIBRARY_SCAN_FORMATS_PLAYABLE
+#endif
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+typedef struct {
+    const char *root;            // Music directory (POSIX path), kept by reference
+    const char *index_path;      // Binary index file, kept by reference
+} library_config_s;
+
+/*
+ * One version of the library. Once published the tracks are never modified;
+ * the path table behind track_store_find() and the search index are built
+ * lazily, so lookups in a published snapshot are left to the UI thread
+ */
+typedef struct {
+    track_store_s tracks;
+    uint32_t version;            // Publish order, 0 until published
+    uint32_t refs;               // Guarded by the library lock
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SEARCH
+    track_search_s search;       // Built by the first library_search()
+    bool search_ready;
+#endif
+} library_snapshot_s;
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Set the library sources, call before anything else
+ * @param config Library paths
+ */
+void library_init(const library_config_s *config);
+
+/**
+ * @brief Create an empty, unpublished snapshot
+ * @return Snapshot holding one reference, NULL on allocation failure
+ */
+library_snapshot_s *library_snapshot_create(void);
+
+/**
+ * @brief Create an unpublished, writable copy of a snapshot
+ * @param snapshot Snapshot to copy, only read
+ * @return Snapshot holding one reference, NULL on allocation failure
+ */
+library_snapshot_s *library_snapshot_copy(const library_snapshot_s *snapshot);
+
+/**
+ * @brief Build a snapshot from the index, the manifest or a directory scan
+ * @note Blocks for the duration of the load, safe on any thread
+ * @return Unpublished snapshot holding one reference, NULL on failure
+ */
+library_snapshot_s *library_load(void);
+
+/**
+ * @brief Load and publish a new snapshot on a background thread
+ * @note A request made during a reload runs once the current one is done
+ * @return 0 if the reload was started or queued, -1 on failure
+ */
+int library_reload_async(void);
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_INDEX
+/**
+ * @brief Write the current snapshot to the index on the background worker
+ * @note Requests made while the worker is busy are merged into one save after it
+ * @return 0 if the save was started or queued, -1 on failure
+ */
+int library_save_async(void);
+#endif
+
+/**
+ * @brief Make a snapshot the current library
+ * @param snapshot Snapshot, the caller's reference passes to the library
+ * @param base_version Version the snapshot was derived from, LIBRARY_VERSION_ANY to replace unconditionally
+ * @return 0 on success, -1 if the current version is no longer base_version (the snapshot is released)
+ */
+int library_publish(library_snapshot_s *snapshot, uint32_t base_version);
+
+/**
+ * @brief Pin the current snapshot
+ * @return Snapshot with one more reference, NULL before the first publish
+ */
+library_snapshot_s *library_acquire(void);
+
+/**
+ * @brief Drop a reference, the last one frees the snapshot
+ * @param snapshot Snapshot, may be NULL
+ */
+void library_release(library_snapshot_s *snapshot);
+
+/**
+ * @brief Get the version of the current snapshot, cheap enough to poll
+ * @return Current version, 0 before the first publish
+ */
+uint32_t library_version(void);
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SEARCH
+/**
+ * @brief Find the tracks of a snapshot matching a query, see track_search_query()
+ * @note The first search of a snapshot builds its index
+ * @param snapshot Snapshot
+ * @param query UTF-8 text typed by the user
+ * @param results Output track ids, best first
+ * @param max Size of results
+ * @return Number of results, -1 if the index cannot be built
+ */
+int library_search(library_snapshot_s *snapshot, const char *query, track_id_t *results, int max);
+#endif
+
+/**
+ * @brief Convert a scanned file to track store input
+ * @param track Scanned file
+ * @param info Output, points into track
+ */
+void library_track_info(const library_scan_track_s *track, track_info_s *info);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* LIBRARY_H */
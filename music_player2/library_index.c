@@ -0,0 +1,492 @@
+/**
+ * Library Index
+ * The file is mmap'ed read-only and the track store points straight into
+ * it; filesystems without mmap support fall back to a single read.
+ * Writers are serialized: saves share the temporary file, and a header
+ * refresh must not land on a file a save has just renamed into place
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <pthread.h>
+#include <lvgl.h>
+
+#include "library_index.h"
+#include "library_scan.h"
+
+#define LIBRARY_INDEX_IO_CHUNK 4096
+
+/* One loaded index, owned by the store it is attached to */
+typedef struct {
+    void *addr;
+    size_t size;
+    bool mapped;         // true for mmap, false for a heap copy
+} index_mapping_s;
+
+// Variables
+static pthread_mutex_t write_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Functions
+static int checksum_file(const char *path, uint32_t *checksum);
+static int source_checksum(library_index_source_s *source);
+static uint32_t entry_hash(const char *rel, int64_t mtime, int64_t size);
+static uint32_t tree_hash(const char *root, const char *rel, int depth);
+static bool header_valid(const library_index_header_s *header, size_t file_size, const track_store_s *store);
+static bool columns_valid(const index_mapping_s *mapping, const library_index_header_s *header,
+                          uint32_t *const columns[], track_id_t *const orders[]);
+static index_mapping_s *map_file(int fd, size_t size);
+static void unmap_file(void *owner);
+static int write_all(int fd, const void *data, size_t len);
+static void refresh_header(const char *index_path, const library_index_header_s *loaded,
+                           const library_index_header_s *header);
+
+/* FNV-1a over the whole file, returns 0 on success */
+static int checksum_file(const char *path, uint32_t *checksum)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    uint8_t *buf = malloc(LIBRARY_INDEX_IO_CHUNK);
+    if (!buf) {
+        close(fd);
+        return -1;
+    }
+
+    uint32_t hash = 2166136261u;
+    ssize_t n;
+    while ((n = read(fd, buf, LIBRARY_INDEX_IO_CHUNK)) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            hash ^= buf[i];
+            hash *= 16777619u;
+        }
+    }
+
+    free(buf);
+    close(fd);
+    if (n < 0) {
+        return -1;
+    }
+
+    *checksum = hash;
+    return 0;
+}
+
+static int source_checksum(library_index_source_s *source)
+{
+    if (!source->checksum_valid) {
+        if (checksum_file(source->manifest_path, &source->manifest_checksum) != 0) {
+            return -1;
+        }
+        source->checksum_valid = true;
+    }
+    return 0;
+}
+
+/* FNV-1a of a path and its stat fields */
+static uint32_t entry_hash(const char *rel, int64_t mtime, int64_t size)
+{
+    uint32_t hash = 2166136261u;
+    while (*rel) {
+        hash ^= (uint8_t)*rel++;
+        hash *= 16777619u;
+    }
+    for (int i = 0; i < 8; i++) {
+        hash ^= (uint8_t)(mtime >> (i * 8));
+        hash *= 16777619u;
+        hash ^= (uint8_t)(size >> (i * 8));
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Sum of the entry hashes below rel, independent of the readdir order */
+static uint32_t tree_hash(const char *root, const char *rel, int depth)
+{
+    char full[LIBRARY_SCAN_PATH_MAX * 2];
+    char path[LIBRARY_SCAN_PATH_MAX];
+    struct dirent *ent;
+    struct stat st;
+    uint32_t hash = 0;
+
+    if (depth >= LIBRARY_SCAN_DEPTH_MAX) {
+        return 0;
+    }
+
+    snprintf(full, sizeof(full), "%s%s%s", root, rel[0] ? "/" : "", rel);
+    DIR *dir = opendir(full);
+    if (!dir) {
+        return 0;
+    }
+
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.' ||
+            snprintf(path, sizeof(path), "%s%s%s", rel, rel[0] ? "/" : "", ent->d_name) >= (int)sizeof(path)) {
+            continue;
+        }
+        snprintf(full, sizeof(full), "%s/%s", root, path);
+        if (stat(full, &st) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            // The directory mtime covers entries added, removed or renamed in it
+            hash += entry_hash(path, st.st_mtime, 0) + tree_hash(root, path, depth + 1);
+        } else {
+            // Edits in place only show up on the file itself
+            hash += entry_hash(path, st.st_mtime, st.st_size);
+        }
+    }
+    closedir(dir);
+    return hash;
+}
+
+static bool header_valid(const library_index_header_s *header, size_t file_size, const track_store_s *store)
+{
+    if (file_size < sizeof(*header) || memcmp(header->magic, LIBRARY_INDEX_MAGIC, 4) != 0) {
+        return false;
+    }
+
+    if (header->version != LIBRARY_INDEX_VERSION || header->byte_order != LIBRARY_INDEX_BYTE_ORDER ||
+        header->header_size != sizeof(*header)) {
+        LV_LOG_USER("Library index format changed");
+        return false;
+    }
+
+    if (strncmp(header->root, store->root, sizeof(header->root)) != 0) {
+        LV_LOG_USER("Library index built for another root: %.*s", (int)sizeof(header->root), header->root);
+        return false;
+    }
+
+    uint64_t columns_end = header->columns_offset +
+                           (uint64_t)header->track_count * TRACK_STORE_COLUMNS * sizeof(uint32_t);
+    uint64_t orders_end = header->orders_offset +
+                          (uint64_t)header->track_count * TRACK_ORDER_COUNT * sizeof(track_id_t);
+    uint64_t arena_end = (uint64_t)header->arena_offset + header->arena_size;
+
+    if (header->orders_offset != 0 && (header->orders_offset % 4 != 0 || header->orders_offset < columns_end ||
+                                       orders_end > header->arena_offset)) {
+        return false;
+    }
+
+    return header->columns_offset % 8 == 0 && header->columns_offset >= sizeof(*header) &&
+           columns_end <= header->arena_offset && arena_end <= file_size && header->arena_size > 0;
+}
+
+/* Every string column entry must land inside the table, which must end in NUL, every order entry on a track */
+static bool columns_valid(const index_mapping_s *mapping, const library_index_header_s *header,
+                          uint32_t *const columns[], track_id_t *const orders[])
+{
+    const char *arena = (const char *)mapping->addr + header->arena_offset;
+    if (arena[0] != '\0' || arena[header->arena_size - 1] != '\0') {
+        return false;
+    }
+
+    // path, name, artist, album and cover hold arena offsets
+    for (int c = 0; c < 5; c++) {
+        for (uint32_t id = 0; id < header->track_count; id++) {
+            if (columns[c][id] >= header->arena_size) {
+                return false;
+            }
+        }
+    }
+
+    for (int i = 0; orders && i < TRACK_ORDER_COUNT; i++) {
+        for (uint32_t pos = 0; pos < header->track_count; pos++) {
+            if (orders[i][pos] >= header->track_count) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static index_mapping_s *map_file(int fd, size_t size)
+{
+    index_mapping_s *mapping = malloc(sizeof(index_mapping_s));
+    if (!mapping) {
+        return NULL;
+    }
+    mapping->size = size;
+
+    void *addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+        mapping->addr = addr;
+        mapping->mapped = true;
+        return mapping;
+    }
+
+    // No mmap on this filesystem, one read is still far cheaper than parsing JSON
+    LV_LOG_INFO("Library index mmap failed (%d), reading it", errno);
+    uint8_t *buf = malloc(size);
+    if (!buf) {
+        free(mapping);
+        return NULL;
+    }
+
+    size_t done = 0;
+    while (done < size) {
+        ssize_t n = read(fd, buf + done, size - done);
+        if (n <= 0) {
+            free(buf);
+            free(mapping);
+            return NULL;
+        }
+        done += n;
+    }
+
+    mapping->addr = buf;
+    mapping->mapped = false;
+    return mapping;
+}
+
+/* Release callback of the attached store, also used on load errors */
+static void unmap_file(void *owner)
+{
+    index_mapping_s *mapping = owner;
+
+    if (mapping->mapped) {
+        munmap(mapping->addr, mapping->size);
+    } else {
+        free(mapping->addr);
+    }
+    free(mapping);
+}
+
+static int write_all(int fd, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Rewrite the header of the file that was loaded, skipped if a save replaced it meanwhile */
+static void refresh_header(const char *index_path, const library_index_header_s *loaded,
+                           const library_index_header_s *header)
+{
+    library_index_header_s current;
+
+    pthread_mutex_lock(&write_lock);
+    int fd = open(index_path, O_RDWR);
+    if (fd >= 0) {
+        if (read(fd, &current, sizeof(current)) == (ssize_t)sizeof(current) &&
+            memcmp(&current, loaded, sizeof(current)) == 0 &&
+            (lseek(fd, 0, SEEK_SET) != 0 || write_all(fd, header, sizeof(*header)) != 0)) {
+            LV_LOG_WARN("Library index header update failed: %d", errno);
+        }
+        close(fd);
+    }
+    pthread_mutex_unlock(&write_lock);
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+int library_index_stat_source(library_index_source_s *source, const char *manifest_path, const char *dir_path)
+{
+    struct stat st;
+
+    memset(source, 0, sizeof(*source));
+    source->manifest_path = manifest_path;
+
+    // A missing manifest is a valid state when the library is scanned
+    if (stat(manifest_path, &st) == 0) {
+        source->manifest_mtime = st.st_mtime;
+        source->manifest_size = st.st_size;
+    } else {
+        source->manifest_size = -1;
+        source->checksum_valid = true;
+    }
+
+    // Only direct entries of the directory are covered by its mtime
+    if (stat(dir_path, &st) != 0) {
+        return -1;
+    }
+    source->dir_mtime = st.st_mtime;
+
+    // A scanned library depends on every file below the root
+    if (source->manifest_size < 0) {
+        uint32_t start = lv_tick_get();
+        source->tree_hash = tree_hash(dir_path, "", 0);
+        LV_LOG_INFO("Music tree stat'ed in %lu ms", (unsigned long)lv_tick_elaps(start));
+        LV_UNUSED(start);
+    }
+    return 0;
+}
+
+int library_index_load(track_store_s *store, const char *index_path, library_index_source_s *source)
+{
+    uint32_t start = lv_tick_get();
+    struct stat st;
+
+    track_store_clear(store);
+
+    int fd = open(index_path, O_RDONLY);
+    if (fd < 0) {
+        LV_LOG_USER("No library index at %s", index_path);
+        return -1;
+    }
+
+    index_mapping_s *mapping = NULL;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(library_index_header_s) ||
+        (mapping = map_file(fd, st.st_size)) == NULL) {
+        close(fd);
+        return -1;
+    }
+    close(fd);
+
+    library_index_header_s header;
+    memcpy(&header, mapping->addr, sizeof(header));
+
+    if (!header_valid(&header, mapping->size, store)) {
+        LV_LOG_WARN("Library index %s is invalid, rebuilding", index_path);
+        unmap_file(mapping);
+        return -1;
+    }
+
+    if (header.manifest_size != source->manifest_size || header.dir_mtime != source->dir_mtime ||
+        header.tree_hash != source->tree_hash) {
+        LV_LOG_USER("Library sources changed, rebuilding index");
+        unmap_file(mapping);
+        return -1;
+    }
+
+    if (header.manifest_mtime != source->manifest_mtime) {
+        // Same size but touched: only a content change forces a rebuild
+        if (source_checksum(source) != 0 || source->manifest_checksum != header.manifest_checksum) {
+            LV_LOG_USER("Manifest content changed, rebuilding index");
+            unmap_file(mapping);
+            return -1;
+        }
+        header.manifest_mtime = source->manifest_mtime;
+        refresh_header(index_path, mapping->addr, &header);
+    }
+
+    uint32_t *columns[TRACK_STORE_COLUMNS];
+    for (int i = 0; i < TRACK_STORE_COLUMNS; i++) {
+        columns[i] = (uint32_t *)((uint8_t *)mapping->addr + header.columns_offset) +
+                     (size_t)i * header.track_count;
+    }
+
+    track_id_t *orders[TRACK_ORDER_COUNT];
+    for (int i = 0; i < TRACK_ORDER_COUNT; i++) {
+        orders[i] = (track_id_t *)((uint8_t *)mapping->addr + header.orders_offset) +
+                    (size_t)i * header.track_count;
+    }
+    track_id_t *const *attached_orders = header.orders_offset != 0 ? orders : NULL;
+
+    if (!columns_valid(mapping, &header, columns, attached_orders)) {
+        LV_LOG_WARN("Library index %s is corrupted, rebuilding", index_path);
+        unmap_file(mapping);
+        return -1;
+    }
+
+    track_store_attach(store, header.track_count, columns,
+                       (char *)mapping->addr + header.arena_offset, header.arena_size,
+                       attached_orders, unmap_file, mapping);
+
+    LV_LOG_USER("Library index loaded: %lu tracks, %lu bytes %s in %lu ms",
+                (unsigned long)header.track_count, (unsigned long)mapping->size,
+                mapping->mapped ? "mapped" : "read", (unsigned long)lv_tick_elaps(start));
+    LV_UNUSED(start);
+    return 0;
+}
+
+int library_index_save(const track_store_s *store, const char *index_path, library_index_source_s *source)
+{
+    uint32_t start = lv_tick_get();
+    char tmp_path[256];
+    library_index_header_s header;
+
+    if (source_checksum(source) != 0) {
+        LV_LOG_WARN("Cannot checksum %s, index not written", source->manifest_path);
+        return -1;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LIBRARY_INDEX_MAGIC, 4);
+    header.version = LIBRARY_INDEX_VERSION;
+    header.byte_order = LIBRARY_INDEX_BYTE_ORDER;
+    header.header_size = sizeof(header);
+    header.track_count = store->count;
+    header.columns_offset = (sizeof(header) + 7) & ~7u;
+    header.arena_offset = header.columns_offset + store->count * TRACK_STORE_COLUMNS * sizeof(uint32_t);
+    if (store->order[0]) {
+        header.orders_offset = header.arena_offset;
+        header.arena_offset += store->count * TRACK_ORDER_COUNT * sizeof(track_id_t);
+    }
+    header.arena_size = store->arena_size;
+    header.manifest_mtime = source->manifest_mtime;
+    header.manifest_size = source->manifest_size;
+    header.dir_mtime = source->dir_mtime;
+    header.tree_hash = source->tree_hash;
+    header.manifest_checksum = source->manifest_checksum;
+    memcpy(header.root, store->root, sizeof(header.root));
+
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", index_path) >= (int)sizeof(tmp_path)) {
+        return -1;
+    }
+
+    // One writer at a time, the next one replaces the file again
+    pthread_mutex_lock(&write_lock);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        pthread_mutex_unlock(&write_lock);
+        LV_LOG_WARN("Cannot create library index %s: %d", tmp_path, errno);
+        return -1;
+    }
+
+    static const uint8_t padding[8];
+    int ret = write_all(fd, &header, sizeof(header));
+    if (ret == 0) {
+        ret = write_all(fd, padding, header.columns_offset - sizeof(header));
+    }
+    for (int i = 0; i < TRACK_STORE_COLUMNS && ret == 0; i++) {
+        ret = write_all(fd, track_store_column(store, i), store->count * sizeof(uint32_t));
+    }
+    for (int i = 0; i < TRACK_ORDER_COUNT && store->order[0] && ret == 0; i++) {
+        ret = write_all(fd, store->order[i], store->count * sizeof(track_id_t));
+    }
+    if (ret == 0) {
+        ret = write_all(fd, store->arena, store->arena_size);
+    }
+    if (ret == 0) {
+        ret = fsync(fd);
+    }
+    close(fd);
+
+    // Readers either see the old complete index or the new one
+    if (ret != 0 || rename(tmp_path, index_path) != 0) {
+        LV_LOG_WARN("Library index write failed: %d", errno);
+        unlink(tmp_path);
+        pthread_mutex_unlock(&write_lock);
+        return -1;
+    }
+    pthread_mutex_unlock(&write_lock);
+
+    LV_LOG_USER("Library index written: %lu tracks, %lu bytes in %lu ms",
+                (unsigned long)store->count,
+                (unsigned long)(header.arena_offset + header.arena_size),
+                (unsigned long)lv_tick_elaps(start));
+    LV_UNUSED(start);
+    return 0;
+}
@@ -0,0 +1,109 @@
+/**
+ * Library Index Header
+ * Versioned binary snapshot of the track store: a header, the fixed-size
+ * track columns, the sort orders and the string table, mapped and used in
+ * place at startup
+ */
+
+#ifndef LIBRARY_INDEX_H
+#define LIBRARY_INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "track_store.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define LIBRARY_INDEX_MAGIC      "VLIX"
+#define LIBRARY_INDEX_VERSION    3
+#define LIBRARY_INDEX_BYTE_ORDER 0x01020304u   // Written natively, rejects foreign-endian files
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+/*
+ * File layout, all offsets from the start of the file:
+ *   header | track_count x uint32_t per column, TRACK_STORE_COLUMNS columns |
+ *   track_count track ids per order, TRACK_ORDER_COUNT orders (optional) | string table
+ */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t header_size;
+    uint32_t track_count;
+    uint32_t columns_offset;     // 8-byte aligned
+    uint32_t arena_offset;
+    uint32_t arena_size;
+
+    // Sources the index was built from
+    int64_t manifest_mtime;
+    int64_t manifest_size;
+    int64_t dir_mtime;
+    uint32_t manifest_checksum;  // FNV-1a of the manifest bytes
+    uint32_t orders_offset;      // 0 when the store was not sorted
+    uint32_t tree_hash;          // Stat fingerprint of the scanned tree, 0 with a manifest
+
+    char root[TRACK_ROOT_MAX];
+} library_index_header_s;
+
+/* Freshness information of the library sources */
+typedef struct {
+    const char *manifest_path;
+    int64_t manifest_mtime;
+    int64_t manifest_size;       // -1 without a manifest
+    int64_t dir_mtime;
+    uint32_t manifest_checksum;
+    uint32_t tree_hash;          // Without a manifest: covers the subdirectories and their files
+    bool checksum_valid;         // Computed on demand, reading the manifest is not free
+} library_index_source_s;
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Stat the manifest and the music directory
+ * @note Without a manifest the whole tree is stat'ed (no file is read), so that
+ *       files added, removed or edited below the root while the app was off are noticed
+ * @param source Output
+ * @param manifest_path manifest.json path (POSIX path, kept by reference), may not exist
+ * @param dir_path Music directory
+ * @return 0 on success, -1 if the directory is missing
+ */
+int library_index_stat_source(library_index_source_s *source, const char *manifest_path, const char *dir_path);
+
+/**
+ * @brief Map an index file and attach it to a store when it matches the sources
+ * @note The mapping belongs to the store and is released by track_store_clear() or deinit
+ * @param store Track store, its root must match the one recorded in the index
+ * @param index_path Index file
+ * @param source Current sources, the checksum is computed only if the mtime changed
+ * @return 0 when the store now uses the index, -1 if it is missing, stale or invalid
+ */
+int library_index_load(track_store_s *store, const char *index_path, library_index_source_s *source);
+
+/**
+ * @brief Write a store to an index file, replacing the old one atomically
+ * @note Safe on any thread, concurrent saves are serialized and the last one wins
+ * @param store Track store
+ * @param index_path Index file
+ * @param source Sources the store was built from
+ * @return 0 on success, -1 on failure
+ */
+int library_index_save(const track_store_s *store, const char *index_path, library_index_source_s *source);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* LIBRARY_INDEX_H */
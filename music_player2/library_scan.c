@@ -0,0 +1,1267 @@
+/**
+ * Library Scanner
+ * The calling thread walks the tree into a sorted job list, workers read
+ * tags of LIBRARY_SCAN_BATCH files at a time into a window of result slots
+ * and the calling thread reports the slots in order
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <syslog.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "library_scan.h"
+
+#define SCAN_LOG(fmt, ...) syslog(LOG_INFO, "[LIBSCAN] " fmt, ##__VA_ARGS__)
+
+#define SCAN_STACKSIZE      8192
+#define SCAN_COMMENT_MAX    16384   // Bytes of a Vorbis comment block examined
+#define SCAN_SYNC_WINDOW    65536   // Bytes searched for the first MP3 frame
+#define SCAN_OGG_TAIL_MAX   65536   // Bytes searched backwards for the last Ogg page
+#define SCAN_CBR_PROBE      8       // Frames compared to detect constant bitrate
+
+/* Buffered view of a file, refilled with one pread per LIBRARY_SCAN_BLOCK_SIZE */
+typedef struct {
+    int fd;
+    off_t size;
+    off_t base;
+    size_t len;
+    uint8_t buf[LIBRARY_SCAN_BLOCK_SIZE];
+} scan_file_s;
+
+/* Per-thread scratch, heap allocated to keep worker stacks small */
+typedef struct {
+    scan_file_s file;
+    uint8_t comment[SCAN_COMMENT_MAX];
+} scan_ctx_s;
+
+typedef struct {
+    uint32_t path;       // Arena offsets
+    uint32_t cover;
+    uint32_t format;
+} scan_job_s;
+
+typedef struct {
+    library_scan_track_s tracks[LIBRARY_SCAN_BATCH];
+    uint32_t batch;
+    bool done;
+} scan_slot_s;
+
+typedef struct {
+    const library_scan_config_s *config;
+
+    // Job list, read-only once the walk is over
+    scan_job_s *jobs;
+    uint32_t job_count;
+    uint32_t job_capacity;
+    char *arena;
+    uint32_t arena_size;
+    uint32_t arena_capacity;
+    uint32_t dir_count;
+
+    // Result window, batch b lives in slots[b % slot_count]
+    scan_slot_s *slots;
+    int slot_count;
+    uint32_t batch_count;
+    uint32_t next_batch;     // Next batch to hand to a worker
+    uint32_t committed;      // Batches reported so far
+    bool stop;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} scan_state_s;
+
+// Functions
+static const uint8_t *file_peek(scan_file_s *file, off_t offset, size_t len);
+static uint32_t be32(const uint8_t *p);
+static uint32_t le32(const uint8_t *p);
+static uint64_t be64(const uint8_t *p);
+static uint64_t le64(const uint8_t *p);
+static uint32_t syncsafe32(const uint8_t *p);
+static void field_set(char *dst, const uint8_t *src, size_t len);
+static void field_set_latin1(char *dst, const uint8_t *src, size_t len);
+static void field_set_utf16(char *dst, const uint8_t *src, size_t len, bool big_endian);
+static void field_set_text(char *dst, const uint8_t *data, size_t len);
+static void vorbis_comments(library_scan_track_s *track, const uint8_t *data, size_t len);
+static off_t id3v2_parse(scan_file_s *file, library_scan_track_s *track);
+static void id3v1_parse(scan_file_s *file, library_scan_track_s *track);
+static int mp3_frame_info(const uint8_t *h, uint32_t *frame_len, uint32_t *samples, uint32_t *rate,
+                          uint32_t *bitrate);
+static void mp3_parse(scan_ctx_s *ctx, library_scan_track_s *track);
+static void flac_parse(scan_ctx_s *ctx, library_scan_track_s *track);
+static void ogg_parse(scan_ctx_s *ctx, library_scan_track_s *track);
+static void mp4_walk(scan_file_s *file, off_t start, off_t end, int depth, library_scan_track_s *track);
+static void mp4_parse(scan_ctx_s *ctx, library_scan_track_s *track);
+static void wav_parse(scan_ctx_s *ctx, library_scan_track_s *track);
+static int read_file(scan_ctx_s *ctx, const char *path, library_scan_track_s *track);
+static uint32_t arena_add(scan_state_s *scan, const char *str);
+static int job_add(scan_state_s *scan, const char *path, uint32_t cover, uint32_t format);
+static int name_compare(const void *a, const void *b);
+static bool is_cover_name(const char *name);
+static int walk_dir(scan_state_s *scan, char *rel, size_t rel_len, int depth);
+static void process_batch(scan_state_s *scan, scan_ctx_s *ctx, uint32_t batch);
+static void *worker_thread_func(void *arg);
+
+/*********************
+ *   FILE ACCESS
+ *********************/
+
+/* Return len bytes at offset, NULL past the end of the file */
+static const uint8_t *file_peek(scan_file_s *file, off_t offset, size_t len)
+{
+    if (offset < 0 || len > sizeof(file->buf) || offset + (off_t)len > file->size) {
+        return NULL;
+    }
+
+    if (offset >= file->base && offset + (off_t)len <= file->base + (off_t)file->len) {
+        return file->buf + (offset - file->base);
+    }
+
+    ssize_t n = pread(file->fd, file->buf, sizeof(file->buf), offset);
+    if (n < (ssize_t)len) {
+        file->len = 0;
+        return NULL;
+    }
+
+    file->base = offset;
+    file->len = n;
+    return file->buf;
+}
+
+static uint32_t be32(const uint8_t *p)
+{
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+    return (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0];
+}
+
+static uint64_t be64(const uint8_t *p)
+{
+    return (uint64_t)be32(p) << 32 | be32(p + 4);
+}
+
+static uint64_t le64(const uint8_t *p)
+{
+    return (uint64_t)le32(p + 4) << 32 | le32(p);
+}
+
+static uint32_t syncsafe32(const uint8_t *p)
+{
+    return (uint32_t)(p[0] & 0x7f) << 21 | (uint32_t)(p[1] & 0x7f) << 14 | (uint32_t)(p[2] & 0x7f) << 7 | (p[3] & 0x7f);
+}
+
+/*********************
+ *   TEXT FIELDS
+ *********************/
+
+/* Copy UTF-8, cutting at a character boundary and trimming trailing blanks */
+static void field_set(char *dst, const uint8_t *src, size_t len)
+{
+    size_t n = 0;
+    while (n < len && src[n] != '\0') {
+        n++;
+    }
+    if (n > LIBRARY_SCAN_FIELD_MAX - 1) {
+        n = LIBRARY_SCAN_FIELD_MAX - 1;
+        while (n > 0 && (src[n] & 0xc0) == 0x80) {
+            n--;
+        }
+    }
+    while (n > 0 && (src[n - 1] == ' ' || src[n - 1] == '\r' || src[n - 1] == '\n')) {
+        n--;
+    }
+    memcpy(dst, src, n);
+    dst[n] = '\0';
+}
+
+static void field_set_latin1(char *dst, const uint8_t *src, size_t len)
+{
+    uint8_t out[LIBRARY_SCAN_FIELD_MAX * 2];
+    size_t n = 0;
+
+    for (size_t i = 0; i < len && src[i] != '\0' && n + 2 < sizeof(out); i++) {
+        if (src[i] < 0x80) {
+            out[n++] = src[i];
+        } else {
+            out[n++] = 0xc0 | src[i] >> 6;
+            out[n++] = 0x80 | (src[i] & 0x3f);
+        }
+    }
+    field_set(dst, out, n);
+}
+
+static void field_set_utf16(char *dst, const uint8_t *src, size_t len, bool big_endian)
+{
+    uint8_t out[LIBRARY_SCAN_FIELD_MAX * 2];
+    size_t n = 0;
+
+    // A byte order mark overrides the default
+    if (len >= 2 && ((src[0] == 0xff && src[1] == 0xfe) || (src[0] == 0xfe && src[1] == 0xff))) {
+        big_endian = src[0] == 0xfe;
+        src += 2;
+        len -= 2;
+    }
+
+    for (size_t i = 0; i + 1 < len && n + 4 < sizeof(out); i += 2) {
+        uint32_t cp = big_endian ? (uint32_t)src[i] << 8 | src[i + 1] : (uint32_t)src[i + 1] << 8 | src[i];
+        if (cp == 0) {
+            break;
+        }
+        if (cp >= 0xd800 && cp < 0xdc00 && i + 3 < len) {
+            uint32_t lo = big_endian ? (uint32_t)src[i + 2] << 8 | src[i + 3] : (uint32_t)src[i + 3] << 8 | src[i + 2];
+            if (lo >= 0xdc00 && lo < 0xe000) {
+                cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+                i += 2;
+            }
+        }
+
+        if (cp < 0x80) {
+            out[n++] = cp;
+        } else if (cp < 0x800) {
+            out[n++] = 0xc0 | cp >> 6;
+            out[n++] = 0x80 | (cp & 0x3f);
+        } else if (cp < 0x10000) {
+            out[n++] = 0xe0 | cp >> 12;
+            out[n++] = 0x80 | ((cp >> 6) & 0x3f);
+            out[n++] = 0x80 | (cp & 0x3f);
+        } else {
+            out[n++] = 0xf0 | cp >> 18;
+            out[n++] = 0x80 | ((cp >> 12) & 0x3f);
+            out[n++] = 0x80 | ((cp >> 6) & 0x3f);
+            out[n++] = 0x80 | (cp & 0x3f);
+        }
+    }
+    field_set(dst, out, n);
+}
+
+/* ID3v2 text frame body: encoding byte followed by the string */
+static void field_set_text(char *dst, const uint8_t *data, size_t len)
+{
+    if (len < 2) {
+        return;
+    }
+
+    switch (data[0]) {
+    case 0: field_set_latin1(dst, data + 1, len - 1); break;
+    case 1: field_set_utf16(dst, data + 1, len - 1, false); break;
+    case 2: field_set_utf16(dst, data + 1, len - 1, true); break;
+    default: field_set(dst, data + 1, len - 1); break;
+    }
+}
+
+/* Vendor string followed by KEY=value pairs, all lengths little-endian */
+static void vorbis_comments(library_scan_track_s *track, const uint8_t *data, size_t len)
+{
+    if (len < 8) {
+        return;
+    }
+
+    size_t pos = 4 + (size_t)le32(data);
+    if (pos + 4 > len) {
+        return;
+    }
+    uint32_t count = le32(data + pos);
+    pos += 4;
+
+    for (uint32_t i = 0; i < count && pos + 4 <= len; i++) {
+        uint32_t size = le32(data + pos);
+        pos += 4;
+        if (size > len - pos) {
+            break;   // Truncated by SCAN_COMMENT_MAX
+        }
+
+        const uint8_t *c = data + pos;
+        pos += size;
+
+        if (size > 6 && strncasecmp((const char *)c, "TITLE=", 6) == 0) {
+            field_set(track->title, c + 6, size - 6);
+        } else if (size > 7 && strncasecmp((const char *)c, "ARTIST=", 7) == 0) {
+            field_set(track->artist, c + 7, size - 7);
+        } else if (size > 6 && strncasecmp((const char *)c, "ALBUM=", 6) == 0) {
+            field_set(track->album, c + 6, size - 6);
+        }
+    }
+}
+
+/*********************
+ *   TAG READERS
+ *********************/
+
+/* Read an ID3v2 tag at the start of the file, returns the offset after it */
+static off_t id3v2_parse(scan_file_s *file, library_scan_track_s *track)
+{
+    const uint8_t *h = file_peek(file, 0, 10);
+    if (!h || memcmp(h, "ID3", 3) != 0 || h[3] < 2 || h[3] > 4) {
+        return 0;
+    }
+
+    int version = h[3];
+    uint8_t flags = h[5];
+    off_t end = 10 + (off_t)syncsafe32(h + 6) + (flags & 0x10 ? 10 : 0);
+    off_t pos = 10;
+
+    if (flags & 0x40 && version >= 3) {
+        const uint8_t *ext = file_peek(file, pos, 4);
+        if (!ext) {
+            return end;
+        }
+        pos += version == 4 ? syncsafe32(ext) : be32(ext) + 4;
+    }
+
+    int header_len = version == 2 ? 6 : 10;
+    uint32_t length_ms = 0;
+
+    while (pos + header_len <= end) {
+        const uint8_t *fh = file_peek(file, pos, header_len);
+        if (!fh || fh[0] == '\0') {
+            break;   // Padding
+        }
+
+        char id[5] = { 0 };
+        uint32_t size;
+        bool skip = false;
+
+        if (version == 2) {
+            memcpy(id, fh, 3);
+            size = (uint32_t)fh[3] << 16 | (uint32_t)fh[4] << 8 | fh[5];
+        } else {
+            memcpy(id, fh, 4);
+            size = version == 4 ? syncsafe32(fh + 4) : be32(fh + 4);
+            // Compressed or encrypted frames are not worth decoding here
+            skip = version == 4 ? (fh[9] & 0x0c) != 0 : (fh[9] & 0xc0) != 0;
+        }
+
+        off_t data = pos + header_len;
+        pos = data + size;
+        if (skip || size == 0 || pos > end) {
+            continue;
+        }
+
+        char *dst = NULL;
+        if (!strcmp(id, "TIT2") || !strcmp(id, "TT2")) {
+            dst = track->title;
+        } else if (!strcmp(id, "TPE1") || !strcmp(id, "TP1")) {
+            dst = track->artist;
+        } else if (!strcmp(id, "TALB") || !strcmp(id, "TAL")) {
+            dst = track->album;
+        } else if (strcmp(id, "TLEN") != 0 && strcmp(id, "TLE") != 0) {
+            continue;
+        }
+
+        // v2.4 data length indicator precedes the body
+        if (version == 4 && (fh[9] & 0x01) && size > 4) {
+            data += 4;
+            size -= 4;
+        }
+
+        uint32_t len = size < 512 ? size : 512;
+        const uint8_t *body = file_peek(file, data, len);
+        if (!body) {
+            continue;
+        }
+
+        if (dst) {
+            field_set_text(dst, body, len);
+        } else {
+            char number[LIBRARY_SCAN_FIELD_MAX] = "";
+            field_set_text(number, body, len);
+            length_ms = strtoul(number, NULL, 10);
+        }
+    }
+
+    // TLEN is only a hint, stream headers take precedence
+    if (length_ms > 0 && track->duration_ms == 0) {
+        track->duration_ms = length_ms;
+    }
+    return end;
+}
+
+/* Fill fields still empty from the 128-byte trailer */
+static void id3v1_parse(scan_file_s *file, library_scan_track_s *track)
+{
+    const uint8_t *t = file_peek(file, file->size - 128, 128);
+    if (!t || memcmp(t, "TAG", 3) != 0) {
+        return;
+    }
+
+    if (track->title[0] == '\0') {
+        field_set_latin1(track->title, t + 3, 30);
+    }
+    if (track->artist[0] == '\0') {
+        field_set_latin1(track->artist, t + 33, 30);
+    }
+    if (track->album[0] == '\0') {
+        field_set_latin1(track->album, t + 63, 30);
+    }
+}
+
+/* Decode a 4-byte MPEG audio header, returns -1 if it is not one */
+static int mp3_frame_info(const uint8_t *h, uint32_t *frame_len, uint32_t *samples, uint32_t *rate,
+                          uint32_t *bitrate)
+{
+    static const uint16_t bitrates[2][3][15] = {
+        {   // MPEG-1 layer I, II, III
+            { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+            { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+            { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+        },
+        {   // MPEG-2 and 2.5 layer I, II, III
+            { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+            { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+            { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+        },
+    };
+    static const uint32_t rates[3] = { 44100, 48000, 32000 };
+
+    if (h[0] != 0xff || (h[1] & 0xe0) != 0xe0) {
+        return -1;
+    }
+
+    int version = (h[1] >> 3) & 3;       // 0: 2.5, 2: 2, 3: 1
+    int layer = 4 - ((h[1] >> 1) & 3);   // 1..3, 4 is reserved
+    int bitrate_index = h[2] >> 4;
+    int rate_index = (h[2] >> 2) & 3;
+    int padding = (h[2] >> 1) & 1;
+
+    if (version == 1 || layer == 4 || bitrate_index == 0 || bitrate_index == 15 || rate_index == 3) {
+        return -1;
+    }
+
+    bool mpeg1 = version == 3;
+    *bitrate = bitrates[mpeg1 ? 0 : 1][layer - 1][bitrate_index] * 1000;
+    *rate = rates[rate_index] >> (version == 3 ? 0 : version == 2 ? 1 : 2);
+
+    if (layer == 1) {
+        *samples = 384;
+        *frame_len = (12 * *bitrate / *rate + padding) * 4;
+    } else {
+        *samples = layer == 3 && !mpeg1 ? 576 : 1152;
+        *frame_len = *samples / 8 * *bitrate / *rate + padding;
+    }
+    return 0;
+}
+
+static void mp3_parse(scan_ctx_s *ctx, library_scan_track_s *track)
+{
+    scan_file_s *file = &ctx->file;
+    uint32_t frame_len, samples, rate, bitrate;
+    uint32_t next_len, next_samples, next_rate, next_bitrate;
+    const uint8_t *h = NULL;
+
+    off_t start = id3v2_parse(file, track);
+    id3v1_parse(file, track);
+
+    // First header followed by a second valid one, to rule out false syncs
+    off_t limit = start + SCAN_SYNC_WINDOW;
+    for (; start < limit; start++) {
+        h = file_peek(file, start, 4);
+        if (!h) {
+            return;
+        }
+        if (h[0] != 0xff || mp3_frame_info(h, &frame_len, &samples, &rate, &bitrate) != 0) {
+            continue;
+        }
+        const uint8_t *n = file_peek(file, start + frame_len, 4);
+        if (n && mp3_frame_info(n, &next_len, &next_samples, &next_rate, &next_bitrate) == 0 &&
+            next_rate == rate) {
+            break;
+        }
+    }
+    if (start >= limit) {
+        return;
+    }
+
+    // Xing/Info and VBRI headers carry the frame count
+    h = file_peek(file, start, 200);
+    if (h) {
+        bool mpeg1 = (h[1] >> 3 & 3) == 3;
+        bool mono = (h[3] >> 6) == 3;
+        const uint8_t *x = h + 4 + (mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17));
+
+        if (memcmp(x, "Xing", 4) == 0 || memcmp(x, "Info", 4) == 0) {
+            uint32_t flags = be32(x + 4);
+            if (flags & 1) {
+                uint64_t total = (uint64_t)be32(x + 8) * samples;
+
+                // LAME tag gapless info follows the optional fields
+                const uint8_t *lame = x + 8 + 4 + (flags & 2 ? 4 : 0) + (flags & 4 ? 100 : 0) + (flags & 8 ? 4 : 0);
+                if (lame + 24 <= h + 200 && memcmp(lame, "LAME", 4) == 0) {
+                    uint32_t delay = (uint32_t)lame[21] << 4 | lame[22] >> 4;
+                    uint32_t pad = (uint32_t)(lame[22] & 0x0f) << 8 | lame[23];
+                    if (delay + pad < total) {
+                        total -= delay + pad;
+                    }
+                }
+                track->duration_ms = total * 1000 / rate;
+                return;
+            }
+        } else if (memcmp(h + 36, "VBRI", 4) == 0) {
+            track->duration_ms = (uint64_t)be32(h + 50) * samples * 1000 / rate;
+            return;
+        }
+    }
+
+    // Without a header the stream must be constant bitrate to be measured cheaply
+    off_t audio_end = file->size;
+    const uint8_t *t = file_peek(file, file->size - 128, 3);
+    if (t && memcmp(t, "TAG", 3) == 0) {
+        audio_end -= 128;
+    }
+
+    off_t pos = start;
+    uint64_t bits = 0;
+    uint32_t probed = 0;
+    for (; probed < SCAN_CBR_PROBE; probed++) {
+        const uint8_t *f = file_peek(file, pos, 4);
+        if (!f || mp3_frame_info(f, &next_len, &next_samples, &next_rate, &next_bitrate) != 0) {
+            break;
+        }
+        bits += next_bitrate;
+        pos += next_len;
+    }
+    if (probed == 0) {
+        return;
+    }
+
+    // Average of the probed frames, exact for CBR
+    uint64_t average = bits / probed;
+    track->duration_ms = (uint64_t)(audio_end - start) * 8 * 1000 / average;
+}
+
+static void flac_parse(scan_ctx_s *ctx, library_scan_track_s *track)
+{
+    scan_file_s *file = &ctx->file;
+    off_t pos = id3v2_parse(file, track);
+
+    const uint8_t *magic = file_peek(file, pos, 4);
+    if (!magic || memcmp(magic, "fLaC", 4) != 0) {
+        return;
+    }
+    pos += 4;
+
+    bool last = false;
+    while (!last) {
+        const uint8_t *b = file_peek(file, pos, 4);
+        if (!b) {
+            return;
+        }
+        last = b[0] & 0x80;
+        int type = b[0] & 0x7f;
+        uint32_t len = (uint32_t)b[1] << 16 | (uint32_t)b[2] << 8 | b[3];
+        off_t data = pos + 4;
+        pos = data + len;
+
+        if (type == 0 && len >= 18) {
+            const uint8_t *s = file_peek(file, data, 18);
+            if (!s) {
+                return;
+            }
+            uint32_t rate = (uint32_t)s[10] << 12 | (uint32_t)s[11] << 4 | s[12] >> 4;
+            uint64_t total = (uint64_t)(s[13] & 0x0f) << 32 | be32(s + 14);
+            if (rate > 0 && total > 0) {
+                track->duration_ms = total * 1000 / rate;
+            }
+        } else if (type == 4) {
+            size_t n = len < SCAN_COMMENT_MAX ? len : SCAN_COMMENT_MAX;
+            ssize_t got = pread(file->fd, ctx->comment, n, data);
+            if (got > 0) {
+                vorbis_comments(track, ctx->comment, got);
+            }
+        }
+    }
+}
+
+static void ogg_parse(scan_ctx_s *ctx, library_scan_track_s *track)
+{
+    scan_file_s *file = &ctx->file;
+    off_t pos = 0;
+    uint32_t serial = 0;
+    uint32_t rate = 0;
+    uint32_t pre_skip = 0;
+    bool opus = false;
+    int packet = 0;
+    size_t comment_len = 0;
+
+    // Packet 0 is the identification header, packet 1 the comments
+    while (packet < 2) {
+        const uint8_t *p = file_peek(file, pos, 27);
+        if (!p || memcmp(p, "OggS", 4) != 0) {
+            return;
+        }
+        int segments = p[26];
+        p = file_peek(file, pos, 27 + segments);
+        if (!p) {
+            return;
+        }
+
+        uint8_t table[255];
+        memcpy(table, p + 27, segments);
+        if (pos == 0) {
+            serial = le32(p + 14);
+        }
+
+        off_t body = pos + 27 + segments;
+        for (int i = 0; i < segments && packet < 2; i++) {
+            if (packet == 0 && i == 0) {
+                const uint8_t *id = file_peek(file, body, 19);
+                if (!id) {
+                    return;
+                }
+                if (memcmp(id, "\x01vorbis", 7) == 0) {
+                    rate = le32(id + 12);
+                } else if (memcmp(id, "OpusHead", 8) == 0) {
+                    opus = true;
+                    rate = 48000;   // Granule positions always count 48 kHz samples
+                    pre_skip = id[10] | (uint32_t)id[11] << 8;
+                } else {
+                    return;
+                }
+            } else if (packet == 1) {
+                size_t n = table[i];
+                if (comment_len + n > SCAN_COMMENT_MAX) {
+                    n = SCAN_COMMENT_MAX - comment_len;
+                }
+                if (n > 0 && pread(file->fd, ctx->comment + comment_len, n, body) != (ssize_t)n) {
+                    return;
+                }
+                comment_len += n;
+            }
+
+            body += table[i];
+            if (table[i] < 255) {
+                packet++;
+            }
+        }
+        pos = body;
+    }
+
+    size_t skip = opus ? 8 : 7;
+    if (comment_len > skip) {
+        vorbis_comments(track, ctx->comment + skip, comment_len - skip);
+    }
+
+    // The granule position of the last page is the total sample count
+    for (off_t tail = 0; tail < SCAN_OGG_TAIL_MAX && rate > 0; tail += LIBRARY_SCAN_BLOCK_SIZE - 27) {
+        off_t from = file->size - tail - LIBRARY_SCAN_BLOCK_SIZE;
+        size_t len = LIBRARY_SCAN_BLOCK_SIZE;
+        if (from < 0) {
+            len += from;
+            from = 0;
+        }
+        const uint8_t *w = file_peek(file, from, len);
+        if (!w) {
+            return;
+        }
+        for (ssize_t i = (ssize_t)len - 27; i >= 0; i--) {
+            if (memcmp(w + i, "OggS", 4) != 0 || le32(w + i + 14) != serial) {
+                continue;
+            }
+            // Pages where no packet ends carry no granule position
+            uint64_t granule = le64(w + i + 6);
+            if (granule != UINT64_MAX) {
+                if (granule > pre_skip) {
+                    track->duration_ms = (granule - pre_skip) * 1000 / rate;
+                }
+                return;
+            }
+        }
+        if (from == 0) {
+            return;
+        }
+    }
+}
+
+/* Walk boxes in [start, end), descending into the containers that lead to mvhd and ilst */
+static void mp4_walk(scan_file_s *file, off_t start, off_t end, int depth, library_scan_track_s *track)
+{
+    off_t pos = start;
+
+    while (pos + 8 <= end && depth < 6) {
+        const uint8_t *b = file_peek(file, pos, 16 <= end - pos ? 16 : 8);
+        if (!b) {
+            return;
+        }
+
+        uint64_t size = be32(b);
+        char type[5] = { b[4], b[5], b[6], b[7], '\0' };
+        off_t header = 8;
+        if (size == 1) {
+            if (end - pos < 16) {
+                return;
+            }
+            size = be64(b + 8);
+            header = 16;
+        } else if (size == 0) {
+            size = end - pos;
+        }
+        if (size < (uint64_t)header || size > (uint64_t)(end - pos)) {
+            return;
+        }
+
+        off_t data = pos + header;
+        off_t box_end = pos + size;
+
+        if (!strcmp(type, "moov") || !strcmp(type, "udta") || !strcmp(type, "ilst")) {
+            mp4_walk(file, data, box_end, depth + 1, track);
+        } else if (!strcmp(type, "meta")) {
+            mp4_walk(file, data + 4, box_end, depth + 1, track);   // Full box
+        } else if (!strcmp(type, "mvhd")) {
+            const uint8_t *m = file_peek(file, data, 32);
+            if (m) {
+                bool v1 = m[0] == 1;
+                uint32_t timescale = be32(m + (v1 ? 20 : 12));
+                uint64_t duration = v1 ? be64(m + 24) : be32(m + 16);
+                if (timescale > 0) {
+                    track->duration_ms = duration * 1000 / timescale;
+                }
+            }
+        } else if (depth >= 3 && (!strcmp(type, "\xa9nam") || !strcmp(type, "\xa9" "ART") ||
+                                  !strcmp(type, "\xa9" "alb"))) {
+            // Item holding a data box: size, "data", type, locale, value
+            uint32_t len = box_end - data;
+            if (len > 16 + LIBRARY_SCAN_FIELD_MAX) {
+                len = 16 + LIBRARY_SCAN_FIELD_MAX;
+            }
+            const uint8_t *d = len > 16 ? file_peek(file, data, len) : NULL;
+            if (d && memcmp(d + 4, "data", 4) == 0) {
+                char *dst = type[1] == 'n' ? track->title : type[1] == 'A' ? track->artist : track->album;
+                field_set(dst, d + 16, len - 16);
+            }
+        }
+
+        // moov is often placed after mdat, which is skipped without reading
+        pos = box_end;
+    }
+}
+
+static void mp4_parse(scan_ctx_s *ctx, library_scan_track_s *track)
+{
+    mp4_walk(&ctx->file, 0, ctx->file.size, 0, track);
+}
+
+static void wav_parse(scan_ctx_s *ctx, library_scan_track_s *track)
+{
+    scan_file_s *file = &ctx->file;
+    const uint8_t *r = file_peek(file, 0, 12);
+    if (!r || memcmp(r, "RIFF", 4) != 0 || memcmp(r + 8, "WAVE", 4) != 0) {
+        return;
+    }
+
+    uint32_t byte_rate = 0;
+    uint32_t data_size = 0;
+    off_t pos = 12;
+
+    while (pos + 8 <= file->size) {
+        const uint8_t *c = file_peek(file, pos, 8);
+        if (!c) {
+            break;
+        }
+        uint32_t size = le32(c + 4);
+        off_t data = pos + 8;
+
+        if (memcmp(c, "fmt ", 4) == 0) {
+            const uint8_t *f = file_peek(file, data, 12);
+            if (f) {
+                byte_rate = le32(f + 8);
+            }
+        } else if (memcmp(c, "data", 4) == 0) {
+            // Streams still being written report 0 or 0xffffffff
+            data_size = size == 0 || size == UINT32_MAX || data + size > file->size ? file->size - data : size;
+        } else if (memcmp(c, "LIST", 4) == 0) {
+            const uint8_t *l = file_peek(file, data, 4);
+            bool info = l && memcmp(l, "INFO", 4) == 0;
+            off_t sub = data + 4;
+            while (info && sub + 8 <= data + size) {
+                const uint8_t *s = file_peek(file, sub, 8);
+                if (!s) {
+                    break;
+                }
+                uint32_t len = le32(s + 4);
+                uint32_t n = len < LIBRARY_SCAN_FIELD_MAX ? len : LIBRARY_SCAN_FIELD_MAX;
+                const uint8_t *v = file_peek(file, sub + 8, n);
+                if (v && memcmp(s, "INAM", 4) == 0) {
+                    field_set(track->title, v, n);
+                } else if (v && memcmp(s, "IART", 4) == 0) {
+                    field_set(track->artist, v, n);
+                } else if (v && memcmp(s, "IPRD", 4) == 0) {
+                    field_set(track->album, v, n);
+                }
+                sub += 8 + len + (len & 1);
+            }
+        }
+
+        pos = data + size + (size & 1);
+    }
+
+    if (byte_rate > 0) {
+        track->duration_ms = (uint64_t)data_size * 1000 / byte_rate;
+    }
+}
+
+static int read_file(scan_ctx_s *ctx, const char *path, library_scan_track_s *track)
+{
+    struct stat st;
+
+    track->title[0] = '\0';
+    track->artist[0] = '\0';
+    track->album[0] = '\0';
+    track->duration_ms = 0;
+    track->format = library_scan_format(path);
+    if (track->format == 0) {
+        return -1;
+    }
+
+    ctx->file.fd = open(path, O_RDONLY);
+    if (ctx->file.fd < 0) {
+        return -1;
+    }
+    if (fstat(ctx->file.fd, &st) != 0) {
+        close(ctx->file.fd);
+        return -1;
+    }
+    ctx->file.size = st.st_size;
+    ctx->file.base = 0;
+    ctx->file.len = 0;
+
+    switch (track->format) {
+    case LIBRARY_SCAN_FORMAT_MP3: mp3_parse(ctx, track); break;
+    case LIBRARY_SCAN_FORMAT_WAV: wav_parse(ctx, track); break;
+    case LIBRARY_SCAN_FORMAT_FLAC: flac_parse(ctx, track); break;
+    case LIBRARY_SCAN_FORMAT_OGG: ogg_parse(ctx, track); break;
+    case LIBRARY_SCAN_FORMAT_MP4: mp4_parse(ctx, track); break;
+    default: break;
+    }
+    close(ctx->file.fd);
+
+    // Untagged files are listed under their file name
+    if (track->title[0] == '\0') {
+        const char *name = strrchr(path, '/');
+        name = name ? name + 1 : path;
+        const char *dot = strrchr(name, '.');
+        field_set(track->title, (const uint8_t *)name, dot ? (size_t)(dot - name) : strlen(name));
+    }
+    return 0;
+}
+
+/*********************
+ *   DIRECTORY WALK
+ *********************/
+
+static uint32_t arena_add(scan_state_s *scan, const char *str)
+{
+    size_t len = strlen(str) + 1;
+    if (scan->arena_size + len > scan->arena_capacity) {
+        uint32_t capacity = scan->arena_capacity ? scan->arena_capacity * 2 : 4096;
+        while (capacity < scan->arena_size + len) {
+            capacity *= 2;
+        }
+        char *arena = realloc(scan->arena, capacity);
+        if (!arena) {
+            return UINT32_MAX;
+        }
+        scan->arena = arena;
+        scan->arena_capacity = capacity;
+    }
+
+    uint32_t offset = scan->arena_size;
+    memcpy(scan->arena + offset, str, len);
+    scan->arena_size += len;
+    return offset;
+}
+
+static int job_add(scan_state_s *scan, const char *path, uint32_t cover, uint32_t format)
+{
+    if (scan->job_count == scan->job_capacity) {
+        uint32_t capacity = scan->job_capacity ? scan->job_capacity * 2 : 256;
+        scan_job_s *jobs = realloc(scan->jobs, capacity * sizeof(scan_job_s));
+        if (!jobs) {
+            return -1;
+        }
+        scan->jobs = jobs;
+        scan->job_capacity = capacity;
+    }
+
+    uint32_t offset = arena_add(scan, path);
+    if (offset == UINT32_MAX) {
+        return -1;
+    }
+
+    scan->jobs[scan->job_count++] = (scan_job_s) { offset, cover, format };
+    return 0;
+}
+
+static int name_compare(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static bool is_cover_name(const char *name)
+{
+    static const char *const bases[] = { "cover.", "folder.", "front.", "album." };
+    static const char *const exts[] = { "jpg", "jpeg", "png", "bmp" };
+
+    for (size_t i = 0; i < sizeof(bases) / sizeof(bases[0]); i++) {
+        size_t len = strlen(bases[i]);
+        if (strncasecmp(name, bases[i], len) != 0) {
+            continue;
+        }
+        for (size_t j = 0; j < sizeof(exts) / sizeof(exts[0]); j++) {
+            if (strcasecmp(name + len, exts[j]) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/* rel holds the directory relative to the root, "" for the root itself */
+static int walk_dir(scan_state_s *scan, char *rel, size_t rel_len, int depth)
+{
+    char full[LIBRARY_SCAN_PATH_MAX * 2];
+    snprintf(full, sizeof(full), "%s%s%s", scan->config->root, rel_len ? "/" : "", rel);
+
+    DIR *dir = opendir(full);
+    if (!dir) {
+        return -1;
+    }
+    scan->dir_count++;
+
+    // Read the whole directory first so that entries are visited sorted
+    char **names = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    struct dirent *ent;
+
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 32;
+            char **grown = realloc(names, capacity * sizeof(char *));
+            if (!grown) {
+                break;
+            }
+            names = grown;
+        }
+
+        // Leading type byte, 'd' sorts directories before files
+        size_t len = strlen(ent->d_name);
+        char *name = malloc(len + 2);
+        if (!name) {
+            break;
+        }
+        bool is_dir = ent->d_type == DT_DIR;
+        if (ent->d_type == DT_UNKNOWN) {
+            struct stat st;
+            char path[LIBRARY_SCAN_PATH_MAX * 2];
+            is_dir = snprintf(path, sizeof(path), "%s/%s", full, ent->d_name) < (int)sizeof(path) &&
+                     stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+        }
+        memcpy(name + 1, ent->d_name, len + 1);
+        name[0] = is_dir ? 'd' : 'f';
+        names[count++] = name;
+    }
+    closedir(dir);
+
+    if (count > 1) {
+        qsort(names, count, sizeof(char *), name_compare);
+    }
+
+    // Cover image shared by the tracks of this directory
+    uint32_t cover = 0;
+    for (size_t i = 0; i < count && cover == 0; i++) {
+        if (names[i][0] == 'f' && is_cover_name(names[i] + 1) && rel_len + strlen(names[i]) < LIBRARY_SCAN_PATH_MAX) {
+            char path[LIBRARY_SCAN_PATH_MAX];
+            snprintf(path, sizeof(path), "%s%s%s", rel, rel_len ? "/" : "", names[i] + 1);
+            uint32_t offset = arena_add(scan, path);
+            cover = offset == UINT32_MAX ? 0 : offset;
+        }
+    }
+
+    int ret = 0;
+    for (size_t i = 0; i < count; i++) {
+        const char *name = names[i] + 1;
+        size_t len = strlen(name);
+        if (ret != 0 || rel_len + 1 + len >= LIBRARY_SCAN_PATH_MAX) {
+            continue;
+        }
+
+        if (names[i][0] == 'd') {
+            if (depth + 1 < LIBRARY_SCAN_DEPTH_MAX) {
+                size_t sub_len = rel_len;
+                if (rel_len) {
+                    rel[sub_len++] = '/';
+                }
+                memcpy(rel + sub_len, name, len + 1);
+                walk_dir(scan, rel, sub_len + len, depth + 1);
+                rel[rel_len] = '\0';
+            }
+            continue;
+        }
+
+        uint32_t format = library_scan_format(name);
+        if (format & scan->config->formats) {
+            char path[LIBRARY_SCAN_PATH_MAX];
+            snprintf(path, sizeof(path), "%s%s%s", rel, rel_len ? "/" : "", name);
+            ret = job_add(scan, path, cover, format);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        free(names[i]);
+    }
+    free(names);
+    return ret;
+}
+
+/*********************
+ *   WORKER POOL
+ *********************/
+
+static void process_batch(scan_state_s *scan, scan_ctx_s *ctx, uint32_t batch)
+{
+    scan_slot_s *slot = &scan->slots[batch % scan->slot_count];
+    uint32_t first = batch * LIBRARY_SCAN_BATCH;
+    char path[LIBRARY_SCAN_PATH_MAX * 2];
+
+    for (uint32_t i = 0; i < LIBRARY_SCAN_BATCH && first + i < scan->job_count; i++) {
+        const scan_job_s *job = &scan->jobs[first + i];
+        library_scan_track_s *track = &slot->tracks[i];
+
+        track->path = scan->arena + job->path;
+        track->cover = scan->arena + job->cover;
+        snprintf(path, sizeof(path), "%s/%s", scan->config->root, track->path);
+        if (read_file(ctx, path, track) != 0) {
+            // Still listed, playback reports the error
+            field_set(track->title, (const uint8_t *)track->path, LIBRARY_SCAN_FIELD_MAX);
+        }
+    }
+}
+
+static void *worker_thread_func(void *arg)
+{
+    scan_state_s *scan = arg;
+    scan_ctx_s *ctx = malloc(sizeof(scan_ctx_s));
+
+    pthread_mutex_lock(&scan->lock);
+    while (ctx && !scan->stop && scan->next_batch < scan->batch_count) {
+        // The window bounds memory: a batch waits until its slot has been reported
+        if (scan->next_batch >= scan->committed + scan->slot_count) {
+            pthread_cond_wait(&scan->cond, &scan->lock);
+            continue;
+        }
+        uint32_t batch = scan->next_batch++;
+        pthread_mutex_unlock(&scan->lock);
+
+        process_batch(scan, ctx, batch);
+
+        pthread_mutex_lock(&scan->lock);
+        scan->slots[batch % scan->slot_count].batch = batch;
+        scan->slots[batch % scan->slot_count].done = true;
+        pthread_cond_broadcast(&scan->cond);
+    }
+    pthread_mutex_unlock(&scan->lock);
+
+    free(ctx);
+    return NULL;
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+uint32_t library_scan_format(const char *name)
+{
+    static const struct {
+        const char *ext;
+        uint32_t format;
+    } formats[] = {
+        { "mp3", LIBRARY_SCAN_FORMAT_MP3 },
+        { "wav", LIBRARY_SCAN_FORMAT_WAV },
+        { "flac", LIBRARY_SCAN_FORMAT_FLAC },
+        { "ogg", LIBRARY_SCAN_FORMAT_OGG },
+        { "oga", LIBRARY_SCAN_FORMAT_OGG },
+        { "opus", LIBRARY_SCAN_FORMAT_OGG },
+        { "m4a", LIBRARY_SCAN_FORMAT_MP4 },
+        { "m4b", LIBRARY_SCAN_FORMAT_MP4 },
+        { "mp4", LIBRARY_SCAN_FORMAT_MP4 },
+    };
+
+    const char *dot = strrchr(name, '.');
+    if (!dot) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        if (strcasecmp(dot + 1, formats[i].ext) == 0) {
+            return formats[i].format;
+        }
+    }
+    return 0;
+}
+
+int library_scan_file(const char *path, library_scan_track_s *track)
+{
+    scan_ctx_s *ctx = malloc(sizeof(scan_ctx_s));
+    if (!ctx) {
+        return -1;
+    }
+
+    int ret = read_file(ctx, path, track);
+    free(ctx);
+    return ret;
+}
+
+void library_scan_dir_cover(const char *root, const char *dir, char *cover, size_t size)
+{
+    char full[LIBRARY_SCAN_PATH_MAX * 2];
+    char best[LIBRARY_SCAN_PATH_MAX] = "";
+    struct dirent *ent;
+
+    cover[0] = '\0';
+    snprintf(full, sizeof(full), "%s%s%s", root, dir[0] ? "/" : "", dir);
+    DIR *d = opendir(full);
+    if (!d) {
+        return;
+    }
+
+    // Same pick as the walk: the first match in sorted order
+    while ((ent = readdir(d)) != NULL) {
+        if (is_cover_name(ent->d_name) && (best[0] == '\0' || strcmp(ent->d_name, best) < 0) &&
+            strlen(ent->d_name) < sizeof(best)) {
+            strcpy(best, ent->d_name);
+        }
+    }
+    closedir(d);
+
+    if (best[0] != '\0') {
+        snprintf(cover, size, "%s%s%s", dir, dir[0] ? "/" : "", best);
+    }
+}
+
+int library_scan_run(const library_scan_config_s *config, library_scan_cb_t cb, void *user_data)
+{
+    struct timespec t0, t1, t2;
+    scan_state_s scan;
+    pthread_t threads[LIBRARY_SCAN_WORKERS_MAX];
+    int thread_count = 0;
+    int reported = 0;
+
+    memset(&scan, 0, sizeof(scan));
+    scan.config = config;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    // Offset 0 is the empty cover path
+    char rel[LIBRARY_SCAN_PATH_MAX] = "";
+    if (arena_add(&scan, "") == UINT32_MAX || walk_dir(&scan, rel, 0, 0) != 0) {
+        SCAN_LOG("Cannot scan %s", config->root);
+        free(scan.jobs);
+        free(scan.arena);
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    int workers = config->workers;
+    if (workers > LIBRARY_SCAN_WORKERS_MAX) {
+        workers = LIBRARY_SCAN_WORKERS_MAX;
+    }
+
+    scan.batch_count = (scan.job_count + LIBRARY_SCAN_BATCH - 1) / LIBRARY_SCAN_BATCH;
+    scan.slot_count = workers > 0 ? workers * 2 : 1;
+    scan.slots = calloc(scan.slot_count, sizeof(scan_slot_s));
+    scan_ctx_s *ctx = workers > 0 ? NULL : malloc(sizeof(scan_ctx_s));
+    if (!scan.slots || (workers == 0 && !ctx)) {
+        free(scan.slots);
+        free(ctx);
+        free(scan.jobs);
+        free(scan.arena);
+        return -1;
+    }
+    pthread_mutex_init(&scan.lock, NULL);
+    pthread_cond_init(&scan.cond, NULL);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, SCAN_STACKSIZE);
+    for (int i = 0; i < workers && scan.batch_count > 0; i++) {
+        if (pthread_create(&threads[thread_count], &attr, worker_thread_func, &scan) == 0) {
+            thread_count++;
+        }
+    }
+    pthread_attr_destroy(&attr);
+
+    // No thread could be started: read on this thread, one slot at a time
+    if (thread_count == 0 && !ctx) {
+        scan.slot_count = 1;
+        ctx = malloc(sizeof(scan_ctx_s));
+    }
+
+    bool stopped = false;
+    for (uint32_t batch = 0; batch < scan.batch_count && !stopped; batch++) {
+        scan_slot_s *slot = &scan.slots[batch % scan.slot_count];
+
+        if (thread_count == 0) {
+            if (!ctx) {
+                break;
+            }
+            process_batch(&scan, ctx, batch);
+        } else {
+            pthread_mutex_lock(&scan.lock);
+            while (!(slot->done && slot->batch == batch)) {
+                pthread_cond_wait(&scan.cond, &scan.lock);
+            }
+            pthread_mutex_unlock(&scan.lock);
+        }
+
+        uint32_t first = batch * LIBRARY_SCAN_BATCH;
+        for (uint32_t i = 0; i < LIBRARY_SCAN_BATCH && first + i < scan.job_count; i++) {
+            reported++;
+            if (!cb(&slot->tracks[i], user_data)) {
+                stopped = true;
+                break;
+            }
+        }
+
+        pthread_mutex_lock(&scan.lock);
+        slot->done = false;
+        scan.committed = batch + 1;
+        scan.stop = stopped;
+        pthread_cond_broadcast(&scan.cond);
+        pthread_mutex_unlock(&scan.lock);
+    }
+
+    pthread_mutex_lock(&scan.lock);
+    scan.stop = true;
+    pthread_cond_broadcast(&scan.cond);
+    pthread_mutex_unlock(&scan.lock);
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    uint32_t walk_ms = (t1.tv_sec - t0.tv_sec) * 1000 + (t1.tv_nsec - t0.tv_nsec) / 1000000;
+    uint32_t read_ms = (t2.tv_sec - t1.tv_sec) * 1000 + (t2.tv_nsec - t1.tv_nsec) / 1000000;
+    SCAN_LOG("Scanned %s: %lu files in %lu dirs, walk %lu ms, tags %lu ms with %d workers",
+             config->root, (unsigned long)scan.job_count, (unsigned long)scan.dir_count,
+             (unsigned long)walk_ms, (unsigned long)read_ms, thread_count);
+
+    pthread_cond_destroy(&scan.cond);
+    pthread_mutex_destroy(&scan.lock);
+    free(ctx);
+    free(scan.slots);
+    free(scan.jobs);
+    free(scan.arena);
+    return reported;
+}
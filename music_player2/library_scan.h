@@ -0,0 +1,110 @@
+/**
+ * Library Scanner Header
+ * Walks the music directory and reads tags and exact durations with a
+ * pool of worker threads, reporting tracks in directory order
+ */
+
+#ifndef LIBRARY_SCAN_H
+#define LIBRARY_SCAN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define LIBRARY_SCAN_FIELD_MAX   128   // Longest tag kept, including NUL
+#define LIBRARY_SCAN_PATH_MAX    256   // Longest relative path accepted
+#define LIBRARY_SCAN_DEPTH_MAX   8     // Deepest directory level visited
+#define LIBRARY_SCAN_BATCH       16    // Files handed to a worker at once
+#define LIBRARY_SCAN_WORKERS_MAX 8
+#define LIBRARY_SCAN_BLOCK_SIZE  4096  // Read size of the per-worker file window
+
+/* Bits in library_scan_config_s.formats */
+#define LIBRARY_SCAN_FORMAT_MP3  (1u << 0)
+#define LIBRARY_SCAN_FORMAT_WAV  (1u << 1)
+#define LIBRARY_SCAN_FORMAT_FLAC (1u << 2)
+#define LIBRARY_SCAN_FORMAT_OGG  (1u << 3)   // Vorbis and Opus
+#define LIBRARY_SCAN_FORMAT_MP4  (1u << 4)   // AAC/ALAC in MP4/M4A
+
+/* Formats the audio engine decodes */
+#define LIBRARY_SCAN_FORMATS_PLAYABLE (LIBRARY_SCAN_FORMAT_MP3 | LIBRARY_SCAN_FORMAT_WAV)
+#define LIBRARY_SCAN_FORMATS_ALL      0x1fu
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+typedef struct {
+    const char *root;        // Directory to walk (POSIX path)
+    int workers;             // Tag reader threads, 0 reads on the calling thread
+    uint32_t formats;        // LIBRARY_SCAN_FORMAT_* to report
+} library_scan_config_s;
+
+/* One scanned file, tags missing from the file are empty */
+typedef struct {
+    const char *path;        // Relative to the root
+    const char *cover;       // Relative cover image of the directory, "" if none
+    char title[LIBRARY_SCAN_FIELD_MAX];   // File name without extension when untagged
+    char artist[LIBRARY_SCAN_FIELD_MAX];
+    char album[LIBRARY_SCAN_FIELD_MAX];
+    uint32_t duration_ms;    // 0 if the stream could not be measured
+    uint32_t format;         // One LIBRARY_SCAN_FORMAT_* bit
+} library_scan_track_s;
+
+/**
+ * Track callback, always invoked on the thread that called library_scan_run()
+ * @param track Scanned file, only valid during the call
+ * @param user_data User pointer given to the scanner
+ * @return true to continue, false to stop the scan
+ */
+typedef bool (*library_scan_cb_t)(const library_scan_track_s *track, void *user_data);
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Scan a directory tree, blocking until every file has been reported
+ * @param config Scan options
+ * @param cb Called for every audio file, in sorted directory order
+ * @param user_data Passed to cb
+ * @return Number of files reported, -1 if the root cannot be read
+ */
+int library_scan_run(const library_scan_config_s *config, library_scan_cb_t cb, void *user_data);
+
+/**
+ * @brief Read the tags of a single file
+ * @param path Absolute file path
+ * @param track Output, path and cover are left untouched
+ * @return 0 on success, -1 if the file cannot be opened or has an unknown extension
+ */
+int library_scan_file(const char *path, library_scan_track_s *track);
+
+/**
+ * @brief Find the cover image of a directory the way the scan does
+ * @param root Scan root
+ * @param dir Directory relative to the root, "" for the root
+ * @param cover Output, relative to the root, "" if there is none
+ * @param size Output size
+ */
+void library_scan_dir_cover(const char *root, const char *dir, char *cover, size_t size);
+
+/**
+ * @brief Map a file name to its LIBRARY_SCAN_FORMAT_* bit
+ * @param name File name or path
+ * @return Format bit, 0 if the extension is not an audio format
+ */
+uint32_t library_scan_format(const char *name);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* LIBRARY_SCAN_H */
@@ -0,0 +1,765 @@
+/**
+ * Library Watcher
+ * Events are collected into a pending set until the tree has been quiet
+ * for debounce_ms, then only the touched files are stat'ed and their tags
+ * read. Without inotify, directories whose mtime changed are re-listed
+ * and diffed against the previous listing
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <pthread.h>
+#include <syslog.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#if defined(CONFIG_FS_NOTIFY) || (defined(__linux__) && !defined(__NuttX__))
+#include <sys/inotify.h>
+#define LIBRARY_WATCH_HAVE_INOTIFY 1
+#endif
+
+#include "library_watch.h"
+
+#define WATCH_LOG(fmt, ...) syslog(LOG_INFO, "[LIBWATCH] " fmt, ##__VA_ARGS__)
+
+#define WATCH_WAKE_MS      500    // Longest sleep, bounds the stop latency
+#define WATCH_EVENT_BUF    4096
+#define WATCH_MANIFEST     "manifest.json"
+
+#ifdef LIBRARY_WATCH_HAVE_INOTIFY
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)
+#endif
+
+/* Pending kinds */
+#define PENDING_FILE        0     // Stat decides between upsert and remove
+#define PENDING_DIR_REMOVED 1
+
+/* Listing entry, kept only when polling */
+typedef struct {
+    char *name;
+    int64_t mtime;
+    int64_t size;
+} watch_file_s;
+
+typedef struct {
+    char *rel;               // "" for the root
+    int wd;                  // inotify watch, -1 when polling
+    int64_t mtime;
+    watch_file_s *files;     // Sorted by name
+    uint32_t file_count;
+} watch_dir_s;
+
+typedef struct {
+    char *path;
+    uint32_t hash;
+    uint8_t kind;
+} watch_pending_s;
+
+// Variables
+static struct {
+    library_watch_config_s config;
+    char root[LIBRARY_SCAN_PATH_MAX];
+    pthread_t thread;
+    pthread_mutex_t lock;
+    bool running;
+    bool started;
+    int fd;                  // inotify descriptor, -1 when polling
+
+    watch_dir_s *dirs;
+    uint32_t dir_count;
+    uint32_t dir_capacity;
+
+    // Coalesced events, owned by the watcher thread
+    watch_pending_s *pending;
+    uint32_t pending_count;
+    uint32_t pending_capacity;
+    uint64_t last_event_ms;
+    bool reload;
+    int64_t manifest_mtime;
+    int64_t manifest_size;
+
+    // Ready changes, guarded by lock
+    library_change_s *ready;
+    uint32_t ready_count;
+} watch;
+
+// Functions
+static uint64_t now_ms(void);
+static uint32_t path_hash(const char *path);
+static int path_join(char *out, size_t size, const char *dir, const char *name);
+static void pending_add(const char *path, uint8_t kind);
+static void pending_clear(void);
+static int file_compare(const void *a, const void *b);
+static int dir_list(const char *rel, watch_file_s **files, uint32_t *count, char ***subdirs, uint32_t *subdir_count);
+static void files_free(watch_file_s *files, uint32_t count);
+static watch_dir_s *dir_find(const char *rel);
+static void dir_register(const char *rel, int depth, bool report_files);
+static void dir_forget(const char *rel);
+static void manifest_check(void);
+static void poll_dirs(void);
+#ifdef LIBRARY_WATCH_HAVE_INOTIFY
+static void inotify_read(void);
+#endif
+static void process_pending(void);
+static void *watch_thread_func(void *arg);
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* FNV-1a */
+static uint32_t path_hash(const char *path)
+{
+    uint32_t hash = 2166136261u;
+    while (*path) {
+        hash ^= (uint8_t)*path++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Returns -1 when the path does not fit, callers skip such entries */
+static int path_join(char *out, size_t size, const char *dir, const char *name)
+{
+    int len = snprintf(out, size, "%s%s%s", dir, dir[0] ? "/" : "", name);
+    return len >= 0 && (size_t)len < size ? 0 : -1;
+}
+
+/* Repeated events for one path collapse into a single entry */
+static void pending_add(const char *path, uint8_t kind)
+{
+    uint32_t hash = path_hash(path);
+    watch.last_event_ms = now_ms();
+
+    for (uint32_t i = 0; i < watch.pending_count; i++) {
+        if (watch.pending[i].hash == hash && strcmp(watch.pending[i].path, path) == 0) {
+            watch.pending[i].kind = kind;
+            return;
+        }
+    }
+
+    if (watch.pending_count == watch.pending_capacity) {
+        uint32_t capacity = watch.pending_capacity ? watch.pending_capacity * 2 : 64;
+        watch_pending_s *pending = realloc(watch.pending, capacity * sizeof(watch_pending_s));
+        if (!pending) {
+            watch.reload = true;   // Losing an event would leave the library wrong
+            return;
+        }
+        watch.pending = pending;
+        watch.pending_capacity = capacity;
+    }
+
+    char *copy = strdup(path);
+    if (!copy) {
+        watch.reload = true;
+        return;
+    }
+    watch.pending[watch.pending_count++] = (watch_pending_s) { copy, hash, kind };
+}
+
+static void pending_clear(void)
+{
+    for (uint32_t i = 0; i < watch.pending_count; i++) {
+        free(watch.pending[i].path);
+    }
+    watch.pending_count = 0;
+}
+
+static int file_compare(const void *a, const void *b)
+{
+    return strcmp(((const watch_file_s *)a)->name, ((const watch_file_s *)b)->name);
+}
+
+/* List audio files (with stat) and subdirectories of one directory */
+static int dir_list(const char *rel, watch_file_s **files, uint32_t *count, char ***subdirs, uint32_t *subdir_count)
+{
+    char full[LIBRARY_SCAN_PATH_MAX * 2];
+    char path[LIBRARY_SCAN_PATH_MAX * 3];
+    struct dirent *ent;
+    uint32_t capacity = 0;
+    uint32_t subdir_capacity = 0;
+
+    *files = NULL;
+    *count = 0;
+    *subdirs = NULL;
+    *subdir_count = 0;
+
+    if (path_join(full, sizeof(full), watch.root, rel) != 0) {
+        return -1;
+    }
+    DIR *dir = opendir(full);
+    if (!dir) {
+        return -1;
+    }
+
+    while ((ent = readdir(dir)) != NULL) {
+        struct stat st;
+        if (ent->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", full, ent->d_name);
+        if (stat(path, &st) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            if (*subdir_count == subdir_capacity) {
+                subdir_capacity = subdir_capacity ? subdir_capacity * 2 : 8;
+                char **grown = realloc(*subdirs, subdir_capacity * sizeof(char *));
+                if (!grown) {
+                    break;
+                }
+                *subdirs = grown;
+            }
+            char *name = strdup(ent->d_name);
+            if (name) {
+                (*subdirs)[(*subdir_count)++] = name;
+            }
+        } else if (watch.config.watch_files && library_scan_format(ent->d_name) & watch.config.formats) {
+            if (*count == capacity) {
+                capacity = capacity ? capacity * 2 : 16;
+                watch_file_s *grown = realloc(*files, capacity * sizeof(watch_file_s));
+                if (!grown) {
+                    break;
+                }
+                *files = grown;
+            }
+            char *name = strdup(ent->d_name);
+            if (name) {
+                (*files)[(*count)++] = (watch_file_s) { name, st.st_mtime, st.st_size };
+            }
+        }
+    }
+    closedir(dir);
+
+    if (*count > 1) {
+        qsort(*files, *count, sizeof(watch_file_s), file_compare);
+    }
+    return 0;
+}
+
+static void files_free(watch_file_s *files, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        free(files[i].name);
+    }
+    free(files);
+}
+
+static watch_dir_s *dir_find(const char *rel)
+{
+    for (uint32_t i = 0; i < watch.dir_count; i++) {
+        if (strcmp(watch.dirs[i].rel, rel) == 0) {
+            return &watch.dirs[i];
+        }
+    }
+    return NULL;
+}
+
+/* Track a directory tree, optionally reporting its files as new */
+static void dir_register(const char *rel, int depth, bool report_files)
+{
+    watch_file_s *files;
+    char **subdirs;
+    uint32_t count;
+    uint32_t subdir_count;
+    char full[LIBRARY_SCAN_PATH_MAX * 2];
+    struct stat st;
+
+    if (depth >= LIBRARY_SCAN_DEPTH_MAX || dir_find(rel)) {
+        return;
+    }
+
+    if (path_join(full, sizeof(full), watch.root, rel) != 0 || stat(full, &st) != 0) {
+        return;
+    }
+
+    // Watch before listing so that nothing created in between is missed
+    int wd = -1;
+#ifdef LIBRARY_WATCH_HAVE_INOTIFY
+    if (watch.fd >= 0) {
+        wd = inotify_add_watch(watch.fd, full, WATCH_MASK);
+        if (wd < 0) {
+            WATCH_LOG("Cannot watch %s: %d", full, errno);
+        }
+    }
+#endif
+
+    if (dir_list(rel, &files, &count, &subdirs, &subdir_count) != 0) {
+        return;
+    }
+
+    if (watch.dir_count == watch.dir_capacity) {
+        uint32_t capacity = watch.dir_capacity ? watch.dir_capacity * 2 : 32;
+        watch_dir_s *dirs = realloc(watch.dirs, capacity * sizeof(watch_dir_s));
+        if (!dirs) {
+            files_free(files, count);
+            for (uint32_t i = 0; i < subdir_count; i++) {
+                free(subdirs[i]);
+            }
+            free(subdirs);
+            return;
+        }
+        watch.dirs = dirs;
+        watch.dir_capacity = capacity;
+    }
+
+    char path[LIBRARY_SCAN_PATH_MAX];
+    for (uint32_t i = 0; i < count && report_files; i++) {
+        if (path_join(path, sizeof(path), rel, files[i].name) == 0) {
+            pending_add(path, PENDING_FILE);
+        }
+    }
+
+    // Listings are only needed to diff directories when polling
+    if (watch.fd >= 0) {
+        files_free(files, count);
+        files = NULL;
+        count = 0;
+    }
+
+    watch.dirs[watch.dir_count++] = (watch_dir_s) { strdup(rel), wd, st.st_mtime, files, count };
+
+    for (uint32_t i = 0; i < subdir_count; i++) {
+        if (path_join(path, sizeof(path), rel, subdirs[i]) == 0) {
+            dir_register(path, depth + 1, report_files);
+        }
+        free(subdirs[i]);
+    }
+    free(subdirs);
+}
+
+/* Drop a directory and everything below it */
+static void dir_forget(const char *rel)
+{
+    size_t len = strlen(rel);
+
+    for (uint32_t i = 0; i < watch.dir_count;) {
+        watch_dir_s *dir = &watch.dirs[i];
+        if (strncmp(dir->rel, rel, len) != 0 || (dir->rel[len] != '\0' && dir->rel[len] != '/')) {
+            i++;
+            continue;
+        }
+
+#ifdef LIBRARY_WATCH_HAVE_INOTIFY
+        if (watch.fd >= 0 && dir->wd >= 0) {
+            inotify_rm_watch(watch.fd, dir->wd);
+        }
+#endif
+        free(dir->rel);
+        files_free(dir->files, dir->file_count);
+        watch.dirs[i] = watch.dirs[--watch.dir_count];
+    }
+}
+
+/* Any change to the manifest means a full reload */
+static void manifest_check(void)
+{
+    char path[LIBRARY_SCAN_PATH_MAX * 2];
+    struct stat st;
+    int64_t mtime = -1;
+    int64_t size = -1;
+
+    if (path_join(path, sizeof(path), watch.root, WATCH_MANIFEST) == 0 && stat(path, &st) == 0) {
+        mtime = st.st_mtime;
+        size = st.st_size;
+    }
+
+    if (mtime != watch.manifest_mtime || size != watch.manifest_size) {
+        watch.manifest_mtime = mtime;
+        watch.manifest_size = size;
+        watch.reload = true;
+        watch.last_event_ms = now_ms();
+    }
+}
+
+/* Fallback: re-list directories whose mtime moved and diff the listings */
+static void poll_dirs(void)
+{
+    char full[LIBRARY_SCAN_PATH_MAX * 2];
+    char path[LIBRARY_SCAN_PATH_MAX];
+    struct stat st;
+
+    manifest_check();
+    if (!watch.config.watch_files) {
+        return;
+    }
+
+    // Registering new subdirectories appends to the table, the loop covers them too
+    for (uint32_t d = 0; d < watch.dir_count; d++) {
+        watch_dir_s *dir = &watch.dirs[d];
+        if (path_join(full, sizeof(full), watch.root, dir->rel) != 0) {
+            continue;
+        }
+
+        if (stat(full, &st) != 0) {
+            char *rel = strdup(dir->rel);
+            if (rel) {
+                pending_add(rel, PENDING_DIR_REMOVED);
+                dir_forget(rel);
+                free(rel);
+            }
+            d = (uint32_t)-1;   // The table was reshuffled, start over
+            continue;
+        }
+        if (st.st_mtime == dir->mtime) {
+            continue;
+        }
+        dir->mtime = st.st_mtime;
+
+        watch_file_s *files;
+        char **subdirs;
+        uint32_t count;
+        uint32_t subdir_count;
+        if (dir_list(dir->rel, &files, &count, &subdirs, &subdir_count) != 0) {
+            continue;
+        }
+
+        // Merge the sorted listings
+        uint32_t i = 0;
+        uint32_t j = 0;
+        while (i < dir->file_count || j < count) {
+            int cmp = i == dir->file_count ? 1 : j == count ? -1 : strcmp(dir->files[i].name, files[j].name);
+            if (cmp < 0) {
+                if (path_join(path, sizeof(path), dir->rel, dir->files[i++].name) == 0) {
+                    pending_add(path, PENDING_FILE);
+                }
+            } else if (cmp > 0) {
+                if (path_join(path, sizeof(path), dir->rel, files[j++].name) == 0) {
+                    pending_add(path, PENDING_FILE);
+                }
+            } else {
+                if ((dir->files[i].mtime != files[j].mtime || dir->files[i].size != files[j].size) &&
+                    path_join(path, sizeof(path), dir->rel, files[j].name) == 0) {
+                    pending_add(path, PENDING_FILE);
+                }
+                i++;
+                j++;
+            }
+        }
+        files_free(dir->files, dir->file_count);
+        dir->files = files;
+        dir->file_count = count;
+
+        char *rel = strdup(dir->rel);
+        for (uint32_t k = 0; k < subdir_count; k++) {
+            if (rel && path_join(path, sizeof(path), rel, subdirs[k]) == 0) {
+                dir_register(path, 1, true);
+            }
+            free(subdirs[k]);
+        }
+        free(subdirs);
+        free(rel);
+    }
+}
+
+#ifdef LIBRARY_WATCH_HAVE_INOTIFY
+static void inotify_read(void)
+{
+    char buf[WATCH_EVENT_BUF] __attribute__((aligned(__alignof__(struct inotify_event))));
+    char path[LIBRARY_SCAN_PATH_MAX];
+
+    ssize_t len = read(watch.fd, buf, sizeof(buf));
+    for (ssize_t pos = 0; pos + (ssize_t)sizeof(struct inotify_event) <= len;) {
+        const struct inotify_event *ev = (const struct inotify_event *)(buf + pos);
+        pos += sizeof(struct inotify_event) + ev->len;
+
+        if (ev->mask & IN_Q_OVERFLOW) {
+            WATCH_LOG("Event queue overflow, full reload");
+            watch.reload = true;
+            watch.last_event_ms = now_ms();
+            continue;
+        }
+
+        watch_dir_s *dir = NULL;
+        for (uint32_t i = 0; i < watch.dir_count; i++) {
+            if (watch.dirs[i].wd == ev->wd) {
+                dir = &watch.dirs[i];
+                break;
+            }
+        }
+        if (!dir || ev->len == 0 || ev->name[0] == '.') {
+            continue;
+        }
+
+        if (dir->rel[0] == '\0' && strcmp(ev->name, WATCH_MANIFEST) == 0) {
+            manifest_check();
+            continue;
+        }
+        if (!watch.config.watch_files || path_join(path, sizeof(path), dir->rel, ev->name) != 0) {
+            continue;
+        }
+
+        if (ev->mask & IN_ISDIR) {
+            if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+                dir_register(path, 1, true);
+            } else if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                pending_add(path, PENDING_DIR_REMOVED);
+                dir_forget(path);
+            }
+        } else if (library_scan_format(ev->name) & watch.config.formats) {
+            pending_add(path, PENDING_FILE);
+        }
+    }
+}
+#endif
+
+/* Turn up to LIBRARY_WATCH_PUBLISH_MAX pending entries into ready changes */
+static void process_pending(void)
+{
+    char full[LIBRARY_SCAN_PATH_MAX * 2];
+    char cover_dir[LIBRARY_SCAN_PATH_MAX] = "";
+    char cover[LIBRARY_SCAN_PATH_MAX] = "";
+    bool cover_valid = false;
+    uint32_t produced = 0;
+    uint32_t taken = 0;
+
+    library_change_s *changes = malloc(LIBRARY_WATCH_PUBLISH_MAX * sizeof(library_change_s));
+    if (!changes) {
+        return;
+    }
+
+    if (watch.reload) {
+        // Everything is re-read anyway
+        pending_clear();
+        watch.reload = false;
+        changes[0].type = LIBRARY_CHANGE_RELOAD;
+        changes[0].path[0] = '\0';
+        produced = 1;
+    }
+
+    for (; taken < watch.pending_count && produced < LIBRARY_WATCH_PUBLISH_MAX; taken++) {
+        watch_pending_s *p = &watch.pending[taken];
+        library_change_s *change = &changes[produced];
+        struct stat st;
+
+        snprintf(change->path, sizeof(change->path), "%s", p->path);
+        if (p->kind == PENDING_DIR_REMOVED) {
+            change->type = LIBRARY_CHANGE_REMOVE_DIR;
+            produced++;
+            continue;
+        }
+
+        if (path_join(full, sizeof(full), watch.root, p->path) != 0 ||
+            stat(full, &st) != 0 || !S_ISREG(st.st_mode)) {
+            change->type = LIBRARY_CHANGE_REMOVE;
+            produced++;
+            continue;
+        }
+
+        if (library_scan_file(full, &change->track) != 0) {
+            continue;
+        }
+
+        // Tracks of one directory usually arrive together, look the cover up once
+        char dir[LIBRARY_SCAN_PATH_MAX];
+        snprintf(dir, sizeof(dir), "%s", p->path);
+        char *slash = strrchr(dir, '/');
+        if (slash) {
+            *slash = '\0';
+        } else {
+            dir[0] = '\0';
+        }
+        if (!cover_valid || strcmp(dir, cover_dir) != 0) {
+            library_scan_dir_cover(watch.root, dir, cover, sizeof(cover));
+            snprintf(cover_dir, sizeof(cover_dir), "%s", dir);
+            cover_valid = true;
+        }
+
+        change->type = LIBRARY_CHANGE_UPSERT;
+        snprintf(change->cover, sizeof(change->cover), "%s", cover);
+        produced++;
+    }
+
+    // Keep the rest for the next round
+    for (uint32_t i = 0; i < taken; i++) {
+        free(watch.pending[i].path);
+    }
+    memmove(watch.pending, watch.pending + taken, (watch.pending_count - taken) * sizeof(watch_pending_s));
+    watch.pending_count -= taken;
+
+    pthread_mutex_lock(&watch.lock);
+    free(watch.ready);
+    watch.ready = changes;
+    watch.ready_count = produced;
+    pthread_mutex_unlock(&watch.lock);
+
+    if (produced > 0) {
+        WATCH_LOG("%lu changes ready, %lu still pending", (unsigned long)produced, (unsigned long)watch.pending_count);
+    }
+}
+
+static void *watch_thread_func(void *arg)
+{
+    (void)arg;
+    uint64_t start = now_ms();
+    uint64_t next_poll = start + watch.config.poll_ms;
+
+    // The tree as it is now is what the library was built from
+    bool reload = watch.reload;
+    manifest_check();
+    watch.reload = reload;
+    dir_register("", 0, false);
+    WATCH_LOG("Watching %s: %lu dirs with %s, ready in %lu ms", watch.root, (unsigned long)watch.dir_count,
+              watch.fd >= 0 ? "inotify" : "mtime polling", (unsigned long)(now_ms() - start));
+
+    pthread_mutex_lock(&watch.lock);
+    while (watch.running) {
+        pthread_mutex_unlock(&watch.lock);
+
+        uint64_t now = now_ms();
+        uint32_t wait = WATCH_WAKE_MS;
+        bool busy = watch.pending_count > 0 || watch.reload;
+        if (busy && watch.last_event_ms + watch.config.debounce_ms > now) {
+            uint64_t left = watch.last_event_ms + watch.config.debounce_ms - now;
+            wait = left < wait ? left : wait;
+        }
+
+#ifdef LIBRARY_WATCH_HAVE_INOTIFY
+        if (watch.fd >= 0) {
+            struct pollfd pfd = { .fd = watch.fd, .events = POLLIN };
+            if (poll(&pfd, 1, wait) > 0 && (pfd.revents & POLLIN)) {
+                inotify_read();
+            }
+        } else
+#endif
+        {
+            usleep(wait * 1000);
+            if (now_ms() >= next_poll) {
+                poll_dirs();
+                next_poll = now_ms() + watch.config.poll_ms;
+            }
+        }
+
+        // Publish once the burst is over and the UI has taken the previous batch
+        busy = watch.pending_count > 0 || watch.reload;
+        if (busy && now_ms() >= watch.last_event_ms + watch.config.debounce_ms) {
+            pthread_mutex_lock(&watch.lock);
+            bool drained = watch.ready_count == 0;
+            pthread_mutex_unlock(&watch.lock);
+            if (drained) {
+                process_pending();
+            }
+        }
+
+        pthread_mutex_lock(&watch.lock);
+    }
+    pthread_mutex_unlock(&watch.lock);
+    return NULL;
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+int library_watch_start(const library_watch_config_s *config)
+{
+    if (watch.started) {
+        return -1;
+    }
+
+    memset(&watch, 0, sizeof(watch));
+    watch.config = *config;
+    snprintf(watch.root, sizeof(watch.root), "%s", config->root);
+    watch.config.root = watch.root;
+    watch.fd = -1;
+
+#ifdef LIBRARY_WATCH_HAVE_INOTIFY
+    watch.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch.fd < 0) {
+        WATCH_LOG("inotify unavailable (%d), polling every %lu ms", errno, (unsigned long)config->poll_ms);
+    }
+#endif
+
+    if (pthread_mutex_init(&watch.lock, NULL) != 0) {
+        goto errout;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, LIBRARY_WATCH_STACKSIZE);
+    watch.running = true;
+    int ret = pthread_create(&watch.thread, &attr, watch_thread_func, NULL);
+    pthread_attr_destroy(&attr);
+    if (ret != 0) {
+        pthread_mutex_destroy(&watch.lock);
+        goto errout;
+    }
+
+    watch.started = true;
+    return 0;
+
+errout:
+    if (watch.fd >= 0) {
+        close(watch.fd);
+    }
+    watch.fd = -1;
+    return -1;
+}
+
+void library_watch_stop(void)
+{
+    if (!watch.started) {
+        return;
+    }
+
+    pthread_mutex_lock(&watch.lock);
+    watch.running = false;
+    pthread_mutex_unlock(&watch.lock);
+    pthread_join(watch.thread, NULL);
+
+    // Closing the descriptor drops the inotify watches
+    for (uint32_t i = 0; i < watch.dir_count; i++) {
+        free(watch.dirs[i].rel);
+        files_free(watch.dirs[i].files, watch.dirs[i].file_count);
+    }
+    free(watch.dirs);
+    pending_clear();
+    free(watch.pending);
+    free(watch.ready);
+    if (watch.fd >= 0) {
+        close(watch.fd);
+    }
+    pthread_mutex_destroy(&watch.lock);
+    memset(&watch, 0, sizeof(watch));
+    watch.fd = -1;
+}
+
+int library_watch_drain(library_change_cb_t cb, void *user_data)
+{
+    if (!watch.started) {
+        return 0;
+    }
+
+    // Take the batch so the callback runs without the lock
+    pthread_mutex_lock(&watch.lock);
+    library_change_s *changes = watch.ready;
+    uint32_t count = watch.ready_count;
+    watch.ready = NULL;
+    watch.ready_count = 0;
+    pthread_mutex_unlock(&watch.lock);
+
+    for (uint32_t i = 0; i < count; i++) {
+        library_change_s *change = &changes[i];
+        change->track.path = change->path;
+        change->track.cover = change->cover;
+        cb(change, user_data);
+    }
+
+    free(changes);
+    return count;
+}
+
+bool library_watch_uses_inotify(void)
+{
+    return watch.started && watch.fd >= 0;
+}
@@ -0,0 +1,94 @@
+/**
+ * Library Watcher Header
+ * Follows changes under the music directory on a background thread and
+ * hands coalesced per-file updates to the UI thread
+ */
+
+#ifndef LIBRARY_WATCH_H
+#define LIBRARY_WATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "library_scan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define LIBRARY_WATCH_PUBLISH_MAX 64     // Changes handed over per drain
+#define LIBRARY_WATCH_STACKSIZE   8192
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+typedef enum {
+    LIBRARY_CHANGE_UPSERT = 0,   // File added or rewritten, track holds its tags
+    LIBRARY_CHANGE_REMOVE,       // File deleted or moved away
+    LIBRARY_CHANGE_REMOVE_DIR,   // Directory deleted or moved away, path is the directory
+    LIBRARY_CHANGE_RELOAD,       // Manifest changed or events were lost, rebuild everything
+} library_change_type_t;
+
+typedef struct {
+    library_change_type_t type;
+    char path[LIBRARY_SCAN_PATH_MAX];    // Relative to the root
+    char cover[LIBRARY_SCAN_PATH_MAX];
+    library_scan_track_s track;          // UPSERT only, path and cover point to the fields above
+} library_change_s;
+
+typedef struct {
+    const char *root;            // Music directory, copied
+    uint32_t formats;            // LIBRARY_SCAN_FORMAT_* reported as tracks
+    uint32_t debounce_ms;        // Quiet time before a burst of events is processed
+    uint32_t poll_ms;            // Directory mtime poll period without inotify
+    bool watch_files;            // false: only report manifest.json changes
+} library_watch_config_s;
+
+/**
+ * Change callback, invoked from library_watch_drain()
+ * @param change Change, only valid during the call
+ * @param user_data User pointer given to library_watch_drain()
+ */
+typedef void (*library_change_cb_t)(const library_change_s *change, void *user_data);
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Start watching, the current tree is taken as the known state
+ * @param config Watch options
+ * @return 0 on success, -1 on failure
+ */
+int library_watch_start(const library_watch_config_s *config);
+
+/**
+ * @brief Stop the watcher thread and drop pending changes
+ */
+void library_watch_stop(void);
+
+/**
+ * @brief Hand ready changes to the caller, meant for the UI thread
+ * @param cb Called for each change in event order
+ * @param user_data Passed to cb
+ * @return Number of changes reported
+ */
+int library_watch_drain(library_change_cb_t cb, void *user_data);
+
+/**
+ * @brief Check whether kernel notifications are in use
+ * @return true with inotify, false when polling directory mtimes
+ */
+bool library_watch_uses_inotify(void);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* LIBRARY_WATCH_H */
@@ -0,0 +1,404 @@
+/**
+ * Streaming Manifest Parser
+ * Incremental JSON tokenizer with just enough grammar to follow
+ * { "musics": [ { "key": value, ... }, ... ] } and skip everything else
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <lvgl.h>
+
+#include "manifest_parser.h"
+
+/* Lexer states */
+#define LEX_NONE    0
+#define LEX_STRING  1
+#define LEX_ESCAPE  2
+#define LEX_UNICODE 3
+#define LEX_LITERAL 4
+
+/* Depth d uses bit d of array_mask, shifting by the mask width would be undefined */
+_Static_assert(MANIFEST_DEPTH_MAX < sizeof(((manifest_parser_s *)0)->array_mask) * 8,
+               "array_mask has no bit for the deepest nesting");
+
+// Functions
+static void token_append(manifest_parser_s *parser, char c);
+static void token_append_utf8(manifest_parser_s *parser, uint32_t cp);
+static bool is_literal_char(char c);
+static int on_open(manifest_parser_s *parser, bool array);
+static int on_close(manifest_parser_s *parser, bool array);
+static void on_value(manifest_parser_s *parser, bool is_string);
+static void copy_field(char *dst, size_t size, const char *src);
+
+static void token_append(manifest_parser_s *parser, char c)
+{
+    // Overlong values are truncated, the rest of the token is still consumed
+    if (parser->token_len < sizeof(parser->token) - 1) {
+        parser->token[parser->token_len++] = c;
+    }
+}
+
+static void token_append_utf8(manifest_parser_s *parser, uint32_t cp)
+{
+    if (cp < 0x80) {
+        token_append(parser, (char)cp);
+    } else if (cp < 0x800) {
+        token_append(parser, (char)(0xc0 | (cp >> 6)));
+        token_append(parser, (char)(0x80 | (cp & 0x3f)));
+    } else if (cp < 0x10000) {
+        token_append(parser, (char)(0xe0 | (cp >> 12)));
+        token_append(parser, (char)(0x80 | ((cp >> 6) & 0x3f)));
+        token_append(parser, (char)(0x80 | (cp & 0x3f)));
+    } else {
+        token_append(parser, (char)(0xf0 | (cp >> 18)));
+        token_append(parser, (char)(0x80 | ((cp >> 12) & 0x3f)));
+        token_append(parser, (char)(0x80 | ((cp >> 6) & 0x3f)));
+        token_append(parser, (char)(0x80 | (cp & 0x3f)));
+    }
+}
+
+static bool is_literal_char(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+           c == '-' || c == '+' || c == '.' || c == 'E';
+}
+
+static void copy_field(char *dst, size_t size, const char *src)
+{
+    size_t len = strlen(src);
+    if (len >= size) {
+        len = size - 1;
+    }
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+static int on_open(manifest_parser_s *parser, bool array)
+{
+    if (parser->depth >= MANIFEST_DEPTH_MAX) {
+        LV_LOG_ERROR("Manifest nesting too deep at line %lu", (unsigned long)parser->line);
+        return -1;
+    }
+
+    // The value of the root "musics" key holds the entries
+    if (array && parser->depth == 1 && !(parser->array_mask & 1u << 1) &&
+        strcmp(parser->key, "musics") == 0) {
+        parser->musics_depth = 2;
+    }
+
+    // An object directly inside "musics" is one entry
+    if (!array && parser->musics_depth != 0 && parser->depth == parser->musics_depth) {
+        memset(&parser->entry, 0, sizeof(parser->entry));
+        parser->in_entry = true;
+    }
+
+    parser->depth++;
+    if (array) {
+        parser->array_mask |= 1u << parser->depth;
+    } else {
+        parser->array_mask &= ~(1u << parser->depth);
+    }
+    parser->expect_key = !array;
+    return 0;
+}
+
+static int on_close(manifest_parser_s *parser, bool array)
+{
+    if (parser->depth == 0 || array != !!(parser->array_mask & 1u << parser->depth)) {
+        LV_LOG_ERROR("Manifest has mismatched bracket at line %lu", (unsigned long)parser->line);
+        return -1;
+    }
+
+    parser->depth--;
+    parser->expect_key = false;
+
+    if (array && parser->musics_depth != 0 && parser->depth + 1 == parser->musics_depth) {
+        parser->musics_depth = 0;
+    }
+
+    if (!array && parser->in_entry && parser->depth == parser->musics_depth) {
+        parser->in_entry = false;
+        parser->entry_count++;
+        if (parser->cb && !parser->cb(&parser->entry, parser->user_data)) {
+            parser->stopped = true;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void on_value(manifest_parser_s *parser, bool is_string)
+{
+    parser->token[parser->token_len] = '\0';
+
+    bool in_object = parser->depth > 0 && !(parser->array_mask & 1u << parser->depth);
+    if (in_object && parser->expect_key) {
+        copy_field(parser->key, sizeof(parser->key), is_string ? parser->token : "");
+        parser->expect_key = false;
+        return;
+    }
+
+    // Only scalar members of an entry are of interest
+    if (!parser->in_entry || parser->depth != parser->musics_depth + 1) {
+        return;
+    }
+
+    manifest_entry_s *entry = &parser->entry;
+    const char *key = parser->key;
+
+    if (is_string) {
+        if (strcmp(key, "path") == 0) {
+            copy_field(entry->path, sizeof(entry->path), parser->token);
+            entry->fields |= MANIFEST_FIELD_PATH;
+        } else if (strcmp(key, "name") == 0) {
+            copy_field(entry->name, sizeof(entry->name), parser->token);
+            entry->fields |= MANIFEST_FIELD_NAME;
+        } else if (strcmp(key, "artist") == 0) {
+            copy_field(entry->artist, sizeof(entry->artist), parser->token);
+            entry->fields |= MANIFEST_FIELD_ARTIST;
+        } else if (strcmp(key, "album") == 0) {
+            copy_field(entry->album, sizeof(entry->album), parser->token);
+            entry->fields |= MANIFEST_FIELD_ALBUM;
+        } else if (strcmp(key, "cover") == 0) {
+            copy_field(entry->cover, sizeof(entry->cover), parser->token);
+            entry->fields |= MANIFEST_FIELD_COVER;
+        } else if (strcmp(key, "color") == 0) {
+            copy_field(entry->color, sizeof(entry->color), parser->token);
+            entry->fields |= MANIFEST_FIELD_COLOR;
+        }
+    } else if (strcmp(key, "total_time") == 0) {
+        char *end;
+        double value = strtod(parser->token, &end);
+        if (end != parser->token) {
+            entry->total_time = value;
+            entry->fields |= MANIFEST_FIELD_TOTAL_TIME;
+        }
+    }
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+void manifest_parser_init(manifest_parser_s *parser, manifest_entry_cb_t cb, void *user_data)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->cb = cb;
+    parser->user_data = user_data;
+    parser->line = 1;
+}
+
+int manifest_parser_feed(manifest_parser_s *parser, const char *data, size_t len)
+{
+    if (parser->error) {
+        return -1;
+    }
+    if (parser->stopped) {
+        return 1;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+
+        switch (parser->lex_state) {
+        case LEX_STRING:
+            if (c == '"') {
+                parser->lex_state = LEX_NONE;
+                on_value(parser, true);
+            } else if (c == '\\') {
+                parser->lex_state = LEX_ESCAPE;
+            } else {
+                token_append(parser, c);
+            }
+            continue;
+
+        case LEX_ESCAPE:
+            parser->lex_state = LEX_STRING;
+            switch (c) {
+            case 'n': token_append(parser, '\n'); break;
+            case 't': token_append(parser, '\t'); break;
+            case 'r': token_append(parser, '\r'); break;
+            case 'b': token_append(parser, '\b'); break;
+            case 'f': token_append(parser, '\f'); break;
+            case 'u':
+                parser->lex_state = LEX_UNICODE;
+                parser->unicode = 0;
+                parser->unicode_digits = 0;
+                break;
+            default: token_append(parser, c); break;
+            }
+            continue;
+
+        case LEX_UNICODE: {
+            int digit;
+            if (c >= '0' && c <= '9') digit = c - '0';
+            else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+            else {
+                LV_LOG_ERROR("Manifest has bad \\u escape at line %lu", (unsigned long)parser->line);
+                parser->error = true;
+                return -1;
+            }
+
+            parser->unicode = parser->unicode << 4 | digit;
+            if (++parser->unicode_digits < 4) {
+                continue;
+            }
+
+            parser->lex_state = LEX_STRING;
+            uint32_t cp = parser->unicode;
+            if (cp >= 0xd800 && cp < 0xdc00) {
+                parser->high_surrogate = cp;
+                continue;
+            }
+            if (cp >= 0xdc00 && cp < 0xe000 && parser->high_surrogate) {
+                cp = 0x10000 + ((parser->high_surrogate - 0xd800) << 10) + (cp - 0xdc00);
+            }
+            parser->high_surrogate = 0;
+            token_append_utf8(parser, cp);
+            continue;
+        }
+
+        case LEX_LITERAL:
+            if (is_literal_char(c)) {
+                token_append(parser, c);
+                continue;
+            }
+            parser->lex_state = LEX_NONE;
+            on_value(parser, false);
+            break;  // Reprocess c as a structural character
+
+        default:
+            break;
+        }
+
+        int ret = 0;
+        switch (c) {
+        case ' ':
+        case '\t':
+        case '\r':
+            break;
+        case '\n':
+            parser->line++;
+            break;
+        case '{':
+            ret = on_open(parser, false);
+            break;
+        case '[':
+            ret = on_open(parser, true);
+            break;
+        case '}':
+            ret = on_close(parser, false);
+            break;
+        case ']':
+            ret = on_close(parser, true);
+            break;
+        case ',':
+            parser->expect_key = parser->depth > 0 && !(parser->array_mask & 1u << parser->depth);
+            break;
+        case ':':
+            break;
+        case '"':
+            parser->lex_state = LEX_STRING;
+            parser->token_len = 0;
+            parser->high_surrogate = 0;
+            break;
+        default:
+            if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+                parser->lex_state = LEX_LITERAL;
+                parser->token_len = 0;
+                token_append(parser, c);
+            } else {
+                LV_LOG_ERROR("Manifest has unexpected '%c' at line %lu", c, (unsigned long)parser->line);
+                ret = -1;
+            }
+            break;
+        }
+
+        if (ret < 0) {
+            parser->error = true;
+            return -1;
+        }
+        if (ret > 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int manifest_parser_finish(manifest_parser_s *parser)
+{
+    if (parser->error) {
+        return -1;
+    }
+    if (parser->stopped) {
+        return 0;
+    }
+
+    if (parser->lex_state == LEX_LITERAL) {
+        parser->lex_state = LEX_NONE;
+        on_value(parser, false);
+    }
+
+    if (parser->lex_state != LEX_NONE || parser->depth != 0) {
+        LV_LOG_ERROR("Manifest truncated at line %lu", (unsigned long)parser->line);
+        return -1;
+    }
+    return 0;
+}
+
+int manifest_parse_file(const char *path, manifest_entry_cb_t cb, void *user_data)
+{
+    char chunk[MANIFEST_CHUNK_SIZE];
+    uint32_t start = lv_tick_get();
+    uint32_t total = 0;
+    int ret = 0;
+
+    // Plain POSIX I/O, the library may be loaded off the LVGL thread
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        LV_LOG_ERROR("Cannot open music manifest file: %s", path);
+        return -1;
+    }
+
+    manifest_parser_s *parser = malloc(sizeof(manifest_parser_s));
+    if (!parser) {
+        close(fd);
+        return -1;
+    }
+    manifest_parser_init(parser, cb, user_data);
+
+    while (ret == 0) {
+        ssize_t bytes_read = read(fd, chunk, sizeof(chunk));
+        if (bytes_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LV_LOG_ERROR("Manifest read failed after %lu bytes", (unsigned long)total);
+            ret = -1;
+            break;
+        }
+        if (bytes_read == 0) {
+            ret = manifest_parser_finish(parser);
+            break;
+        }
+        total += bytes_read;
+        ret = manifest_parser_feed(parser, chunk, bytes_read);
+    }
+
+    close(fd);
+
+    int count = ret < 0 ? -1 : (int)parser->entry_count;
+    LV_LOG_USER("Manifest parsed: %lu entries, %lu bytes in %lu ms",
+                (unsigned long)parser->entry_count, (unsigned long)total,
+                (unsigned long)lv_tick_elaps(start));
+    LV_UNUSED(start);
+
+    free(parser);
+    return count;
+}
@@ -0,0 +1,129 @@
+/**
+ * Streaming Manifest Parser Header
+ * Reads manifest.json in fixed-size chunks and reports each entry of the
+ * "musics" array as soon as it is complete, without building a tree
+ */
+
+#ifndef MANIFEST_PARSER_H
+#define MANIFEST_PARSER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define MANIFEST_CHUNK_SIZE 512   // Bytes read from the file per step
+#define MANIFEST_FIELD_MAX  256   // Longest string kept per field, including NUL
+#define MANIFEST_KEY_MAX    32    // Longest key compared, longer keys are ignored
+#define MANIFEST_DEPTH_MAX  31    // Deepest nesting accepted, one array_mask bit per depth 1..31
+
+/* Bits in manifest_entry_s.fields */
+#define MANIFEST_FIELD_PATH       (1u << 0)
+#define MANIFEST_FIELD_NAME       (1u << 1)
+#define MANIFEST_FIELD_ARTIST     (1u << 2)
+#define MANIFEST_FIELD_COVER      (1u << 3)
+#define MANIFEST_FIELD_TOTAL_TIME (1u << 4)
+#define MANIFEST_FIELD_COLOR      (1u << 5)
+#define MANIFEST_FIELD_ALBUM      (1u << 6)
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+/* One element of the "musics" array, strings are truncated to MANIFEST_FIELD_MAX */
+typedef struct {
+    char path[MANIFEST_FIELD_MAX];
+    char name[MANIFEST_FIELD_MAX];
+    char artist[MANIFEST_FIELD_MAX];
+    char album[MANIFEST_FIELD_MAX];
+    char cover[MANIFEST_FIELD_MAX];
+    char color[16];
+    double total_time;
+    uint32_t fields;         // MANIFEST_FIELD_* present in the entry
+} manifest_entry_s;
+
+/**
+ * Entry callback
+ * @param entry Parsed entry, only valid during the call
+ * @param user_data User pointer given to the parser
+ * @return true to continue, false to stop parsing
+ */
+typedef bool (*manifest_entry_cb_t)(const manifest_entry_s *entry, void *user_data);
+
+/* Parser state, fixed size regardless of the manifest length */
+typedef struct {
+    // Lexer
+    uint8_t lex_state;
+    char token[MANIFEST_FIELD_MAX];
+    uint16_t token_len;
+    uint32_t unicode;
+    uint8_t unicode_digits;
+    uint32_t high_surrogate;
+
+    // Grammar
+    uint8_t depth;
+    uint32_t array_mask;     // Bit d set when the container at depth d is an array
+    bool expect_key;
+    char key[MANIFEST_KEY_MAX];
+    uint8_t musics_depth;    // Depth of the "musics" array, 0 when outside
+    bool in_entry;
+
+    // Result
+    manifest_entry_s entry;
+    manifest_entry_cb_t cb;
+    void *user_data;
+    uint32_t entry_count;
+    uint32_t line;
+    bool stopped;
+    bool error;
+} manifest_parser_s;
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Prepare a parser
+ * @param parser Parser state
+ * @param cb Called for every complete entry
+ * @param user_data Passed to cb
+ */
+void manifest_parser_init(manifest_parser_s *parser, manifest_entry_cb_t cb, void *user_data);
+
+/**
+ * @brief Feed the next chunk of the document
+ * @param parser Parser state
+ * @param data Chunk bytes
+ * @param len Number of bytes
+ * @return 0 to continue, 1 when the callback stopped parsing, -1 on syntax error
+ */
+int manifest_parser_feed(manifest_parser_s *parser, const char *data, size_t len);
+
+/**
+ * @brief Signal the end of the document
+ * @param parser Parser state
+ * @return 0 on success, -1 if the document is truncated or invalid
+ */
+int manifest_parser_finish(manifest_parser_s *parser);
+
+/**
+ * @brief Parse a manifest file in MANIFEST_CHUNK_SIZE steps
+ * @param path File path (POSIX path)
+ * @param cb Called for every complete entry
+ * @param user_data Passed to cb
+ * @return Number of entries reported, -1 if the file cannot be read or is invalid
+ */
+int manifest_parse_file(const char *path, manifest_entry_cb_t cb, void *user_data);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* MANIFEST_PARSER_H */
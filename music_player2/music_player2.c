@@ -5,6 +5,15 @@
 #include "music_player2.h"
 #include "playlist_manager.h"
 #include "font_config.h"
+#include "library_index.h"
+#include "library_scan.h"
+#include "library_watch.h"
+#include "pcm_cache.h"
+#include "cover_cache.h"
+#include "cover_art.h"
+#include "ui_profiler.h"
+#include "render_profile.h"
+#include "perf_monitor.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <netutils/cJSON.h>
@@ -27,6 +36,25 @@
 
 #define COVER_SIZE                  200
 #define COVER_ROTATION_DURATION     8000  // 8 seconds per rotation for visual effect
+#define COVER_ROTATION_PERIOD       33    // ms per rotation frame, 30 fps
+
+#define LIBRARY_SYNC_PERIOD         250     // ms between checks for library changes
+#define LIBRARY_SAVE_DELAY          30000   // ms of quiet before the edited index is written
+#define COVER_WAIT_PERIOD           20      // ms between checks for a cover still being decoded
+#define PREFETCH_NEIGHBORS          3       // Current, next and previous track
+#define VOLUME_BAR_HEIGHT           180     // Volume bar height, one volume step per pixel
+#define PROGRESS_SEEK_GROW          4       // Progress bar growth above and below while seeking
+#define PROGRESS_PRECISE_GROW       5       // Same, in precise adjustment mode
+#define RENDER_PROFILE_WINDOW       1000    // ms per render profile governor measurement
+#define RENDER_BENCH_DELAY          3000    // ms after startup before the render benchmark
+#define RENDER_BENCH_FRAMES         20      // Full-screen refreshes per benchmark measurement
+
+/* Player page parts redrawn at the next display refresh, see app_ui_invalidate() */
+#define UI_DIRTY_PROGRESS           (1 << 0)  // Progress bar and time spans
+#define UI_DIRTY_DATE_TIME          (1 << 1)  // Clock and weekday labels
+#define UI_DIRTY_PLAY_STATUS        (1 << 2)  // Play / pause button
+#define UI_DIRTY_VOLUME             (1 << 3)  // Volume bar and speaker icon
+#define UI_DIRTY_ALBUM_INFO         (1 << 4)  // Title and artist labels
 
 /**********************
  *      TYPEDEFS
@@ -44,6 +72,13 @@ typedef struct {
     int32_t current_value;         // Current value
 } progress_bar_state_t;
 
+/* State of one library watcher drain */
+typedef struct {
+    library_snapshot_s* snapshot;  // Edited copy of the pinned library, created on first change
+    uint32_t changed;              // Tracks added, updated or removed
+    bool reload;                   // Full reload requested
+} library_apply_s;
+
 /**********************
  *  STATIC PROTOTYPES
  **********************/
@@ -51,24 +86,60 @@ typedef struct {
 /* Init functions */
 static void read_configs(void);
 static bool init_resource(void);
-static void reload_music_config(void);
+static void app_style_page_background(lv_style_t* style, render_profile_t profile);
+static void app_style_card(lv_style_t* style, render_profile_t profile);
+static void app_style_status_bar(lv_style_t* style, render_profile_t profile);
+static void app_style_progress(lv_style_t* style, render_profile_t profile);
+static void app_style_play_glow(lv_style_t* style, render_profile_t profile);
+static void app_style_play_glow_pressed(lv_style_t* style, render_profile_t profile);
+static void app_style_switch_pressed(lv_style_t* style, render_profile_t profile);
 static void app_create_error_page(void);
 static void app_create_main_page(void);
 static void app_create_top_layer(void);
 
 // Functions
 static void app_refresh_album_info(void);
+static void app_refresh_album_cover(void);
+static void app_show_album_cover(const lv_image_dsc_t* cover);
 static void app_refresh_date_time(void);
 static void app_refresh_play_status(void);
 static void app_refresh_playback_progress(void);
 static void app_refresh_playlist(void);
 static void app_refresh_volume_bar(void);
 static void app_refresh_volume_countdown_timer(void);
+static void app_refresh_cover_rotation(void);
+
+/* Frame-coalesced UI updates */
+static void app_ui_invalidate(uint32_t parts);
+static void app_ui_refr_start_cb(lv_event_t* e);
+static void app_apply_date_time(void);
+static void app_apply_play_status(void);
+static void app_apply_playback_progress(void);
+static void app_apply_volume_bar(void);
+static void app_apply_album_info(void);
+static void app_set_label_text(lv_obj_t* label, const char* text);
+static void app_set_span_text(lv_span_t* span, char* shown, size_t size, const char* text);
 
 /* Additional static function declarations */
 static void app_set_volume(uint16_t volume);
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PERFORMANCE_MONITORING
+static audioctl_s* app_get_audioctl(void);
+#endif
 static void app_set_playback_time(uint32_t current_time);
 static void app_start_updating_date_time(void);
+static void app_prefetch_neighbors(void);
+static void app_switch_track(track_id_t id, bool record_history);
+static void app_play_next(bool manual);
+static void app_play_previous(void);
+static void app_refresh_queue_modes(void);
+static track_id_t app_map_track(track_id_t id, void* user_data);
+static void app_report_start_latency(void);
+static void app_pin_library(void);
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_WATCH
+static void app_start_library_watch(void);
+static void app_drain_library_watch(void);
+static void app_apply_library_change(const library_change_s* change, void* user_data);
+#endif
 
 /* Event handler functions */
 static void app_audio_event_handler(lv_event_t* e);
@@ -76,6 +147,7 @@ static void app_play_status_event_handler(lv_event_t* e);
 // Removed: now using playlist_manager system
 static void app_playlist_event_handler(lv_event_t* e);
 static void app_switch_album_event_handler(lv_event_t* e);
+static void app_queue_mode_event_handler(lv_event_t* e);
 static void app_volume_bar_event_handler(lv_event_t* e);
 static void app_playback_progress_bar_event_handler(lv_event_t* e);
 
@@ -83,6 +155,19 @@ static void app_playback_progress_bar_event_handler(lv_event_t* e);
 static void app_refresh_date_time_timer_cb(lv_timer_t* timer);
 static void app_playback_progress_update_timer_cb(lv_timer_t* timer);
 static void app_volume_bar_countdown_timer_cb(lv_timer_t* timer);
+static void app_library_sync_timer_cb(lv_timer_t* timer);
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_ROTATION
+static void app_cover_rotation_timer_cb(lv_timer_t* timer);
+#endif
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_CACHE
+static void app_cover_wait_timer_cb(lv_timer_t* timer);
+#endif
+#ifdef CONFIG_LVX_MUSIC_PLAYER_RENDER_PROFILE_BENCH
+static void app_render_bench_timer_cb(lv_timer_t* timer);
+#endif
+#if defined(CONFIG_LVX_MUSIC_PLAYER_LIBRARY_WATCH) && defined(CONFIG_LVX_MUSIC_PLAYER_LIBRARY_INDEX)
+static void app_library_save_timer_cb(lv_timer_t* timer);
+#endif
 
 static void progress_smooth_anim_cb(void* obj, int32_t value);
 static void start_smooth_progress_animation(int32_t target_value);
@@ -102,6 +187,21 @@ static progress_bar_state_t progress_state = {
     .current_value = 0
 };
 
+/* Text last given to the time spans, compared before setting them again */
+static struct {
+    char current_time[16];
+    char total_time[16];
+} ui_text;
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PERFORMANCE_MONITORING
+/* Tap-to-first-sample statistics, index 0 = file start, 1 = cached start */
+static struct {
+    uint32_t count[2];
+    uint64_t total_us[2];
+    uint64_t worst_us[2];
+} start_latency;
+#endif
+
 const char* WEEK_DAYS[] = { "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday" };
 const lv_style_prop_t transition_props[] = {
     LV_STYLE_OPA,
@@ -125,6 +225,7 @@ void app_create(void)
     lv_memzero(&R, sizeof(R));
     lv_memzero(&C, sizeof(C));
     lv_memzero(&CF, sizeof(CF));
+    C.current_track = TRACK_ID_INVALID;
 
     // System initialization
     LV_LOG_USER("Starting music player...");
@@ -148,7 +249,54 @@ void app_create(void)
         return;
     }
 
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PCM_CACHE
+    pcm_cache_init(CONFIG_LVX_MUSIC_PLAYER_PCM_CACHE_BUDGET);
+#endif
+
+    // Covers are composited into the ARGB8888 disc image, which reads XRGB8888
+    cover_art_init();
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_CACHE
+    if (cover_cache_init(CONFIG_LVX_MUSIC_PLAYER_COVER_CACHE_BUDGET, LV_COLOR_FORMAT_XRGB8888) == 0) {
+        C.timers.cover_wait = lv_timer_create(app_cover_wait_timer_cb, COVER_WAIT_PERIOD, NULL);
+        lv_timer_pause(C.timers.cover_wait);
+    }
+#endif
+
+    play_queue_init(&C.queue, R.tracks->count, (uint32_t)time(NULL) ^ lv_tick_get());
+
     app_create_main_page();
+#ifdef CONFIG_LVX_MUSIC_PLAYER_UI_PROFILER
+    // After the page's own REFR_START handler, so layout it forces shows up as forced
+    if (ui_profiler_init(NULL, CONFIG_LVX_MUSIC_PLAYER_UI_PROFILER_PERIOD_MS) == 0) {
+        ui_profiler_watch(lv_screen_active());
+        ui_profiler_watch(lv_layer_top());
+    }
+#endif
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PERFORMANCE_MONITORING
+    perf_monitor_config_s perf = {
+        .period_ms = CONFIG_LVX_MUSIC_PLAYER_PERF_PERIOD_MS,
+        .csv_path = CONFIG_LVX_MUSIC_PLAYER_PERF_CSV_PATH,
+        .audio = app_get_audioctl,
+    };
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PERF_OVERLAY
+    perf.overlay = true;
+#endif
+    perf_monitor_init(&perf);
+#endif
+#ifdef CONFIG_LVX_MUSIC_PLAYER_RENDER_PROFILE_AUTO
+    render_profile_auto_s render_auto = {
+        .frame_ms = CONFIG_LVX_MUSIC_PLAYER_RENDER_PROFILE_FRAME_MS,
+        .cpu_pct = CONFIG_LVX_MUSIC_PLAYER_RENDER_PROFILE_CPU,
+        .window_ms = RENDER_PROFILE_WINDOW,
+    };
+    render_profile_auto_start(NULL, &render_auto);
+#endif
+#ifdef CONFIG_LVX_MUSIC_PLAYER_RENDER_PROFILE_BENCH
+    // Once the page has settled, the timer deletes itself after the run
+    lv_timer_t* bench = lv_timer_create(app_render_bench_timer_cb, RENDER_BENCH_DELAY, NULL);
+    lv_timer_set_repeat_count(bench, 1);
+#endif
     app_set_play_status(PLAY_STATUS_STOP);
     app_switch_to_album(0);
     app_set_volume(30);
@@ -156,24 +304,91 @@ void app_create(void)
     app_refresh_album_info();
     app_refresh_playlist();
     app_refresh_volume_bar();
+
+    // Pick up library versions published in the background
+    C.timers.library_sync = lv_timer_create(app_library_sync_timer_cb, LIBRARY_SYNC_PERIOD, NULL);
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_WATCH
+    app_start_library_watch();
+#endif
     
     LV_LOG_USER("Music Player initialized");
     
     // Initialization complete
 }
 
+/* Undo app_create() in reverse order, the page's widgets are left to the caller */
+void app_destroy(void)
+{
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_WATCH
+    library_watch_stop();
+#endif
+
+    lv_timer_t** timers[] = {
+        &C.timers.library_sync,
+        &C.timers.library_save,
+        &C.timers.volume_bar_countdown,
+        &C.timers.playback_progress_update,
+        &C.timers.cover_rotation,
+        &C.timers.refresh_date_time,
+        &C.timers.cover_wait,
+    };
+    for (size_t i = 0; i < sizeof(timers) / sizeof(timers[0]); i++) {
+        if (*timers[i]) {
+            lv_timer_delete(*timers[i]);
+            *timers[i] = NULL;
+        }
+    }
+
+    // Started on the first play, after everything else; it may still read a PCM cache entry
+    if (C.audioctl) {
+        audio_ctl_uninit_nxaudio(C.audioctl);
+        C.audioctl = NULL;
+    }
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_RENDER_PROFILE_AUTO
+    render_profile_auto_stop();
+#endif
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PERFORMANCE_MONITORING
+    // Writes the CSV lines still buffered
+    perf_monitor_deinit();
+#endif
+#ifdef CONFIG_LVX_MUSIC_PLAYER_UI_PROFILER
+    ui_profiler_deinit();
+#endif
+    if (lv_display_get_default()) {
+        lv_display_remove_event_cb_with_user_data(lv_display_get_default(), app_ui_refr_start_cb, NULL);
+    }
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_CACHE
+    cover_cache_deinit();
+#endif
+    // The widget must not point at the freed disc
+    if (R.ui.album_cover) {
+        lv_image_set_src(R.ui.album_cover, NULL);
+    }
+    cover_art_deinit();
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PCM_CACHE
+    pcm_cache_deinit();
+#endif
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
 
-static int32_t app_get_album_index(album_info_t* album)
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PERFORMANCE_MONITORING
+static audioctl_s* app_get_audioctl(void)
 {
-    for (int i = 0; i < R.album_count; i++) {
-        if (album == &R.albums[i]) {
-            return i;
-        }
+    return C.audioctl;
+}
+#endif
+
+static uint64_t app_get_total_time(void)
+{
+    if (!track_store_valid(R.tracks, C.current_track)) {
+        return 0;
     }
-    return -1;
+    return R.tracks->duration_ms[C.current_track];
 }
 
 static void app_set_volume(uint16_t volume)
@@ -187,14 +402,59 @@ void app_set_play_status(play_status_t status)
     C.play_status_prev = C.play_status;
     C.play_status = status;
     app_refresh_play_status();
+    app_refresh_cover_rotation();
+}
+
+void app_switch_to_album(track_id_t id)
+{
+    app_switch_track(id, true);
+}
+
+int app_queue_next(track_id_t id)
+{
+    if (!track_store_valid(R.tracks, id) || play_queue_insert_next(&C.queue, id) != 0)
+        return -1;
+
+    LV_LOG_USER("Queued next: %s", track_store_name(R.tracks, id));
+    app_prefetch_neighbors();
+    return 0;
+}
+
+int app_play_tracks(const track_id_t* ids, uint32_t count)
+{
+    if (count == 0 || !track_store_valid(R.tracks, ids[0]))
+        return -1;
+
+    // The list replaces whatever was queued, the rest of the library follows it
+    play_queue_clear(&C.queue);
+    for (uint32_t i = 1; i < count; i++) {
+        if (play_queue_append(&C.queue, ids[i]) != 0) {
+            LV_LOG_WARN("Queued %lu of %lu tracks", (unsigned long)i - 1, (unsigned long)count - 1);
+            break;
+        }
+    }
+
+    if (C.current_track == ids[0]) {
+        app_prefetch_neighbors();
+        app_set_playback_time(0);
+        return 0;
+    }
+    app_switch_track(ids[0], true);
+    return 0;
 }
 
-void app_switch_to_album(int index)
+/* Make a track current, remembering the one left unless going back through the history */
+static void app_switch_track(track_id_t id, bool record_history)
 {
-    if (R.album_count == 0 || index < 0 || index >= R.album_count || C.current_album == &R.albums[index])
+    if (!track_store_valid(R.tracks, id) || C.current_track == id)
         return;
 
-    C.current_album = &R.albums[index];
+    if (record_history) {
+        play_queue_push_history(&C.queue, C.current_track);
+    }
+    C.current_track = id;
+    C.play_request_us = (C.play_status == PLAY_STATUS_STOP) ? 0 : audio_ctl_clock_us();
+    app_prefetch_neighbors();
     
     // Reset progress bar state to avoid confusion during track switching
     reset_progress_bar_state();
@@ -211,6 +471,156 @@ void app_switch_to_album(int index)
     app_set_play_status(PLAY_STATUS_PLAY);
 }
 
+/* Ask the prefetch caches for the current track and what the queue plays around it */
+static void app_prefetch_neighbors(void)
+{
+#if defined(CONFIG_LVX_MUSIC_PLAYER_PCM_CACHE) || defined(CONFIG_LVX_MUSIC_PLAYER_COVER_CACHE)
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PCM_CACHE
+    static char path_bufs[PREFETCH_NEIGHBORS][LV_FS_MAX_PATH_LENGTH];
+    const char* paths[PREFETCH_NEIGHBORS];
+#endif
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_CACHE
+    static char cover_bufs[PREFETCH_NEIGHBORS][LV_FS_MAX_PATH_LENGTH];
+    const char* covers[PREFETCH_NEIGHBORS];
+#endif
+    track_id_t id = C.current_track;
+
+    if (!track_store_valid(R.tracks, id)) {
+        return;
+    }
+
+    track_id_t ids[PREFETCH_NEIGHBORS] = {
+        id,
+        play_queue_peek(&C.queue, id),
+        play_queue_peek_previous(&C.queue, id),
+    };
+    int n = 0;
+
+    for (int i = 0; i < PREFETCH_NEIGHBORS; i++) {
+        // Skip the end of the queue and tracks already listed
+        bool listed = !track_store_valid(R.tracks, ids[i]);
+        for (int j = 0; j < i && !listed; j++) {
+            listed = ids[j] == ids[i];
+        }
+        if (listed) {
+            continue;
+        }
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PCM_CACHE
+        track_store_full_path(R.tracks, ids[i], path_bufs[n], sizeof(path_bufs[n]));
+        paths[n] = path_bufs[n];
+#endif
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_CACHE
+        // Tracks without a cover are skipped by the cache
+        covers[n] = track_store_full_cover(R.tracks, ids[i], cover_bufs[n], sizeof(cover_bufs[n])) >= 0
+            ? cover_bufs[n] : NULL;
+#endif
+        n++;
+    }
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PCM_CACHE
+    pcm_cache_prefetch(paths, n);
+#endif
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_CACHE
+    cover_cache_prefetch(covers, n);
+#endif
+#endif
+}
+
+/* Move on through the play queue, manual for the next button, otherwise the end of the track */
+static void app_play_next(bool manual)
+{
+    track_id_t id = play_queue_next(&C.queue, C.current_track, manual);
+
+    if (id == TRACK_ID_INVALID) {
+        // End of the library without repeat
+        app_set_play_status(PLAY_STATUS_STOP);
+        C.current_time = 0;
+        return;
+    }
+
+    if (id == C.current_track) {
+        // Repeat one, or a library of one track: start it over
+        C.play_request_us = (C.play_status == PLAY_STATUS_STOP) ? 0 : audio_ctl_clock_us();
+        reset_progress_bar_state();
+        app_set_playback_time(0);
+        if (C.play_status != PLAY_STATUS_STOP) {
+            app_set_play_status(PLAY_STATUS_STOP);
+            app_set_play_status(PLAY_STATUS_PLAY);
+        }
+        return;
+    }
+
+    app_switch_track(id, true);
+}
+
+static void app_play_previous(void)
+{
+    track_id_t id = play_queue_previous(&C.queue, C.current_track);
+
+    if (id == C.current_track) {
+        // Nothing before it in this shuffle, restart the track
+        app_set_playback_time(0);
+        return;
+    }
+    app_switch_track(id, false);
+}
+
+static void app_refresh_queue_modes(void)
+{
+    static const char* const repeat_symbols[PLAY_QUEUE_REPEAT_COUNT] = {
+        [PLAY_QUEUE_REPEAT_OFF] = LV_SYMBOL_LOOP,
+        [PLAY_QUEUE_REPEAT_ALL] = LV_SYMBOL_LOOP,
+        [PLAY_QUEUE_REPEAT_ONE] = LV_SYMBOL_LOOP " 1",
+    };
+
+    if (!R.ui.shuffle_btn || !R.ui.repeat_label) {
+        return;
+    }
+
+    // Active modes are highlighted
+    if (C.queue.shuffle) {
+        lv_obj_add_state(R.ui.shuffle_btn, LV_STATE_CHECKED);
+    } else {
+        lv_obj_remove_state(R.ui.shuffle_btn, LV_STATE_CHECKED);
+    }
+
+    lv_obj_t* repeat_btn = lv_obj_get_parent(R.ui.repeat_label);
+    lv_label_set_text(R.ui.repeat_label, repeat_symbols[C.queue.repeat]);
+    if (C.queue.repeat != PLAY_QUEUE_REPEAT_OFF) {
+        lv_obj_add_state(repeat_btn, LV_STATE_CHECKED);
+    } else {
+        lv_obj_remove_state(repeat_btn, LV_STATE_CHECKED);
+    }
+}
+
+/* Log tap-to-first-sample latency once the engine has produced output */
+static void app_report_start_latency(void)
+{
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PERFORMANCE_MONITORING
+    if (!C.audioctl || C.play_request_us == 0 || C.audioctl->first_sample_us == 0) {
+        return;
+    }
+
+    int hit = C.audioctl->cache_hit ? 1 : 0;
+    uint64_t latency = C.audioctl->first_sample_us - C.play_request_us;
+    C.play_request_us = 0;
+
+    start_latency.count[hit]++;
+    start_latency.total_us[hit] += latency;
+    if (latency > start_latency.worst_us[hit]) {
+        start_latency.worst_us[hit] = latency;
+    }
+
+    LV_LOG_USER("Tap-to-first-sample: %lu us (%s) | cached avg %lu us worst %lu us (n=%lu) | file avg %lu us worst %lu us (n=%lu)",
+                (unsigned long)latency, hit ? "cached" : "file",
+                (unsigned long)(start_latency.count[1] ? start_latency.total_us[1] / start_latency.count[1] : 0),
+                (unsigned long)start_latency.worst_us[1], (unsigned long)start_latency.count[1],
+                (unsigned long)(start_latency.count[0] ? start_latency.total_us[0] / start_latency.count[0] : 0),
+                (unsigned long)start_latency.worst_us[0], (unsigned long)start_latency.count[0]);
+#endif
+}
+
 static void app_set_playback_time(uint32_t current_time)
 {
     C.current_time = current_time;
@@ -228,6 +638,11 @@ static void app_set_playback_time(uint32_t current_time)
 }
 
 static void app_refresh_date_time(void)
+{
+    app_ui_invalidate(UI_DIRTY_DATE_TIME);
+}
+
+static void app_apply_date_time(void)
 {
     // Check UI components
     if (!R.ui.time || !R.ui.date) {
@@ -263,97 +678,196 @@ static void app_refresh_date_time(void)
     // Update time display
     char time_str[6];
     lv_snprintf(time_str, sizeof(time_str), "%02d:%02d", current_time->tm_hour, current_time->tm_min);
-    lv_label_set_text(R.ui.time, time_str);
+    app_set_label_text(R.ui.time, time_str);
 
     // Update weekday display
     char date_str[12];
     int wday = current_time->tm_wday;
     if (wday < 0 || wday > 6) wday = 0;
     lv_snprintf(date_str, sizeof(date_str), "%s", WEEK_DAYS[wday]);
-    lv_label_set_text(R.ui.date, date_str);
+    app_set_label_text(R.ui.date, date_str);
 
     // Time update completed
 }
 
 static void app_refresh_volume_bar(void)
 {
-    int32_t volume_bar_indic_height = C.volume;
+    app_ui_invalidate(UI_DIRTY_VOLUME);
+}
 
-    lv_obj_set_height(R.ui.volume_bar_indic, volume_bar_indic_height);
+static void app_apply_volume_bar(void)
+{
+    // A bar value only invalidates the indicator, no layout is involved
+    lv_bar_set_value(R.ui.volume_bar, C.volume, LV_ANIM_OFF);
 
-    lv_obj_refr_size(R.ui.volume_bar_indic);
-    lv_obj_update_layout(R.ui.volume_bar_indic);
+    const void* icon = C.volume > 0 ? R.images.audio : R.images.mute;
+    if (lv_image_get_src(R.ui.audio) != icon) {
+        lv_image_set_src(R.ui.audio, icon);
+    }
+}
 
-    if (C.volume > 0) {
-        lv_image_set_src(R.ui.audio, R.images.audio);
-    } else {
-        lv_image_set_src(R.ui.audio, R.images.mute);
+/* Composite a cover into the disc image, NULL shows the placeholder */
+static void app_show_album_cover(const lv_image_dsc_t* cover)
+{
+    // Decoded only while composited, the disc does not refer to it afterwards
+    lv_image_dsc_t placeholder = { 0 };
+    if (!cover) {
+        if (cover_cache_load(R.images.nocover, LV_COLOR_FORMAT_XRGB8888, &placeholder) == 0) {
+            cover = &placeholder;
+        } else {
+            LV_LOG_WARN("Placeholder cover not decodable: %s", R.images.nocover);
+        }
     }
+
+    int ret = cover_art_compose(cover);
+    cover_cache_free(&placeholder);
+    if (ret != 0) {
+        lv_image_set_src(R.ui.album_cover, R.images.nocover);
+        return;
+    }
+
+    // Same image source, only its pixels changed
+    lv_image_set_src(R.ui.album_cover, cover_art_image());
+    lv_obj_invalidate(R.ui.album_cover);
 }
 
-static void app_refresh_album_info(void)
+/* Load the cover of the current track, decoded ahead by the cover cache when it runs */
+static void app_refresh_album_cover(void)
 {
-    if (C.current_album) {
-        // Load album cover
-        if (access(C.current_album->cover, F_OK) == 0) {
-            lv_image_set_src(R.ui.album_cover, C.current_album->cover);
-            LV_LOG_USER("Loading album cover: %s", C.current_album->cover);
-            
-            // Display image properly
-            lv_image_set_scale(R.ui.album_cover, 256);
-            lv_image_set_inner_align(R.ui.album_cover, LV_IMAGE_ALIGN_CENTER);
-            lv_obj_set_style_bg_image_opa(R.ui.album_cover, LV_OPA_COVER, LV_PART_MAIN);
-            lv_obj_set_style_image_recolor_opa(R.ui.album_cover, LV_OPA_0, LV_PART_MAIN);
-            
+    static char cover[LV_FS_MAX_PATH_LENGTH];
+    bool found = track_store_full_cover(R.tracks, C.current_track, cover, sizeof(cover)) >= 0;
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_CACHE
+    if (found && cover_cache_running()) {
+        const lv_image_dsc_t* image = NULL;
+        int state = cover_cache_acquire(cover, &image);
+
+        if (state == 0) {
+            // Still decoding, the previous cover stays until the wait timer finds it ready
+            lv_timer_reset(C.timers.cover_wait);
+            lv_timer_resume(C.timers.cover_wait);
+            return;
+        }
+        lv_timer_pause(C.timers.cover_wait);
+
+        if (state > 0) {
+            // The disc keeps a copy, the cached cover is not needed while shown
+            app_show_album_cover(image);
+            cover_cache_release(image);
+            LV_LOG_USER("Album cover from cache: %s", cover);
         } else {
-            lv_image_set_src(R.ui.album_cover, R.images.nocover);
-            LV_LOG_WARN("Album cover file not found, using default: %s", C.current_album->cover);
+            app_show_album_cover(NULL);
+            LV_LOG_WARN("Album cover not decodable, using default: %s", cover);
         }
-        
-        // Update song information
-        const char* display_name = (C.current_album->name && strlen(C.current_album->name) > 0) ? 
-                                  C.current_album->name : "Unknown Song";
-        const char* display_artist = (C.current_album->artist && strlen(C.current_album->artist) > 0) ? 
-                                    C.current_album->artist : "Unknown Artist";
-        
-        // Use font configuration system
+        return;
+    }
+#endif
+
+    lv_image_dsc_t image;
+    if (found && cover_cache_load(cover, LV_COLOR_FORMAT_XRGB8888, &image) == 0) {
+        app_show_album_cover(&image);
+        cover_cache_free(&image);
+        LV_LOG_USER("Loading album cover: %s", cover);
+    } else {
+        app_show_album_cover(NULL);
+        LV_LOG_WARN("Album cover not found, using default: %s", cover);
+    }
+}
+
+static void app_refresh_album_info(void)
+{
+    if (track_store_valid(R.tracks, C.current_track)) {
+        app_refresh_album_cover();
+        app_ui_invalidate(UI_DIRTY_ALBUM_INFO);
+    }
+}
+
+static void app_apply_album_info(void)
+{
+    if (!track_store_valid(R.tracks, C.current_track)) {
+        return;
+    }
+
+    const char* name = track_store_name(R.tracks, C.current_track);
+    const char* artist = track_store_artist(R.tracks, C.current_track);
+    const char* display_name = name[0] != '\0' ? name : "Unknown Song";
+    const char* display_artist = artist[0] != '\0' ? artist : "Unknown Artist";
+
+    // Use font configuration system; a same-titled track leaves the label alone
+    if (strcmp(lv_label_get_text(R.ui.album_name), display_name) != 0) {
         set_label_utf8_text(R.ui.album_name, display_name, get_font_by_size(28));
+    }
+    if (strcmp(lv_label_get_text(R.ui.album_artist), display_artist) != 0) {
         set_label_utf8_text(R.ui.album_artist, display_artist, get_font_by_size(22));
-        
-        // Album information updated
     }
 }
 
+/* Spin the cover disc while playing, from the angle it stopped at */
+static void app_refresh_cover_rotation(void)
+{
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_ROTATION
+    bool spin = C.play_status == PLAY_STATUS_PLAY && cover_art_image() != NULL;
+
+    if (C.timers.cover_rotation == NULL) {
+        C.timers.cover_rotation = lv_timer_create(app_cover_rotation_timer_cb, COVER_ROTATION_PERIOD, NULL);
+        lv_timer_pause(C.timers.cover_rotation);
+    }
+
+    if (spin == C.animations.is_rotating) {
+        return;
+    }
+
+    C.animations.is_rotating = spin;
+    if (spin) {
+        // The cover copy is freed a while after the disc stops, composite it again then
+        cover_art_set_spinning(true);
+        if (cover_art_rotate(C.animations.rotation_angle) != 0) {
+            app_refresh_album_cover();
+        }
+        C.animations.rotation_tick = lv_tick_get() -
+                                     (uint32_t)C.animations.rotation_angle * COVER_ROTATION_DURATION / 3600;
+        lv_timer_resume(C.timers.cover_rotation);
+    } else {
+        lv_timer_pause(C.timers.cover_rotation);
+        cover_art_set_spinning(false);
+    }
+#endif
+}
+
 static void app_refresh_play_status(void)
 {
+    app_ui_invalidate(UI_DIRTY_PLAY_STATUS);
+
     if (C.timers.playback_progress_update == NULL) {
         C.timers.playback_progress_update = lv_timer_create(app_playback_progress_update_timer_cb, 1000, NULL);
     }
 
     switch (C.play_status) {
     case PLAY_STATUS_STOP:
-        lv_image_set_src(R.ui.play_btn, R.images.play);
         lv_timer_pause(C.timers.playback_progress_update);
+        // The controller stays for the session, with its sink, volume and ring size
         if (C.audioctl) {
             audio_ctl_stop(C.audioctl);
-            audio_ctl_uninit_nxaudio(C.audioctl);
-            C.audioctl = NULL;
         }
         break;
     case PLAY_STATUS_PLAY:
-        lv_image_set_src(R.ui.play_btn, R.images.pause);
         lv_timer_resume(C.timers.playback_progress_update);
         if (C.play_status_prev == PLAY_STATUS_PAUSE)
             audio_ctl_resume(C.audioctl);
         else if (C.play_status_prev == PLAY_STATUS_STOP) {
-            if (!C.current_album || C.current_album->path[0] == '\0') {
+            if (C.play_request_us == 0) {
+                C.play_request_us = audio_ctl_clock_us();
+            }
+
+            static char track_path[LV_FS_MAX_PATH_LENGTH];
+            if (track_store_full_path(R.tracks, C.current_track, track_path, sizeof(track_path)) < 0) {
                 LV_LOG_ERROR("Current album or path is empty, cannot initialize audio");
                 app_set_play_status(PLAY_STATUS_STOP);
                 return;
             }
             
             // Audio file path processing
-            const char* audio_path = C.current_album->path;
+            const char* audio_path = track_path;
             
             // Use audio file path
             
@@ -387,39 +901,47 @@ static void app_refresh_play_status(void)
                 }
                 
                 if (!audio_path) {
-                    LV_LOG_ERROR("Cannot find audio file: %s", C.current_album->path);
+                    LV_LOG_ERROR("Cannot find audio file: %s", track_path);
                     app_set_play_status(PLAY_STATUS_STOP);
                     return;
                 }
             }
             
-            // Initialize audio controller
-            
-            // Audio controller initialization
-            int retry_count = 3;
-            while (retry_count > 0 && !C.audioctl) {
-                C.audioctl = audio_ctl_init_nxaudio(audio_path);
-                if (!C.audioctl) {
-                    retry_count--;
-                    LV_LOG_WARN("Audio controller init failed, retries left: %d", retry_count);
-                    if (retry_count > 0) {
-                        lv_delay_ms(100);
+            // Later tracks only switch the source of the session controller
+            if (C.audioctl) {
+                if (audio_ctl_set_source(C.audioctl, audio_path) != 0) {
+                    LV_LOG_ERROR("Cannot play audio file: %s", audio_path);
+                    app_set_play_status(PLAY_STATUS_STOP);
+                    return;
+                }
+            } else {
+                // Audio controller initialization
+                int retry_count = 3;
+                while (retry_count > 0 && !C.audioctl) {
+                    C.audioctl = audio_ctl_init_nxaudio(audio_path);
+                    if (!C.audioctl) {
+                        retry_count--;
+                        LV_LOG_WARN("Audio controller init failed, retries left: %d", retry_count);
+                        if (retry_count > 0) {
+                            lv_delay_ms(100);
+                        }
                     }
                 }
-            }
-            
-            if (!C.audioctl) {
-                LV_LOG_ERROR("Audio controller init finally failed, check audio file: %s", audio_path);
-                app_set_play_status(PLAY_STATUS_STOP);
-                return;
+
+                if (!C.audioctl) {
+                    LV_LOG_ERROR("Audio controller init finally failed, check audio file: %s", audio_path);
+                    app_set_play_status(PLAY_STATUS_STOP);
+                    return;
+                }
+
+                // A new sink starts at its own default level
+                audio_ctl_set_volume(C.audioctl, C.volume);
             }
             
             // Start audio playback
             int ret = audio_ctl_start(C.audioctl);
             if (ret < 0) {
                 LV_LOG_ERROR("Audio playback start failed: %d", ret);
-                audio_ctl_uninit_nxaudio(C.audioctl);
-                C.audioctl = NULL;
                 app_set_play_status(PLAY_STATUS_STOP);
                 return;
             }
@@ -428,7 +950,6 @@ static void app_refresh_play_status(void)
         }
         break;
     case PLAY_STATUS_PAUSE:
-        lv_image_set_src(R.ui.play_btn, R.images.play);
         lv_timer_pause(C.timers.playback_progress_update);
         audio_ctl_pause(C.audioctl);
         break;
@@ -439,54 +960,113 @@ static void app_refresh_play_status(void)
 
 static void app_refresh_playback_progress(void)
 {
-    if (!C.current_album) {
+    if (!track_store_valid(R.tracks, C.current_track)) {
         return;
     }
 
-    uint64_t total_time = C.current_album->total_time;
+    if (C.current_time > app_get_total_time()) {
+        // Track finished, the queue picks what follows
+        app_play_next(false);
+        return;
+    }
 
-    if (C.current_time > total_time) {
-        app_set_play_status(PLAY_STATUS_STOP);
-        C.current_time = 0;
+    app_ui_invalidate(UI_DIRTY_PROGRESS);
+}
+
+static void app_apply_play_status(void)
+{
+    const void* icon = C.play_status == PLAY_STATUS_PLAY ? R.images.pause : R.images.play;
+    if (lv_image_get_src(R.ui.play_btn) != icon) {
+        lv_image_set_src(R.ui.play_btn, icon);
+    }
+}
+
+static void app_apply_playback_progress(void)
+{
+    if (!track_store_valid(R.tracks, C.current_track)) {
         return;
     }
 
+    uint64_t total_time = app_get_total_time();
+    uint64_t shown_time = C.current_time;
+
     lv_bar_set_range(R.ui.playback_progress, 0, (int32_t)total_time);
     
-    // If not in dragging state, use smooth animation to update progress bar
-    if (!progress_state.is_seeking) {
-        if (progress_state.smooth_update_enabled) {
-            // Check if smooth animation needs to be started
-            int32_t current_value = lv_bar_get_value(R.ui.playback_progress);
-            int32_t new_value = (int32_t)C.current_time;
-            
-            // If difference is large (over 2 seconds), use smooth animation
-            if (abs(new_value - current_value) > 2000) {
-                start_smooth_progress_animation(new_value);
-            } else {
-                // Small difference, update directly
-                lv_bar_set_value(R.ui.playback_progress, new_value, LV_ANIM_OFF);
-                progress_state.current_value = new_value;
-            }
+    if (progress_state.is_seeking) {
+        // Dragging: the bar and the time follow the preview position
+        shown_time = progress_state.seek_preview_time;
+        lv_bar_set_value(R.ui.playback_progress, (int32_t)shown_time, LV_ANIM_OFF);
+    } else if (progress_state.smooth_update_enabled) {
+        // Check if smooth animation needs to be started
+        int32_t current_value = lv_bar_get_value(R.ui.playback_progress);
+        int32_t new_value = (int32_t)C.current_time;
+        
+        // If difference is large (over 2 seconds), use smooth animation
+        if (abs(new_value - current_value) > 2000) {
+            start_smooth_progress_animation(new_value);
         } else {
-            lv_bar_set_value(R.ui.playback_progress, (int32_t)C.current_time, LV_ANIM_OFF);
+            // Small difference, update directly
+            lv_bar_set_value(R.ui.playback_progress, new_value, LV_ANIM_OFF);
+            progress_state.current_value = new_value;
         }
+    } else {
+        lv_bar_set_value(R.ui.playback_progress, (int32_t)C.current_time, LV_ANIM_OFF);
     }
-    // If in dragging state, don't update progress bar display to avoid conflicts with user operations
 
-    // Update time display (unless in drag preview)
-    if (!progress_state.is_seeking) {
-        char buff[16];
-        
-        uint32_t current_time_min = C.current_time / 60000;
-        uint32_t current_time_sec = (C.current_time % 60000) / 1000;
-        uint32_t total_time_min = total_time / 60000;
-        uint32_t total_time_sec = (total_time % 60000) / 1000;
+    // The spans change once a second at most, whatever the update rate
+    char buff[16];
+    lv_snprintf(buff, sizeof(buff), "%02d:%02d", (int)(shown_time / 60000), (int)(shown_time % 60000 / 1000));
+    app_set_span_text(R.ui.playback_current_time, ui_text.current_time, sizeof(ui_text.current_time), buff);
+    lv_snprintf(buff, sizeof(buff), "%02d:%02d", (int)(total_time / 60000), (int)(total_time % 60000 / 1000));
+    app_set_span_text(R.ui.playback_total_time, ui_text.total_time, sizeof(ui_text.total_time), buff);
+}
 
-        lv_snprintf(buff, sizeof(buff), "%02d:%02d", current_time_min, current_time_sec);
-        lv_span_set_text(R.ui.playback_current_time, buff);
-        lv_snprintf(buff, sizeof(buff), "%02d:%02d", total_time_min, total_time_sec);
-        lv_span_set_text(R.ui.playback_total_time, buff);
+/* Record UI parts to redraw; they are applied once, when the display starts its next refresh */
+static void app_ui_invalidate(uint32_t parts)
+{
+    C.ui_dirty |= parts;
+}
+
+static void app_ui_refr_start_cb(lv_event_t* e)
+{
+    LV_UNUSED(e);
+
+    uint32_t parts = C.ui_dirty;
+    if (parts == 0) {
+        return;
+    }
+    C.ui_dirty = 0;
+
+    if (parts & UI_DIRTY_PLAY_STATUS) {
+        app_apply_play_status();
+    }
+    if (parts & UI_DIRTY_PROGRESS) {
+        app_apply_playback_progress();
+    }
+    if (parts & UI_DIRTY_ALBUM_INFO) {
+        app_apply_album_info();
+    }
+    if (parts & UI_DIRTY_VOLUME) {
+        app_apply_volume_bar();
+    }
+    if (parts & UI_DIRTY_DATE_TIME) {
+        app_apply_date_time();
+    }
+}
+
+/* Setting a label invalidates it and measures the text again, even for the same text */
+static void app_set_label_text(lv_obj_t* label, const char* text)
+{
+    if (strcmp(lv_label_get_text(label), text) != 0) {
+        lv_label_set_text(label, text);
+    }
+}
+
+static void app_set_span_text(lv_span_t* span, char* shown, size_t size, const char* text)
+{
+    if (strcmp(shown, text) != 0) {
+        lv_snprintf(shown, size, "%s", text);
+        lv_span_set_text(span, text);
     }
 }
 
@@ -529,6 +1109,23 @@ static void app_playback_progress_update_timer_cb(lv_timer_t* timer)
         return;
     }
 
+    // An unreadable file stops the engine: skip it, without cycling through a broken library
+    if (audio_ctl_failed(C.audioctl)) {
+        LV_LOG_ERROR("Cannot play %s, skipping", track_store_path(R.tracks, C.current_track));
+        if (++C.failed_tracks >= R.tracks->count) {
+            C.failed_tracks = 0;
+            app_set_play_status(PLAY_STATUS_STOP);
+            return;
+        }
+        app_play_next(false);
+        return;
+    }
+    if (audio_ctl_get_start_latency_us(C.audioctl) != 0) {
+        C.failed_tracks = 0;
+    }
+
+    app_report_start_latency();
+
     // Get current playback position
     int position = audio_ctl_get_position(C.audioctl);
     if (position >= 0) {
@@ -611,7 +1208,7 @@ static void app_playlist_event_handler(lv_event_t* e)
     // Playlist button clicked
     
     // Check playlist data
-    if (!R.albums || R.album_count == 0) {
+    if (R.tracks->count == 0) {
         LV_LOG_WARN("Playlist is empty or not initialized, cannot display");
         
         // Error message
@@ -631,11 +1228,11 @@ static void app_playlist_event_handler(lv_event_t* e)
     // Use traditional playlist - optimize memory check
     if (playlist_manager_is_open()) {
         // If playlist is already open, close it
-        LV_LOG_USER("Closing playlist (songs: %d)", R.album_count);
+        LV_LOG_USER("Closing playlist (songs: %lu)", (unsigned long)R.tracks->count);
         playlist_manager_close();
     } else {
         // Create playlist - relax memory limits
-        LV_LOG_USER("Opening playlist (songs: %d)", R.album_count);
+        LV_LOG_USER("Opening playlist (songs: %lu)", (unsigned long)R.tracks->count);
         
         // Smart container selection logic
         lv_obj_t* parent_container = lv_layer_top();
@@ -645,16 +1242,9 @@ static void app_playlist_event_handler(lv_event_t* e)
         }
         
         if (parent_container) {
-            // Memory check
-            lv_mem_monitor_t mem_info;
-            lv_mem_monitor(&mem_info);
-            // Memory status check
-            
             // Try to create even with low memory, let playlist handle internally
+            // (heap use is sampled by the performance monitor)
             playlist_manager_create(parent_container);
-            
-            lv_mem_monitor(&mem_info);
-            // Playlist creation completed
         } else {
             LV_LOG_ERROR("Cannot find suitable parent container");
         }
@@ -673,18 +1263,13 @@ static void app_volume_bar_event_handler(lv_event_t* e)
     lv_indev_t* indev = lv_indev_active();
     lv_indev_get_vect(indev, &point);
 
-    int32_t volume_bar_height = lv_obj_get_height(R.ui.volume_bar);
-    int32_t volume_bar_indic_height = lv_obj_get_height(R.ui.volume_bar_indic);
-
-    if (volume_bar_indic_height < 0) {
-        volume_bar_indic_height = 0;
-    } else if (volume_bar_indic_height > volume_bar_height) {
-        volume_bar_indic_height = volume_bar_height;
-    }
-
-    int32_t volume = volume_bar_indic_height - point.y;
-    if (volume < 0)
+    // Follow the finger from the volume itself, the widget may not be redrawn yet
+    int32_t volume = (int32_t)C.volume - point.y;
+    if (volume < 0) {
         volume = 0;
+    } else if (volume > VOLUME_BAR_HEIGHT) {
+        volume = VOLUME_BAR_HEIGHT;
+    }
 
     app_set_volume(volume);
 
@@ -754,19 +1339,7 @@ static void app_audio_event_handler(lv_event_t* e)
     }
     
     // Update volume icon status
-    if (R.ui.audio) {
-        if (C.volume > 0) {
-            lv_image_set_src(R.ui.audio, R.images.audio);
-        } else {
-            lv_image_set_src(R.ui.audio, R.images.mute);
-        }
-    }
-    
-    // Memory status check
-    // Memory monitoring - silent mode
-    lv_mem_monitor_t mem_info;
-    lv_mem_monitor(&mem_info);
-    
+    app_ui_invalidate(UI_DIRTY_VOLUME);
 }
 
 
@@ -784,12 +1357,10 @@ static void app_switch_album_event_handler(lv_event_t* e)
     if (code == LV_EVENT_PRESSED && target) {
         // Visual feedback when pressed
         lv_obj_set_style_transform_scale(target, 245, LV_PART_MAIN);  // Slight shrink
-        lv_obj_set_style_shadow_width(target, 20, LV_PART_MAIN);
         return;
     } else if (code == LV_EVENT_RELEASED && target) {
         // Restore state when released
         lv_obj_set_style_transform_scale(target, 256, LV_PART_MAIN);
-        lv_obj_set_style_shadow_width(target, 15, LV_PART_MAIN);
         return;
     }
     
@@ -799,12 +1370,13 @@ static void app_switch_album_event_handler(lv_event_t* e)
     }
     
     // Basic state validation
-    if (R.album_count == 0) {
+    uint32_t count = R.tracks->count;
+    if (count == 0) {
         LV_LOG_WARN("Playlist is empty, cannot switch songs");
         return;
     }
     
-    if (!C.current_album) {
+    if (!track_store_valid(R.tracks, C.current_track)) {
         LV_LOG_WARN("Current album is empty, trying to select first song");
         app_switch_to_album(0);
         return;
@@ -820,35 +1392,37 @@ static void app_switch_album_event_handler(lv_event_t* e)
     
     // Song switch operation
     
-    int32_t album_index = app_get_album_index(C.current_album);
-    if (album_index < 0) {
-        // Cannot get current song index, reset to first song
-        app_switch_to_album(0);
-        return;
-    }
-
-    // Calculate new index
-    int32_t new_index = album_index;
+    // The play queue decides: queued tracks, shuffle and history
     switch (direction) {
     case SWITCH_ALBUM_MODE_PREV:
-        new_index = (album_index - 1 + R.album_count) % R.album_count;
+        app_play_previous();
         break;
     case SWITCH_ALBUM_MODE_NEXT:
-        new_index = (album_index + 1) % R.album_count;
+        app_play_next(true);
         break;
     }
-    
-    // Final validation
-    if (new_index < 0 || new_index >= R.album_count) {
-        LV_LOG_ERROR("Calculated index is invalid: %ld (range: 0-%d)", (long)new_index, R.album_count - 1);
+}
+
+/**
+ * Shuffle toggle and repeat cycle (off, all, one)
+ */
+static void app_queue_mode_event_handler(lv_event_t* e)
+{
+    if (lv_event_get_code(e) != LV_EVENT_CLICKED) {
         return;
     }
 
-    // Switch song
+    if (lv_event_get_target(e) == R.ui.shuffle_btn) {
+        play_queue_set_shuffle(&C.queue, !C.queue.shuffle, C.current_track);
+        LV_LOG_USER("Shuffle %s", C.queue.shuffle ? "on" : "off");
+    } else {
+        play_queue_set_repeat(&C.queue, (play_queue_repeat_t)((C.queue.repeat + 1) % PLAY_QUEUE_REPEAT_COUNT));
+        LV_LOG_USER("Repeat mode %d", (int)C.queue.repeat);
+    }
 
-    // Execute switch
-    app_switch_to_album(new_index);
-    // Song switch successful
+    // The next track may have changed, so has the prefetch hint
+    app_prefetch_neighbors();
+    app_refresh_queue_modes();
 }
 
 static void app_play_status_event_handler(lv_event_t* e)
@@ -872,13 +1446,11 @@ static void app_play_status_event_handler(lv_event_t* e)
         // Visual feedback when pressed
         lv_obj_add_state(target, LV_STATE_PRESSED);
         lv_obj_set_style_transform_scale(target, 245, LV_PART_MAIN);  // Slight shrink
-        lv_obj_set_style_shadow_width(target, 35, LV_PART_MAIN);
         return;
     } else if (code == LV_EVENT_RELEASED) {
         // Restore state when released
         lv_obj_clear_state(target, LV_STATE_PRESSED);
         lv_obj_set_style_transform_scale(target, 256, LV_PART_MAIN);
-        lv_obj_set_style_shadow_width(target, 25, LV_PART_MAIN);
         return;
     } else if (code != LV_EVENT_CLICKED) {
         // Only handle click, press and release events
@@ -886,11 +1458,11 @@ static void app_play_status_event_handler(lv_event_t* e)
     }
     
     // Status check - ensure player is in valid state
-    if (!C.current_album && R.album_count > 0) {
+    if (!track_store_valid(R.tracks, C.current_track) && R.tracks->count > 0) {
         LV_LOG_WARN("No album selected currently, automatically selecting first song");
         app_switch_to_album(0);
         return;
-    } else if (R.album_count == 0) {
+    } else if (R.tracks->count == 0) {
         LV_LOG_ERROR("Playlist is empty, cannot play");
         return;
     }
@@ -990,7 +1562,7 @@ static void app_playback_progress_bar_event_handler(lv_event_t* e)
     
     lv_event_code_t code = lv_event_get_code(e);
     
-    if (!C.current_album) {
+    if (!track_store_valid(R.tracks, C.current_track)) {
         LV_LOG_ERROR("Current album is empty, cannot operate progress bar");
         return;
     }
@@ -1011,9 +1583,10 @@ static void app_playback_progress_bar_event_handler(lv_event_t* e)
         }
         
         // Drag state visual feedback - blue highlight and smooth animation
-        lv_obj_set_height(R.ui.playback_progress, 14);  // More noticeable height change
+        // Grown by a transform, a height change would lay out the whole control row again
+        lv_obj_set_style_transform_height(R.ui.playback_progress, PROGRESS_SEEK_GROW, LV_PART_MAIN);
         lv_obj_set_style_bg_color(R.ui.playback_progress, lv_color_hex(0x0078D4), LV_PART_INDICATOR);  // Microsoft blue
-        lv_obj_set_style_shadow_width(R.ui.playback_progress, 12, LV_PART_INDICATOR);
+        lv_obj_set_style_shadow_width(R.ui.playback_progress, render_profile_get() == RENDER_PROFILE_LITE ? 0 : 12, LV_PART_INDICATOR);
         lv_obj_set_style_shadow_color(R.ui.playback_progress, lv_color_hex(0x0078D4), LV_PART_INDICATOR);
         lv_obj_set_style_shadow_opa(R.ui.playback_progress, LV_OPA_70, LV_PART_INDICATOR);
         lv_obj_set_style_radius(R.ui.playback_progress, 7, LV_PART_INDICATOR);
@@ -1052,7 +1625,7 @@ static void app_playback_progress_bar_event_handler(lv_event_t* e)
         else if (relative_x > bar_width) relative_x = bar_width;
         
         // Calculate new preview time
-        uint64_t total_time = C.current_album->total_time;
+        uint64_t total_time = app_get_total_time();
         uint64_t new_time = (uint64_t)relative_x * total_time / bar_width;
         
         // Time range check
@@ -1062,16 +1635,9 @@ static void app_playback_progress_bar_event_handler(lv_event_t* e)
         
         // Drag position calculation completed
         
-        // Update UI display
+        // Update UI display at the next refresh, however many moves come before it
         progress_state.current_value = (int32_t)new_time;
-        lv_bar_set_value(R.ui.playback_progress, (int32_t)new_time, LV_ANIM_OFF);
-        
-        // Update time display
-        char buff[16];
-        uint32_t preview_min = new_time / 60000;
-        uint32_t preview_sec = (new_time % 60000) / 1000;
-        lv_snprintf(buff, sizeof(buff), "%02d:%02d", preview_min, preview_sec);
-        lv_span_set_text(R.ui.playback_current_time, buff);
+        app_ui_invalidate(UI_DIRTY_PROGRESS);
         
         // Preview feedback - silent mode
         
@@ -1084,7 +1650,7 @@ static void app_playback_progress_bar_event_handler(lv_event_t* e)
         progress_state.is_seeking = false;
         
         // Restore progress bar normal style - smooth transition
-        lv_obj_set_height(R.ui.playback_progress, 8);
+        lv_obj_set_style_transform_height(R.ui.playback_progress, 0, LV_PART_MAIN);
         lv_obj_set_style_bg_color(R.ui.playback_progress, lv_color_hex(0xFF4757), LV_PART_INDICATOR);
         lv_obj_set_style_shadow_width(R.ui.playback_progress, 0, LV_PART_INDICATOR);
         lv_obj_set_style_radius(R.ui.playback_progress, 4, LV_PART_INDICATOR);
@@ -1094,11 +1660,11 @@ static void app_playback_progress_bar_event_handler(lv_event_t* e)
         uint64_t seek_time = progress_state.seek_preview_time;
         
         // Safe boundary check
-        if (seek_time > C.current_album->total_time) {
-            seek_time = C.current_album->total_time;
+        if (seek_time > app_get_total_time()) {
+            seek_time = app_get_total_time();
         }
         
-        if (C.audioctl && seek_time <= C.current_album->total_time) {
+        if (C.audioctl && seek_time <= app_get_total_time()) {
             // Execute seek, pass milliseconds
             int seek_result = audio_ctl_seek(C.audioctl, seek_time);
             
@@ -1160,33 +1726,21 @@ static void app_playback_progress_bar_event_handler(lv_event_t* e)
         if (relative_x > bar_width) relative_x = bar_width;
         
         // Calculate new playback time
-        uint64_t total_time = C.current_album->total_time;
+        uint64_t total_time = app_get_total_time();
         uint64_t new_time = (uint64_t)relative_x * total_time / bar_width;
         
         if (new_time > total_time) new_time = total_time;
         
         // Click jump operation
         
-        // Immediately update progress bar value for instant feedback
-        lv_bar_set_value(R.ui.playback_progress, (int32_t)new_time, LV_ANIM_ON);
-        
-        // Execute actual jump
+        // Execute actual jump, the bar animates to it at the next refresh
         if (C.audioctl) {
             int seek_result = audio_ctl_seek(C.audioctl, new_time);
             
             if (seek_result == 0) {
                 C.current_time = new_time;
-                
-                // Update time display
-                char buff[16];
-                uint32_t current_min = new_time / 60000;
-                uint32_t current_sec = (new_time % 60000) / 1000;
-                lv_snprintf(buff, sizeof(buff), "%02d:%02d", current_min, current_sec);
-                lv_span_set_text(R.ui.playback_current_time, buff);
-            } else {
-                // Seek failed, restore original progress
-                app_refresh_playback_progress();
             }
+            app_refresh_playback_progress();
         }
         break;
     }
@@ -1196,7 +1750,7 @@ static void app_playback_progress_bar_event_handler(lv_event_t* e)
             progress_state.is_seeking = false;
             
             // Restore normal style
-            lv_obj_set_height(R.ui.playback_progress, 8);
+            lv_obj_set_style_transform_height(R.ui.playback_progress, 0, LV_PART_MAIN);
             lv_obj_set_style_bg_color(R.ui.playback_progress, lv_color_hex(0xFF4757), LV_PART_INDICATOR);
             lv_obj_set_style_shadow_width(R.ui.playback_progress, 0, LV_PART_INDICATOR);
             lv_obj_set_style_radius(R.ui.playback_progress, 4, LV_PART_INDICATOR);
@@ -1230,9 +1784,9 @@ static void app_playback_progress_bar_event_handler(lv_event_t* e)
         }
         
         // Precise adjustment mode visual feedback - green highlight
-        lv_obj_set_height(R.ui.playback_progress, 16);  // Maximum height
+        lv_obj_set_style_transform_height(R.ui.playback_progress, PROGRESS_PRECISE_GROW, LV_PART_MAIN);  // Maximum height
         lv_obj_set_style_bg_color(R.ui.playback_progress, lv_color_hex(0x00C851), LV_PART_INDICATOR);  // Green
-        lv_obj_set_style_shadow_width(R.ui.playback_progress, 8, LV_PART_INDICATOR);
+        lv_obj_set_style_shadow_width(R.ui.playback_progress, render_profile_get() == RENDER_PROFILE_LITE ? 0 : 8, LV_PART_INDICATOR);
         lv_obj_set_style_shadow_color(R.ui.playback_progress, lv_color_hex(0x00C851), LV_PART_INDICATOR);
         lv_obj_set_style_shadow_opa(R.ui.playback_progress, LV_OPA_80, LV_PART_INDICATOR);
         lv_obj_set_style_radius(R.ui.playback_progress, 8, LV_PART_INDICATOR);
@@ -1269,12 +1823,14 @@ static bool init_resource(void)
     // Modern UI Styles
     lv_style_init(&R.styles.button_default);
     lv_style_init(&R.styles.button_pressed);
-    lv_style_init(&R.styles.circular_cover);
-    lv_style_init(&R.styles.vinyl_ring);
     lv_style_init(&R.styles.vinyl_center);
     lv_style_init(&R.styles.gradient_progress);
     lv_style_init(&R.styles.frosted_glass);
     lv_style_init(&R.styles.modern_card);
+    lv_style_init(&R.styles.page_background);
+    lv_style_init(&R.styles.play_glow);
+    lv_style_init(&R.styles.play_glow_pressed);
+    lv_style_init(&R.styles.switch_pressed);
 
     // Professional button styles - touch-friendly design
     lv_style_set_opa(&R.styles.button_default, LV_OPA_COVER);
@@ -1300,28 +1856,6 @@ static bool init_resource(void)
     lv_style_set_border_color(&R.styles.button_pressed, MODERN_PRIMARY_COLOR);
     lv_style_set_border_opa(&R.styles.button_pressed, LV_OPA_80);
 
-    // Circular cover style - enhanced circular border effect
-    lv_style_set_radius(&R.styles.circular_cover, LV_RADIUS_CIRCLE);
-    lv_style_set_border_width(&R.styles.circular_cover, 6);  // Increase border width to make it more visible
-    lv_style_set_border_color(&R.styles.circular_cover, lv_color_hex(0x3B82F6));  // Blue border more prominent
-    lv_style_set_border_opa(&R.styles.circular_cover, LV_OPA_80);  // Slightly transparent
-    lv_style_set_shadow_width(&R.styles.circular_cover, 25);  // Enhanced shadow
-    lv_style_set_shadow_color(&R.styles.circular_cover, lv_color_hex(0x3B82F6));  // Blue shadow
-    lv_style_set_shadow_opa(&R.styles.circular_cover, LV_OPA_30);
-    lv_style_set_shadow_spread(&R.styles.circular_cover, 5);
-
-    // Vinyl ring style - outer ring style
-    lv_style_set_radius(&R.styles.vinyl_ring, LV_RADIUS_CIRCLE);
-    lv_style_set_border_width(&R.styles.vinyl_ring, 8);  // Thick border simulating vinyl edge
-    lv_style_set_border_color(&R.styles.vinyl_ring, lv_color_hex(0x1A1A1A));  // Deep black
-    lv_style_set_border_opa(&R.styles.vinyl_ring, LV_OPA_COVER);
-    lv_style_set_bg_color(&R.styles.vinyl_ring, lv_color_hex(0x0F0F0F));  // Very deep background
-    lv_style_set_bg_opa(&R.styles.vinyl_ring, LV_OPA_30);  // Semi-transparent
-    lv_style_set_shadow_width(&R.styles.vinyl_ring, 30);
-    lv_style_set_shadow_color(&R.styles.vinyl_ring, lv_color_hex(0x000000));
-    lv_style_set_shadow_opa(&R.styles.vinyl_ring, LV_OPA_70);
-    lv_style_set_shadow_spread(&R.styles.vinyl_ring, 8);
-
     // Vinyl center style - center hole style
     lv_style_set_radius(&R.styles.vinyl_center, LV_RADIUS_CIRCLE);
     lv_style_set_bg_color(&R.styles.vinyl_center, lv_color_hex(0x1A1A1A));  // Deep black center
@@ -1331,23 +1865,27 @@ static bool init_resource(void)
     lv_style_set_border_opa(&R.styles.vinyl_center, LV_OPA_COVER);
 
     // Gradient progress bar style
-    lv_style_set_bg_color(&R.styles.gradient_progress, MODERN_PRIMARY_COLOR);
-    lv_style_set_bg_grad_color(&R.styles.gradient_progress, MODERN_SECONDARY_COLOR);
-    lv_style_set_bg_grad_dir(&R.styles.gradient_progress, LV_GRAD_DIR_HOR);
     lv_style_set_radius(&R.styles.gradient_progress, 10);
 
     // Frosted glass style (simplified without backdrop filter)
-    lv_style_set_bg_color(&R.styles.frosted_glass, lv_color_hex(0x1E1E1E));
-    lv_style_set_bg_opa(&R.styles.frosted_glass, LV_OPA_70);
     lv_style_set_radius(&R.styles.frosted_glass, 20);
 
     // Modern card style
-    lv_style_set_bg_color(&R.styles.modern_card, MODERN_CARD_COLOR);
-    lv_style_set_bg_opa(&R.styles.modern_card, LV_OPA_90);
     lv_style_set_radius(&R.styles.modern_card, 25);
-    lv_style_set_shadow_width(&R.styles.modern_card, 15);
-    lv_style_set_shadow_color(&R.styles.modern_card, lv_color_black());
-    lv_style_set_shadow_opa(&R.styles.modern_card, LV_OPA_30);
+
+    // Shadows, gradients and translucent fills depend on the render profile
+#ifdef CONFIG_LVX_MUSIC_PLAYER_RENDER_PROFILE_LITE
+    render_profile_init(RENDER_PROFILE_LITE);
+#else
+    render_profile_init(RENDER_PROFILE_FULL);
+#endif
+    render_profile_register("page_background", &R.styles.page_background, app_style_page_background);
+    render_profile_register("modern_card", &R.styles.modern_card, app_style_card);
+    render_profile_register("frosted_glass", &R.styles.frosted_glass, app_style_status_bar);
+    render_profile_register("gradient_progress", &R.styles.gradient_progress, app_style_progress);
+    render_profile_register("play_glow", &R.styles.play_glow, app_style_play_glow);
+    render_profile_register("play_glow_pressed", &R.styles.play_glow_pressed, app_style_play_glow_pressed);
+    render_profile_register("switch_pressed", &R.styles.switch_pressed, app_style_switch_pressed);
 
     // transition animations
     lv_style_transition_dsc_init(&R.styles.transition_dsc, transition_props, &lv_anim_path_ease_in_out, 300, 0, NULL);
@@ -1370,8 +1908,20 @@ static bool init_resource(void)
     // R.images.background = ICONS_ROOT "/background.png";  // Removed
     R.images.background = NULL;  // Explicitly set to NULL
 
-    // albums
-    reload_music_config();
+    // albums, the first version is loaded before the UI exists
+    library_config_s library_config = {
+        .root = MUSICS_ROOT,
+        .index_path = LIBRARY_INDEX_PATH,
+    };
+    library_init(&library_config);
+
+    library_snapshot_s* snapshot = library_load();
+    if (snapshot == NULL) {
+        LV_LOG_ERROR("Music library initialization failed");
+        return false;
+    }
+    library_publish(snapshot, LIBRARY_VERSION_ANY);
+    app_pin_library();
 
     return true;
 }
@@ -1389,9 +1939,10 @@ static void app_create_top_layer(void)
     // Note: Only create volume bar, playlist has been moved to new playlist_manager system
 
     // VOLUME BAR
-    R.ui.volume_bar = lv_obj_create(top_layer);
+    R.ui.volume_bar = lv_bar_create(top_layer);
     lv_obj_remove_style_all(R.ui.volume_bar);
-    lv_obj_set_size(R.ui.volume_bar, 60, 180);
+    lv_obj_set_size(R.ui.volume_bar, 60, VOLUME_BAR_HEIGHT);  // Taller than wide: fills upwards
+    lv_bar_set_range(R.ui.volume_bar, 0, VOLUME_BAR_HEIGHT);
     lv_obj_set_style_bg_color(R.ui.volume_bar, lv_color_hex(0x444444), LV_PART_MAIN);
     lv_obj_set_style_bg_opa(R.ui.volume_bar, LV_OPA_COVER, LV_PART_MAIN);
     lv_obj_set_style_opa(R.ui.volume_bar, LV_OPA_0, LV_STATE_DEFAULT);
@@ -1402,22 +1953,85 @@ static void app_create_top_layer(void)
     lv_obj_align(R.ui.volume_bar, LV_ALIGN_BOTTOM_RIGHT, -45, -95);
     lv_obj_set_style_transition(R.ui.volume_bar, &R.styles.transition_dsc, LV_STATE_DEFAULT);
 
-    R.ui.volume_bar_indic = lv_obj_create(R.ui.volume_bar);
-    lv_obj_remove_style_all(R.ui.volume_bar_indic);
-    lv_obj_set_style_bg_color(R.ui.volume_bar_indic, lv_color_white(), LV_PART_MAIN);
-    lv_obj_set_style_bg_opa(R.ui.volume_bar_indic, LV_OPA_COVER, LV_PART_MAIN);
-    lv_obj_set_size(R.ui.volume_bar_indic, LV_PCT(100), 40);
-    lv_obj_align(R.ui.volume_bar_indic, LV_ALIGN_BOTTOM_MID, 0, 0);
+    lv_obj_set_style_bg_color(R.ui.volume_bar, lv_color_white(), LV_PART_INDICATOR);
+    lv_obj_set_style_bg_opa(R.ui.volume_bar, LV_OPA_COVER, LV_PART_INDICATOR);
 
     // Old playlist system removed - now using new system in playlist_manager.c
     // Set playlist-related UI pointers to NULL to avoid misuse elsewhere
     R.ui.playlist_base = NULL;
     R.ui.playlist = NULL;
 
-    lv_obj_add_flag(R.ui.volume_bar_indic, LV_OBJ_FLAG_EVENT_BUBBLE);
     lv_obj_add_event_cb(R.ui.volume_bar, app_volume_bar_event_handler, LV_EVENT_ALL, NULL);
 }
 
+/* Render profile variants of the shared styles, see render_profile_register() */
+static void app_style_page_background(lv_style_t* style, render_profile_t profile)
+{
+    lv_style_set_bg_color(style, lv_color_hex(0x121212));
+    if (profile == RENDER_PROFILE_FULL) {
+        lv_style_set_bg_grad_color(style, lv_color_hex(0x0F0F0F));
+        lv_style_set_bg_grad_dir(style, LV_GRAD_DIR_VER);
+    } else {
+        lv_style_set_bg_grad_dir(style, LV_GRAD_DIR_NONE);
+    }
+}
+
+static void app_style_card(lv_style_t* style, render_profile_t profile)
+{
+    lv_style_set_bg_color(style, MODERN_CARD_COLOR);
+    if (profile == RENDER_PROFILE_FULL) {
+        lv_style_set_bg_opa(style, LV_OPA_90);
+        lv_style_set_shadow_width(style, 15);
+        lv_style_set_shadow_color(style, lv_color_black());
+        lv_style_set_shadow_opa(style, LV_OPA_30);
+    } else {
+        // Opaque fill of about the same shade, nothing to blend
+        lv_style_set_bg_opa(style, LV_OPA_COVER);
+        lv_style_set_shadow_width(style, 0);
+    }
+}
+
+static void app_style_status_bar(lv_style_t* style, render_profile_t profile)
+{
+    if (profile == RENDER_PROFILE_FULL) {
+        lv_style_set_bg_color(style, lv_color_hex(0x1E1E1E));
+        lv_style_set_bg_opa(style, LV_OPA_70);
+    } else {
+        // 0x1E1E1E at 70% over the page background, precomputed
+        lv_style_set_bg_color(style, lv_color_hex(0x1A1A1A));
+        lv_style_set_bg_opa(style, LV_OPA_COVER);
+    }
+}
+
+static void app_style_progress(lv_style_t* style, render_profile_t profile)
+{
+    lv_style_set_bg_color(style, MODERN_PRIMARY_COLOR);
+    if (profile == RENDER_PROFILE_FULL) {
+        lv_style_set_bg_grad_color(style, MODERN_SECONDARY_COLOR);
+        lv_style_set_bg_grad_dir(style, LV_GRAD_DIR_HOR);
+    } else {
+        lv_style_set_bg_grad_dir(style, LV_GRAD_DIR_NONE);
+    }
+}
+
+static void app_style_play_glow(lv_style_t* style, render_profile_t profile)
+{
+    lv_style_set_shadow_width(style, profile == RENDER_PROFILE_FULL ? 25 : 0);
+    lv_style_set_shadow_color(style, lv_color_hex(0x00BFFF));  // Blue shadow
+    lv_style_set_shadow_opa(style, LV_OPA_70);
+}
+
+static void app_style_play_glow_pressed(lv_style_t* style, render_profile_t profile)
+{
+    lv_style_set_shadow_width(style, profile == RENDER_PROFILE_FULL ? 35 : 0);
+    lv_style_set_shadow_opa(style, LV_OPA_90);
+}
+
+static void app_style_switch_pressed(lv_style_t* style, render_profile_t profile)
+{
+    lv_style_set_shadow_width(style, profile == RENDER_PROFILE_FULL ? 20 : 0);
+}
+
 static void app_create_error_page(void)
 {
     lv_obj_t* root = lv_screen_active();
@@ -1436,9 +2050,7 @@ static void app_create_main_page(void)
 
     // Professional solid background design - remove background.png dependency
     // Adopt dark professional theme to enhance user experience and performance
-    lv_obj_set_style_bg_color(root, lv_color_hex(0x121212), LV_PART_MAIN);  // Dark theme
-    lv_obj_set_style_bg_grad_color(root, lv_color_hex(0x0F0F0F), LV_PART_MAIN);  // Deeper gradient
-        lv_obj_set_style_bg_grad_dir(root, LV_GRAD_DIR_VER, LV_PART_MAIN);
+    lv_obj_add_style(root, &R.styles.page_background, LV_PART_MAIN);  // Dark theme, deeper gradient
     lv_obj_set_style_bg_opa(root, LV_OPA_COVER, LV_PART_MAIN);
     
     // Dark background applied
@@ -1536,38 +2148,20 @@ static void app_create_main_page(void)
     lv_obj_set_style_transform_pivot_x(album_container, 160, 0);
     lv_obj_set_style_transform_pivot_y(album_container, 160, 0);
 
-    // Vinyl outer ring - outermost border effect
-    lv_obj_t* vinyl_ring = lv_obj_create(album_container);
-    R.ui.vinyl_ring = vinyl_ring;
-    lv_obj_remove_style_all(vinyl_ring);
-    lv_obj_add_style(vinyl_ring, &R.styles.vinyl_ring, LV_PART_MAIN);
-    lv_obj_set_size(vinyl_ring, 320, 320);
-    lv_obj_center(vinyl_ring);
-
-    // Album cover image - perfect circular display, complete image without distortion
+    // Album cover disc - ring, shadows, round cover and border composited into one image
+    lv_obj_add_flag(album_container, LV_OBJ_FLAG_OVERFLOW_VISIBLE);  // The ring shadow reaches past the container
     lv_obj_t* album_cover = lv_image_create(album_container);
     R.ui.album_cover = album_cover;
     lv_obj_remove_style_all(album_cover);
-    lv_obj_add_style(album_cover, &R.styles.circular_cover, LV_PART_MAIN);
-    lv_obj_set_size(album_cover, 280, 280);
+    lv_obj_set_size(album_cover, COVER_ART_SIZE, COVER_ART_SIZE);
     lv_obj_center(album_cover);
-    
-    // Set image display mode: complete display, centered, maintain original aspect ratio
-    lv_image_set_scale(album_cover, 256);  // Appropriate scaling to maintain clarity
-    lv_image_set_inner_align(album_cover, LV_IMAGE_ALIGN_CENTER);
-    lv_image_set_pivot(album_cover, 140, 140);  // Set rotation center point
-    
-    // Add image loading error handling
-    lv_image_set_src(album_cover, R.images.nocover);
-    
-    // Ensure PNG images are displayed completely in circular container with original aspect ratio
-    lv_obj_set_style_clip_corner(album_cover, true, LV_PART_MAIN);  // Enable circular clipping
-    lv_obj_set_style_bg_img_recolor_opa(album_cover, LV_OPA_0, LV_PART_MAIN);  // Don't recolor
-    lv_obj_set_style_image_recolor_opa(album_cover, LV_OPA_0, LV_PART_MAIN);  // Don't recolor image
-    
-    // Optimize image fill method to ensure complete display
-    lv_obj_set_style_bg_image_opa(album_cover, LV_OPA_COVER, LV_PART_MAIN);
-    lv_obj_set_style_radius(album_cover, LV_RADIUS_CIRCLE, LV_PART_MAIN);  // Circular border
+    lv_image_set_pivot(album_cover, COVER_ART_SIZE / 2, COVER_ART_SIZE / 2);  // Set rotation center point
+
+    if (cover_art_image()) {
+        lv_image_set_src(album_cover, cover_art_image());
+    } else {
+        lv_image_set_src(album_cover, R.images.nocover);
+    }
 
     // Remove vinyl center hole - user requested not to show center black dot
     // lv_obj_t* vinyl_center = lv_obj_create(album_container);
@@ -1639,9 +2233,9 @@ static void app_create_main_page(void)
     R.ui.playback_current_time = current_time;
     R.ui.playback_total_time = total_time;
     
-    lv_span_set_text(current_time, "00:00");
+    app_set_span_text(current_time, ui_text.current_time, sizeof(ui_text.current_time), "00:00");
     lv_span_set_text(separator, " / ");  // Use "/" separator, more concise
-    lv_span_set_text(total_time, "00:00");
+    app_set_span_text(total_time, ui_text.total_time, sizeof(ui_text.total_time), "00:00");
     lv_obj_set_style_text_font(time_display, R.fonts.size_22.bold, LV_PART_MAIN);  // Changed from 16pt to 22pt font
     lv_obj_set_style_text_color(time_display, lv_color_hex(0x3B82F6), LV_PART_MAIN);
     lv_obj_set_style_text_align(time_display, LV_TEXT_ALIGN_RIGHT, LV_PART_MAIN);  // Right aligned
@@ -1661,6 +2255,7 @@ static void app_create_main_page(void)
     // Professional playlist button - apply professional configuration
     lv_obj_t* playlist_btn = lv_button_create(control_area);
     lv_obj_t* playlist_icon = lv_image_create(playlist_btn);
+    R.ui.playlist_btn = playlist_btn;
     lv_obj_remove_style_all(playlist_btn);
     
     // Apply professional button configuration
@@ -1681,6 +2276,7 @@ static void app_create_main_page(void)
     // Previous button configuration
     lv_obj_set_style_bg_color(prev_btn, lv_color_hex(0x374151), LV_PART_MAIN);
     lv_obj_set_style_bg_color(prev_btn, lv_color_hex(0x4B5563), LV_PART_MAIN | LV_STATE_PRESSED);
+    lv_obj_add_style(prev_btn, &R.styles.switch_pressed, LV_PART_MAIN | LV_STATE_PRESSED);
     
     lv_image_set_src(prev_icon, R.images.previous);
     lv_obj_set_size(prev_icon, 32, 32);
@@ -1700,11 +2296,8 @@ static void app_create_main_page(void)
     lv_obj_set_style_bg_color(play_btn, lv_color_hex(0x4B5563), LV_PART_MAIN | LV_STATE_PRESSED);
     
     // Main button special glow effect
-    lv_obj_set_style_shadow_width(play_btn, 25, LV_STATE_DEFAULT);
-    lv_obj_set_style_shadow_width(play_btn, 35, LV_STATE_PRESSED);
-    lv_obj_set_style_shadow_color(play_btn, lv_color_hex(0x00BFFF), LV_PART_MAIN);  // Blue shadow
-    lv_obj_set_style_shadow_opa(play_btn, LV_OPA_70, LV_STATE_DEFAULT);
-    lv_obj_set_style_shadow_opa(play_btn, LV_OPA_90, LV_STATE_PRESSED);
+    lv_obj_add_style(play_btn, &R.styles.play_glow, LV_PART_MAIN);
+    lv_obj_add_style(play_btn, &R.styles.play_glow_pressed, LV_PART_MAIN | LV_STATE_PRESSED);
     
     lv_image_set_src(play_icon, R.images.play);
     lv_obj_set_size(play_icon, 48, 48);
@@ -1714,6 +2307,7 @@ static void app_create_main_page(void)
 
     // Pro next button
     lv_obj_t* next_btn = lv_button_create(control_area);
+    R.ui.next_btn = next_btn;
     lv_obj_t* next_icon = lv_image_create(next_btn);
     lv_obj_remove_style_all(next_btn);
     
@@ -1721,6 +2315,7 @@ static void app_create_main_page(void)
     // Next button configuration
     lv_obj_set_style_bg_color(next_btn, lv_color_hex(0x374151), LV_PART_MAIN);
     lv_obj_set_style_bg_color(next_btn, lv_color_hex(0x4B5563), LV_PART_MAIN | LV_STATE_PRESSED);
+    lv_obj_add_style(next_btn, &R.styles.switch_pressed, LV_PART_MAIN | LV_STATE_PRESSED);
     
     lv_image_set_src(next_icon, R.images.next);
     lv_obj_set_size(next_icon, 32, 32);
@@ -1740,6 +2335,38 @@ static void app_create_main_page(void)
     lv_obj_set_size(volume_icon, 28, 28);
     lv_obj_center(volume_icon);
 
+    // Play queue modes below the transport controls
+    lv_obj_t* mode_area = lv_obj_create(player_main);
+    lv_obj_remove_style_all(mode_area);
+    lv_obj_set_size(mode_area, LV_PCT(100), LV_SIZE_CONTENT);
+    lv_obj_set_flex_flow(mode_area, LV_FLEX_FLOW_ROW);
+    lv_obj_set_flex_align(mode_area, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+    lv_obj_set_style_pad_column(mode_area, 24, LV_PART_MAIN);
+
+    lv_obj_t* mode_btns[2];
+    const char* mode_symbols[2] = { LV_SYMBOL_SHUFFLE, LV_SYMBOL_LOOP };
+    for (int i = 0; i < 2; i++) {
+        lv_obj_t* btn = lv_button_create(mode_area);
+        lv_obj_remove_style_all(btn);
+        lv_obj_set_size(btn, 56, 36);
+        lv_obj_set_style_radius(btn, 18, LV_PART_MAIN);
+        lv_obj_set_style_bg_opa(btn, LV_OPA_COVER, LV_PART_MAIN);
+        lv_obj_set_style_bg_color(btn, lv_color_hex(0x374151), LV_PART_MAIN);
+        lv_obj_set_style_bg_color(btn, lv_color_hex(0x4B5563), LV_PART_MAIN | LV_STATE_PRESSED);
+        lv_obj_set_style_text_color(btn, MODERN_TEXT_SECONDARY, LV_PART_MAIN);
+        lv_obj_set_style_text_color(btn, MODERN_PRIMARY_COLOR, LV_PART_MAIN | LV_STATE_CHECKED);
+
+        lv_obj_t* label = lv_label_create(btn);
+        lv_label_set_text(label, mode_symbols[i]);
+        lv_obj_center(label);
+        mode_btns[i] = btn;
+        if (i == 1) {
+            R.ui.repeat_label = label;
+        }
+    }
+    R.ui.shuffle_btn = mode_btns[0];
+    app_refresh_queue_modes();
+
     // Create top layer overlay (volume bar, playlist, etc)
     app_create_top_layer();
 
@@ -1770,6 +2397,9 @@ static void app_create_main_page(void)
     // Add long press support - environment friendly
     lv_obj_add_event_cb(prev_btn, app_switch_album_event_handler, LV_EVENT_LONG_PRESSED_REPEAT, (lv_uintptr_t*)SWITCH_ALBUM_MODE_PREV);
     lv_obj_add_event_cb(next_btn, app_switch_album_event_handler, LV_EVENT_LONG_PRESSED_REPEAT, (lv_uintptr_t*)SWITCH_ALBUM_MODE_NEXT);
+
+    lv_obj_add_event_cb(mode_btns[0], app_queue_mode_event_handler, LV_EVENT_CLICKED, NULL);
+    lv_obj_add_event_cb(mode_btns[1], app_queue_mode_event_handler, LV_EVENT_CLICKED, NULL);
     
     // Enhanced progress bar interaction - supports click jump and drag
     lv_obj_add_event_cb(progress_bar, app_playback_progress_bar_event_handler, LV_EVENT_ALL, NULL);
@@ -1783,6 +2413,9 @@ static void app_create_main_page(void)
 
     // Start time update timer
     app_start_updating_date_time();
+
+    // State changes collected since the last frame are applied as the display starts the next one
+    lv_display_add_event_cb(lv_display_get_default(), app_ui_refr_start_cb, LV_EVENT_REFR_START, NULL);
     
     // UI creation completed
 }
@@ -1858,174 +2491,253 @@ static void read_configs(void)
     lv_free(buff);
 }
 
-static void reload_music_config(void)
+/* Pin the newest library version, following the current track by path */
+static void app_pin_library(void)
 {
-    // Safe memory cleanup - enhanced version
-    LV_LOG_USER("Starting to reload music configuration...");
-    
-    /* Clear previous music config */
-    if (R.albums) {
-        for (int i = 0; i < R.album_count; i++) {
-            // Safely release string memory
-            if (R.albums[i].name) {
-                lv_free((void*)R.albums[i].name);
-                R.albums[i].name = NULL;
-            }
-            if (R.albums[i].artist) {
-                lv_free((void*)R.albums[i].artist);
-                R.albums[i].artist = NULL;
-            }
-            // Clear path and cover character arrays
-            memset(R.albums[i].path, 0, sizeof(R.albums[i].path));
-            memset(R.albums[i].cover, 0, sizeof(R.albums[i].cover));
-        }
+    library_snapshot_s* snapshot = library_acquire();
+    if (snapshot == R.library) {
+        library_release(snapshot);
+        return;
+    }
 
-        lv_free(R.albums);
-        R.albums = NULL;
+    // Ids are per version, only the path identifies a track across them
+    track_id_t id = TRACK_ID_INVALID;
+    if (R.library && track_store_valid(R.tracks, C.current_track)) {
+        id = track_store_find(&snapshot->tracks, track_store_path(R.tracks, C.current_track));
+    }
+    if (R.library) {
+        play_queue_remap(&C.queue, snapshot->tracks.count, id, app_map_track, snapshot);
     }
-    
-    R.album_count = 0;
-    
-    // Memory statistics
-    // Memory cleanup completed - silent mode
 
-    /* Load music config - enhanced memory safety */
-    uint32_t file_size;
-    lv_fs_file_t file;
-    char* buff = NULL;
-    cJSON* json = NULL;
-    
-    // Safe file opening
-    lv_fs_res_t res = lv_fs_open(&file, MUSICS_ROOT "/manifest.json", LV_FS_MODE_RD);
-    if (res != LV_FS_RES_OK) {
-        LV_LOG_ERROR("Cannot open music manifest file: %s", MUSICS_ROOT "/manifest.json");
-        return;
+    // Whatever still uses the old version (e.g. a pending drain) keeps it alive
+    library_release(R.library);
+    R.library = snapshot;
+    R.tracks = &snapshot->tracks;
+    C.current_track = id;
+}
+
+/* Play queue id mapping from the pinned version to a newer snapshot */
+static track_id_t app_map_track(track_id_t id, void* user_data)
+{
+    library_snapshot_s* snapshot = user_data;
+    if (!track_store_valid(R.tracks, id)) {
+        return TRACK_ID_INVALID;
     }
+    return track_store_find(&snapshot->tracks, track_store_path(R.tracks, id));
+}
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_RENDER_PROFILE_BENCH
+static void app_render_bench_timer_cb(lv_timer_t* timer)
+{
+    LV_UNUSED(timer);
+
+    render_profile_benchmark(NULL, RENDER_BENCH_FRAMES);
+}
+#endif
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_CACHE
+static void app_cover_wait_timer_cb(lv_timer_t* timer)
+{
+    LV_UNUSED(timer);
+
+    // Pauses itself once the cover is shown
+    app_refresh_album_cover();
+}
+#endif
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_COVER_ROTATION
+static void app_cover_rotation_timer_cb(lv_timer_t* timer)
+{
+    LV_UNUSED(timer);
 
-    // Safe file size retrieval
-    if (lv_fs_seek(&file, 0, LV_FS_SEEK_END) != LV_FS_RES_OK ||
-        lv_fs_tell(&file, &file_size) != LV_FS_RES_OK ||
-        lv_fs_seek(&file, 0, LV_FS_SEEK_SET) != LV_FS_RES_OK) {
-        LV_LOG_ERROR("File operation failed");
-        lv_fs_close(&file);
+    // Nothing is drawn while the cover is off screen or under the playlist
+    if (playlist_manager_is_open() || !lv_obj_is_visible(R.ui.album_cover)) {
         return;
     }
 
-    // Safe memory allocation
-    if (file_size == 0 || file_size > 2 * 1024 * 1024) {  // Limit 2MB
-        LV_LOG_ERROR("Music manifest file size abnormal: %lu bytes", (unsigned long)file_size);
-        lv_fs_close(&file);
+    // Angle from the elapsed time, frames the timer misses do not slow the turn
+    uint32_t elapsed = lv_tick_elaps(C.animations.rotation_tick) % COVER_ROTATION_DURATION;
+    int16_t angle = (int16_t)(elapsed * 3600 / COVER_ROTATION_DURATION);
+    if (angle == C.animations.rotation_angle) {
         return;
     }
-    
-    buff = lv_malloc(file_size + 1);  // +1 for null terminator
-    if (!buff) {
-        // Memory allocation failed - silent handling
-        lv_fs_close(&file);
+
+    // Without the cover copy (still decoding) the disc waits for the next compose
+    if (cover_art_rotate(angle) != 0) {
         return;
     }
-    
-    memset(buff, 0, file_size + 1);
-    
-    uint32_t bytes_read;
-    if (lv_fs_read(&file, buff, file_size, &bytes_read) != LV_FS_RES_OK || bytes_read != file_size) {
-        LV_LOG_ERROR("File read failed: expected %lu bytes, actually read %lu bytes", 
-                     (unsigned long)file_size, (unsigned long)bytes_read);
-        goto cleanup_and_exit;
-    }
-    
-    lv_fs_close(&file);
+    C.animations.rotation_angle = angle;
 
-    // JSON parsing
-    json = cJSON_Parse(buff);
-    if (json == NULL) {
-        const char* error_ptr = cJSON_GetErrorPtr();
-        LV_LOG_ERROR("JSON parsing error: %s", error_ptr ? error_ptr : "unknown error");
-        goto cleanup_and_exit;
-    }
+    // Only the cover square changes, the ring and its shadow are not redrawn
+    lv_area_t area;
+    lv_obj_get_coords(R.ui.album_cover, &area);
+    area.x1 += COVER_ART_DISC_OFFSET;
+    area.y1 += COVER_ART_DISC_OFFSET;
+    area.x2 = area.x1 + COVER_ART_COVER - 1;
+    area.y2 = area.y1 + COVER_ART_COVER - 1;
+    lv_obj_invalidate_area(R.ui.album_cover, &area);
+}
+#endif
 
-    cJSON* musics_object = cJSON_GetObjectItem(json, "musics");
-    if (musics_object == NULL) {
-        LV_LOG_ERROR("'musics' object not found in JSON");
-        goto cleanup_and_exit;
-    }
+static void app_library_sync_timer_cb(lv_timer_t* timer)
+{
+    LV_UNUSED(timer);
 
-    int total_albums = cJSON_GetArraySize(musics_object);
-    // Limit album count to prevent memory overflow
-    #define MAX_SAFE_ALBUMS 50
-    R.album_count = (total_albums > MAX_SAFE_ALBUMS) ? MAX_SAFE_ALBUMS : total_albums;
-    
-    LV_LOG_USER("Found %d albums in JSON, loading %d", total_albums, R.album_count);
-    
-    R.albums = lv_malloc_zeroed(R.album_count * sizeof(album_info_t));
-    if (!R.albums) {
-        // Album memory allocation failed
-        lv_free(buff);
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_WATCH
+    app_drain_library_watch();
+#endif
+
+    if (library_version() == R.library->version) {
         return;
     }
 
-    for (int i = 0; i < R.album_count; i++) {
-        cJSON* music_object = cJSON_GetArrayItem(musics_object, i);
-        if (!music_object) {
-            // Album JSON object invalid
-            continue;
+    // Playback goes on, the engine has its own copy of the path
+    bool had_track = track_store_valid(R.tracks, C.current_track);
+    app_pin_library();
+    LV_LOG_USER("Library version %lu: %lu tracks", (unsigned long)R.library->version, (unsigned long)R.tracks->count);
+
+    if (track_store_valid(R.tracks, C.current_track)) {
+        app_refresh_album_info();
+    } else {
+        if (had_track) {
+            // The current file is gone
+            app_set_play_status(PLAY_STATUS_STOP);
         }
+        app_switch_to_album(0);
+    }
+    app_refresh_playlist();
+}
 
-        const char* path = cJSON_GetStringValue(cJSON_GetObjectItem(music_object, "path"));
-        const char* name = cJSON_GetStringValue(cJSON_GetObjectItem(music_object, "name"));
-        const char* artist = cJSON_GetStringValue(cJSON_GetObjectItem(music_object, "artist"));
-        const char* cover = cJSON_GetStringValue(cJSON_GetObjectItem(music_object, "cover"));
-        const double total_time_double = cJSON_GetNumberValue(cJSON_GetObjectItem(music_object, "total_time"));
-        const char* color_str = cJSON_GetStringValue(cJSON_GetObjectItem(music_object, "color"));
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_WATCH
+/* Follow the music directory; with a manifest, only the manifest itself matters */
+static void app_start_library_watch(void)
+{
+    library_watch_config_s config = {
+        .root = MUSICS_ROOT,
+        .formats = LIBRARY_FORMATS,
+        .debounce_ms = CONFIG_LVX_MUSIC_PLAYER_LIBRARY_WATCH_DEBOUNCE_MS,
+        .poll_ms = CONFIG_LVX_MUSIC_PLAYER_LIBRARY_WATCH_POLL_MS,
+        .watch_files = access(MUSICS_ROOT "/manifest.json", F_OK) != 0,
+    };
 
-        // Safety check
-        if (!path || !name) {
-            // Album missing necessary information
-            continue;
-        }
+    if (library_watch_start(&config) != 0) {
+        LV_LOG_WARN("Library watcher not started, changes need a restart");
+    }
+}
 
-        uint64_t total_time = (uint64_t)total_time_double;
-        LV_LOG_USER("Loading album %d: %s - %s", i, name, artist ? artist : "Unknown Artist");
-        uint32_t color_int = strtoul(color_str + 1, NULL, 16);
+/* Apply watcher changes to a copy of the pinned version and publish it */
+static void app_drain_library_watch(void)
+{
+    uint32_t start = lv_tick_get();
+    library_apply_s apply = { 0 };
+    int count = library_watch_drain(app_apply_library_change, &apply);
+    if (count == 0) {
+        return;
+    }
 
-        if (total_time == 0)
-            total_time = 1;
+    if (apply.reload) {
+        // The manifest may have appeared or gone, which changes what is watched
+        library_release(apply.snapshot);
+        library_watch_stop();
+        library_reload_async();
+        app_start_library_watch();
+        return;
+    }
 
-        lv_color_t color = lv_color_hex(color_int);
+    if (apply.changed == 0) {
+        library_release(apply.snapshot);
+        return;
+    }
 
-        lv_snprintf(R.albums[i].path, sizeof(R.albums[i].path), "%s/%s", MUSICS_ROOT, path);
-        lv_snprintf(R.albums[i].cover, sizeof(R.albums[i].cover), "%s/%s", MUSICS_ROOT, cover);
-        R.albums[i].name = lv_strdup(name);
-        R.albums[i].artist = lv_strdup(artist);
-        R.albums[i].total_time = total_time;
-        R.albums[i].color = color;
+    // A reload finished meanwhile already read the files from disk
+    if (library_publish(apply.snapshot, R.library->version) != 0) {
+        LV_LOG_USER("Library reloaded meanwhile, %d changes dropped", count);
+        return;
+    }
+    LV_LOG_USER("Library updated: %d changes in %lu ms", count, (unsigned long)lv_tick_elaps(start));
+    LV_UNUSED(start);
 
-        LV_LOG_USER("Album %d: %s - %s | %s %s %lu", i, R.albums[i].name, R.albums[i].artist, R.albums[i].path, R.albums[i].cover, (unsigned long)total_time);
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_INDEX
+    // Edits are written to the index once they settle
+    if (C.timers.library_save) {
+        lv_timer_set_repeat_count(C.timers.library_save, 1);
+        lv_timer_reset(C.timers.library_save);
+        lv_timer_resume(C.timers.library_save);
+    } else {
+        C.timers.library_save = lv_timer_create(app_library_save_timer_cb, LIBRARY_SAVE_DELAY, NULL);
+        lv_timer_set_repeat_count(C.timers.library_save, 1);
+        lv_timer_set_auto_delete(C.timers.library_save, false);
     }
+#endif
+}
 
-    // Safe resource cleanup
-    goto cleanup_success;
+static void app_apply_library_change(const library_change_s* change, void* user_data)
+{
+    library_apply_s* apply = user_data;
+    track_id_t id;
 
-cleanup_and_exit:
-    // Resource release when cleanup fails
-    if (R.albums) {
-        lv_free(R.albums);
-        R.albums = NULL;
-        R.album_count = 0;
+    // A reload comes first in its batch and rebuilds everything after it anyway
+    if (apply->reload) {
+        return;
     }
-    
-cleanup_success:
-    // Resources that need to be cleaned up regardless of success or failure
-    if (json) {
-        cJSON_Delete(json);
-        json = NULL;
+    if (change->type == LIBRARY_CHANGE_RELOAD) {
+        apply->reload = true;
+        return;
     }
-    
-    if (buff) {
-        lv_free(buff);
-        buff = NULL;
+
+    // Published versions are immutable, edit a private copy
+    if (apply->snapshot == NULL) {
+        apply->snapshot = library_snapshot_copy(R.library);
+        if (apply->snapshot == NULL) {
+            LV_LOG_ERROR("No memory to update the library");
+            apply->reload = true;
+            return;
+        }
+    }
+    track_store_s* tracks = &apply->snapshot->tracks;
+
+    switch (change->type) {
+    case LIBRARY_CHANGE_UPSERT: {
+        track_info_s info;
+        library_track_info(&change->track, &info);
+        id = track_store_find(tracks, change->path);
+        if (id != TRACK_ID_INVALID ? track_store_update(tracks, id, &info) == 0
+                                   : track_store_add(tracks, &info) != TRACK_ID_INVALID) {
+            apply->changed++;
+        }
+        break;
+    }
+    case LIBRARY_CHANGE_REMOVE:
+        id = track_store_find(tracks, change->path);
+        if (id != TRACK_ID_INVALID) {
+            track_store_remove(tracks, id);
+            apply->changed++;
+        }
+        break;
+    case LIBRARY_CHANGE_REMOVE_DIR: {
+        // Walking down, the track swapped into a removed slot was already checked
+        size_t len = strlen(change->path);
+        for (id = tracks->count; id-- > 0;) {
+            const char* path = track_store_path(tracks, id);
+            if (strncmp(path, change->path, len) == 0 && path[len] == '/') {
+                track_store_remove(tracks, id);
+                apply->changed++;
+            }
+        }
+        break;
+    }
+    default:
+        break;
     }
-    
-    // Music configuration loading completed
 }
 
+#ifdef CONFIG_LVX_MUSIC_PLAYER_LIBRARY_INDEX
+static void app_library_save_timer_cb(lv_timer_t* timer)
+{
+    LV_UNUSED(timer);
+
+    // File I/O and fsync stay off the LVGL thread
+    library_save_async();
+}
+#endif
+#endif
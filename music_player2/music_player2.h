@@ -7,6 +7,8 @@
 #define LVGL_APP_H
 
 #include "audio_ctl.h"
+#include "library.h"
+#include "play_queue.h"
 #include "lvgl.h"
 #include "wifi.h"
 
@@ -20,14 +22,8 @@
 #define ICONS_ROOT RES_ROOT "/icons"
 #define MUSICS_ROOT RES_ROOT "/musics"
 
-typedef struct _album_info_t {
-    const char* name;
-    const char* artist;
-    char path[LV_FS_MAX_PATH_LENGTH];
-    char cover[LV_FS_MAX_PATH_LENGTH];
-    uint64_t total_time; /**< in milliseconds */
-    lv_color_t color;
-} album_info_t;
+/* Kept outside MUSICS_ROOT so writing it does not change the directory mtime */
+#define LIBRARY_INDEX_PATH RES_ROOT "/library.idx"
 
 typedef enum _switch_album_mode_t {
     SWITCH_ALBUM_MODE_PREV,
@@ -48,17 +44,17 @@ struct resource_s {
         lv_obj_t* player_group;
 
         lv_obj_t* volume_bar;
-        lv_obj_t* volume_bar_indic;
         lv_obj_t* audio;
         lv_obj_t* playlist_base;
 
         lv_obj_t* album_cover_container;
         lv_obj_t* album_cover;
-        lv_obj_t* vinyl_ring;
         lv_obj_t* vinyl_center;
         lv_obj_t* album_name;
         lv_obj_t* album_artist;
 
+        lv_obj_t* playlist_btn;
+        lv_obj_t* next_btn;
         lv_obj_t* play_btn;
         lv_obj_t* playback_group;
         lv_obj_t* playback_progress;
@@ -70,6 +66,8 @@ struct resource_s {
         lv_obj_t* backward_10s_btn;
         lv_obj_t* forward_10s_btn;
         lv_obj_t* wifi_status_label;
+        lv_obj_t* shuffle_btn;
+        lv_obj_t* repeat_label;
     } ui;
 
     struct {
@@ -93,12 +91,14 @@ struct resource_s {
     struct {
         lv_style_t button_default;
         lv_style_t button_pressed;
-        lv_style_t circular_cover;
-        lv_style_t vinyl_ring;
         lv_style_t vinyl_center;
         lv_style_t gradient_progress;
         lv_style_t frosted_glass;
         lv_style_t modern_card;             // Modern card style
+        lv_style_t page_background;
+        lv_style_t play_glow;
+        lv_style_t play_glow_pressed;
+        lv_style_t switch_pressed;          // Previous and next buttons
         lv_style_transition_dsc_t button_transition_dsc;
         lv_style_transition_dsc_t transition_dsc;
         lv_style_transition_dsc_t cover_rotation;     // Cover rotation animation
@@ -117,14 +117,15 @@ struct resource_s {
         const char* background;  // Background image
     } images;
 
-    album_info_t* albums;
-    uint8_t album_count;
+    library_snapshot_s* library;             // Library version pinned by the UI
+    track_store_s* tracks;                   // Its tracks, indexed by track id
 };
 
 struct ctx_s {
     bool resource_healthy_check;
 
-    album_info_t* current_album;
+    track_id_t current_track;                // TRACK_ID_INVALID when nothing is selected
+    play_queue_s queue;                      // Queued tracks, shuffle, repeat and history
     lv_obj_t* current_album_related_obj;
 
     uint16_t volume;
@@ -132,18 +133,25 @@ struct ctx_s {
     play_status_t play_status_prev;
     play_status_t play_status;
     uint64_t current_time;
+    uint64_t play_request_us;                // Tap timestamp for start latency, 0 when reported
+    uint32_t failed_tracks;                  // Tracks in a row that could not be opened
+    uint32_t ui_dirty;                       // UI_DIRTY_* parts waiting for the next display refresh
 
     struct {
         lv_timer_t* volume_bar_countdown;
         lv_timer_t* playback_progress_update;
         lv_timer_t* refresh_date_time;       // Date time update timer
         lv_timer_t* cover_rotation;          // Cover rotation timer
+        lv_timer_t* library_sync;            // Pins new library versions, applies watcher changes
+        lv_timer_t* library_save;            // Deferred index write after library changes
+        lv_timer_t* cover_wait;              // Polls the cover cache while the current cover decodes
     } timers;
 
     struct {
         lv_anim_t cover_rotation_anim;       // Cover rotation animation
         bool is_rotating;                    // Whether currently rotating
-        int16_t rotation_angle;              // Current rotation angle
+        int16_t rotation_angle;              // Current rotation angle, 0.1 degree
+        uint32_t rotation_tick;              // Tick of angle 0 in the current turn
     } animations;
 
     audioctl_s* audioctl;
@@ -156,6 +164,7 @@ struct conf_s {
 };
 
 void app_create(void);
+void app_destroy(void);  // Stop playback, the workers and the timers app_create() started
 void splash_screen_create(void);  // Splash screen creation function
 
 // Unified playlist manager functions (optimized version)
@@ -166,7 +175,9 @@ bool playlist_manager_is_open(void);
 
 // app control API for external modules
 void app_set_play_status(play_status_t status);
-void app_switch_to_album(int index);
+void app_switch_to_album(track_id_t id);
+int app_queue_next(track_id_t id);
+int app_play_tracks(const track_id_t* ids, uint32_t count);
 
 // WiFi optimization functions (v1.1.2 new)
 int wifi_manager_optimized_init(void);
@@ -177,6 +188,6 @@ void wifi_create_settings_ui(lv_obj_t* parent);
 void wifi_manager_optimized_cleanup(void);
 
 // Internal function declarations
-void app_switch_to_album(int index);
+void app_switch_to_album(track_id_t id);
 
 #endif // LVGL_APP_H
@@ -61,6 +61,7 @@ int main(int argc, FAR char* argv[])
     // Start LVGL UI loop
     lv_nuttx_uv_loop(&ui_loop, &result);
 
+    app_destroy();
     lv_nuttx_deinit(&result);
     lv_deinit();
 
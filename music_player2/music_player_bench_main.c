@@ -0,0 +1,981 @@
+/**
+ * Music Player Benchmark Entry Point
+ * Runs the real player page on an off-screen display, without the
+ * frame buffer or touch drivers, and drives it with a scripted timeline
+ * of touch input through a virtual pointer: open and scroll the
+ * playlist, skip 50 tracks, drag the seek bar, change the volume. Then
+ * it plays under a synthetic UI load, first with the engine threads on
+ * the UI task's own scheduling and then on the configured one, and
+ * grows the library to a large synthetic one that a worker keeps
+ * republishing while the playlist scrolls. With the PCM cache it also
+ * skips tracks with the cache off and on. At the end it prints render
+ * time percentiles and underruns per step (playing against paused shows
+ * what the spinning cover adds), tap-to-first-sample latency per step,
+ * the cover resampling cost, the render time of the cover as the old
+ * styled image widget and as the composited disc, the cost of a playlist
+ * refresh in place against the rebuild it replaced, the snapshot publish
+ * cost, the LVGL heap peak and allocation count, and the peak of the
+ * system heap
+ */
+
+// include NuttX headers
+#include <nuttx/config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+
+// include lvgl headers
+#include <lvgl/lvgl.h>
+
+#include "music_player2.h"
+#include "cover_art.h"
+#include "render_profile.h"
+#include "frame_timing.h"
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PCM_CACHE
+#include "pcm_cache.h"
+#endif
+
+#define BENCH_FRAMES_MAX    20000   // Rendered frames kept for the percentiles
+#define BENCH_TAP_HOLD      60      // ms a tap stays pressed, two indev reads at least
+#define BENCH_TAP_GAP       100     // ms released after a tap or a drag, unless the step sets it
+#define BENCH_SKIP_GAP      1500    // ms between skips timed for start latency, the next prefetch included
+#define BENCH_SAMPLE_PERIOD 100     // ms between system heap samples
+#define BENCH_PROFILE_FRAMES 20     // Refreshes per render profile measurement (-p)
+#define BENCH_LIBRARY_TRACKS 10000  // Default size of the synthetic library (-n)
+#define BENCH_CHURN_PERIOD  250     // ms between snapshots published by the churn worker
+#define BENCH_LOAD_PERIOD   16      // UI load: every display frame period...
+#define BENCH_LOAD_BUSY_MS  12      // ...the LVGL thread spins this long
+#define BENCH_SPIN_FRAMES   90      // Cover disc turns timed, 3 s at 30 fps
+#define BENCH_SPIN_STEP     15      // 0.1 degree per turn, an 8 s revolution at 30 fps
+#define BENCH_SPIN_FPS      30
+#define BENCH_COVER_FRAMES  30      // Refreshes per cover widget measurement
+#define BENCH_PLAYLIST_REFRESHES 20 // Playlist refreshes per variant
+
+typedef enum {
+    BENCH_WAIT,                     // Let timers, animations and audio run
+    BENCH_TAP,                      // Press and release at a point, repeated
+    BENCH_DRAG,                     // Press, move in a straight line, release
+    BENCH_CALL,                     // Call a function, e.g. an action without a widget
+} bench_action_t;
+
+/* One step of the timeline, points are fractions of the target (the screen for NULL) */
+typedef struct {
+    const char* name;
+    bench_action_t action;
+    lv_obj_t* (*target)(void);
+    float x0, y0;
+    float x1, y1;                   // Drag end
+    uint32_t ms;                    // Wait or drag duration, release time between taps
+    uint32_t repeat;                // Taps
+    void (*call)(void);
+} bench_step_s;
+
+/* Rendered frame and the step it belongs to */
+typedef struct {
+    uint32_t us;
+    uint16_t step;
+} bench_frame_s;
+
+extern struct resource_s R;
+extern struct ctx_s C;
+
+static void bench_load_start(void);
+static void bench_load_stop(void);
+static void bench_sched_ui(void);
+static void bench_sched_audio(void);
+static void bench_large_library(void);
+static void bench_churn_start(void);
+static void bench_churn_stop(void);
+static void bench_spin_cost(void);
+static void bench_cover_widgets(void);
+static void bench_playlist_refresh(void);
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PCM_CACHE
+static void bench_cache_off(void);
+static void bench_cache_on(void);
+#endif
+
+static lv_obj_t* target_playlist_btn(void) { return R.ui.playlist_btn; }
+static lv_obj_t* target_next_btn(void) { return R.ui.next_btn; }
+static lv_obj_t* target_play_btn(void) { return R.ui.play_btn; }
+static lv_obj_t* target_progress(void) { return R.ui.playback_progress; }
+static lv_obj_t* target_volume_btn(void) { return R.ui.audio; }
+static lv_obj_t* target_volume_bar(void) { return R.ui.volume_bar; }
+
+static const bench_step_s timeline[] = {
+    { "startup",        BENCH_WAIT, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 2000, 0, NULL },
+    { "open playlist",  BENCH_TAP,  target_playlist_btn, 0.5f, 0.5f, 0.0f, 0.0f, 0,    1, NULL },
+    { "playlist idle",  BENCH_WAIT, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 500,  0, NULL },
+    { "playlist refresh", BENCH_CALL, NULL,              0.0f, 0.0f, 0.0f, 0.0f, 0,    0, bench_playlist_refresh },
+    { "scroll down",    BENCH_DRAG, NULL,                0.5f, 0.8f, 0.5f, 0.2f, 600,  0, NULL },
+    { "scroll up",      BENCH_DRAG, NULL,                0.5f, 0.2f, 0.5f, 0.8f, 600,  0, NULL },
+    { "close playlist", BENCH_CALL, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 0,    0, playlist_manager_close },
+    { "play",           BENCH_TAP,  target_play_btn,     0.5f, 0.5f, 0.0f, 0.0f, 0,    1, NULL },
+    { "skip x50",       BENCH_TAP,  target_next_btn,     0.5f, 0.5f, 0.0f, 0.0f, 0,    50, NULL },
+    { "settle",         BENCH_WAIT, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 1000, 0, NULL },
+    { "drag seek",      BENCH_DRAG, target_progress,     0.1f, 0.5f, 0.9f, 0.5f, 1500, 0, NULL },
+    { "show volume",    BENCH_TAP,  target_volume_btn,   0.5f, 0.5f, 0.0f, 0.0f, 0,    1, NULL },
+    { "drag volume",    BENCH_DRAG, target_volume_bar,   0.5f, 0.8f, 0.5f, 0.3f, 800,  0, NULL },
+    { "playing",        BENCH_WAIT, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 3000, 0, NULL },
+    { "spin cost",      BENCH_CALL, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 0,    0, bench_spin_cost },
+    { "cover widgets",  BENCH_CALL, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 0,    0, bench_cover_widgets },
+    { "pause",          BENCH_TAP,  target_play_btn,     0.5f, 0.5f, 0.0f, 0.0f, 0,    1, NULL },
+    { "paused",         BENCH_WAIT, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 3000, 0, NULL },
+    { "resume",         BENCH_TAP,  target_play_btn,     0.5f, 0.5f, 0.0f, 0.0f, 0,    1, NULL },
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PCM_CACHE
+    { "pcm cache off",  BENCH_CALL, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 0,    0, bench_cache_off },
+    { "skip, file",     BENCH_TAP,  target_next_btn,     0.5f, 0.5f, 0.0f, 0.0f, BENCH_SKIP_GAP, 5, NULL },
+    { "pcm cache on",   BENCH_CALL, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 0,    0, bench_cache_on },
+    { "skip, cached",   BENCH_TAP,  target_next_btn,     0.5f, 0.5f, 0.0f, 0.0f, BENCH_SKIP_GAP, 5, NULL },
+#endif
+    { "ui load on",     BENCH_CALL, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 0,    0, bench_load_start },
+    { "ui sched",       BENCH_CALL, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 0,    0, bench_sched_ui },
+    { "load, ui sched", BENCH_WAIT, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 5000, 0, NULL },
+    { "audio sched",    BENCH_CALL, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 0,    0, bench_sched_audio },
+    { "load, audio sched", BENCH_WAIT, NULL,             0.0f, 0.0f, 0.0f, 0.0f, 5000, 0, NULL },
+    { "ui load off",    BENCH_CALL, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 0,    0, bench_load_stop },
+    { "large library",  BENCH_CALL, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 0,    0, bench_large_library },
+    { "library sync",   BENCH_WAIT, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 1000, 0, NULL },
+    { "open large",     BENCH_TAP,  target_playlist_btn, 0.5f, 0.5f, 0.0f, 0.0f, 0,    1, NULL },
+    { "scroll large",   BENCH_DRAG, NULL,                0.5f, 0.8f, 0.5f, 0.2f, 600,  0, NULL },
+    { "churn on",       BENCH_CALL, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 0,    0, bench_churn_start },
+    { "churn idle",     BENCH_WAIT, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 3000, 0, NULL },
+    { "churn scroll",   BENCH_DRAG, NULL,                0.5f, 0.2f, 0.5f, 0.8f, 600,  0, NULL },
+    { "churn off",      BENCH_CALL, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 0,    0, bench_churn_stop },
+    { "close large",    BENCH_CALL, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 0,    0, playlist_manager_close },
+    { "after churn",    BENCH_WAIT, NULL,                0.0f, 0.0f, 0.0f, 0.0f, 1000, 0, NULL },
+};
+
+#define BENCH_STEPS (sizeof(timeline) / sizeof(timeline[0]))
+
+static struct {
+    // Virtual pointer
+    lv_point_t point;
+    bool pressed;
+
+    // Timeline
+    uint32_t step;
+    uint32_t step_start;
+    uint32_t done_taps;
+    bool finished;
+
+    // Frame timing
+    bench_frame_s* frames;
+    uint32_t frame_count;
+    uint32_t frames_dropped;
+
+    // Memory
+    size_t sys_base;
+    size_t sys_peak;
+    uint32_t lv_used_cnt_base;
+    uint32_t lv_used_cnt_peak;
+
+    // Underruns per step, from the session stats of the audio controller
+    uint32_t underruns_at_step;
+    uint32_t step_underruns[BENCH_STEPS];
+
+    // Tap-to-first-sample latency per step, timed from the release that clicks
+    uint64_t tap_us;
+    uint32_t start_count[BENCH_STEPS];
+    uint32_t start_hits[BENCH_STEPS];       // Starts served from the PCM cache
+    uint64_t start_total_us[BENCH_STEPS];
+    uint32_t start_max_us[BENCH_STEPS];
+
+    // UI load and engine scheduling
+    lv_timer_t* load_timer;
+    audio_thread_config_s thread_config;    // Configured scheduling, restored after the UI sched run
+    bool have_thread_config;
+
+    // Large library and snapshot churn
+    uint32_t library_tracks;
+    pthread_t churn_thread;
+    volatile bool churning;
+    uint32_t churn_count;                   // Snapshots published
+    uint32_t churn_conflicts;               // Publishes lost to a newer version
+    uint64_t churn_total_us;                // Copy, edit and publish
+    uint32_t churn_max_us;
+
+    // Cover disc resampling, 0 frames when the disc did not turn
+    uint32_t spin_frames;
+    uint64_t spin_total_us;
+    uint32_t spin_max_us;
+
+    // Cover area refreshed alone, as the styled image widget and as the disc image
+    bool timing_widget;                     // Frames rendered by the measurement, not the timeline
+    uint32_t cover_styled_us;
+    uint32_t cover_styled_max_us;
+    uint32_t cover_disc_us;
+    uint32_t cover_disc_max_us;
+
+    // Playlist refresh on a track change, then its frame: in place, and closed and created again
+    uint32_t playlist_refreshes;
+    uint32_t playlist_inplace_us;
+    uint32_t playlist_inplace_max_us;
+    int32_t playlist_inplace_blocks;        // LVGL heap blocks allocated per refresh
+    uint32_t playlist_rebuild_us;
+    uint32_t playlist_rebuild_max_us;
+    int32_t playlist_rebuild_blocks;
+} bench;
+
+static uint32_t bench_tick_cb(void)
+{
+    return (uint32_t)(audio_ctl_clock_us() / 1000);
+}
+
+static void bench_flush_cb(lv_display_t* disp, const lv_area_t* area, uint8_t* px_map)
+{
+    // Off-screen: the frame is rendered into the buffer and never shown
+    LV_UNUSED(area);
+    LV_UNUSED(px_map);
+    lv_display_flush_ready(disp);
+}
+
+static void bench_indev_read_cb(lv_indev_t* indev, lv_indev_data_t* data)
+{
+    LV_UNUSED(indev);
+
+    data->point = bench.point;
+    data->state = bench.pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+}
+
+static void bench_frame_timing_cb(uint32_t us, bool rendered, void* user_data)
+{
+    LV_UNUSED(user_data);
+
+    if (!rendered || bench.finished || bench.timing_widget) {
+        return;
+    }
+    if (bench.frame_count < BENCH_FRAMES_MAX) {
+        bench_frame_s* f = &bench.frames[bench.frame_count++];
+        f->us = us;
+        f->step = (uint16_t)bench.step;
+    } else {
+        bench.frames_dropped++;
+    }
+}
+
+static void bench_sample_memory_cb(lv_timer_t* timer)
+{
+    LV_UNUSED(timer);
+
+    struct mallinfo info = mallinfo();
+    if ((size_t)info.uordblks > bench.sys_peak) {
+        bench.sys_peak = info.uordblks;
+    }
+
+    lv_mem_monitor_t mem;
+    lv_mem_monitor(&mem);
+    if (mem.used_cnt > bench.lv_used_cnt_peak) {
+        bench.lv_used_cnt_peak = mem.used_cnt;
+    }
+}
+
+/* Point at fractions fx, fy of the target, or of the screen */
+static lv_point_t bench_point_at(const bench_step_s* step, float fx, float fy)
+{
+    lv_area_t area;
+    lv_obj_t* target = step->target ? step->target() : NULL;
+
+    if (target) {
+        lv_obj_get_coords(target, &area);
+    } else {
+        lv_display_t* disp = lv_display_get_default();
+        lv_area_set(&area, 0, 0, lv_display_get_horizontal_resolution(disp) - 1,
+                    lv_display_get_vertical_resolution(disp) - 1);
+    }
+
+    lv_point_t p;
+    p.x = area.x1 + (int32_t)(fx * (float)(lv_area_get_width(&area) - 1));
+    p.y = area.y1 + (int32_t)(fy * (float)(lv_area_get_height(&area) - 1));
+    return p;
+}
+
+static uint32_t bench_underruns(void)
+{
+    audio_ctl_stats_s stats;
+
+    if (!C.audioctl || audio_ctl_get_stats(C.audioctl, &stats) != 0) {
+        return 0;
+    }
+    return stats.underrun_count;
+}
+
+/* Keep the LVGL thread busy, as heavy animations or a playlist rebuild would */
+static void bench_load_cb(lv_timer_t* timer)
+{
+    LV_UNUSED(timer);
+
+    uint64_t end = audio_ctl_clock_us() + BENCH_LOAD_BUSY_MS * 1000;
+    while (audio_ctl_clock_us() < end) {
+    }
+}
+
+static void bench_load_start(void)
+{
+    if (!bench.load_timer) {
+        bench.load_timer = lv_timer_create(bench_load_cb, BENCH_LOAD_PERIOD, NULL);
+    }
+}
+
+static void bench_load_stop(void)
+{
+    if (bench.load_timer) {
+        lv_timer_delete(bench.load_timer);
+        bench.load_timer = NULL;
+    }
+}
+
+/* Restart the current track so new engine scheduling takes effect */
+static void bench_restart_audio(const audio_thread_config_s* config)
+{
+    if (!C.audioctl || C.play_status != PLAY_STATUS_PLAY) {
+        printf("[bench] not playing, scheduling unchanged\n");
+        return;
+    }
+    if (audio_ctl_set_thread_config(C.audioctl, config) != 0 || audio_ctl_start(C.audioctl) != 0) {
+        printf("[bench] audio restart failed\n");
+    }
+}
+
+/* Engine threads compete with the UI on equal terms, as with default thread attributes */
+static void bench_sched_ui(void)
+{
+    if (!C.audioctl) {
+        return;
+    }
+
+    bench.thread_config = C.audioctl->thread_config;
+    bench.have_thread_config = true;
+
+    struct sched_param param;
+    audio_thread_config_s config = bench.thread_config;
+    config.policy = sched_getscheduler(0);
+    config.priority = sched_getparam(0, &param) == 0 ? param.sched_priority : 0;
+    config.cpu_mask = 0;
+    config.lock_memory = false;
+    bench_restart_audio(&config);
+}
+
+/* Back to the configured policy, priority, affinity and mlock */
+static void bench_sched_audio(void)
+{
+    if (bench.have_thread_config) {
+        bench_restart_audio(&bench.thread_config);
+    }
+}
+
+/* Grow the library to bench.library_tracks, the added tracks exist only in the index */
+static void bench_large_library(void)
+{
+    library_snapshot_s* current = library_acquire();
+    if (!current) {
+        printf("[bench] no library to grow\n");
+        return;
+    }
+
+    library_snapshot_s* snapshot = library_snapshot_copy(current);
+    uint32_t base = current->version;
+    library_release(current);
+    if (!snapshot) {
+        printf("[bench] out of memory for the library copy\n");
+        return;
+    }
+
+    uint64_t start = audio_ctl_clock_us();
+    uint32_t playable = snapshot->tracks.count;
+    char path[32];
+    char name[32];
+    char artist[24];
+    char album[24];
+    for (uint32_t i = playable; i < bench.library_tracks; i++) {
+        track_info_s info;
+        memset(&info, 0, sizeof(info));
+        snprintf(path, sizeof(path), "bench/%06lu.mp3", (unsigned long)i);
+        snprintf(name, sizeof(name), "Bench track %06lu", (unsigned long)i);
+        snprintf(artist, sizeof(artist), "Artist %03lu", (unsigned long)(i % 500));
+        snprintf(album, sizeof(album), "Album %04lu", (unsigned long)(i % 2000));
+        info.path = path;
+        info.name = name;
+        info.artist = artist;
+        info.album = album;
+        info.duration_ms = 180000 + (i % 120) * 1000;
+        info.color = 0x303030;
+        if (track_store_add(&snapshot->tracks, &info) == TRACK_ID_INVALID) {
+            printf("[bench] library full at %lu tracks\n", (unsigned long)snapshot->tracks.count);
+            break;
+        }
+    }
+
+    uint32_t count = snapshot->tracks.count;
+    size_t memory = track_store_memory(&snapshot->tracks);
+    if (library_publish(snapshot, base) != 0) {
+        printf("[bench] library changed while growing it\n");
+        return;
+    }
+    printf("[bench] library: %lu tracks (%lu playable), %lu bytes, built in %lu us\n",
+           (unsigned long)count, (unsigned long)playable, (unsigned long)memory,
+           (unsigned long)(audio_ctl_clock_us() - start));
+}
+
+/* Republish the library with one synthetic track replaced, as the watcher does on file changes */
+static void* bench_churn_thread(void* arg)
+{
+    LV_UNUSED(arg);
+
+    char path[32];
+    while (bench.churning) {
+        uint64_t start = audio_ctl_clock_us();
+        library_snapshot_s* current = library_acquire();
+        if (!current) {
+            break;
+        }
+        library_snapshot_s* snapshot = library_snapshot_copy(current);
+        uint32_t base = current->version;
+        library_release(current);
+        if (!snapshot) {
+            break;
+        }
+
+        // Only synthetic tracks go, playback keeps its track
+        track_store_s* tracks = &snapshot->tracks;
+        if (tracks->count > 0 && strncmp(track_store_path(tracks, tracks->count - 1), "bench/", 6) == 0) {
+            track_store_remove(tracks, tracks->count - 1);
+        }
+
+        track_info_s info;
+        memset(&info, 0, sizeof(info));
+        snprintf(path, sizeof(path), "bench/churn-%06lu.mp3", (unsigned long)bench.churn_count);
+        info.path = path;
+        info.name = path + 6;
+        info.artist = "Churn";
+        info.album = "Churn";
+        info.duration_ms = 180000;
+        track_store_add(tracks, &info);
+
+        if (library_publish(snapshot, base) == 0) {
+            uint32_t us = (uint32_t)(audio_ctl_clock_us() - start);
+            bench.churn_count++;
+            bench.churn_total_us += us;
+            bench.churn_max_us = LV_MAX(bench.churn_max_us, us);
+        } else {
+            bench.churn_conflicts++;
+        }
+        usleep(BENCH_CHURN_PERIOD * 1000);
+    }
+    return NULL;
+}
+
+static void bench_churn_start(void)
+{
+    if (bench.churning) {
+        return;
+    }
+    bench.churning = true;
+    if (pthread_create(&bench.churn_thread, NULL, bench_churn_thread, NULL) != 0) {
+        printf("[bench] churn thread not started\n");
+        bench.churning = false;
+    }
+}
+
+static void bench_churn_stop(void)
+{
+    if (bench.churning) {
+        bench.churning = false;
+        pthread_join(bench.churn_thread, NULL);
+    }
+}
+
+/* Time the resampling of the cover disc, which runs in a timer and not in the render */
+static void bench_spin_cost(void)
+{
+    int32_t angle = C.animations.rotation_angle;
+
+    for (uint32_t i = 0; i < BENCH_SPIN_FRAMES; i++) {
+        angle += BENCH_SPIN_STEP;
+        uint64_t start = audio_ctl_clock_us();
+        if (cover_art_rotate(angle) != 0) {
+            break;
+        }
+        uint32_t us = (uint32_t)(audio_ctl_clock_us() - start);
+        bench.spin_frames++;
+        bench.spin_total_us += us;
+        bench.spin_max_us = LV_MAX(bench.spin_max_us, us);
+    }
+
+    // Back to where the rotation timer left the disc
+    cover_art_rotate(C.animations.rotation_angle);
+}
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_PCM_CACHE
+static void bench_cache_off(void)
+{
+    pcm_cache_set_enabled(false);
+}
+
+static void bench_cache_on(void)
+{
+    pcm_cache_set_enabled(true);
+}
+#endif
+
+/* Time the start that the last tap caused, once the engine has produced output */
+static void bench_sample_start(void)
+{
+    audioctl_s* ctl = C.audioctl;
+
+    if (bench.tap_us == 0 || !ctl || ctl->start_time_us < bench.tap_us || ctl->first_sample_us == 0) {
+        return;
+    }
+
+    uint32_t us = (uint32_t)(ctl->first_sample_us - bench.tap_us);
+    bench.tap_us = 0;
+    bench.start_count[bench.step]++;
+    bench.start_hits[bench.step] += ctl->cache_hit ? 1 : 0;
+    bench.start_total_us[bench.step] += us;
+    bench.start_max_us[bench.step] = LV_MAX(bench.start_max_us[bench.step], us);
+}
+
+/* Average refresh time of one widget's area, the first frame (image decode) left out */
+static uint32_t bench_time_widget(lv_obj_t* obj, uint32_t* max_us)
+{
+    lv_display_t* disp = lv_obj_get_display(obj);
+    uint64_t total = 0;
+
+    *max_us = 0;
+    bench.timing_widget = true;
+    for (uint32_t i = 0; i <= BENCH_COVER_FRAMES; i++) {
+        lv_obj_invalidate(obj);
+        uint64_t start = audio_ctl_clock_us();
+        lv_refr_now(disp);
+        uint32_t us = (uint32_t)(audio_ctl_clock_us() - start);
+        if (i > 0) {
+            total += us;
+            *max_us = LV_MAX(*max_us, us);
+        }
+    }
+    bench.timing_widget = false;
+    return (uint32_t)(total / BENCH_COVER_FRAMES);
+}
+
+/* Render the cover as it was drawn before the disc image, then the disc, over the real cover */
+static void bench_cover_widgets(void)
+{
+    if (!cover_art_image()) {
+        printf("[bench] no cover disc to compare\n");
+        return;
+    }
+
+    lv_area_t area;
+    lv_obj_get_coords(R.ui.album_cover, &area);
+    int32_t cx = area.x1 + lv_area_get_width(&area) / 2;
+    int32_t cy = area.y1 + lv_area_get_height(&area) / 2;
+
+    // Vinyl ring object with its shadow, then a round-clipped image with border and shadow
+    lv_style_t ring_style;
+    lv_style_init(&ring_style);
+    lv_style_set_radius(&ring_style, LV_RADIUS_CIRCLE);
+    lv_style_set_border_width(&ring_style, 8);
+    lv_style_set_border_color(&ring_style, lv_color_hex(0x1A1A1A));
+    lv_style_set_border_opa(&ring_style, LV_OPA_COVER);
+    lv_style_set_bg_color(&ring_style, lv_color_hex(0x0F0F0F));
+    lv_style_set_bg_opa(&ring_style, LV_OPA_30);
+    lv_style_set_shadow_width(&ring_style, 30);
+    lv_style_set_shadow_color(&ring_style, lv_color_hex(0x000000));
+    lv_style_set_shadow_opa(&ring_style, LV_OPA_70);
+    lv_style_set_shadow_spread(&ring_style, 8);
+
+    lv_style_t cover_style;
+    lv_style_init(&cover_style);
+    lv_style_set_radius(&cover_style, LV_RADIUS_CIRCLE);
+    lv_style_set_clip_corner(&cover_style, true);
+    lv_style_set_border_width(&cover_style, 6);
+    lv_style_set_border_color(&cover_style, lv_color_hex(0x3B82F6));
+    lv_style_set_border_opa(&cover_style, LV_OPA_80);
+    lv_style_set_shadow_width(&cover_style, 25);
+    lv_style_set_shadow_color(&cover_style, lv_color_hex(0x3B82F6));
+    lv_style_set_shadow_opa(&cover_style, LV_OPA_30);
+    lv_style_set_shadow_spread(&cover_style, 5);
+
+    lv_obj_t* styled = lv_obj_create(lv_layer_top());
+    lv_obj_remove_style_all(styled);
+    lv_obj_set_size(styled, 320, 320);
+    lv_obj_set_pos(styled, cx - 160, cy - 160);
+    lv_obj_add_flag(styled, LV_OBJ_FLAG_OVERFLOW_VISIBLE);
+
+    lv_obj_t* ring = lv_obj_create(styled);
+    lv_obj_remove_style_all(ring);
+    lv_obj_add_style(ring, &ring_style, LV_PART_MAIN);
+    lv_obj_set_size(ring, 320, 320);
+    lv_obj_center(ring);
+
+    lv_obj_t* image = lv_image_create(styled);
+    lv_obj_remove_style_all(image);
+    lv_obj_add_style(image, &cover_style, LV_PART_MAIN);
+    lv_obj_set_size(image, COVER_ART_COVER, COVER_ART_COVER);
+    lv_obj_center(image);
+    lv_image_set_inner_align(image, LV_IMAGE_ALIGN_CENTER);
+    lv_image_set_src(image, R.images.nocover);
+
+    bench.cover_styled_us = bench_time_widget(styled, &bench.cover_styled_max_us);
+    lv_obj_delete(styled);
+    lv_style_reset(&ring_style);
+    lv_style_reset(&cover_style);
+
+    // The same area as one pre-rendered image without styles
+    lv_obj_t* disc = lv_image_create(lv_layer_top());
+    lv_obj_remove_style_all(disc);
+    lv_obj_set_size(disc, COVER_ART_SIZE, COVER_ART_SIZE);
+    lv_obj_set_pos(disc, cx - COVER_ART_SIZE / 2, cy - COVER_ART_SIZE / 2);
+    lv_image_set_src(disc, cover_art_image());
+
+    bench.cover_disc_us = bench_time_widget(disc, &bench.cover_disc_max_us);
+    lv_obj_delete(disc);
+}
+
+static uint32_t bench_lv_blocks(void)
+{
+    lv_mem_monitor_t mem;
+    lv_mem_monitor(&mem);
+    return mem.used_cnt;
+}
+
+/* Move the now-playing mark between two tracks, as a skip does, and time the list
+ * refresh plus the frame that shows it: in place, then as the old close and create */
+static void bench_playlist_refresh(void)
+{
+    if (!playlist_manager_is_open() || R.tracks->count < 2) {
+        printf("[bench] playlist not open, refresh not timed\n");
+        return;
+    }
+
+    lv_display_t* disp = lv_display_get_default();
+    track_id_t saved = C.current_track;
+    track_id_t ids[2] = { 0, 1 };
+    uint64_t inplace_total = 0;
+    uint64_t rebuild_total = 0;
+    int64_t inplace_blocks = 0;
+    int64_t rebuild_blocks = 0;
+
+    bench.timing_widget = true;
+    for (uint32_t i = 0; i < BENCH_PLAYLIST_REFRESHES; i++) {
+        C.current_track = ids[i % 2];
+        uint32_t blocks = bench_lv_blocks();
+        uint64_t start = audio_ctl_clock_us();
+        playlist_manager_refresh();
+        lv_refr_now(disp);
+        uint32_t us = (uint32_t)(audio_ctl_clock_us() - start);
+        inplace_total += us;
+        inplace_blocks += (int64_t)bench_lv_blocks() - blocks;
+        bench.playlist_inplace_max_us = LV_MAX(bench.playlist_inplace_max_us, us);
+    }
+
+    for (uint32_t i = 0; i < BENCH_PLAYLIST_REFRESHES; i++) {
+        C.current_track = ids[i % 2];
+        uint64_t start = audio_ctl_clock_us();
+        playlist_manager_close();
+        uint32_t blocks = bench_lv_blocks();
+        playlist_manager_create(lv_layer_top());
+        rebuild_blocks += (int64_t)bench_lv_blocks() - blocks;
+        lv_refr_now(disp);
+        uint32_t us = (uint32_t)(audio_ctl_clock_us() - start);
+        rebuild_total += us;
+        bench.playlist_rebuild_max_us = LV_MAX(bench.playlist_rebuild_max_us, us);
+    }
+    bench.timing_widget = false;
+
+    C.current_track = saved;
+    playlist_manager_refresh();
+
+    bench.playlist_refreshes = BENCH_PLAYLIST_REFRESHES;
+    bench.playlist_inplace_us = (uint32_t)(inplace_total / BENCH_PLAYLIST_REFRESHES);
+    bench.playlist_inplace_blocks = (int32_t)(inplace_blocks / BENCH_PLAYLIST_REFRESHES);
+    bench.playlist_rebuild_us = (uint32_t)(rebuild_total / BENCH_PLAYLIST_REFRESHES);
+    bench.playlist_rebuild_blocks = (int32_t)(rebuild_blocks / BENCH_PLAYLIST_REFRESHES);
+}
+
+static void bench_next_step(uint32_t now)
+{
+    uint32_t underruns = bench_underruns();
+    bench.step_underruns[bench.step] = underruns - bench.underruns_at_step;
+    bench.underruns_at_step = underruns;
+
+    bench.pressed = false;
+    bench.done_taps = 0;
+    bench.step_start = now;
+    bench.step++;
+    if (bench.step >= BENCH_STEPS) {
+        bench.finished = true;
+        return;
+    }
+    printf("[bench] %s\n", timeline[bench.step].name);
+}
+
+/* Advance the timeline, called between lv_timer_handler() runs */
+static void bench_run_timeline(void)
+{
+    uint32_t now = lv_tick_get();
+    const bench_step_s* step = &timeline[bench.step];
+    uint32_t elapsed = now - bench.step_start;
+
+    switch (step->action) {
+    case BENCH_WAIT:
+        if (elapsed >= step->ms) {
+            bench_next_step(now);
+        }
+        break;
+    case BENCH_CALL:
+        step->call();
+        bench_next_step(now);
+        break;
+    case BENCH_TAP: {
+        // Each tap: pressed for BENCH_TAP_HOLD, then released for the gap
+        uint32_t gap = step->ms ? step->ms : BENCH_TAP_GAP;
+        uint32_t phase = elapsed - bench.done_taps * (BENCH_TAP_HOLD + gap);
+        if (phase < BENCH_TAP_HOLD) {
+            if (!bench.pressed) {
+                bench.point = bench_point_at(step, step->x0, step->y0);
+                bench.pressed = true;
+            }
+        } else if (phase < BENCH_TAP_HOLD + gap) {
+            if (bench.pressed) {
+                bench.pressed = false;
+                bench.tap_us = audio_ctl_clock_us();
+            }
+        } else if (++bench.done_taps >= step->repeat) {
+            bench_next_step(now);
+        }
+        break;
+    }
+    case BENCH_DRAG:
+        if (elapsed < step->ms) {
+            float t = (float)elapsed / (float)step->ms;
+            if (!bench.pressed) {
+                bench.point = bench_point_at(step, step->x0, step->y0);
+                bench.pressed = true;
+            } else {
+                bench.point = bench_point_at(step, step->x0 + (step->x1 - step->x0) * t,
+                                             step->y0 + (step->y1 - step->y0) * t);
+            }
+        } else if (elapsed < step->ms + BENCH_TAP_GAP) {
+            bench.pressed = false;
+        } else {
+            bench_next_step(now);
+        }
+        break;
+    }
+}
+
+static int bench_compare_us(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void bench_print_percentiles(const char* name, uint32_t* us, uint32_t count, uint32_t underruns)
+{
+    if (count == 0) {
+        printf("[bench] %-18s no frames  xrun %lu\n", name, (unsigned long)underruns);
+        return;
+    }
+
+    qsort(us, count, sizeof(uint32_t), bench_compare_us);
+    printf("[bench] %-18s %5lu frames  p50 %6lu  p90 %6lu  p99 %6lu  max %6lu us  xrun %lu\n", name,
+           (unsigned long)count, (unsigned long)us[count / 2], (unsigned long)us[count * 9 / 10],
+           (unsigned long)us[count * 99 / 100], (unsigned long)us[count - 1], (unsigned long)underruns);
+}
+
+static void bench_report(void)
+{
+    uint32_t* us = malloc(LV_MAX(bench.frame_count, 1) * sizeof(uint32_t));
+    if (!us) {
+        printf("[bench] out of memory for the report\n");
+        return;
+    }
+
+    printf("[bench] render time per frame and audio underruns\n");
+    uint32_t underruns = 0;
+    for (uint32_t s = 0; s < BENCH_STEPS; s++) {
+        underruns += bench.step_underruns[s];
+        if (timeline[s].action == BENCH_CALL) {
+            continue;
+        }
+
+        uint32_t count = 0;
+        for (uint32_t i = 0; i < bench.frame_count; i++) {
+            if (bench.frames[i].step == s) {
+                us[count++] = bench.frames[i].us;
+            }
+        }
+        bench_print_percentiles(timeline[s].name, us, count, bench.step_underruns[s]);
+    }
+    for (uint32_t i = 0; i < bench.frame_count; i++) {
+        us[i] = bench.frames[i].us;
+    }
+    bench_print_percentiles("all", us, bench.frame_count, underruns);
+    if (bench.frames_dropped) {
+        printf("[bench] %lu frames past %d not timed\n", (unsigned long)bench.frames_dropped, BENCH_FRAMES_MAX);
+    }
+    free(us);
+
+    for (uint32_t s = 0; s < BENCH_STEPS; s++) {
+        if (bench.start_count[s] > 0) {
+            printf("[bench] start latency %-14s %lu starts, avg %lu us, max %lu us, %lu from the PCM cache\n",
+                   timeline[s].name, (unsigned long)bench.start_count[s],
+                   (unsigned long)(bench.start_total_us[s] / bench.start_count[s]),
+                   (unsigned long)bench.start_max_us[s], (unsigned long)bench.start_hits[s]);
+        }
+    }
+
+    printf("[bench] snapshot churn: %lu published, %lu conflicts, avg %lu us, max %lu us\n",
+           (unsigned long)bench.churn_count, (unsigned long)bench.churn_conflicts,
+           (unsigned long)(bench.churn_count ? bench.churn_total_us / bench.churn_count : 0),
+           (unsigned long)bench.churn_max_us);
+
+    if (bench.spin_frames > 0) {
+        uint32_t avg = (uint32_t)(bench.spin_total_us / bench.spin_frames);
+        printf("[bench] cover spin: %lu turns, avg %lu us, max %lu us, %lu.%lu%% of a core at %d fps\n",
+               (unsigned long)bench.spin_frames, (unsigned long)avg, (unsigned long)bench.spin_max_us,
+               (unsigned long)(avg * BENCH_SPIN_FPS / 10000), (unsigned long)(avg * BENCH_SPIN_FPS / 1000 % 10),
+               BENCH_SPIN_FPS);
+    } else {
+        printf("[bench] cover spin: the disc did not turn\n");
+    }
+
+    if (bench.playlist_refreshes > 0) {
+        printf("[bench] playlist refresh + frame: in place avg %lu us max %lu us %ld blocks, "
+               "rebuild avg %lu us max %lu us %ld blocks (%lu each)\n",
+               (unsigned long)bench.playlist_inplace_us, (unsigned long)bench.playlist_inplace_max_us,
+               (long)bench.playlist_inplace_blocks, (unsigned long)bench.playlist_rebuild_us,
+               (unsigned long)bench.playlist_rebuild_max_us, (long)bench.playlist_rebuild_blocks,
+               (unsigned long)bench.playlist_refreshes);
+    }
+
+    if (bench.cover_disc_us > 0) {
+        printf("[bench] cover widget: styled image avg %lu us max %lu us, composited disc avg %lu us max %lu us\n",
+               (unsigned long)bench.cover_styled_us, (unsigned long)bench.cover_styled_max_us,
+               (unsigned long)bench.cover_disc_us, (unsigned long)bench.cover_disc_max_us);
+    }
+
+    lv_mem_monitor_t mem;
+    lv_mem_monitor(&mem);
+    printf("[bench] LVGL heap: peak %lu bytes, %lu live allocations (peak %lu, %lu at start)\n",
+           (unsigned long)mem.max_used, (unsigned long)mem.used_cnt,
+           (unsigned long)bench.lv_used_cnt_peak, (unsigned long)bench.lv_used_cnt_base);
+    printf("[bench] system heap: peak %lu bytes, %lu before the player\n",
+           (unsigned long)bench.sys_peak, (unsigned long)bench.sys_base);
+}
+
+static void bench_usage(const char* prog)
+{
+    printf("Usage: %s [-W width] [-H height] [-n tracks] [-p]\n"
+           "  -W, -H  off-screen display size (default %dx%d)\n"
+           "  -n      size of the synthetic library (default %d)\n"
+           "  -p      also time each render profile style afterwards\n",
+           prog, CONFIG_LVX_MUSIC_PLAYER_LCD_WIDTH, CONFIG_LVX_MUSIC_PLAYER_LCD_HEIGHT,
+           BENCH_LIBRARY_TRACKS);
+}
+
+int main(int argc, FAR char* argv[])
+{
+    int32_t width = CONFIG_LVX_MUSIC_PLAYER_LCD_WIDTH;
+    int32_t height = CONFIG_LVX_MUSIC_PLAYER_LCD_HEIGHT;
+    long tracks = BENCH_LIBRARY_TRACKS;
+    bool profile_bench = false;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "W:H:n:p")) != -1) {
+        switch (opt) {
+        case 'W':
+            width = atoi(optarg);
+            break;
+        case 'H':
+            height = atoi(optarg);
+            break;
+        case 'n':
+            tracks = atol(optarg);
+            break;
+        case 'p':
+            profile_bench = true;
+            break;
+        default:
+            bench_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (width <= 0 || height <= 0 || tracks <= 0) {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    if (lv_is_initialized()) {
+        LV_LOG_ERROR("LVGL already initialized! aborting.");
+        return -1;
+    }
+
+    memset(&bench, 0, sizeof(bench));
+    bench.library_tracks = (uint32_t)tracks;
+    bench.frames = malloc(BENCH_FRAMES_MAX * sizeof(bench_frame_s));
+    if (!bench.frames) {
+        printf("[bench] out of memory\n");
+        return 1;
+    }
+
+    lv_init();
+    lv_tick_set_cb(bench_tick_cb);
+
+    // Full-size buffer in direct mode, as a frame buffer display renders
+    lv_display_t* disp = lv_display_create(width, height);
+    lv_color_format_t cf = lv_display_get_color_format(disp);
+    uint32_t stride = lv_draw_buf_width_to_stride(width, cf);
+    void* fb = malloc(stride * height);
+    if (!fb) {
+        printf("[bench] out of memory for a %ldx%ld display\n", (long)width, (long)height);
+        return 1;
+    }
+    lv_display_set_buffers(disp, fb, NULL, stride * height, LV_DISPLAY_RENDER_MODE_DIRECT);
+    lv_display_set_flush_cb(disp, bench_flush_cb);
+    frame_timing_subscribe(disp, bench_frame_timing_cb, NULL);
+
+    lv_indev_t* indev = lv_indev_create();
+    lv_indev_set_type(indev, LV_INDEV_TYPE_POINTER);
+    lv_indev_set_read_cb(indev, bench_indev_read_cb);
+
+    struct mallinfo info = mallinfo();
+    bench.sys_base = info.uordblks;
+    bench.sys_peak = info.uordblks;
+    lv_mem_monitor_t mem;
+    lv_mem_monitor(&mem);
+    bench.lv_used_cnt_base = mem.used_cnt;
+
+    // The player page itself, no splash screen
+    printf("[bench] %ldx%ld, %u steps\n", (long)width, (long)height, (unsigned)BENCH_STEPS);
+    app_create();
+    lv_timer_create(bench_sample_memory_cb, BENCH_SAMPLE_PERIOD, NULL);
+
+    bench.step_start = lv_tick_get();
+    printf("[bench] %s\n", timeline[0].name);
+    while (!bench.finished) {
+        bench_run_timeline();
+        uint32_t idle = lv_timer_handler();
+        bench_sample_start();
+        usleep(LV_MIN(idle, 5) * 1000);
+    }
+
+    bench_churn_stop();
+    bench_load_stop();
+    bench_sample_memory_cb(NULL);
+    bench_report();
+
+    if (profile_bench) {
+        render_profile_benchmark(disp, BENCH_PROFILE_FRAMES);
+    }
+
+    app_destroy();
+    frame_timing_unsubscribe(bench_frame_timing_cb, NULL);
+    printf("[bench] done\n");
+    return 0;
+}
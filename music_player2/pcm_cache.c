@@ -0,0 +1,341 @@
+/**
+ * PCM Prefetch Cache
+ * Background worker that reads the first PCM_CACHE_PREFETCH_MS of the
+ * current, next and previous tracks into a budgeted set of RAM slots
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <pthread.h>
+#include <syslog.h>
+
+#include "pcm_cache.h"
+
+#define CACHE_LOG(fmt, ...) syslog(LOG_INFO, "[PCMCACHE] " fmt, ##__VA_ARGS__)
+
+/* Slot states */
+#define SLOT_EMPTY   0
+#define SLOT_PENDING 1
+#define SLOT_LOADING 2
+#define SLOT_READY   3
+#define SLOT_FAILED  4
+
+// Variables
+static struct {
+    pcm_cache_entry_s slots[PCM_CACHE_SLOTS];
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t worker;
+    size_t budget;
+    size_t used;
+    bool running;
+    bool enabled;
+} cache;
+
+// Functions
+static void slot_reset(pcm_cache_entry_s *slot);
+static pcm_cache_entry_s *slot_find(const char *path);
+static pcm_cache_entry_s *slot_claim(void);
+static pcm_cache_entry_s *slot_next_pending(void);
+static void slot_load(pcm_cache_entry_s *slot);
+static void *worker_thread_func(void *arg);
+
+/* Drop cached data, caller holds the lock */
+static void slot_reset(pcm_cache_entry_s *slot)
+{
+    if (slot->data) {
+        cache.used -= slot->size;
+        free(slot->data);
+    }
+    slot->data = NULL;
+    slot->size = 0;
+    slot->path[0] = '\0';
+    slot->priority = -1;
+    slot->state = SLOT_EMPTY;
+    slot->generation++;
+}
+
+static pcm_cache_entry_s *slot_find(const char *path)
+{
+    for (int i = 0; i < PCM_CACHE_SLOTS; i++) {
+        pcm_cache_entry_s *slot = &cache.slots[i];
+        if (slot->state != SLOT_EMPTY && strcmp(slot->path, path) == 0) {
+            return slot;
+        }
+    }
+    return NULL;
+}
+
+/* Find a slot that may be reused: empty first, then stale and unpinned */
+static pcm_cache_entry_s *slot_claim(void)
+{
+    for (int i = 0; i < PCM_CACHE_SLOTS; i++) {
+        if (cache.slots[i].state == SLOT_EMPTY) {
+            return &cache.slots[i];
+        }
+    }
+
+    for (int i = 0; i < PCM_CACHE_SLOTS; i++) {
+        pcm_cache_entry_s *slot = &cache.slots[i];
+        if (slot->priority < 0 && slot->refs == 0 && slot->state != SLOT_LOADING) {
+            slot_reset(slot);
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+static pcm_cache_entry_s *slot_next_pending(void)
+{
+    pcm_cache_entry_s *best = NULL;
+
+    for (int i = 0; i < PCM_CACHE_SLOTS; i++) {
+        pcm_cache_entry_s *slot = &cache.slots[i];
+        if (slot->state == SLOT_PENDING && (!best || slot->priority < best->priority)) {
+            best = slot;
+        }
+    }
+    return best;
+}
+
+/* Read the start of a track, called without the lock held */
+static void slot_load(pcm_cache_entry_s *slot)
+{
+    char path[sizeof(slot->path)];
+    uint32_t generation;
+    size_t budget_left;
+    wav_s info;
+
+    pthread_mutex_lock(&cache.lock);
+    strcpy(path, slot->path);
+    generation = slot->generation;
+    budget_left = cache.budget > cache.used ? cache.budget - cache.used : 0;
+    pthread_mutex_unlock(&cache.lock);
+
+    int format = audio_ctl_detect_format(path);
+    int fd = open(path, O_RDONLY);
+    uint8_t *data = NULL;
+    ssize_t got = -1;
+
+    if (fd >= 0 && audio_ctl_probe_stream(fd, format, &info) == 0) {
+        size_t want = (size_t)info.byte_rate * PCM_CACHE_PREFETCH_MS / 1000;
+        size_t per_slot = cache.budget / PCM_CACHE_REQUEST_MAX;
+
+        if (want > per_slot) want = per_slot;
+        if (want > budget_left) want = budget_left;
+        if (want > info.data_size) want = info.data_size;
+
+        if (want > 0 && (data = malloc(want)) != NULL &&
+            lseek(fd, info.data_offset, SEEK_SET) == (off_t)info.data_offset) {
+            got = read(fd, data, want);
+        }
+    }
+
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    pthread_mutex_lock(&cache.lock);
+
+    if (slot->generation != generation) {
+        // Slot was reassigned while loading
+        free(data);
+    } else if (got <= 0) {
+        CACHE_LOG("Prefetch failed: %s", path);
+        free(data);
+        slot->state = SLOT_FAILED;
+    } else {
+        slot->audio_format = format;
+        slot->info = info;
+        slot->data = data;
+        slot->size = (uint32_t)got;
+        slot->state = SLOT_READY;
+        cache.used += slot->size;
+        CACHE_LOG("Prefetched %lu bytes of %s (%lu/%lu bytes used)",
+                  (unsigned long)got, path, (unsigned long)cache.used, (unsigned long)cache.budget);
+    }
+
+    pthread_mutex_unlock(&cache.lock);
+}
+
+/* Prefetch worker - services pending slots in priority order */
+static void *worker_thread_func(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&cache.lock);
+
+    while (cache.running) {
+        pcm_cache_entry_s *slot = slot_next_pending();
+        if (!slot) {
+            pthread_cond_wait(&cache.cond, &cache.lock);
+            continue;
+        }
+
+        slot->state = SLOT_LOADING;
+        pthread_mutex_unlock(&cache.lock);
+        slot_load(slot);
+        pthread_mutex_lock(&cache.lock);
+    }
+
+    pthread_mutex_unlock(&cache.lock);
+    return NULL;
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+int pcm_cache_init(size_t budget_bytes)
+{
+    if (cache.running) {
+        return 0;
+    }
+
+    memset(&cache, 0, sizeof(cache));
+    for (int i = 0; i < PCM_CACHE_SLOTS; i++) {
+        cache.slots[i].priority = -1;
+    }
+
+    cache.budget = budget_bytes;
+    cache.enabled = true;
+
+    if (pthread_mutex_init(&cache.lock, NULL) != 0) {
+        return -1;
+    }
+    if (pthread_cond_init(&cache.cond, NULL) != 0) {
+        pthread_mutex_destroy(&cache.lock);
+        return -1;
+    }
+
+    cache.running = true;
+    if (pthread_create(&cache.worker, NULL, worker_thread_func, NULL) != 0) {
+        CACHE_LOG("Failed to create prefetch worker");
+        cache.running = false;
+        pthread_cond_destroy(&cache.cond);
+        pthread_mutex_destroy(&cache.lock);
+        return -1;
+    }
+
+    CACHE_LOG("Prefetch cache started, budget %lu bytes", (unsigned long)budget_bytes);
+    return 0;
+}
+
+void pcm_cache_deinit(void)
+{
+    if (!cache.running) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache.lock);
+    cache.running = false;
+    pthread_cond_signal(&cache.cond);
+    pthread_mutex_unlock(&cache.lock);
+
+    pthread_join(cache.worker, NULL);
+
+    for (int i = 0; i < PCM_CACHE_SLOTS; i++) {
+        slot_reset(&cache.slots[i]);
+    }
+
+    pthread_cond_destroy(&cache.cond);
+    pthread_mutex_destroy(&cache.lock);
+}
+
+void pcm_cache_set_enabled(bool enabled)
+{
+    if (!cache.running) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache.lock);
+    cache.enabled = enabled;
+    pthread_mutex_unlock(&cache.lock);
+}
+
+void pcm_cache_prefetch(const char *const paths[], int count)
+{
+    if (!cache.running || !paths) {
+        return;
+    }
+
+    if (count > PCM_CACHE_REQUEST_MAX) {
+        count = PCM_CACHE_REQUEST_MAX;
+    }
+
+    pthread_mutex_lock(&cache.lock);
+
+    // Everything not named again becomes an eviction candidate
+    for (int i = 0; i < PCM_CACHE_SLOTS; i++) {
+        cache.slots[i].priority = -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (!paths[i] || paths[i][0] == '\0') {
+            continue;
+        }
+
+        pcm_cache_entry_s *slot = slot_find(paths[i]);
+        if (slot) {
+            if (slot->priority < 0) {
+                slot->priority = i;
+            }
+            // A file that was missing or busy may be readable now
+            if (slot->state == SLOT_FAILED) {
+                slot->state = SLOT_PENDING;
+            }
+            continue;
+        }
+
+        slot = slot_claim();
+        if (!slot) {
+            CACHE_LOG("No free slot for %s", paths[i]);
+            continue;
+        }
+
+        strncpy(slot->path, paths[i], sizeof(slot->path) - 1);
+        slot->path[sizeof(slot->path) - 1] = '\0';
+        slot->priority = i;
+        slot->state = SLOT_PENDING;
+    }
+
+    pthread_cond_signal(&cache.cond);
+    pthread_mutex_unlock(&cache.lock);
+}
+
+pcm_cache_entry_s *pcm_cache_acquire(const char *path)
+{
+    pcm_cache_entry_s *entry = NULL;
+
+    if (!cache.running || !path) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&cache.lock);
+    pcm_cache_entry_s *slot = cache.enabled ? slot_find(path) : NULL;
+    if (slot && slot->state == SLOT_READY) {
+        slot->refs++;
+        entry = slot;
+    }
+    pthread_mutex_unlock(&cache.lock);
+
+    return entry;
+}
+
+void pcm_cache_release(pcm_cache_entry_s *entry)
+{
+    if (!entry) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache.lock);
+    if (entry->refs > 0) {
+        entry->refs--;
+    }
+    pthread_mutex_unlock(&cache.lock);
+}
@@ -0,0 +1,96 @@
+/**
+ * PCM Prefetch Cache Header
+ * Keeps the start of nearby queue entries resident in RAM so that
+ * playback can begin before the file has been opened and parsed
+ */
+
+#ifndef PCM_CACHE_H
+#define PCM_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "audio_ctl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+/* Amount of audio cached for each track */
+#define PCM_CACHE_PREFETCH_MS 500
+
+/* Current, next and previous entry plus one slot still pinned by the engine */
+#define PCM_CACHE_REQUEST_MAX 3
+#define PCM_CACHE_SLOTS       (PCM_CACHE_REQUEST_MAX + 1)
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+/* Cached start of one track */
+typedef struct pcm_cache_entry {
+    char path[512];
+    int audio_format;
+    wav_s info;          // Stream information as parsed from the file
+    uint8_t *data;       // Payload starting at info.data_offset
+    uint32_t size;       // Valid bytes in data
+    int priority;        // Index in the last prefetch request, -1 if stale
+    int refs;            // Pins held by playback threads
+    int state;
+    uint32_t generation; // Bumped when the slot is reassigned
+} pcm_cache_entry_s;
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Start the prefetch worker
+ * @param budget_bytes Upper bound for all cached payload
+ * @return 0 on success, -1 on failure
+ */
+int pcm_cache_init(size_t budget_bytes);
+
+/**
+ * @brief Stop the worker and free all cached data
+ */
+void pcm_cache_deinit(void);
+
+/**
+ * @brief Enable or disable cache lookups (prefetching continues)
+ * @note Used by music_player_bench to compare start latency with and without the cache
+ * @param enabled false forces every start to read from the file
+ */
+void pcm_cache_set_enabled(bool enabled);
+
+/**
+ * @brief Request the start of the given tracks to be cached
+ * @note Entries whose prefetch failed are retried when requested again
+ * @param paths Track paths ordered by priority (current, next, previous)
+ * @param count Number of paths, at most PCM_CACHE_REQUEST_MAX
+ */
+void pcm_cache_prefetch(const char *const paths[], int count);
+
+/**
+ * @brief Pin a ready entry for playback
+ * @param path Track path
+ * @return Entry on cache hit, NULL otherwise
+ */
+pcm_cache_entry_s *pcm_cache_acquire(const char *path);
+
+/**
+ * @brief Release an entry obtained from pcm_cache_acquire()
+ * @param entry Cache entry
+ */
+void pcm_cache_release(pcm_cache_entry_s *entry);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* PCM_CACHE_H */
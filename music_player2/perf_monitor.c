@@ -0,0 +1,287 @@
+/**
+ * Performance Monitor
+ * Frame times come from frame_timing, only refreshes that rendered are
+ * frames; invalidated areas from LV_EVENT_INVALIDATE_AREA. The CSV file is buffered and flushed every
+ * PERF_CSV_FLUSH_SAMPLES lines, so sampling rarely waits on storage in
+ * the LVGL thread; a sample with underruns is flushed at once so that a
+ * crash or power cut right after a glitch still leaves it in the file
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "perf_monitor.h"
+#include "render_profile.h"
+#include "frame_timing.h"
+
+#define PERF_CSV_BUFFER  4096
+#define PERF_CSV_FLUSH_SAMPLES 10    // Lines per flush, 10 s at the default period
+
+// Variables
+static struct {
+    bool running;
+    perf_monitor_config_s config;
+    lv_display_t *disp;
+    lv_timer_t *timer;
+    lv_obj_t *overlay;
+    FILE *csv;
+    char *csv_buffer;
+    uint32_t csv_lines;              // Since the last flush
+
+    // Current period
+    uint64_t period_start_us;
+    uint64_t busy_us;
+    uint64_t area_px;
+    uint32_t frames;
+    uint32_t frame_max_us;
+
+    // Underrun count at the last sample
+    uint32_t underruns;
+
+    bool have_sample;
+    perf_monitor_sample_s sample;
+} perf;
+
+// Functions
+static void display_event_cb(lv_event_t *e);
+static void frame_timing_cb(uint32_t us, bool rendered, void *user_data);
+static void sample_timer_cb(lv_timer_t *timer);
+static void sample_audio(perf_monitor_sample_s *s);
+static void overlay_update(const perf_monitor_sample_s *s);
+static void csv_write(const perf_monitor_sample_s *s);
+
+static void display_event_cb(lv_event_t *e)
+{
+    if (lv_event_get_code(e) == LV_EVENT_INVALIDATE_AREA) {
+        const lv_area_t *area = lv_event_get_param(e);
+        perf.area_px += lv_area_get_size(area);
+    }
+}
+
+static void frame_timing_cb(uint32_t us, bool rendered, void *user_data)
+{
+    LV_UNUSED(user_data);
+
+    if (!rendered) {
+        return;
+    }
+
+    perf.busy_us += us;
+    perf.frames++;
+    if (us > perf.frame_max_us) {
+        perf.frame_max_us = us;
+    }
+}
+
+static void sample_audio(perf_monitor_sample_s *s)
+{
+    s->ring_fill_pct = -1;
+    s->ring_ms = 0;
+    s->underruns = 0;
+
+    audioctl_s *ctl = perf.config.audio ? perf.config.audio() : NULL;
+    if (!ctl) {
+        return;
+    }
+
+    uint32_t fill;
+    uint32_t size;
+    if (audio_ctl_get_ring_level(ctl, &fill, &size) == 0 && size > 0) {
+        s->ring_fill_pct = (int8_t)((uint64_t)fill * 100 / size);
+        if (ctl->wav.byte_rate) {
+            s->ring_ms = (uint32_t)((uint64_t)fill * 1000 / ctl->wav.byte_rate);
+        }
+    }
+
+    // Session counts, they only start over after audio_ctl_reset_stats()
+    audio_ctl_stats_s stats;
+    if (audio_ctl_get_stats(ctl, &stats) == 0) {
+        uint32_t last = perf.underruns;
+        s->underruns = stats.underrun_count >= last ? stats.underrun_count - last : stats.underrun_count;
+        perf.underruns = stats.underrun_count;
+    }
+}
+
+static void overlay_update(const perf_monitor_sample_s *s)
+{
+    char text[96];
+    char ring[24] = "-";
+
+    if (s->ring_fill_pct >= 0) {
+        lv_snprintf(ring, sizeof(ring), "%d%% %lums", s->ring_fill_pct, (unsigned long)s->ring_ms);
+    }
+    lv_snprintf(text, sizeof(text), "%lu.%lu fps %lu.%lu ms %lu kpx\nheap %d%% ring %s xrun %lu",
+                (unsigned long)(s->fps_x10 / 10), (unsigned long)(s->fps_x10 % 10),
+                (unsigned long)(s->frame_avg_us / 1000), (unsigned long)(s->frame_avg_us % 1000 / 100),
+                (unsigned long)(s->area_px / 1000), s->heap_used_pct, ring,
+                (unsigned long)s->underruns);
+
+    // The overlay redraws its own area, a label of two short lines
+    if (strcmp(lv_label_get_text(perf.overlay), text) != 0) {
+        lv_label_set_text(perf.overlay, text);
+    }
+}
+
+static void csv_write(const perf_monitor_sample_s *s)
+{
+    fprintf(perf.csv, "%llu,%lu.%lu,%lu,%lu,%lu,%lu,%u,%u,%d,%lu,%lu,%s\n",
+            (unsigned long long)s->time_ms,
+            (unsigned long)(s->fps_x10 / 10), (unsigned long)(s->fps_x10 % 10),
+            (unsigned long)s->frame_avg_us, (unsigned long)s->frame_max_us,
+            (unsigned long)s->area_px, (unsigned long)s->heap_used,
+            s->heap_used_pct, s->heap_frag_pct, s->ring_fill_pct,
+            (unsigned long)s->ring_ms, (unsigned long)s->underruns,
+            render_profile_name(render_profile_get()));
+}
+
+static void sample_timer_cb(lv_timer_t *timer)
+{
+    LV_UNUSED(timer);
+
+    perf_monitor_sample_s s;
+    uint64_t now = audio_ctl_clock_us();
+    uint64_t elapsed = now - perf.period_start_us;
+
+    memset(&s, 0, sizeof(s));
+    s.time_ms = now / 1000;
+    s.fps_x10 = elapsed ? (uint32_t)((uint64_t)perf.frames * 10000000 / elapsed) : 0;
+    s.frame_avg_us = perf.frames ? (uint32_t)(perf.busy_us / perf.frames) : 0;
+    s.frame_max_us = perf.frame_max_us;
+    s.area_px = perf.frames ? (uint32_t)(perf.area_px / perf.frames) : 0;
+
+    lv_mem_monitor_t mem;
+    lv_mem_monitor(&mem);
+    s.heap_used = (uint32_t)(mem.total_size - mem.free_size);
+    s.heap_used_pct = mem.used_pct;
+    s.heap_frag_pct = mem.frag_pct;
+
+    sample_audio(&s);
+
+    perf.period_start_us = now;
+    perf.busy_us = 0;
+    perf.area_px = 0;
+    perf.frames = 0;
+    perf.frame_max_us = 0;
+
+    perf.sample = s;
+    perf.have_sample = true;
+
+    if (perf.overlay) {
+        overlay_update(&s);
+    }
+    if (perf.csv) {
+        csv_write(&s);
+        if (s.underruns > 0 || ++perf.csv_lines >= PERF_CSV_FLUSH_SAMPLES) {
+            perf_monitor_flush();
+        }
+    }
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+int perf_monitor_init(const perf_monitor_config_s *config)
+{
+    if (perf.running || !config || config->period_ms == 0) {
+        return -1;
+    }
+
+    lv_display_t *disp = lv_display_get_default();
+    if (!disp) {
+        return -1;
+    }
+
+    memset(&perf, 0, sizeof(perf));
+    perf.config = *config;
+    perf.config.csv_path = NULL;
+    perf.disp = disp;
+
+    if (config->csv_path && config->csv_path[0] != '\0') {
+        perf.csv = fopen(config->csv_path, "w");
+        if (!perf.csv) {
+            LV_LOG_WARN("Performance CSV not writable: %s", config->csv_path);
+        } else {
+            perf.csv_buffer = malloc(PERF_CSV_BUFFER);
+            if (perf.csv_buffer) {
+                setvbuf(perf.csv, perf.csv_buffer, _IOFBF, PERF_CSV_BUFFER);
+            }
+            fprintf(perf.csv, "time_ms,fps,frame_avg_us,frame_max_us,area_px,heap_used,"
+                              "heap_used_pct,heap_frag_pct,ring_fill_pct,ring_ms,underruns,profile\n");
+        }
+    }
+
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_INVALIDATE_AREA, NULL);
+    if (frame_timing_subscribe(disp, frame_timing_cb, NULL) != 0) {
+        LV_LOG_WARN("Performance monitor: frame timing unavailable");
+    }
+
+    perf.period_start_us = audio_ctl_clock_us();
+    perf.timer = lv_timer_create(sample_timer_cb, config->period_ms, NULL);
+    perf.running = true;
+
+    perf_monitor_show_overlay(config->overlay);
+    return 0;
+}
+
+void perf_monitor_deinit(void)
+{
+    if (!perf.running) {
+        return;
+    }
+
+    perf_monitor_show_overlay(false);
+    lv_display_remove_event_cb_with_user_data(perf.disp, display_event_cb, NULL);
+    frame_timing_unsubscribe(frame_timing_cb, NULL);
+    lv_timer_delete(perf.timer);
+    if (perf.csv) {
+        fclose(perf.csv);
+    }
+    free(perf.csv_buffer);
+    memset(&perf, 0, sizeof(perf));
+}
+
+void perf_monitor_show_overlay(bool show)
+{
+    if (!perf.running || show == (perf.overlay != NULL)) {
+        return;
+    }
+
+    if (!show) {
+        lv_obj_delete(perf.overlay);
+        perf.overlay = NULL;
+        return;
+    }
+
+    // System layer: above the page, the playlist and the volume bar
+    perf.overlay = lv_label_create(lv_layer_sys());
+    lv_obj_set_style_bg_color(perf.overlay, lv_color_black(), LV_PART_MAIN);
+    lv_obj_set_style_bg_opa(perf.overlay, LV_OPA_70, LV_PART_MAIN);
+    lv_obj_set_style_text_color(perf.overlay, lv_color_hex(0x00FF7F), LV_PART_MAIN);
+    lv_obj_set_style_pad_all(perf.overlay, 4, LV_PART_MAIN);
+    lv_obj_align(perf.overlay, LV_ALIGN_BOTTOM_LEFT, 0, 0);
+    lv_obj_remove_flag(perf.overlay, LV_OBJ_FLAG_CLICKABLE);
+    lv_label_set_text(perf.overlay, "");
+    if (perf.have_sample) {
+        overlay_update(&perf.sample);
+    }
+}
+
+int perf_monitor_get_sample(perf_monitor_sample_s *sample)
+{
+    if (!perf.have_sample || !sample) {
+        return -1;
+    }
+
+    *sample = perf.sample;
+    return 0;
+}
+
+void perf_monitor_flush(void)
+{
+    if (perf.csv) {
+        fflush(perf.csv);
+        perf.csv_lines = 0;
+    }
+}
@@ -0,0 +1,99 @@
+/**
+ * Performance Monitor Header
+ * Samples UI and audio health once per period: frame rate, render time
+ * per frame, invalidated pixels, LVGL heap use and the audio ring fill
+ * with its underruns. Samples go to an optional overlay on the system
+ * layer and an optional CSV file, timestamped with the same monotonic
+ * clock as the audio underrun history so UI jank and underruns can be
+ * lined up in field logs
+ */
+
+#ifndef PERF_MONITOR_H
+#define PERF_MONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <lvgl.h>
+
+#include "audio_ctl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+/**
+ * Get the audio controller to sample
+ * @return Current controller, NULL while nothing is loaded
+ */
+typedef audioctl_s *(*perf_monitor_audio_cb_t)(void);
+
+typedef struct {
+    uint32_t period_ms;              // Sample period
+    bool overlay;                    // Show the last sample on the system layer
+    const char *csv_path;            // CSV file, NULL or "" for none
+    perf_monitor_audio_cb_t audio;   // NULL to leave the audio columns empty
+} perf_monitor_config_s;
+
+/* One sample, rates and averages over the period */
+typedef struct {
+    uint64_t time_ms;                // Monotonic, audio_ctl_clock_us() / 1000
+    uint32_t fps_x10;                // Rendered frames per second, times 10
+    uint32_t frame_avg_us;           // Render time of frames that drew something
+    uint32_t frame_max_us;
+    uint32_t area_px;                // Invalidated pixels per rendered frame
+    uint32_t heap_used;              // LVGL heap, bytes
+    uint8_t heap_used_pct;
+    uint8_t heap_frag_pct;
+    int8_t ring_fill_pct;            // Audio ring fill, -1 without audio
+    uint32_t ring_ms;                // Queued audio
+    uint32_t underruns;              // Underruns during the period
+} perf_monitor_sample_s;
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Start sampling the default display
+ * @note LVGL thread only
+ * @param config Configuration, copied; the CSV path is opened here
+ * @return 0 on success, -1 if already running or without a display. A CSV file that
+ *         cannot be opened is logged, sampling still starts
+ */
+int perf_monitor_init(const perf_monitor_config_s *config);
+
+/**
+ * @brief Stop sampling, remove the overlay and close the CSV file
+ * @note Writes the lines still buffered, call it before the app exits
+ */
+void perf_monitor_deinit(void);
+
+/**
+ * @brief Show or hide the overlay
+ * @param show true to show the samples
+ */
+void perf_monitor_show_overlay(bool show);
+
+/**
+ * @brief Get the last sample
+ * @param sample Filled with the last complete period
+ * @return 0 on success, -1 before the first period ends
+ */
+int perf_monitor_get_sample(perf_monitor_sample_s *sample);
+
+/**
+ * @brief Write buffered CSV lines to the file
+ * @note Done every few samples and after any sample with underruns anyway
+ */
+void perf_monitor_flush(void);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* PERF_MONITOR_H */
@@ -0,0 +1,373 @@
+/**
+ * Play Queue
+ * A shuffle round keeps only the positions it has swapped in a small
+ * hash table, so memory grows with the tracks played, not the library
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lvgl.h>
+
+#include "play_queue.h"
+
+#define PLAY_QUEUE_MIN_CAPACITY 16
+#define PLAY_QUEUE_MIN_SWAPS    64
+
+// Functions
+static uint32_t rng_below(play_queue_s *queue, uint32_t n);
+static int items_grow(play_queue_s *queue);
+static track_id_t items_pop_front(play_queue_s *queue);
+static uint32_t swap_slot(const play_queue_s *queue, uint32_t pos);
+static uint32_t swap_get(const play_queue_s *queue, uint32_t pos);
+static int swap_set(play_queue_s *queue, uint32_t pos, uint32_t value);
+static void shuffle_restart(play_queue_s *queue, track_id_t first);
+static track_id_t shuffle_draw(play_queue_s *queue);
+static track_id_t sequence_next(play_queue_s *queue, track_id_t current, bool wrap);
+
+/* xorshift32, uniform enough for track order; n must not be 0 */
+static uint32_t rng_below(play_queue_s *queue, uint32_t n)
+{
+    uint32_t x = queue->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    queue->rng = x;
+    return (uint32_t)(((uint64_t)x * n) >> 32);
+}
+
+static int items_grow(play_queue_s *queue)
+{
+    uint32_t capacity = queue->capacity ? queue->capacity * 2 : PLAY_QUEUE_MIN_CAPACITY;
+    track_id_t *items = malloc(capacity * sizeof(track_id_t));
+    if (!items) {
+        return -1;
+    }
+
+    // Unwrap the ring to the start of the new buffer
+    for (uint32_t i = 0; i < queue->size; i++) {
+        items[i] = queue->items[(queue->head + i) & (queue->capacity - 1)];
+    }
+    free(queue->items);
+    queue->items = items;
+    queue->head = 0;
+    queue->capacity = capacity;
+    return 0;
+}
+
+static track_id_t items_pop_front(play_queue_s *queue)
+{
+    track_id_t id = queue->items[queue->head];
+    queue->head = (queue->head + 1) & (queue->capacity - 1);
+    queue->size--;
+    return id;
+}
+
+/* Slot holding pos, or the free slot where it would go */
+static uint32_t swap_slot(const play_queue_s *queue, uint32_t pos)
+{
+    uint32_t mask = queue->swap_capacity - 1;
+    uint32_t slot = (pos * 2654435761u) & mask;
+
+    while (queue->swap_keys[slot] != 0 && queue->swap_keys[slot] != pos + 1) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+static uint32_t swap_get(const play_queue_s *queue, uint32_t pos)
+{
+    if (queue->swap_capacity == 0) {
+        return pos;
+    }
+
+    uint32_t slot = swap_slot(queue, pos);
+    return queue->swap_keys[slot] != 0 ? queue->swap_values[slot] : pos;
+}
+
+static int swap_set(play_queue_s *queue, uint32_t pos, uint32_t value)
+{
+    // Keep the load factor at or below 1/2
+    if ((queue->swap_size + 1) * 2 > queue->swap_capacity) {
+        uint32_t capacity = queue->swap_capacity ? queue->swap_capacity * 2 : PLAY_QUEUE_MIN_SWAPS;
+        uint32_t *keys = calloc(capacity, sizeof(uint32_t));
+        uint32_t *values = malloc(capacity * sizeof(uint32_t));
+        if (!keys || !values) {
+            free(keys);
+            free(values);
+            return -1;
+        }
+
+        play_queue_s grown = *queue;
+        grown.swap_keys = keys;
+        grown.swap_values = values;
+        grown.swap_capacity = capacity;
+        for (uint32_t i = 0; i < queue->swap_capacity; i++) {
+            if (queue->swap_keys[i] != 0) {
+                uint32_t slot = swap_slot(&grown, queue->swap_keys[i] - 1);
+                keys[slot] = queue->swap_keys[i];
+                values[slot] = queue->swap_values[i];
+            }
+        }
+
+        free(queue->swap_keys);
+        free(queue->swap_values);
+        queue->swap_keys = keys;
+        queue->swap_values = values;
+        queue->swap_capacity = capacity;
+    }
+
+    uint32_t slot = swap_slot(queue, pos);
+    if (queue->swap_keys[slot] == 0) {
+        queue->swap_keys[slot] = pos + 1;
+        queue->swap_size++;
+    }
+    queue->swap_values[slot] = value;
+    return 0;
+}
+
+/* New round over the whole library, first (if valid) counts as already played */
+static void shuffle_restart(play_queue_s *queue, track_id_t first)
+{
+    if (queue->swap_keys) {
+        memset(queue->swap_keys, 0, queue->swap_capacity * sizeof(uint32_t));
+    }
+    queue->swap_size = 0;
+    queue->drawn = 0;
+    queue->ahead = TRACK_ID_INVALID;
+
+    if (first < queue->count) {
+        // Swap first into position 0 and consume it
+        if (first != 0) {
+            swap_set(queue, first, 0);
+        }
+        queue->drawn = 1;
+    }
+}
+
+/* One Fisher-Yates step: pick among the positions not drawn yet */
+static track_id_t shuffle_draw(play_queue_s *queue)
+{
+    if (queue->drawn >= queue->count) {
+        return TRACK_ID_INVALID;
+    }
+
+    uint32_t pos = queue->drawn + rng_below(queue, queue->count - queue->drawn);
+    track_id_t id = swap_get(queue, pos);
+    if (pos != queue->drawn && swap_set(queue, pos, swap_get(queue, queue->drawn)) != 0) {
+        // Without memory the round may repeat a track, it still ends
+        LV_LOG_WARN("Shuffle table full, tracks may repeat");
+    }
+    queue->drawn++;
+    return id;
+}
+
+/* Next library track after the user queue is empty, consuming a shuffle draw */
+static track_id_t sequence_next(play_queue_s *queue, track_id_t current, bool wrap)
+{
+    if (queue->count == 0) {
+        return TRACK_ID_INVALID;
+    }
+
+    wrap = wrap || queue->repeat == PLAY_QUEUE_REPEAT_ALL;
+
+    if (!queue->shuffle) {
+        if (current >= queue->count) {
+            return 0;
+        }
+        if (current + 1 < queue->count) {
+            return current + 1;
+        }
+        return wrap ? 0 : TRACK_ID_INVALID;
+    }
+
+    track_id_t id = queue->ahead;
+    queue->ahead = TRACK_ID_INVALID;
+    if (id != TRACK_ID_INVALID) {
+        return id;
+    }
+
+    id = shuffle_draw(queue);
+    if (id == TRACK_ID_INVALID && wrap) {
+        // Round over, the track just played does not open the next one
+        shuffle_restart(queue, queue->count > 1 ? current : TRACK_ID_INVALID);
+        id = shuffle_draw(queue);
+    }
+    return id;
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+void play_queue_init(play_queue_s *queue, uint32_t count, uint32_t seed)
+{
+    memset(queue, 0, sizeof(*queue));
+    queue->count = count;
+    queue->ahead = TRACK_ID_INVALID;
+    queue->rng = seed ? seed : 0x9e3779b9u;
+}
+
+void play_queue_deinit(play_queue_s *queue)
+{
+    free(queue->items);
+    free(queue->swap_keys);
+    free(queue->swap_values);
+    memset(queue, 0, sizeof(*queue));
+    queue->ahead = TRACK_ID_INVALID;
+}
+
+track_id_t play_queue_next(play_queue_s *queue, track_id_t current, bool manual)
+{
+    if (!manual && queue->repeat == PLAY_QUEUE_REPEAT_ONE && current < queue->count) {
+        return current;
+    }
+
+    if (queue->size > 0) {
+        return items_pop_front(queue);
+    }
+    return sequence_next(queue, current, manual);
+}
+
+track_id_t play_queue_peek(play_queue_s *queue, track_id_t current)
+{
+    if (queue->repeat == PLAY_QUEUE_REPEAT_ONE && current < queue->count) {
+        return current;
+    }
+
+    if (queue->size > 0) {
+        return queue->items[queue->head];
+    }
+
+    if (queue->shuffle) {
+        // Draw now and keep it, so the hint is what actually plays
+        if (queue->ahead == TRACK_ID_INVALID) {
+            queue->ahead = sequence_next(queue, current, false);
+        }
+        return queue->ahead;
+    }
+    return sequence_next(queue, current, false);
+}
+
+track_id_t play_queue_previous(play_queue_s *queue, track_id_t current)
+{
+    if (queue->history_count == 0) {
+        if (queue->shuffle || queue->count == 0) {
+            return current;
+        }
+        return current < queue->count ? (current + queue->count - 1) % queue->count : 0;
+    }
+
+    queue->history_head = (queue->history_head + PLAY_QUEUE_HISTORY_MAX - 1) % PLAY_QUEUE_HISTORY_MAX;
+    queue->history_count--;
+    track_id_t id = queue->history[queue->history_head];
+
+    if (current < queue->count) {
+        play_queue_insert_next(queue, current);
+    }
+    return id;
+}
+
+track_id_t play_queue_peek_previous(const play_queue_s *queue, track_id_t current)
+{
+    if (queue->history_count == 0) {
+        if (queue->shuffle || queue->count == 0) {
+            return current;
+        }
+        return current < queue->count ? (current + queue->count - 1) % queue->count : 0;
+    }
+    return queue->history[(queue->history_head + PLAY_QUEUE_HISTORY_MAX - 1) % PLAY_QUEUE_HISTORY_MAX];
+}
+
+void play_queue_push_history(play_queue_s *queue, track_id_t id)
+{
+    if (id >= queue->count) {
+        return;
+    }
+
+    // The oldest entry is overwritten once full
+    queue->history[queue->history_head] = id;
+    queue->history_head = (queue->history_head + 1) % PLAY_QUEUE_HISTORY_MAX;
+    if (queue->history_count < PLAY_QUEUE_HISTORY_MAX) {
+        queue->history_count++;
+    }
+}
+
+int play_queue_insert_next(play_queue_s *queue, track_id_t id)
+{
+    if (queue->size == queue->capacity && items_grow(queue) != 0) {
+        return -1;
+    }
+
+    queue->head = (queue->head + queue->capacity - 1) & (queue->capacity - 1);
+    queue->items[queue->head] = id;
+    queue->size++;
+    return 0;
+}
+
+int play_queue_append(play_queue_s *queue, track_id_t id)
+{
+    if (queue->size == queue->capacity && items_grow(queue) != 0) {
+        return -1;
+    }
+
+    queue->items[(queue->head + queue->size) & (queue->capacity - 1)] = id;
+    queue->size++;
+    return 0;
+}
+
+void play_queue_clear(play_queue_s *queue)
+{
+    queue->head = 0;
+    queue->size = 0;
+}
+
+void play_queue_set_shuffle(play_queue_s *queue, bool shuffle, track_id_t current)
+{
+    queue->shuffle = shuffle;
+    if (shuffle) {
+        shuffle_restart(queue, current);
+    } else {
+        queue->ahead = TRACK_ID_INVALID;
+    }
+}
+
+void play_queue_set_repeat(play_queue_s *queue, play_queue_repeat_t repeat)
+{
+    queue->repeat = repeat;
+}
+
+void play_queue_remap(play_queue_s *queue, uint32_t count, track_id_t current,
+                      play_queue_map_cb_t map, void *user_data)
+{
+    // Queued tracks, compacted to the start of the buffer
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < queue->size; i++) {
+        track_id_t id = map(queue->items[(queue->head + i) & (queue->capacity - 1)], user_data);
+        if (id != TRACK_ID_INVALID) {
+            // Never overtakes the read position, i >= kept
+            queue->items[(queue->head + kept) & (queue->capacity - 1)] = id;
+            kept++;
+        }
+    }
+    queue->size = kept;
+
+    // History, oldest first, written back in place
+    uint32_t oldest = (queue->history_head + PLAY_QUEUE_HISTORY_MAX - queue->history_count) % PLAY_QUEUE_HISTORY_MAX;
+    kept = 0;
+    for (uint32_t i = 0; i < queue->history_count; i++) {
+        track_id_t id = map(queue->history[(oldest + i) % PLAY_QUEUE_HISTORY_MAX], user_data);
+        if (id != TRACK_ID_INVALID) {
+            queue->history[(oldest + kept) % PLAY_QUEUE_HISTORY_MAX] = id;
+            kept++;
+        }
+    }
+    queue->history_count = kept;
+    queue->history_head = (oldest + kept) % PLAY_QUEUE_HISTORY_MAX;
+
+    // Swapped positions refer to the old ids, start a new round
+    queue->count = count;
+    if (queue->shuffle) {
+        shuffle_restart(queue, current);
+    }
+}
@@ -0,0 +1,186 @@
+/**
+ * Play Queue Header
+ * What plays after the current track: tracks queued by the user first,
+ * then the library in order or shuffled, plus a history for "previous".
+ * The shuffle is a Fisher-Yates drawn one track at a time, so starting
+ * it costs nothing whatever the library size
+ */
+
+#ifndef PLAY_QUEUE_H
+#define PLAY_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "track_store.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define PLAY_QUEUE_HISTORY_MAX 64    // Tracks remembered for "previous"
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+typedef enum {
+    PLAY_QUEUE_REPEAT_OFF,           // Stop after the last track
+    PLAY_QUEUE_REPEAT_ALL,           // Start over, with a new shuffle
+    PLAY_QUEUE_REPEAT_ONE,           // Replay the current track when it ends
+    PLAY_QUEUE_REPEAT_COUNT,
+} play_queue_repeat_t;
+
+/**
+ * Maps a track id of the previous library version to the new one
+ * @return New id, TRACK_ID_INVALID if the track is gone
+ */
+typedef track_id_t (*play_queue_map_cb_t)(track_id_t id, void *user_data);
+
+typedef struct {
+    uint32_t count;                  // Tracks in the library
+
+    // Queued by the user, a ring buffer played front first
+    track_id_t *items;
+    uint32_t head;
+    uint32_t size;
+    uint32_t capacity;               // Power of two
+
+    // Played tracks, a ring buffer with the newest at history_head - 1
+    track_id_t history[PLAY_QUEUE_HISTORY_MAX];
+    uint32_t history_head;
+    uint32_t history_count;
+
+    play_queue_repeat_t repeat;
+    bool shuffle;
+
+    // Incremental Fisher-Yates: positions below drawn are played, the permutation
+    // is the identity except for the positions swapped so far
+    uint32_t drawn;
+    uint32_t *swap_keys;             // Position + 1, 0 marks a free slot
+    uint32_t *swap_values;
+    uint32_t swap_size;
+    uint32_t swap_capacity;          // Power of two
+    track_id_t ahead;                // Drawn by play_queue_peek(), next in line
+    uint32_t rng;
+} play_queue_s;
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Initialize an empty queue
+ * @param queue Play queue
+ * @param count Tracks in the library
+ * @param seed Shuffle seed
+ */
+void play_queue_init(play_queue_s *queue, uint32_t count, uint32_t seed);
+
+/**
+ * @brief Free a queue
+ * @param queue Play queue
+ */
+void play_queue_deinit(play_queue_s *queue);
+
+/**
+ * @brief Take the track to play after the current one
+ * @param queue Play queue
+ * @param current Current track, TRACK_ID_INVALID if none
+ * @param manual true for the next button: skips repeat-one and wraps around the library
+ * @return Track id, TRACK_ID_INVALID at the end of the library
+ */
+track_id_t play_queue_next(play_queue_s *queue, track_id_t current, bool manual);
+
+/**
+ * @brief Get the track play_queue_next() will return when the current one ends
+ * @note Used as prefetch hint; a shuffle draw made here is kept for the next call
+ * @param queue Play queue
+ * @param current Current track
+ * @return Track id, TRACK_ID_INVALID if playback will stop
+ */
+track_id_t play_queue_peek(play_queue_s *queue, track_id_t current);
+
+/**
+ * @brief Take the track to go back to
+ * @note The current track is queued first, so going forward returns to it
+ * @param queue Play queue
+ * @param current Current track
+ * @return Track id, current itself when there is nothing before it
+ */
+track_id_t play_queue_previous(play_queue_s *queue, track_id_t current);
+
+/**
+ * @brief Get the track play_queue_previous() will return
+ * @param queue Play queue
+ * @param current Current track
+ * @return Track id
+ */
+track_id_t play_queue_peek_previous(const play_queue_s *queue, track_id_t current);
+
+/**
+ * @brief Record a track that was left for another one
+ * @param queue Play queue
+ * @param id Track id, ignored if invalid
+ */
+void play_queue_push_history(play_queue_s *queue, track_id_t id);
+
+/**
+ * @brief Queue a track to play right after the current one
+ * @param queue Play queue
+ * @param id Track id
+ * @return 0 on success, -1 on allocation failure
+ */
+int play_queue_insert_next(play_queue_s *queue, track_id_t id);
+
+/**
+ * @brief Queue a track after the tracks already queued
+ * @param queue Play queue
+ * @param id Track id
+ * @return 0 on success, -1 on allocation failure
+ */
+int play_queue_append(play_queue_s *queue, track_id_t id);
+
+/**
+ * @brief Drop the tracks queued by the user
+ * @param queue Play queue
+ */
+void play_queue_clear(play_queue_s *queue);
+
+/**
+ * @brief Turn shuffle on or off
+ * @param queue Play queue
+ * @param shuffle Shuffle the library
+ * @param current Current track, not drawn again in this round
+ */
+void play_queue_set_shuffle(play_queue_s *queue, bool shuffle, track_id_t current);
+
+/**
+ * @brief Set the repeat mode
+ * @param queue Play queue
+ * @param repeat Repeat mode
+ */
+void play_queue_set_repeat(play_queue_s *queue, play_queue_repeat_t repeat);
+
+/**
+ * @brief Follow a new library version
+ * @note Queued and history tracks are mapped, dropped if gone; a shuffle starts a new round
+ * @param queue Play queue
+ * @param count Tracks in the new library
+ * @param current Current track in the new library
+ * @param map Id mapping from the old version
+ * @param user_data Passed to map
+ */
+void play_queue_remap(play_queue_s *queue, uint32_t count, track_id_t current,
+                      play_queue_map_cb_t map, void *user_data);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* PLAY_QUEUE_H */
@@ -6,78 +6,566 @@
 #include "music_player.h"
 #include "playlist_manager.h"
 #include "font_config.h"
+#include "track_order.h"
+#include "playlist_parser.h"
 #include <stdio.h>
+#include <string.h>
 
 // External variables
 extern struct resource_s R;
 extern struct ctx_s C;
 
 // Defines
-#define MAX_PLAYLIST_ITEMS 6
 #define PLAYLIST_ITEM_HEIGHT 70
+#define PLAYLIST_ROW_STRIDE (PLAYLIST_ITEM_HEIGHT + 4)  // Row and gap, rows sit at position * stride
+#define PLAYLIST_OVERSCAN 2                             // Rows bound above and below the visible ones
+#define PLAYLIST_ROW_POOL_MAX 24
+#define SEARCH_RESULTS_MAX 100
 #define PLAYLIST_NO_ANIMATION
+#define VIEW_LISTS (TRACK_ORDER_COUNT + 1)     // Playlist files view, after the track orders
+#define MAX_SAVED_PLAYLISTS 16
 // Variables
 static lv_obj_t* playlist_container = NULL;
+static lv_obj_t* playlist_list = NULL;
 static bool playlist_is_open = false;
+static int playlist_view = 0;                       // 0: library order, then track order + 1, then VIEW_LISTS
+static const char* view_map[VIEW_LISTS + 2];
+
+/*
+ * The list is virtual: a spacer gives it the height of every entry and a
+ * fixed pool of rows is rebound to the positions scrolled into view, so
+ * the object count does not depend on the library size
+ */
+typedef struct {
+    lv_obj_t* btn;
+    lv_obj_t* label;
+    lv_obj_t* caption;                              // Group name on the first row of an artist or album
+    uint32_t pos;                                   // Bound position, UINT32_MAX when unused
+    track_id_t id;                                  // Bound track, TRACK_ID_INVALID for playlist files
+    bool playing;                                   // Highlighted as the current track
+    char text[80];                                  // Label texts are static, rebinding does not allocate
+    char caption_text[64];
+} playlist_row_s;
+static playlist_row_s playlist_rows[PLAYLIST_ROW_POOL_MAX];
+static uint32_t playlist_row_count = 0;
+static uint32_t playlist_item_count = 0;            // Positions in the current view
+static uint32_t playlist_version = 0;               // Library version the positions were taken from
+static bool playlist_shows_files = false;           // Rows are playlist files, not tracks
+static lv_obj_t* playlist_spacer = NULL;
+static lv_obj_t* playlist_message = NULL;           // Shown instead of rows when the view is empty
+
+// Playlist files of the music directory, their track ids are read on first play
+typedef struct {
+    char name[PLAYLIST_NAME_MAX];
+    playlist_s list;
+    bool loaded;
+} saved_playlist_s;
+typedef struct {
+    saved_playlist_s* lists;
+    int count;
+} saved_playlist_scan_s;
+static saved_playlist_s saved_playlists[MAX_SAVED_PLAYLISTS];
+static int saved_playlist_count = 0;
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SEARCH
+static lv_obj_t* search_keyboard = NULL;
+static char search_query[TRACK_SEARCH_QUERY_MAX];   // Kept across refreshes
+static track_id_t search_results[SEARCH_RESULTS_MAX];
+#endif
 
 // Functions
-static void create_playlist_item(lv_obj_t* parent, int index);
-static void playlist_item_click_cb(lv_event_t* e);
+static void create_row_pool(lv_obj_t* parent);
+static void load_items(void);
+static void fill_playlist(void);
+static uint32_t current_track_pos(void);
+static bool search_active(void);
+static track_id_t item_track(uint32_t pos);
+static void bind_row(playlist_row_s* row, uint32_t pos);
+static bool row_set_playing(playlist_row_s* row, bool playing);
+static uint32_t update_rows(bool rebind);
+static void list_scroll_cb(lv_event_t* e);
+static void create_view_selector(lv_obj_t* parent);
+static void scan_saved_playlists(void);
+static void saved_playlist_found_cb(const char* name, void* user_data);
+static int saved_playlist_compare(const void* a, const void* b);
+static void play_saved_playlist(uint32_t index);
+static void view_changed_cb(lv_event_t* e);
+static void row_click_cb(lv_event_t* e);
+static void row_long_press_cb(lv_event_t* e);
 static void playlist_close_cb(lv_event_t* e);
-static void create_playlist_item(lv_obj_t* parent, int index) {
-    if (index >= R.album_count || index >= MAX_PLAYLIST_ITEMS) {
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SEARCH
+static void create_search_box(lv_obj_t* parent);
+static void search_changed_cb(lv_event_t* e);
+static void search_keyboard_cb(lv_event_t* e);
+#endif
+/**
+ * Rows for the visible part of the list plus the overscan, created once
+ */
+static void create_row_pool(lv_obj_t* parent) {
+    uint32_t visible = lv_display_get_vertical_resolution(NULL) / PLAYLIST_ROW_STRIDE + 1;
+    uint32_t count = LV_MIN(visible + 2 * PLAYLIST_OVERSCAN, PLAYLIST_ROW_POOL_MAX);
+    const lv_font_t* playlist_font = get_playlist_font("song");
+
+    playlist_row_count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        playlist_row_s* row = &playlist_rows[i];
+
+        row->btn = lv_btn_create(parent);
+        if (!row->btn) break;
+
+        lv_obj_set_size(row->btn, LV_PCT(100), PLAYLIST_ITEM_HEIGHT);
+        lv_obj_set_style_bg_color(row->btn, lv_color_hex(0x333333), LV_PART_MAIN);
+        lv_obj_set_style_bg_color(row->btn, lv_color_hex(0x4A4A4A), LV_PART_MAIN | LV_STATE_PRESSED);
+        lv_obj_set_style_radius(row->btn, 8, LV_PART_MAIN);
+        lv_obj_set_style_pad_ver(row->btn, 4, LV_PART_MAIN);
+        lv_obj_add_flag(row->btn, LV_OBJ_FLAG_HIDDEN);
+
+        // Now playing: checked state, the title inherits the text color
+        lv_obj_set_style_bg_color(row->btn, lv_color_hex(0x1E3A5F), LV_PART_MAIN | LV_STATE_CHECKED);
+        lv_obj_set_style_text_color(row->btn, lv_color_hex(0xFFFFFF), LV_PART_MAIN);
+        lv_obj_set_style_text_color(row->btn, lv_color_hex(0x00BFFF), LV_PART_MAIN | LV_STATE_CHECKED);
+
+        row->label = lv_label_create(row->btn);
+        lv_obj_center(row->label);
+        if (playlist_font) {
+            lv_obj_set_style_text_font(row->label, playlist_font, LV_PART_MAIN);
+        }
+
+        row->caption = lv_label_create(row->btn);
+        lv_obj_align(row->caption, LV_ALIGN_TOP_LEFT, 0, 0);
+        lv_obj_set_style_text_color(row->caption, lv_color_hex(0x9CA3AF), LV_PART_MAIN);
+        lv_obj_add_flag(row->caption, LV_OBJ_FLAG_HIDDEN);
+
+        row->text[0] = '\0';
+        row->caption_text[0] = '\0';
+        lv_label_set_text_static(row->label, row->text);
+        lv_label_set_text_static(row->caption, row->caption_text);
+        row->pos = UINT32_MAX;
+        row->id = TRACK_ID_INVALID;
+        row->playing = false;
+
+        // Rows are found through the user data, whatever position they show
+        lv_obj_add_event_cb(row->btn, row_click_cb, LV_EVENT_CLICKED, row);
+        lv_obj_add_event_cb(row->btn, row_long_press_cb, LV_EVENT_LONG_PRESSED, row);
+        playlist_row_count++;
+    }
+}
+
+/**
+ * Select what the list shows - library, a track order, search matches or playlist files -
+ * and size the scroll range for it
+ */
+static void load_items(void) {
+    const char* message = NULL;
+
+    playlist_version = R.library ? R.library->version : 0;
+    playlist_shows_files = false;
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SEARCH
+    if (search_query[0] != '\0') {
+        int count = library_search(R.library, search_query, search_results, SEARCH_RESULTS_MAX);
+        playlist_item_count = count > 0 ? count : 0;
+        if (count <= 0) {
+            message = count < 0 ? "Search unavailable" : "No matches";
+        }
+    } else
+#endif
+    if (playlist_view == VIEW_LISTS) {
+        scan_saved_playlists();
+        playlist_item_count = saved_playlist_count;
+        playlist_shows_files = true;
+        if (saved_playlist_count == 0) {
+            message = "No .m3u, .m3u8 or .pls files in the music folder";
+        }
+    } else {
+        playlist_item_count = R.tracks->count;
+    }
+
+    if (playlist_message) {
+        lv_label_set_text(playlist_message, message ? message : "");
+        if (message) {
+            lv_obj_remove_flag(playlist_message, LV_OBJ_FLAG_HIDDEN);
+        } else {
+            lv_obj_add_flag(playlist_message, LV_OBJ_FLAG_HIDDEN);
+        }
+    }
+
+    lv_obj_set_height(playlist_spacer, (int32_t)(playlist_item_count * PLAYLIST_ROW_STRIDE));
+}
+
+/**
+ * Show a new view from its start, or from the current track in track views
+ */
+static void fill_playlist(void) {
+    load_items();
+    uint32_t start = playlist_shows_files || search_active() ? 0 : current_track_pos();
+
+    // The scroll range must be known before scrolling, only done when the view changes
+    lv_obj_update_layout(playlist_list);
+    lv_obj_scroll_to_y(playlist_list, (int32_t)(start * PLAYLIST_ROW_STRIDE), LV_ANIM_OFF);
+    update_rows(true);
+}
+
+/**
+ * Position of the current track in the library or order view, to open the list on it
+ */
+static uint32_t current_track_pos(void) {
+    if (!track_store_valid(R.tracks, C.current_track)) {
+        return 0;
+    }
+    if (playlist_view == 0) {
+        return C.current_track;
+    }
+
+    const track_id_t* ids = track_order_ids(R.tracks, (track_order_t)(playlist_view - 1));
+    for (uint32_t pos = 0; ids && pos < R.tracks->count; pos++) {
+        if (ids[pos] == C.current_track) {
+            return pos;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Whether the list shows search matches rather than the selected view
+ */
+static bool search_active(void) {
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SEARCH
+    return search_query[0] != '\0';
+#else
+    return false;
+#endif
+}
+
+/**
+ * Track shown at a position of a track view
+ */
+static track_id_t item_track(uint32_t pos) {
+    if (pos >= playlist_item_count || playlist_shows_files) {
+        return TRACK_ID_INVALID;
+    }
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SEARCH
+    if (search_query[0] != '\0') {
+        return search_results[pos];
+    }
+#endif
+
+    // Sorted views walk the orders stored with the library, nothing is sorted here
+    const track_id_t* ids = playlist_view > 0 ? track_order_ids(R.tracks, (track_order_t)(playlist_view - 1)) : NULL;
+    return ids ? ids[pos] : pos;
+}
+
+/**
+ * Show one position in a row of the pool
+ */
+static void bind_row(playlist_row_s* row, uint32_t pos) {
+    const char* caption = NULL;
+
+    row->pos = pos;
+    row->id = item_track(pos);
+    if (playlist_shows_files) {
+        const saved_playlist_s* saved = &saved_playlists[pos];
+        if (saved->loaded) {
+            snprintf(row->text, sizeof(row->text), LV_SYMBOL_LIST " %s (%lu)", saved->name,
+                     (unsigned long)saved->list.count);
+        } else {
+            snprintf(row->text, sizeof(row->text), LV_SYMBOL_LIST " %s", saved->name);
+        }
+    } else {
+        track_id_t id = row->id;
+        const char* name = track_store_name(R.tracks, id);
+        snprintf(row->text, sizeof(row->text), "%lu. %s", (unsigned long)id + 1, name[0] != '\0' ? name : "Unknown");
+
+        // Artist and album views name each group on its first row
+        track_order_t order = (track_order_t)(playlist_view - 1);
+        if (!search_active() && playlist_view > 0 && order != TRACK_ORDER_TITLE) {
+            uint32_t group = track_order_group(R.tracks, order, id);
+            if (pos == 0 || track_order_group(R.tracks, order, item_track(pos - 1)) != group) {
+                caption = track_store_str(R.tracks, group);
+                caption = caption[0] != '\0' ? caption : "Unknown";
+            }
+        }
+    }
+
+    lv_label_set_text_static(row->label, row->text);
+    if (caption) {
+        snprintf(row->caption_text, sizeof(row->caption_text), "%s", caption);
+        lv_label_set_text_static(row->caption, row->caption_text);
+        lv_obj_remove_flag(row->caption, LV_OBJ_FLAG_HIDDEN);
+    } else {
+        lv_obj_add_flag(row->caption, LV_OBJ_FLAG_HIDDEN);
+    }
+
+    row_set_playing(row, row->id != TRACK_ID_INVALID && row->id == C.current_track);
+    lv_obj_set_y(row->btn, (int32_t)(pos * PLAYLIST_ROW_STRIDE));
+    lv_obj_remove_flag(row->btn, LV_OBJ_FLAG_HIDDEN);
+}
+
+/**
+ * Now playing highlight of a row, true if it changed
+ */
+static bool row_set_playing(playlist_row_s* row, bool playing) {
+    if (row->playing == playing) {
+        return false;
+    }
+
+    row->playing = playing;
+    if (playing) {
+        lv_obj_add_state(row->btn, LV_STATE_CHECKED);
+    } else {
+        lv_obj_remove_state(row->btn, LV_STATE_CHECKED);
+    }
+    return true;
+}
+
+/**
+ * Bind the pool to the positions around the scroll offset. Position p always lands in
+ * row p % pool size, so scrolling by one row rebinds one row; rows still showing the
+ * same track only get their highlight checked. Returns the rows touched
+ */
+static uint32_t update_rows(bool rebind) {
+    uint32_t n = playlist_row_count;
+    uint32_t touched = 0;
+    if (n == 0) return 0;
+
+    int32_t top = lv_obj_get_scroll_y(playlist_list);
+    uint32_t first = top > 0 ? (uint32_t)top / PLAYLIST_ROW_STRIDE : 0;
+    first = first > PLAYLIST_OVERSCAN ? first - PLAYLIST_OVERSCAN : 0;
+    if (first + n > playlist_item_count) {
+        first = playlist_item_count > n ? playlist_item_count - n : 0;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        playlist_row_s* row = &playlist_rows[i];
+        uint32_t pos = first + (i + n - first % n) % n;
+
+        if (pos >= playlist_item_count) {
+            if (row->pos != UINT32_MAX) {
+                row->pos = UINT32_MAX;
+                lv_obj_add_flag(row->btn, LV_OBJ_FLAG_HIDDEN);
+                touched++;
+            }
+        } else if (rebind || row->pos != pos || row->id != item_track(pos)) {
+            bind_row(row, pos);
+            touched++;
+        } else if (row_set_playing(row, row->id != TRACK_ID_INVALID && row->id == C.current_track)) {
+            touched++;
+        }
+    }
+    return touched;
+}
+
+/**
+ * List scrolled - rows that left the window are rebound to the positions entering it
+ */
+static void list_scroll_cb(lv_event_t* e) {
+    LV_UNUSED(e);
+    update_rows(false);
+}
+
+/**
+ * Re-read the playlist names, keeping the ids of files still there
+ */
+static void scan_saved_playlists(void) {
+    static saved_playlist_s found[MAX_SAVED_PLAYLISTS];
+    saved_playlist_scan_s scan = { found, 0 };
+
+    memset(found, 0, sizeof(found));
+    if (playlist_list_dir(MUSICS_ROOT, saved_playlist_found_cb, &scan) < 0) {
+        LV_LOG_WARN("Cannot list playlists in %s", MUSICS_ROOT);
+    }
+    int found_count = scan.count;
+
+    for (int i = 0; i < saved_playlist_count; i++) {
+        int j = 0;
+        while (j < found_count && strcmp(found[j].name, saved_playlists[i].name) != 0) {
+            j++;
+        }
+        if (j < found_count) {
+            found[j].list = saved_playlists[i].list;
+            found[j].loaded = saved_playlists[i].loaded;
+        } else {
+            playlist_free(&saved_playlists[i].list);
+        }
+    }
+
+    qsort(found, found_count, sizeof(saved_playlist_s), saved_playlist_compare);
+    memcpy(saved_playlists, found, sizeof(saved_playlists));
+    saved_playlist_count = found_count;
+}
+
+/**
+ * One playlist file of the music directory, the first MAX_SAVED_PLAYLISTS are kept
+ */
+static void saved_playlist_found_cb(const char* name, void* user_data) {
+    saved_playlist_scan_s* scan = user_data;
+
+    if (scan->count < MAX_SAVED_PLAYLISTS) {
+        snprintf(scan->lists[scan->count].name, PLAYLIST_NAME_MAX, "%s", name);
+        scan->count++;
+    }
+}
+
+static int saved_playlist_compare(const void* a, const void* b) {
+    return strcmp(((const saved_playlist_s*)a)->name, ((const saved_playlist_s*)b)->name);
+}
+
+/**
+ * Play a playlist file - its paths are resolved once per library version
+ */
+static void play_saved_playlist(uint32_t index) {
+    if (index >= (uint32_t)saved_playlist_count || !R.library) {
         return;
     }
-    
-    // Create simple button for playlist item
-    lv_obj_t* btn = lv_btn_create(parent);
-    if (!btn) return;
-    
-    lv_obj_set_size(btn, LV_PCT(100), PLAYLIST_ITEM_HEIGHT);
-    lv_obj_set_style_bg_color(btn, lv_color_hex(0x333333), LV_PART_MAIN);
-    lv_obj_set_style_bg_color(btn, lv_color_hex(0x4A4A4A), LV_PART_MAIN | LV_STATE_PRESSED);
-    lv_obj_set_style_radius(btn, 8, LV_PART_MAIN);
-    lv_obj_set_style_margin_bottom(btn, 4, LV_PART_MAIN);
-    
-    // Create label with enhanced styling
-    lv_obj_t* label = lv_label_create(btn);
-    if (!label) return;
-    
-    char text[80];
-    const char* name = R.albums[index].name ? R.albums[index].name : "Unknown";
-    snprintf(text, sizeof(text), "%d. %s", index + 1, name);
-    lv_label_set_text(label, text);
-    lv_obj_center(label);
-    
-    // Apply playlist font
-    const lv_font_t* playlist_font = get_playlist_font("song");
-    if (playlist_font) {
-        lv_obj_set_style_text_font(label, playlist_font, LV_PART_MAIN);
+
+    saved_playlist_s* saved = &saved_playlists[index];
+    if (!saved->loaded || saved->list.version != R.library->version) {
+        if (playlist_load(&saved->list, R.tracks, saved->name) != 0) {
+            return;
+        }
+        saved->list.version = R.library->version;
+        saved->loaded = true;
     }
-    
-    // Set text color to white
-    lv_obj_set_style_text_color(label, lv_color_hex(0xFFFFFF), LV_PART_MAIN);
-    
-    // Click event handler
-    lv_obj_add_event_cb(btn, playlist_item_click_cb, LV_EVENT_CLICKED, (void*)(uintptr_t)index);
+
+    if (app_play_tracks(saved->list.ids, saved->list.count) != 0) {
+        LV_LOG_WARN("Playlist %s has no track of the library", saved->name);
+        update_rows(true);
+        return;
+    }
+    playlist_manager_close();
 }
 
 /**
- * Playlist item click handler
+ * Library / Title / Artist / Album / Lists switch, kept across refreshes
  */
-static void playlist_item_click_cb(lv_event_t* e) {
-    int index = (int)(uintptr_t)lv_event_get_user_data(e);
-    
-    if (index >= 0 && index < R.album_count) {
+static void create_view_selector(lv_obj_t* parent) {
+    lv_obj_t* selector = lv_buttonmatrix_create(parent);
+    if (!selector) return;
+
+    view_map[0] = "Library";
+    for (int i = 0; i < TRACK_ORDER_COUNT; i++) {
+        view_map[i + 1] = track_order_name((track_order_t)i);
+    }
+    view_map[VIEW_LISTS] = "Lists";
+    view_map[VIEW_LISTS + 1] = "";
+
+    lv_buttonmatrix_set_map(selector, view_map);
+    lv_buttonmatrix_set_button_ctrl_all(selector, LV_BUTTONMATRIX_CTRL_CHECKABLE);
+    lv_buttonmatrix_set_one_checked(selector, true);
+    lv_buttonmatrix_set_button_ctrl(selector, playlist_view, LV_BUTTONMATRIX_CTRL_CHECKED);
+    lv_obj_set_size(selector, LV_PCT(100), 44);
+    lv_obj_set_style_margin_bottom(selector, 8, LV_PART_MAIN);
+    lv_obj_add_event_cb(selector, view_changed_cb, LV_EVENT_VALUE_CHANGED, NULL);
+}
+
+/**
+ * View switch - only the visible rows are rebuilt
+ */
+static void view_changed_cb(lv_event_t* e) {
+    lv_obj_t* selector = lv_event_get_target(e);
+    uint32_t view = lv_buttonmatrix_get_selected_button(selector);
+    if (view > VIEW_LISTS || (int)view == playlist_view) {
+        return;
+    }
+
+    playlist_view = view;
+    fill_playlist();
+}
+
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SEARCH
+/**
+ * Search field above the list, with an on-screen keyboard while it has focus
+ */
+static void create_search_box(lv_obj_t* parent) {
+    lv_obj_t* textarea = lv_textarea_create(parent);
+    if (!textarea) return;
+
+    lv_obj_set_width(textarea, LV_PCT(100));
+    lv_textarea_set_one_line(textarea, true);
+    lv_textarea_set_max_length(textarea, TRACK_SEARCH_QUERY_MAX - 1);
+    lv_textarea_set_placeholder_text(textarea, "Search title, artist, album");
+    lv_textarea_set_text(textarea, search_query);
+    lv_obj_set_style_margin_bottom(textarea, 8, LV_PART_MAIN);
+
+    // Same font as the rows, so CJK queries render
+    const lv_font_t* search_font = get_playlist_font("song");
+    if (search_font) {
+        lv_obj_set_style_text_font(textarea, search_font, LV_PART_MAIN);
+    }
+
+    // Keyboard over the lower part of the overlay, outside the content so it is not scrolled
+    search_keyboard = lv_keyboard_create(playlist_container);
+    if (search_keyboard) {
+        lv_obj_set_size(search_keyboard, LV_PCT(100), LV_PCT(40));
+        lv_obj_align(search_keyboard, LV_ALIGN_BOTTOM_MID, 0, 0);
+        lv_obj_add_flag(search_keyboard, LV_OBJ_FLAG_HIDDEN);
+    }
+
+    // Added after the text is restored, the list is filled once by the caller
+    lv_obj_add_event_cb(textarea, search_changed_cb, LV_EVENT_VALUE_CHANGED, NULL);
+    lv_obj_add_event_cb(textarea, search_keyboard_cb, LV_EVENT_FOCUSED, NULL);
+    lv_obj_add_event_cb(textarea, search_keyboard_cb, LV_EVENT_DEFOCUSED, NULL);
+    lv_obj_add_event_cb(textarea, search_keyboard_cb, LV_EVENT_READY, NULL);
+    lv_obj_add_event_cb(textarea, search_keyboard_cb, LV_EVENT_CANCEL, NULL);
+}
+
+/**
+ * Search text changed - every keystroke queries the library index
+ */
+static void search_changed_cb(lv_event_t* e) {
+    lv_obj_t* textarea = lv_event_get_target(e);
+    snprintf(search_query, sizeof(search_query), "%s", lv_textarea_get_text(textarea));
+    fill_playlist();
+}
+
+/**
+ * Show the keyboard while the search field has focus
+ */
+static void search_keyboard_cb(lv_event_t* e) {
+    lv_obj_t* textarea = lv_event_get_target(e);
+    if (!search_keyboard) return;
+
+    if (lv_event_get_code(e) == LV_EVENT_FOCUSED) {
+        lv_keyboard_set_textarea(search_keyboard, textarea);
+        lv_obj_remove_flag(search_keyboard, LV_OBJ_FLAG_HIDDEN);
+    } else {
+        lv_keyboard_set_textarea(search_keyboard, NULL);
+        lv_obj_add_flag(search_keyboard, LV_OBJ_FLAG_HIDDEN);
+    }
+}
+#endif
+
+/**
+ * Row click handler
+ */
+static void row_click_cb(lv_event_t* e) {
+    const playlist_row_s* row = lv_event_get_user_data(e);
+
+    if (playlist_shows_files) {
+        play_saved_playlist(row->pos);
+        return;
+    }
+
+    track_id_t id = item_track(row->pos);
+    if (track_store_valid(R.tracks, id)) {
         // Switch to selected track
-        extern void app_switch_to_album(int index);
-        app_switch_to_album(index);
+        app_switch_to_album(id);
         
         // Close playlist
         playlist_manager_close();
     }
 }
 
+/**
+ * Row long press handler, queues the track to play next
+ */
+static void row_long_press_cb(lv_event_t* e) {
+    const playlist_row_s* row = lv_event_get_user_data(e);
+
+    // No click on release, the list stays open to queue more tracks
+    lv_indev_wait_release(lv_indev_active());
+
+    app_queue_next(item_track(row->pos));
+}
+
 /**
  * Close playlist callback
  */
@@ -149,10 +637,31 @@ void playlist_manager_create(lv_obj_t* parent) {
         lv_obj_set_style_text_align(title, LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
     }
     
-    // Create limited list items
-    int max_items = (R.album_count < MAX_PLAYLIST_ITEMS) ? R.album_count : MAX_PLAYLIST_ITEMS;
-    for (int i = 0; i < max_items; i++) {
-        create_playlist_item(content, i);
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SEARCH
+    create_search_box(content);
+#endif
+    create_view_selector(content);
+
+    // Virtual list: no layout, rows are placed by position
+    playlist_list = lv_obj_create(content);
+    if (playlist_list) {
+        lv_obj_remove_style_all(playlist_list);
+        lv_obj_set_width(playlist_list, LV_PCT(100));
+        lv_obj_set_flex_grow(playlist_list, 1);
+        lv_obj_set_scroll_dir(playlist_list, LV_DIR_VER);
+
+        playlist_spacer = lv_obj_create(playlist_list);
+        lv_obj_remove_style_all(playlist_spacer);
+        lv_obj_remove_flag(playlist_spacer, LV_OBJ_FLAG_CLICKABLE);
+        lv_obj_set_width(playlist_spacer, 1);
+
+        playlist_message = lv_label_create(playlist_list);
+        lv_obj_set_style_text_color(playlist_message, lv_color_hex(0x9CA3AF), LV_PART_MAIN);
+        lv_obj_add_flag(playlist_message, LV_OBJ_FLAG_HIDDEN);
+
+        create_row_pool(playlist_list);
+        lv_obj_add_event_cb(playlist_list, list_scroll_cb, LV_EVENT_SCROLL, NULL);
+        fill_playlist();
     }
     
     // Mark playlist as open
@@ -166,6 +675,13 @@ void playlist_manager_close(void) {
     if (playlist_container) {
         lv_obj_del(playlist_container);
         playlist_container = NULL;
+        playlist_list = NULL;
+        playlist_spacer = NULL;
+        playlist_message = NULL;
+        playlist_row_count = 0;
+#ifdef CONFIG_LVX_MUSIC_PLAYER_SEARCH
+        search_keyboard = NULL;
+#endif
     }
     
     // Mark playlist as closed
@@ -180,15 +696,43 @@ bool playlist_manager_is_open(void) {
 }
 
 /**
- * Refresh playlist - simple recreation logic
+ * Refresh playlist - only rows whose track or now-playing state changed are touched
  */
 void playlist_manager_refresh(void) {
-    if (playlist_is_open) {
-        // If already open, close and recreate
-        lv_obj_t* parent = lv_obj_get_parent(playlist_container);
-        playlist_manager_close();
-        if (parent) {
-            playlist_manager_create(parent);
+    if (!playlist_is_open || !playlist_list) {
+        return;
+    }
+
+    uint64_t start_us = audio_ctl_clock_us();
+#if LV_USE_LOG && LV_LOG_LEVEL <= LV_LOG_LEVEL_INFO
+    // Walking the heap is not free, only done when the line is printed
+    lv_mem_monitor_t mem_before;
+    lv_mem_monitor(&mem_before);
+#endif
+
+    // Another library version: counts, orders and matches may all differ
+    bool reload = !R.library || R.library->version != playlist_version;
+    if (reload) {
+        load_items();
+        lv_obj_update_layout(playlist_list);
+
+        // Keep the offset unless the list got shorter than it
+        int32_t bottom = lv_obj_get_scroll_bottom(playlist_list);
+        if (bottom < 0) {
+            lv_obj_scroll_by(playlist_list, 0, -bottom, LV_ANIM_OFF);
         }
     }
+    uint32_t touched = update_rows(reload);
+
+#if LV_USE_LOG && LV_LOG_LEVEL <= LV_LOG_LEVEL_INFO
+    uint32_t elapsed_us = (uint32_t)(audio_ctl_clock_us() - start_us);
+    lv_mem_monitor_t mem;
+    lv_mem_monitor(&mem);
+    LV_LOG_INFO("Playlist refresh: %lu rows touched, %lu us, %+ld blocks",
+                (unsigned long)touched, (unsigned long)elapsed_us,
+                (long)mem.used_cnt - (long)mem_before.used_cnt);
+    LV_UNUSED(elapsed_us);
+#endif
+    LV_UNUSED(start_us);
+    LV_UNUSED(touched);
 }
\ No newline at end of file
@@ -0,0 +1,542 @@
+/**
+ * Playlist Parser
+ * One line splitter for both formats. Locations are decoded and
+ * normalized to a path relative to the library root, then looked up in
+ * the path hash of the track store, no scan over the tracks
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <lvgl.h>
+
+#include "playlist_parser.h"
+
+#define PLAYLIST_PATH_MAX       (TRACK_ROOT_MAX + PLAYLIST_LINE_MAX)
+#define PLAYLIST_MISSING_LOGGED 4    // Unresolved entries logged per load
+
+/* Resolved entry, sorted by index before the positions are dropped */
+typedef struct {
+    uint32_t index;
+    track_id_t id;
+} entry_ref_s;
+
+/* playlist_load() state */
+typedef struct {
+    track_store_s *store;
+    char dir[PLAYLIST_LINE_MAX];     // Playlist directory relative to the root, "" for the root
+    entry_ref_s *refs;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t missing;
+    bool sorted;                     // Indexes seen in increasing order so far
+    bool failed;
+} load_ctx_s;
+
+// Functions
+static void on_line(playlist_parser_s *parser);
+static void on_m3u_line(playlist_parser_s *parser, char *line);
+static void on_pls_line(playlist_parser_s *parser, char *line);
+static void emit(playlist_parser_s *parser, const char *location, const char *title, int32_t duration_s,
+                 uint32_t index);
+static int hex_digit(char c);
+static int decode_location(const char *location, char *buf, size_t size);
+static int normalize_path(const char *path, char *buf, size_t size);
+static int resolve_location(const track_store_s *store, const char *dir, const char *location, char *buf,
+                            size_t size);
+static bool load_entry_cb(const playlist_entry_s *entry, void *user_data);
+static int ref_compare(const void *a, const void *b);
+
+static void on_line(playlist_parser_s *parser)
+{
+    char *line = parser->line;
+    size_t len = parser->line_len;
+
+    line[len] = '\0';
+    parser->line_len = 0;
+
+    if (parser->line_skip) {
+        parser->line_skip = false;
+        parser->skipped++;
+        LV_LOG_WARN("Playlist line %lu too long, skipped", (unsigned long)parser->line_no + 1);
+        return;
+    }
+
+    // UTF-8 BOM, written by many Windows tools in front of .m3u8 files
+    if (parser->line_no == 0 && len >= 3 && memcmp(line, "\xEF\xBB\xBF", 3) == 0) {
+        line += 3;
+        len -= 3;
+    }
+
+    while (len > 0 && (line[len - 1] == ' ' || line[len - 1] == '\t')) {
+        line[--len] = '\0';
+    }
+    while (*line == ' ' || *line == '\t') {
+        line++;
+    }
+    if (*line == '\0') {
+        return;
+    }
+
+    if (parser->format == PLAYLIST_FORMAT_PLS) {
+        on_pls_line(parser, line);
+    } else {
+        on_m3u_line(parser, line);
+    }
+}
+
+static void on_m3u_line(playlist_parser_s *parser, char *line)
+{
+    if (line[0] != '#') {
+        emit(parser, line, parser->title, parser->duration_s, parser->entry_count);
+        parser->title[0] = '\0';
+        parser->duration_s = -1;
+        return;
+    }
+
+    // #EXTINF:<seconds> [attributes],<title>, other directives are ignored
+    if (strncasecmp(line, "#EXTINF:", 8) != 0) {
+        return;
+    }
+
+    parser->duration_s = (int32_t)strtol(line + 8, NULL, 10);
+    const char *title = strchr(line + 8, ',');
+    title = title ? title + 1 : "";
+    while (*title == ' ') {
+        title++;
+    }
+
+    // Truncated on a character boundary
+    size_t n = strlen(title);
+    if (n >= sizeof(parser->title)) {
+        n = sizeof(parser->title) - 1;
+        while (n > 0 && ((uint8_t)title[n] & 0xc0) == 0x80) {
+            n--;
+        }
+    }
+    memcpy(parser->title, title, n);
+    parser->title[n] = '\0';
+}
+
+static void on_pls_line(playlist_parser_s *parser, char *line)
+{
+    // Only FileN=<location>: titles and lengths may come after their file
+    char *eq = strchr(line, '=');
+    if (!eq || strncasecmp(line, "File", 4) != 0) {
+        return;
+    }
+
+    char *end;
+    unsigned long number = strtoul(line + 4, &end, 10);
+    while (*end == ' ') {
+        end++;
+    }
+    if (end == line + 4 || end != eq || number == 0 || number > UINT32_MAX) {
+        return;
+    }
+
+    char *location = eq + 1;
+    while (*location == ' ') {
+        location++;
+    }
+    if (*location != '\0') {
+        emit(parser, location, "", -1, (uint32_t)(number - 1));
+    }
+}
+
+static void emit(playlist_parser_s *parser, const char *location, const char *title, int32_t duration_s,
+                 uint32_t index)
+{
+    playlist_entry_s entry = { location, title, duration_s, index };
+
+    parser->entry_count++;
+    if (parser->cb && !parser->cb(&entry, parser->user_data)) {
+        parser->stopped = true;
+    }
+}
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/* Location as a plain path with '/' separators, -1 for streams */
+static int decode_location(const char *location, char *buf, size_t size)
+{
+    size_t len = 0;
+
+    if (strncasecmp(location, "file://", 7) == 0) {
+        location += 7;
+        if (strncasecmp(location, "localhost/", 10) == 0) {
+            location += 9;
+        }
+
+        // Percent-encoded bytes, %00 is refused
+        while (*location != '\0') {
+            char c = *location++;
+            if (c == '%' && hex_digit(location[0]) >= 0 && hex_digit(location[1]) >= 0) {
+                c = (char)(hex_digit(location[0]) << 4 | hex_digit(location[1]));
+                location += 2;
+                if (c == '\0') {
+                    return -1;
+                }
+            }
+            if (len + 1 >= size) {
+                return -1;
+            }
+            buf[len++] = c;
+        }
+    } else if (strstr(location, "://")) {
+        return -1;
+    } else {
+        len = strlen(location);
+        if (len >= size) {
+            return -1;
+        }
+        memcpy(buf, location, len);
+    }
+    buf[len] = '\0';
+
+    // Playlists written on Windows
+    for (char *p = buf; *p != '\0'; p++) {
+        if (*p == '\\') {
+            *p = '/';
+        }
+    }
+    return 0;
+}
+
+/* Relative path without "", "." and ".." components, -1 if it climbs above its start */
+static int normalize_path(const char *path, char *buf, size_t size)
+{
+    size_t len = 0;
+
+    while (*path != '\0') {
+        const char *end = strchr(path, '/');
+        if (!end) {
+            end = path + strlen(path);
+        }
+        size_t n = end - path;
+
+        if (n == 2 && path[0] == '.' && path[1] == '.') {
+            if (len == 0) {
+                return -1;
+            }
+            while (len > 0 && buf[len - 1] != '/') {
+                len--;
+            }
+            if (len > 0) {
+                len--;
+            }
+        } else if (n > 0 && !(n == 1 && path[0] == '.')) {
+            if (len + 1 + n >= size) {
+                return -1;
+            }
+            if (len > 0) {
+                buf[len++] = '/';
+            }
+            memcpy(buf + len, path, n);
+            len += n;
+        }
+
+        path = *end != '\0' ? end + 1 : end;
+    }
+
+    buf[len] = '\0';
+    return len > 0 ? 0 : -1;
+}
+
+/*
+ * Path of an entry relative to the store root. Returns 0 when resolved, 1 for an
+ * absolute path outside the root whose components are left in buf, -1 otherwise
+ */
+static int resolve_location(const track_store_s *store, const char *dir, const char *location, char *buf,
+                            size_t size)
+{
+    char decoded[PLAYLIST_PATH_MAX];
+    if (decode_location(location, decoded, sizeof(decoded)) != 0) {
+        return -1;
+    }
+
+    bool drive = ((decoded[0] | 0x20) >= 'a' && (decoded[0] | 0x20) <= 'z') && decoded[1] == ':';
+    if (decoded[0] != '/' && !drive) {
+        char joined[PLAYLIST_PATH_MAX * 2];
+        snprintf(joined, sizeof(joined), "%s%s%s", dir, dir[0] != '\0' ? "/" : "", decoded);
+        return normalize_path(joined, buf, size);
+    }
+
+    size_t root_len = strlen(store->root);
+    if (!drive && root_len > 0 && strncmp(decoded, store->root, root_len) == 0 && decoded[root_len] == '/') {
+        return normalize_path(decoded + root_len + 1, buf, size);
+    }
+
+    // Written on another machine, the caller matches what it can
+    return normalize_path(decoded + (drive ? 2 : 1), buf, size) == 0 ? 1 : -1;
+}
+
+static bool load_entry_cb(const playlist_entry_s *entry, void *user_data)
+{
+    load_ctx_s *ctx = user_data;
+    char path[PLAYLIST_PATH_MAX];
+    track_id_t id = TRACK_ID_INVALID;
+
+    int ret = resolve_location(ctx->store, ctx->dir, entry->location, path, sizeof(path));
+    if (ret == 0) {
+        id = track_store_find(ctx->store, path);
+    } else if (ret == 1) {
+        // Longest tail of a foreign path found in the library, e.g. Music/Artist/x.mp3 -> Artist/x.mp3
+        for (const char *tail = path; tail && id == TRACK_ID_INVALID; tail = strchr(tail, '/')) {
+            tail += *tail == '/';
+            id = track_store_find(ctx->store, tail);
+        }
+    }
+
+    if (id == TRACK_ID_INVALID) {
+        if (ctx->missing++ < PLAYLIST_MISSING_LOGGED) {
+            LV_LOG_WARN("Playlist entry not in the library: %s", entry->location);
+        }
+        return true;
+    }
+
+    if (ctx->count == ctx->capacity) {
+        uint32_t capacity = ctx->capacity ? ctx->capacity * 2 : 64;
+        entry_ref_s *refs = realloc(ctx->refs, capacity * sizeof(entry_ref_s));
+        if (!refs) {
+            ctx->failed = true;
+            return false;
+        }
+        ctx->refs = refs;
+        ctx->capacity = capacity;
+    }
+
+    if (ctx->count > 0 && entry->index < ctx->refs[ctx->count - 1].index) {
+        ctx->sorted = false;
+    }
+    ctx->refs[ctx->count].index = entry->index;
+    ctx->refs[ctx->count].id = id;
+    ctx->count++;
+    return true;
+}
+
+static int ref_compare(const void *a, const void *b)
+{
+    const entry_ref_s *ra = a;
+    const entry_ref_s *rb = b;
+    return (ra->index > rb->index) - (ra->index < rb->index);
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+playlist_format_t playlist_format(const char *name)
+{
+    const char *dot = strrchr(name, '.');
+    if (!dot || strchr(dot, '/')) {
+        return PLAYLIST_FORMAT_UNKNOWN;
+    }
+
+    if (strcasecmp(dot + 1, "m3u") == 0 || strcasecmp(dot + 1, "m3u8") == 0) {
+        return PLAYLIST_FORMAT_M3U;
+    }
+    if (strcasecmp(dot + 1, "pls") == 0) {
+        return PLAYLIST_FORMAT_PLS;
+    }
+    return PLAYLIST_FORMAT_UNKNOWN;
+}
+
+void playlist_parser_init(playlist_parser_s *parser, playlist_format_t format,
+                          playlist_entry_cb_t cb, void *user_data)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->format = format;
+    parser->duration_s = -1;
+    parser->cb = cb;
+    parser->user_data = user_data;
+}
+
+int playlist_parser_feed(playlist_parser_s *parser, const char *data, size_t len)
+{
+    const char *end = data + len;
+
+    while (data < end && !parser->stopped) {
+        // Copy up to the next line break in one go
+        const char *brk = data;
+        while (brk < end && *brk != '\n' && *brk != '\r') {
+            brk++;
+        }
+
+        size_t n = brk - data;
+        if (!parser->line_skip) {
+            if (parser->line_len + n < sizeof(parser->line)) {
+                memcpy(parser->line + parser->line_len, data, n);
+                parser->line_len += n;
+            } else {
+                parser->line_skip = true;
+            }
+        }
+
+        if (brk == end) {
+            break;
+        }
+
+        // "\r\n" ends the line at '\r', the '\n' then ends an empty one
+        on_line(parser);
+        if (*brk == '\n') {
+            parser->line_no++;
+        }
+        data = brk + 1;
+    }
+
+    return parser->stopped ? 1 : 0;
+}
+
+int playlist_parser_finish(playlist_parser_s *parser)
+{
+    if (!parser->stopped && (parser->line_len > 0 || parser->line_skip)) {
+        on_line(parser);
+    }
+    return parser->stopped ? 1 : 0;
+}
+
+int playlist_parse_file(const char *path, playlist_entry_cb_t cb, void *user_data)
+{
+    char chunk[PLAYLIST_CHUNK_SIZE];
+    int ret = 0;
+
+    playlist_format_t format = playlist_format(path);
+    if (format == PLAYLIST_FORMAT_UNKNOWN) {
+        LV_LOG_ERROR("Not a playlist: %s", path);
+        return -1;
+    }
+
+    // Plain POSIX I/O like the manifest, callable off the LVGL thread
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        LV_LOG_ERROR("Cannot open playlist: %s", path);
+        return -1;
+    }
+
+    playlist_parser_s *parser = malloc(sizeof(playlist_parser_s));
+    if (!parser) {
+        close(fd);
+        return -1;
+    }
+    playlist_parser_init(parser, format, cb, user_data);
+
+    while (ret == 0) {
+        ssize_t bytes_read = read(fd, chunk, sizeof(chunk));
+        if (bytes_read < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LV_LOG_ERROR("Playlist read failed: %s", path);
+            ret = -1;
+            break;
+        }
+        if (bytes_read == 0) {
+            playlist_parser_finish(parser);
+            break;
+        }
+        ret = playlist_parser_feed(parser, chunk, bytes_read);
+    }
+
+    close(fd);
+
+    int count = ret < 0 ? -1 : (int)parser->entry_count;
+    free(parser);
+    return count;
+}
+
+int playlist_load(playlist_s *playlist, track_store_s *store, const char *path)
+{
+    uint32_t start = lv_tick_get();
+    char full[PLAYLIST_PATH_MAX];
+
+    load_ctx_s *ctx = calloc(1, sizeof(load_ctx_s));
+    if (!ctx) {
+        return -1;
+    }
+    ctx->store = store;
+    ctx->sorted = true;
+
+    snprintf(full, sizeof(full), "%s/%s", store->root, path);
+    snprintf(ctx->dir, sizeof(ctx->dir), "%s", path);
+    char *slash = strrchr(ctx->dir, '/');
+    if (slash) {
+        *slash = '\0';
+    } else {
+        ctx->dir[0] = '\0';
+    }
+
+    int ret = playlist_parse_file(full, load_entry_cb, ctx);
+    if (ret < 0 || ctx->failed) {
+        if (ctx->failed) {
+            LV_LOG_ERROR("No memory for playlist %s", path);
+        }
+        free(ctx->refs);
+        free(ctx);
+        return -1;
+    }
+
+    // PLS numbers need not be in file order
+    if (!ctx->sorted) {
+        qsort(ctx->refs, ctx->count, sizeof(entry_ref_s), ref_compare);
+    }
+
+    // Ids packed over the refs in place, ids[i] only overwrites refs already read
+    track_id_t *ids = (track_id_t *)ctx->refs;
+    for (uint32_t i = 0; i < ctx->count; i++) {
+        ids[i] = ctx->refs[i].id;
+    }
+    if (ctx->count > 0) {
+        track_id_t *shrunk = realloc(ids, ctx->count * sizeof(track_id_t));
+        ids = shrunk ? shrunk : ids;
+    }
+
+    free(playlist->ids);
+    playlist->ids = ids;
+    playlist->count = ctx->count;
+    playlist->missing = ctx->missing;
+
+    LV_LOG_USER("Playlist %s: %lu tracks, %lu missing in %lu ms", path, (unsigned long)ctx->count,
+                (unsigned long)ctx->missing, (unsigned long)lv_tick_elaps(start));
+    LV_UNUSED(start);
+    free(ctx);
+    return 0;
+}
+
+void playlist_free(playlist_s *playlist)
+{
+    free(playlist->ids);
+    memset(playlist, 0, sizeof(*playlist));
+}
+
+int playlist_list_dir(const char *dir, playlist_name_cb_t cb, void *user_data)
+{
+    DIR *d = opendir(dir);
+    if (!d) {
+        return -1;
+    }
+
+    int count = 0;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (ent->d_name[0] == '.' || strlen(ent->d_name) >= PLAYLIST_NAME_MAX ||
+            playlist_format(ent->d_name) == PLAYLIST_FORMAT_UNKNOWN) {
+            continue;
+        }
+        cb(ent->d_name, user_data);
+        count++;
+    }
+    closedir(d);
+    return count;
+}
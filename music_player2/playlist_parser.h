@@ -0,0 +1,167 @@
+/**
+ * Playlist Parser Header
+ * Streaming M3U/M3U8 and PLS reader. Entries are resolved against the
+ * track store as they are parsed, so a saved playlist ends up as an
+ * array of track ids and no path is kept
+ */
+
+#ifndef PLAYLIST_PARSER_H
+#define PLAYLIST_PARSER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "track_store.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define PLAYLIST_CHUNK_SIZE 512      // Bytes read from the file per step
+#define PLAYLIST_LINE_MAX   512      // Longest line kept, longer lines are skipped
+#define PLAYLIST_TITLE_MAX  128      // Longest #EXTINF title kept, including NUL
+#define PLAYLIST_NAME_MAX   64       // Longest playlist file name listed, including NUL
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+typedef enum {
+    PLAYLIST_FORMAT_UNKNOWN,
+    PLAYLIST_FORMAT_M3U,             // .m3u and .m3u8, #EXTINF understood
+    PLAYLIST_FORMAT_PLS,             // .pls, FileN entries
+} playlist_format_t;
+
+/* One entry as written in the file, only valid during the callback */
+typedef struct {
+    const char *location;            // Path or URL
+    const char *title;               // #EXTINF title, "" if none (PLS titles are not reported)
+    int32_t duration_s;              // #EXTINF length, -1 if unknown
+    uint32_t index;                  // Position in the playlist, PLS entries may come in any order
+} playlist_entry_s;
+
+/**
+ * Entry callback
+ * @param entry Parsed entry
+ * @param user_data User pointer given to the parser
+ * @return true to continue, false to stop parsing
+ */
+typedef bool (*playlist_entry_cb_t)(const playlist_entry_s *entry, void *user_data);
+
+/**
+ * Playlist file callback of playlist_list_dir()
+ * @param name File name
+ * @param user_data User pointer
+ */
+typedef void (*playlist_name_cb_t)(const char *name, void *user_data);
+
+/* Parser state, fixed size regardless of the playlist length */
+typedef struct {
+    playlist_format_t format;
+    char line[PLAYLIST_LINE_MAX];
+    uint16_t line_len;
+    bool line_skip;                  // Current line is too long, dropped up to its end
+    uint32_t line_no;
+
+    // M3U: #EXTINF waiting for the location it describes
+    char title[PLAYLIST_TITLE_MAX];
+    int32_t duration_s;
+
+    playlist_entry_cb_t cb;
+    void *user_data;
+    uint32_t entry_count;
+    uint32_t skipped;                // Lines too long to parse
+    bool stopped;
+} playlist_parser_s;
+
+/* Saved playlist, compact track ids of one library version */
+typedef struct {
+    track_id_t *ids;                 // In playlist order, count entries
+    uint32_t count;
+    uint32_t missing;                // Entries not found in the library, left out
+    uint32_t version;                // Library version of the ids, set by the caller
+} playlist_s;
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Get the format of a playlist from its file name
+ * @param name File name or path
+ * @return Format, PLAYLIST_FORMAT_UNKNOWN if not a playlist
+ */
+playlist_format_t playlist_format(const char *name);
+
+/**
+ * @brief Prepare a parser
+ * @param parser Parser state
+ * @param format File format
+ * @param cb Called for every entry
+ * @param user_data Passed to cb
+ */
+void playlist_parser_init(playlist_parser_s *parser, playlist_format_t format,
+                          playlist_entry_cb_t cb, void *user_data);
+
+/**
+ * @brief Feed the next chunk of the file
+ * @param parser Parser state
+ * @param data Chunk bytes
+ * @param len Number of bytes
+ * @return 0 to continue, 1 when the callback stopped parsing
+ */
+int playlist_parser_feed(playlist_parser_s *parser, const char *data, size_t len);
+
+/**
+ * @brief Signal the end of the file, the last line may have no line break
+ * @param parser Parser state
+ * @return 0 to continue, 1 when the callback stopped parsing
+ */
+int playlist_parser_finish(playlist_parser_s *parser);
+
+/**
+ * @brief Parse a playlist file in PLAYLIST_CHUNK_SIZE steps
+ * @param path File path (POSIX path)
+ * @param cb Called for every entry
+ * @param user_data Passed to cb
+ * @return Number of entries reported, -1 if the file cannot be read or has no known format
+ */
+int playlist_parse_file(const char *path, playlist_entry_cb_t cb, void *user_data);
+
+/**
+ * @brief Read a playlist and resolve its entries to track ids
+ * @note Relative locations are taken from the playlist directory; absolute paths and
+ *       file:// URLs must be under the store root; streams are counted as missing.
+ *       Each entry costs one track_store_find() hash lookup
+ * @param playlist Filled on success, free with playlist_free()
+ * @param store Track store the ids refer to
+ * @param path Playlist file, relative to the store root
+ * @return 0 on success, -1 if the file cannot be read or on allocation failure
+ */
+int playlist_load(playlist_s *playlist, track_store_s *store, const char *path);
+
+/**
+ * @brief Free the ids of a playlist
+ * @param playlist Saved playlist, emptied
+ */
+void playlist_free(playlist_s *playlist);
+
+/**
+ * @brief List the playlist files of a directory, not recursing into subdirectories
+ * @param dir Directory (POSIX path)
+ * @param cb Called for each playlist file, in directory order
+ * @param user_data Passed to cb
+ * @return Number of playlists found, -1 if the directory cannot be opened
+ */
+int playlist_list_dir(const char *dir, playlist_name_cb_t cb, void *user_data);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* PLAYLIST_PARSER_H */
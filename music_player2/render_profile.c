@@ -0,0 +1,251 @@
+/**
+ * Render Profile
+ * Styles are rewritten in place and reported with
+ * lv_obj_report_style_change(), which refreshes and invalidates only the
+ * objects using them. The governor takes the refreshes that rendered
+ * something from frame_timing, idle refreshes would hide slow frames in
+ * the average, and reads the LVGL load from lv_timer_get_idle()
+ */
+
+#include <string.h>
+
+#include "render_profile.h"
+#include "audio_ctl.h"
+#include "frame_timing.h"
+
+#define RENDER_PROFILE_OVER_WINDOWS   2     // Windows over a threshold before switching to lite
+#define RENDER_PROFILE_QUIET_WINDOWS  5     // Quiet windows before switching back, doubled per switch
+#define RENDER_PROFILE_QUIET_MAX      320
+
+/* Registered style */
+typedef struct {
+    const char *name;
+    lv_style_t *style;
+    render_profile_apply_cb_t apply;
+} render_profile_style_s;
+
+// Variables
+static struct {
+    render_profile_t profile;
+    int count;
+    render_profile_style_s styles[RENDER_PROFILE_STYLES_MAX];
+
+    // Governor
+    bool running;
+    bool benchmarking;
+    lv_timer_t *timer;
+    render_profile_auto_s config;
+    uint64_t busy_us;
+    uint32_t frames;
+    uint32_t over_windows;
+    uint32_t quiet_windows;
+    uint32_t quiet_needed;
+} rp;
+
+// Functions
+static void apply_style(const render_profile_style_s *s, render_profile_t profile);
+static void switch_profile(render_profile_t profile);
+static void frame_timing_cb(uint32_t us, bool rendered, void *user_data);
+static void window_timer_cb(lv_timer_t *timer);
+static uint32_t measure(lv_display_t *disp, uint32_t frames);
+
+static void apply_style(const render_profile_style_s *s, render_profile_t profile)
+{
+    s->apply(s->style, profile);
+    lv_obj_report_style_change(s->style);
+}
+
+static void switch_profile(render_profile_t profile)
+{
+    rp.profile = profile;
+    for (int i = 0; i < rp.count; i++) {
+        apply_style(&rp.styles[i], profile);
+    }
+    rp.over_windows = 0;
+    rp.quiet_windows = 0;
+}
+
+static void frame_timing_cb(uint32_t us, bool rendered, void *user_data)
+{
+    LV_UNUSED(user_data);
+
+    if (rendered && !rp.benchmarking) {
+        rp.busy_us += us;
+        rp.frames++;
+    }
+}
+
+static void window_timer_cb(lv_timer_t *timer)
+{
+    LV_UNUSED(timer);
+
+    uint32_t frame_us = rp.frames ? (uint32_t)(rp.busy_us / rp.frames) : 0;
+    uint32_t cpu = 100 - lv_timer_get_idle();
+    rp.busy_us = 0;
+    rp.frames = 0;
+
+    uint32_t frame_limit_us = rp.config.frame_ms * 1000;
+    bool over = (frame_limit_us && frame_us > frame_limit_us) ||
+                (rp.config.cpu_pct && cpu > rp.config.cpu_pct);
+    // Well under the thresholds, lite frames are cheaper than full ones would be
+    bool quiet = (!frame_limit_us || frame_us < frame_limit_us / 2) &&
+                 (!rp.config.cpu_pct || cpu < rp.config.cpu_pct * 3 / 4);
+
+    if (rp.profile == RENDER_PROFILE_FULL) {
+        rp.over_windows = over ? rp.over_windows + 1 : 0;
+        if (rp.over_windows >= RENDER_PROFILE_OVER_WINDOWS) {
+            LV_LOG_USER("Render profile: lite (%lu us/frame, %lu%% load)",
+                        (unsigned long)frame_us, (unsigned long)cpu);
+            switch_profile(RENDER_PROFILE_LITE);
+            rp.quiet_needed = LV_MIN(rp.quiet_needed * 2, RENDER_PROFILE_QUIET_MAX);
+        }
+    } else {
+        rp.quiet_windows = quiet ? rp.quiet_windows + 1 : 0;
+        if (rp.quiet_windows >= rp.quiet_needed) {
+            LV_LOG_USER("Render profile: full (%lu us/frame, %lu%% load)",
+                        (unsigned long)frame_us, (unsigned long)cpu);
+            switch_profile(RENDER_PROFILE_FULL);
+        }
+    }
+}
+
+/* Average time of full-screen refreshes, after one to warm the caches */
+static uint32_t measure(lv_display_t *disp, uint32_t frames)
+{
+    lv_obj_t *screen = lv_display_get_screen_active(disp);
+    uint64_t total = 0;
+
+    for (uint32_t i = 0; i <= frames; i++) {
+        lv_obj_invalidate(screen);
+        uint64_t start = audio_ctl_clock_us();
+        lv_refr_now(disp);
+        if (i > 0) {
+            total += audio_ctl_clock_us() - start;
+        }
+    }
+    return frames ? (uint32_t)(total / frames) : 0;
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+void render_profile_init(render_profile_t profile)
+{
+    rp.profile = profile;
+    rp.count = 0;
+}
+
+int render_profile_register(const char *name, lv_style_t *style, render_profile_apply_cb_t apply)
+{
+    if (rp.count >= RENDER_PROFILE_STYLES_MAX) {
+        LV_LOG_ERROR("Render profile: no room for style %s", name);
+        return -1;
+    }
+
+    render_profile_style_s *s = &rp.styles[rp.count++];
+    s->name = name;
+    s->style = style;
+    s->apply = apply;
+    apply_style(s, rp.profile);
+    return 0;
+}
+
+void render_profile_set(render_profile_t profile)
+{
+    if (profile != rp.profile) {
+        switch_profile(profile);
+    }
+}
+
+render_profile_t render_profile_get(void)
+{
+    return rp.profile;
+}
+
+const char *render_profile_name(render_profile_t profile)
+{
+    return profile == RENDER_PROFILE_LITE ? "lite" : "full";
+}
+
+int render_profile_auto_start(lv_display_t *disp, const render_profile_auto_s *config)
+{
+    if (rp.running) {
+        return -1;
+    }
+
+    if (!disp) {
+        disp = lv_display_get_default();
+    }
+    if (!disp || !config || config->window_ms == 0) {
+        return -1;
+    }
+
+    if (frame_timing_subscribe(disp, frame_timing_cb, NULL) != 0) {
+        return -1;
+    }
+
+    rp.config = *config;
+    rp.busy_us = 0;
+    rp.frames = 0;
+    rp.over_windows = 0;
+    rp.quiet_windows = 0;
+    rp.quiet_needed = RENDER_PROFILE_QUIET_WINDOWS;
+    rp.timer = lv_timer_create(window_timer_cb, config->window_ms, NULL);
+    rp.running = true;
+    return 0;
+}
+
+void render_profile_auto_stop(void)
+{
+    if (!rp.running) {
+        return;
+    }
+
+    frame_timing_unsubscribe(frame_timing_cb, NULL);
+    lv_timer_delete(rp.timer);
+    rp.timer = NULL;
+    rp.running = false;
+}
+
+void render_profile_benchmark(lv_display_t *disp, uint32_t frames)
+{
+    if (!disp) {
+        disp = lv_display_get_default();
+    }
+    if (!disp || frames == 0) {
+        return;
+    }
+
+    render_profile_t saved = rp.profile;
+    rp.benchmarking = true;
+
+    switch_profile(RENDER_PROFILE_FULL);
+    uint32_t full_us = measure(disp, frames);
+    LV_LOG_USER("Render benchmark: full %lu us/frame over %lu frames",
+                (unsigned long)full_us, (unsigned long)frames);
+
+    // One style in lite at a time, the rest stays full
+    for (int i = 0; i < rp.count; i++) {
+        apply_style(&rp.styles[i], RENDER_PROFILE_LITE);
+        uint32_t us = measure(disp, frames);
+        apply_style(&rp.styles[i], RENDER_PROFILE_FULL);
+
+        int32_t saved_us = (int32_t)full_us - (int32_t)us;
+        LV_LOG_USER("Render benchmark:   %-18s lite %lu us/frame, saves %ld us (%ld%%)",
+                    rp.styles[i].name, (unsigned long)us, (long)saved_us,
+                    full_us ? (long)saved_us * 100 / (long)full_us : 0L);
+        LV_UNUSED(saved_us);
+    }
+
+    switch_profile(RENDER_PROFILE_LITE);
+    uint32_t lite_us = measure(disp, frames);
+    int32_t saved_us = (int32_t)full_us - (int32_t)lite_us;
+    LV_LOG_USER("Render benchmark: lite %lu us/frame, saves %ld us (%ld%%)",
+                (unsigned long)lite_us, (long)saved_us,
+                full_us ? (long)saved_us * 100 / (long)full_us : 0L);
+    LV_UNUSED(saved_us);
+
+    switch_profile(saved);
+    rp.benchmarking = false;
+}
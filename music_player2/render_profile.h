@@ -0,0 +1,120 @@
+/**
+ * Render Profile Header
+ * Shared styles come in a full and a lite variant. Each registered style
+ * has an apply function writing the properties of either variant, so the
+ * whole page changes profile at runtime by rewriting a few styles. An
+ * optional governor switches to lite when rendering gets too slow and
+ * back once there is headroom again
+ */
+
+#ifndef RENDER_PROFILE_H
+#define RENDER_PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <lvgl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define RENDER_PROFILE_STYLES_MAX  16
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+
+typedef enum {
+    RENDER_PROFILE_FULL = 0,   // Shadows, gradients and translucent panels
+    RENDER_PROFILE_LITE,       // Opaque flat fills
+} render_profile_t;
+
+/**
+ * Write the properties of one variant into a style
+ * @param style Style to update, the one given to render_profile_register()
+ * @param profile Variant to write
+ */
+typedef void (*render_profile_apply_cb_t)(lv_style_t *style, render_profile_t profile);
+
+/* Governor thresholds, checked once per window */
+typedef struct {
+    uint32_t frame_ms;         // Average rendered frame time that switches to lite, 0 to ignore
+    uint32_t cpu_pct;          // LVGL load that switches to lite, 0 to ignore
+    uint32_t window_ms;        // Measurement window
+} render_profile_auto_s;
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Set the profile styles start with, before registering them
+ * @param profile Initial profile
+ */
+void render_profile_init(render_profile_t profile);
+
+/**
+ * @brief Add a style to the profile set and write the current variant into it
+ * @note LVGL thread only. The style must be initialized and outlive the profile set
+ * @param name Name used in logs
+ * @param style Shared style
+ * @param apply Writes either variant
+ * @return 0 on success, -1 when RENDER_PROFILE_STYLES_MAX styles are registered
+ */
+int render_profile_register(const char *name, lv_style_t *style, render_profile_apply_cb_t apply);
+
+/**
+ * @brief Switch every registered style to a profile and refresh the objects using them
+ * @note LVGL thread only. The governor, when running, may switch again later
+ * @param profile New profile
+ */
+void render_profile_set(render_profile_t profile);
+
+/**
+ * @brief Get the current profile
+ * @return Profile the styles are in
+ */
+render_profile_t render_profile_get(void);
+
+/**
+ * @brief Get the name of a profile
+ * @param profile Profile
+ * @return "full" or "lite"
+ */
+const char *render_profile_name(render_profile_t profile);
+
+/**
+ * @brief Measure rendering on a display and switch profile with the load
+ * @note Switches to lite when a threshold is exceeded for two windows in a row, back to
+ *       full after a longer quiet spell that doubles with every switch to lite
+ * @param disp Display to measure, NULL for the default display
+ * @param config Thresholds, copied
+ * @return 0 on success, -1 if already running or without a display
+ */
+int render_profile_auto_start(lv_display_t *disp, const render_profile_auto_s *config);
+
+/**
+ * @brief Stop the governor, the current profile stays
+ */
+void render_profile_auto_stop(void);
+
+/**
+ * @brief Render the whole screen in the full profile, then with each style in turn
+ *        and all styles in lite, and log the time per frame of each
+ * @note LVGL thread only, blocks for about (styles + 2) * (frames + 1) refreshes. The
+ *       profile in use before is restored
+ * @param disp Display to render, NULL for the default display
+ * @param frames Refreshes per measurement
+ */
+void render_profile_benchmark(lv_display_t *disp, uint32_t frames);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* RENDER_PROFILE_H */
@@ -0,0 +1,313 @@
+/**
+ * Track Order
+ * A full sort compares precomputed 8-byte collation keys and folds the
+ * strings only when two keys tie; single changes fold on the fly, a
+ * binary search needs about twenty comparisons
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lvgl.h>
+
+#include "track_order.h"
+#include "track_search.h"
+
+/* Sort fields, compared in the sequence of each order */
+#define FIELD_TITLE  0
+#define FIELD_ARTIST 1
+#define FIELD_ALBUM  2
+#define FIELD_COUNT  3
+
+/* Collation key of empty fields, above every folded prefix */
+#define KEY_EMPTY UINT64_MAX
+
+static const uint8_t ORDER_FIELDS[TRACK_ORDER_COUNT][FIELD_COUNT] = {
+    [TRACK_ORDER_TITLE] = { FIELD_TITLE, FIELD_ARTIST, FIELD_ALBUM },
+    [TRACK_ORDER_ARTIST] = { FIELD_ARTIST, FIELD_ALBUM, FIELD_TITLE },
+    [TRACK_ORDER_ALBUM] = { FIELD_ALBUM, FIELD_ARTIST, FIELD_TITLE },
+};
+
+static const char *const ORDER_NAMES[TRACK_ORDER_COUNT] = {
+    [TRACK_ORDER_TITLE] = "Title",
+    [TRACK_ORDER_ARTIST] = "Artist",
+    [TRACK_ORDER_ALBUM] = "Album",
+};
+
+/* Comparison state of one order */
+typedef struct {
+    const track_store_s *store;
+    const uint8_t *fields;
+    const uint64_t *keys[FIELD_COUNT];   // Per track, NULL to fold every comparison
+} order_ctx_s;
+
+// Functions
+static const uint32_t *field_column(const track_store_s *store, int field);
+static uint64_t collation_key(const char *str);
+static int fold_compare(const char *a, const char *b);
+static int track_compare(const order_ctx_s *ctx, track_id_t a, track_id_t b);
+static void sort_ids(const order_ctx_s *ctx, track_id_t *ids, track_id_t *tmp, uint32_t count);
+static uint32_t lower_bound(const order_ctx_s *ctx, const track_id_t *ids, uint32_t count, track_id_t id);
+static uint32_t find_entry(const order_ctx_s *ctx, const track_id_t *ids, uint32_t count, track_id_t id,
+                           track_id_t entry);
+
+static const uint32_t *field_column(const track_store_s *store, int field)
+{
+    switch (field) {
+    case FIELD_TITLE:
+        return store->name;
+    case FIELD_ARTIST:
+        return store->artist;
+    default:
+        return store->album;
+    }
+}
+
+/* First 8 folded bytes, big-endian so integer order is byte order */
+static uint64_t collation_key(const char *str)
+{
+    // Room for a few characters past the 8th, so the prefix is never cut short
+    char folded[16];
+    size_t len = track_search_fold(str, folded, sizeof(folded));
+    if (len == 0) {
+        return KEY_EMPTY;
+    }
+
+    uint64_t key = 0;
+    for (size_t i = 0; i < 8; i++) {
+        key = (key << 8) | (i < len ? (uint8_t)folded[i] : 0);
+    }
+    return key;
+}
+
+static int fold_compare(const char *a, const char *b)
+{
+    char fa[TRACK_ORDER_FOLD_MAX];
+    char fb[TRACK_ORDER_FOLD_MAX];
+    size_t la = track_search_fold(a, fa, sizeof(fa));
+    size_t lb = track_search_fold(b, fb, sizeof(fb));
+
+    if (la == 0 || lb == 0) {
+        return (la == 0) - (lb == 0);
+    }
+    return strcmp(fa, fb);
+}
+
+static int track_compare(const order_ctx_s *ctx, track_id_t a, track_id_t b)
+{
+    const track_store_s *store = ctx->store;
+
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        int field = ctx->fields[i];
+        const uint32_t *column = field_column(store, field);
+
+        // Interned: the same offset is the same string
+        if (column[a] == column[b]) {
+            continue;
+        }
+
+        if (ctx->keys[field]) {
+            uint64_t ka = ctx->keys[field][a];
+            uint64_t kb = ctx->keys[field][b];
+            if (ka != kb) {
+                return ka < kb ? -1 : 1;
+            }
+        }
+
+        int c = fold_compare(track_store_str(store, column[a]), track_store_str(store, column[b]));
+        if (c != 0) {
+            return c;
+        }
+    }
+
+    // Paths are unique and, unlike ids, survive track_store_remove()
+    return strcmp(track_store_path(store, a), track_store_path(store, b));
+}
+
+/* Bottom-up merge sort, qsort() has no context argument */
+static void sort_ids(const order_ctx_s *ctx, track_id_t *ids, track_id_t *tmp, uint32_t count)
+{
+    track_id_t *src = ids;
+    track_id_t *dst = tmp;
+
+    for (uint32_t width = 1; width < count; width *= 2) {
+        for (uint32_t lo = 0; lo < count; lo += 2 * width) {
+            uint32_t mid = lo + width < count ? lo + width : count;
+            uint32_t hi = lo + 2 * width < count ? lo + 2 * width : count;
+            uint32_t i = lo;
+            uint32_t j = mid;
+            uint32_t k = lo;
+
+            while (i < mid && j < hi) {
+                dst[k++] = track_compare(ctx, src[j], src[i]) < 0 ? src[j++] : src[i++];
+            }
+            while (i < mid) {
+                dst[k++] = src[i++];
+            }
+            while (j < hi) {
+                dst[k++] = src[j++];
+            }
+        }
+
+        track_id_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != ids) {
+        memcpy(ids, src, count * sizeof(track_id_t));
+    }
+}
+
+/* First position whose track does not sort before id */
+static uint32_t lower_bound(const order_ctx_s *ctx, const track_id_t *ids, uint32_t count, track_id_t id)
+{
+    uint32_t lo = 0;
+    uint32_t hi = count;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (track_compare(ctx, ids[mid], id) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* Position of entry, located through the fields of id; count if missing */
+static uint32_t find_entry(const order_ctx_s *ctx, const track_id_t *ids, uint32_t count, track_id_t id,
+                           track_id_t entry)
+{
+    uint32_t pos = lower_bound(ctx, ids, count, id);
+    if (pos < count && ids[pos] == entry) {
+        return pos;
+    }
+
+    // Only reached if the order was not sorted, e.g. a damaged index
+    for (pos = 0; pos < count && ids[pos] != entry; pos++) {
+    }
+    return pos;
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+int track_order_build(track_store_s *store)
+{
+    uint32_t start = lv_tick_get();
+    uint32_t capacity = store->capacity > store->count ? store->capacity : store->count;
+    track_id_t *orders[TRACK_ORDER_COUNT] = { NULL };
+    uint64_t *keys[FIELD_COUNT] = { NULL };
+    bool ok = true;
+
+    track_id_t *tmp = malloc((capacity ? capacity : 1) * sizeof(track_id_t));
+    ok = tmp != NULL;
+    for (int i = 0; i < TRACK_ORDER_COUNT && ok; i++) {
+        orders[i] = malloc((capacity ? capacity : 1) * sizeof(track_id_t));
+        ok = orders[i] != NULL;
+    }
+    for (int f = 0; f < FIELD_COUNT && ok; f++) {
+        keys[f] = malloc((store->count ? store->count : 1) * sizeof(uint64_t));
+        ok = keys[f] != NULL;
+    }
+
+    if (ok) {
+        // Each key is folded once here instead of in every comparison
+        for (int f = 0; f < FIELD_COUNT; f++) {
+            const uint32_t *column = field_column(store, f);
+            for (track_id_t id = 0; id < store->count; id++) {
+                keys[f][id] = collation_key(track_store_str(store, column[id]));
+            }
+        }
+
+        for (int i = 0; i < TRACK_ORDER_COUNT; i++) {
+            order_ctx_s ctx = { store, ORDER_FIELDS[i], { keys[0], keys[1], keys[2] } };
+            for (track_id_t id = 0; id < store->count; id++) {
+                orders[i][id] = id;
+            }
+            sort_ids(&ctx, orders[i], tmp, store->count);
+        }
+    }
+
+    for (int f = 0; f < FIELD_COUNT; f++) {
+        free(keys[f]);
+    }
+    free(tmp);
+
+    if (!store->order_borrowed) {
+        for (int i = 0; i < TRACK_ORDER_COUNT; i++) {
+            free(store->order[i]);
+        }
+    }
+    store->order_borrowed = false;
+
+    if (!ok) {
+        for (int i = 0; i < TRACK_ORDER_COUNT; i++) {
+            free(orders[i]);
+            store->order[i] = NULL;
+        }
+        LV_LOG_ERROR("No memory to sort %lu tracks", (unsigned long)store->count);
+        return -1;
+    }
+
+    memcpy(store->order, orders, sizeof(orders));
+    LV_LOG_USER("Sorted %lu tracks in %lu ms", (unsigned long)store->count, (unsigned long)lv_tick_elaps(start));
+    LV_UNUSED(start);
+    return 0;
+}
+
+const track_id_t *track_order_ids(const track_store_s *store, track_order_t order)
+{
+    return store->order[order];
+}
+
+const char *track_order_name(track_order_t order)
+{
+    return ORDER_NAMES[order];
+}
+
+uint32_t track_order_group(const track_store_s *store, track_order_t order, track_id_t id)
+{
+    return field_column(store, ORDER_FIELDS[order][0])[id];
+}
+
+void track_order_insert(track_store_s *store, track_id_t id, uint32_t count)
+{
+    for (int i = 0; i < TRACK_ORDER_COUNT; i++) {
+        order_ctx_s ctx = { store, ORDER_FIELDS[i], { NULL } };
+        track_id_t *ids = store->order[i];
+
+        uint32_t pos = lower_bound(&ctx, ids, count, id);
+        memmove(ids + pos + 1, ids + pos, (count - pos) * sizeof(track_id_t));
+        ids[pos] = id;
+    }
+}
+
+void track_order_erase(track_store_s *store, track_id_t id, uint32_t count)
+{
+    for (int i = 0; i < TRACK_ORDER_COUNT; i++) {
+        order_ctx_s ctx = { store, ORDER_FIELDS[i], { NULL } };
+        track_id_t *ids = store->order[i];
+
+        uint32_t pos = find_entry(&ctx, ids, count, id, id);
+        if (pos < count) {
+            memmove(ids + pos, ids + pos + 1, (count - pos - 1) * sizeof(track_id_t));
+        }
+    }
+}
+
+void track_order_rename(track_store_s *store, track_id_t from, track_id_t to, uint32_t count)
+{
+    for (int i = 0; i < TRACK_ORDER_COUNT; i++) {
+        order_ctx_s ctx = { store, ORDER_FIELDS[i], { NULL } };
+        track_id_t *ids = store->order[i];
+
+        uint32_t pos = find_entry(&ctx, ids, count, to, from);
+        if (pos < count) {
+            ids[pos] = to;
+        }
+    }
+}
@@ -0,0 +1,98 @@
+/**
+ * Track Order Header
+ * Title, artist and album orderings of a track store as permutation
+ * arrays: sorted once when the library is built, stored in the library
+ * index and kept sorted by later changes, so browsing never sorts
+ */
+
+#ifndef TRACK_ORDER_H
+#define TRACK_ORDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "track_store.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define TRACK_ORDER_FOLD_MAX 256     // Folded bytes compared per string
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Sort the tracks of a store in every order
+ * @note Strings compare folded like the search (case and Latin diacritics ignored),
+ *       empty fields last, ties broken by path
+ * @param store Track store, its orders are replaced
+ * @return 0 on success, -1 on allocation failure (the store is left without orders)
+ */
+int track_order_build(track_store_s *store);
+
+/**
+ * @brief Get the track ids of a store in one order
+ * @param store Track store
+ * @param order Order
+ * @return store->count track ids, NULL if the store has not been sorted
+ */
+const track_id_t *track_order_ids(const track_store_s *store, track_order_t order);
+
+/**
+ * @brief Get the name of an order for display
+ * @param order Order
+ * @return Static string
+ */
+const char *track_order_name(track_order_t order);
+
+/**
+ * @brief Get the field a track is grouped by in an order
+ * @param store Track store
+ * @param order Order
+ * @param id Track id
+ * @return Arena offset of the field, equal for tracks of the same group
+ */
+uint32_t track_order_group(const track_store_s *store, track_order_t order, track_id_t id);
+
+/*
+ * Maintenance of built orders, called by the track store. Each one costs a
+ * binary search and a memmove per order
+ */
+
+/**
+ * @brief Insert a track into every order
+ * @param store Track store holding the track
+ * @param id Track id
+ * @param count Entries in the orders before the insertion
+ */
+void track_order_insert(track_store_s *store, track_id_t id, uint32_t count);
+
+/**
+ * @brief Remove a track from every order, its fields must be unchanged since it was inserted
+ * @param store Track store holding the track
+ * @param id Track id
+ * @param count Entries in the orders before the removal
+ */
+void track_order_erase(track_store_s *store, track_id_t id, uint32_t count);
+
+/**
+ * @brief Rename a track that moved to another id with the same fields
+ * @param store Track store, the fields are already at the new id
+ * @param from Old id
+ * @param to New id
+ * @param count Entries in the orders
+ */
+void track_order_rename(track_store_s *store, track_id_t from, track_id_t to, uint32_t count);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* TRACK_ORDER_H */
@@ -0,0 +1,492 @@
+/**
+ * Track Search
+ * Besides the trigrams of the text, every track is listed under marker
+ * keys for the first one and two bytes of its title and of each word.
+ * A query reads at most three lists, best rank first: title starts, word
+ * starts, then the rarest trigram, stopping as soon as it has enough
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "track_search.h"
+
+#define TRACK_SEARCH_MIN_BUCKETS_BITS 12
+#define TRACK_SEARCH_MAX_BUCKETS_BITS 18
+
+/* Marker bytes of the prefix keys, folded text never contains control characters */
+#define KEY_TITLE '\x1d'
+#define KEY_WORD  '\x1e'
+
+/* Match ranks, best first */
+#define RANK_TITLE    0
+#define RANK_WORD     1
+#define RANK_ANYWHERE 2
+
+/* Latin-1 Supplement U+00C0..U+00FF without diacritics, '.' keeps the character */
+static const char LATIN1_FOLD[64] =
+    "aaaaaa.ceeeeiiii" "dnooooo.ouuuuy.."
+    "aaaaaa.ceeeeiiii" "dnooooo.ouuuuy.y";
+
+/* Latin Extended-A U+0100..U+017F */
+static const char LATIN_EXT_A_FOLD[128] =
+    "aaaaaaccccccccddddeeeeeeeeeegggggggghhhhiiiiiiiiiiiijjkkklllllll"
+    "lllnnnnnnnnnoooooooorrrrrrssssssssttttttuuuuuuuuuuuuwwyyyzzzzzzs";
+
+/* Results of one query, per rank */
+typedef struct {
+    track_id_t ids[3][TRACK_SEARCH_RESULTS_MAX];
+    int count[3];
+    int max;                     // Total wanted over all ranks
+} search_results_s;
+
+// Functions
+static uint32_t utf8_next(const char **str);
+static size_t utf8_encode(uint32_t cp, char *out);
+static size_t fold_char(uint32_t cp, char *out);
+static size_t fold_append(char *out, const char *str);
+static uint32_t trigram_bucket(const track_search_s *search, const char *p);
+static void prefix_key(char *key, char marker, const char *str, size_t len);
+static bool is_word_start(const char *text, uint32_t i);
+static void postings_add(track_search_s *search, uint32_t *last, uint32_t *slot, bool fill, track_id_t id,
+                         const char *key);
+static void index_track(track_search_s *search, uint32_t *last, uint32_t *slot, bool fill, track_id_t id);
+static const char *find_bytes(const char *hay, size_t hay_len, const char *needle, size_t needle_len);
+static int match_rank(const char *text, size_t len, const char *query, size_t query_len);
+static uint32_t bucket_size(const track_search_s *search, uint32_t bucket);
+static void collect(const track_search_s *search, uint32_t bucket, const char *query, size_t len, int first,
+                    int last, search_results_s *results);
+
+/* Decode one character, invalid bytes come out as '?' */
+static uint32_t utf8_next(const char **str)
+{
+    const uint8_t *p = (const uint8_t *)*str;
+    uint32_t cp = p[0];
+
+    if (cp >= 0xf0 && (p[1] & 0xc0) == 0x80 && (p[2] & 0xc0) == 0x80 && (p[3] & 0xc0) == 0x80) {
+        cp = ((cp & 0x07) << 18) | ((p[1] & 0x3f) << 12) | ((p[2] & 0x3f) << 6) | (p[3] & 0x3f);
+        *str += 4;
+    } else if (cp >= 0xe0 && cp < 0xf0 && (p[1] & 0xc0) == 0x80 && (p[2] & 0xc0) == 0x80) {
+        cp = ((cp & 0x0f) << 12) | ((p[1] & 0x3f) << 6) | (p[2] & 0x3f);
+        *str += 3;
+    } else if (cp >= 0xc0 && cp < 0xe0 && (p[1] & 0xc0) == 0x80) {
+        cp = ((cp & 0x1f) << 6) | (p[1] & 0x3f);
+        *str += 2;
+    } else {
+        cp = cp < 0x80 ? cp : '?';
+        *str += 1;
+    }
+    return cp;
+}
+
+static size_t utf8_encode(uint32_t cp, char *out)
+{
+    if (cp < 0x80) {
+        out[0] = cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = 0xc0 | (cp >> 6);
+        out[1] = 0x80 | (cp & 0x3f);
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = 0xe0 | (cp >> 12);
+        out[1] = 0x80 | ((cp >> 6) & 0x3f);
+        out[2] = 0x80 | (cp & 0x3f);
+        return 3;
+    }
+    out[0] = 0xf0 | (cp >> 18);
+    out[1] = 0x80 | ((cp >> 12) & 0x3f);
+    out[2] = 0x80 | ((cp >> 6) & 0x3f);
+    out[3] = 0x80 | (cp & 0x3f);
+    return 4;
+}
+
+/* Never longer than the UTF-8 input, so text can be sized from the source strings */
+static size_t fold_char(uint32_t cp, char *out)
+{
+    if (cp < 0x80) {
+        // Control characters would collide with the field separator
+        out[0] = cp < 0x20 ? ' ' : (cp >= 'A' && cp <= 'Z') ? cp + 32 : cp;
+        return 1;
+    }
+
+    switch (cp) {
+    case 0xc6: case 0xe6:
+        memcpy(out, "ae", 2);
+        return 2;
+    case 0xdf:
+        memcpy(out, "ss", 2);
+        return 2;
+    case 0x152: case 0x153:
+        memcpy(out, "oe", 2);
+        return 2;
+    case 0x3000:
+        out[0] = ' ';
+        return 1;
+    default:
+        break;
+    }
+
+    if (cp >= 0xc0 && cp <= 0xff && LATIN1_FOLD[cp - 0xc0] != '.') {
+        out[0] = LATIN1_FOLD[cp - 0xc0];
+        return 1;
+    }
+    if (cp >= 0x100 && cp <= 0x17f) {
+        out[0] = LATIN_EXT_A_FOLD[cp - 0x100];
+        return 1;
+    }
+    if (cp >= 0xff01 && cp <= 0xff5e) {
+        // Full-width forms typed by CJK input methods
+        return fold_char(cp - 0xfee0, out);
+    }
+
+    // Greek and Cyrillic capitals
+    if (cp >= 0x391 && cp <= 0x3a9 && cp != 0x3a2) {
+        cp += 0x20;
+    } else if (cp >= 0x410 && cp <= 0x42f) {
+        cp += 0x20;
+    } else if (cp >= 0x400 && cp <= 0x40f) {
+        cp += 0x50;
+    }
+    return utf8_encode(cp, out);
+}
+
+static size_t fold_append(char *out, const char *str)
+{
+    size_t len = 0;
+    while (*str) {
+        len += fold_char(utf8_next(&str), out + len);
+    }
+    return len;
+}
+
+static uint32_t trigram_bucket(const track_search_s *search, const char *p)
+{
+    const uint8_t *b = (const uint8_t *)p;
+    uint32_t key = ((uint32_t)b[0] << 16) | ((uint32_t)b[1] << 8) | b[2];
+    return (key * 2654435761u) >> search->bucket_shift;
+}
+
+/* Marker plus the first one or two bytes: "MMa" or "Mab" */
+static void prefix_key(char *key, char marker, const char *str, size_t len)
+{
+    key[0] = marker;
+    key[1] = len >= 2 ? str[0] : marker;
+    key[2] = len >= 2 ? str[1] : str[0];
+}
+
+/* Words start after a field separator, a space or ASCII punctuation */
+static bool is_word_start(const char *text, uint32_t i)
+{
+    uint8_t c = text[i];
+    if (c == TRACK_SEARCH_FIELD_SEP || c == '\0' || (c < 0x80 && !isalnum(c))) {
+        return false;
+    }
+    if (i == 0) {
+        return true;
+    }
+    uint8_t prev = text[i - 1];
+    return prev == TRACK_SEARCH_FIELD_SEP || (prev < 0x80 && !isalnum(prev));
+}
+
+/* Tracks are added in id order, so each list stays sorted and lists a track once */
+static void postings_add(track_search_s *search, uint32_t *last, uint32_t *slot, bool fill, track_id_t id,
+                         const char *key)
+{
+    uint32_t b = trigram_bucket(search, key);
+    if (last[b] == id + 1) {
+        return;
+    }
+    last[b] = id + 1;
+    if (fill) {
+        search->postings[slot[b]++] = id;
+    } else {
+        slot[b]++;
+    }
+}
+
+static void index_track(track_search_s *search, uint32_t *last, uint32_t *slot, bool fill, track_id_t id)
+{
+    const char *text = search->text + search->text_offset[id];
+    uint32_t len = search->text_offset[id + 1] - search->text_offset[id] - 1;
+    char key[3];
+
+    for (uint32_t i = 0; i < len; i++) {
+        // Bytes up to the end of the current field
+        uint32_t rest = 0;
+        while (rest < 2 && i + rest < len && text[i + rest] != TRACK_SEARCH_FIELD_SEP) {
+            rest++;
+        }
+
+        if (is_word_start(text, i)) {
+            for (size_t n = 1; n <= rest; n++) {
+                if (i == 0) {
+                    prefix_key(key, KEY_TITLE, text, n);
+                    postings_add(search, last, slot, fill, id, key);
+                }
+                prefix_key(key, KEY_WORD, text + i, n);
+                postings_add(search, last, slot, fill, id, key);
+            }
+        }
+
+        if (i + 3 <= len && text[i] != TRACK_SEARCH_FIELD_SEP && text[i + 1] != TRACK_SEARCH_FIELD_SEP &&
+            text[i + 2] != TRACK_SEARCH_FIELD_SEP) {
+            postings_add(search, last, slot, fill, id, text + i);
+        }
+    }
+}
+
+static const char *find_bytes(const char *hay, size_t hay_len, const char *needle, size_t needle_len)
+{
+    const char *end = hay + hay_len;
+
+    while ((size_t)(end - hay) >= needle_len) {
+        hay = memchr(hay, needle[0], end - hay - needle_len + 1);
+        if (!hay) {
+            return NULL;
+        }
+        if (memcmp(hay, needle, needle_len) == 0) {
+            return hay;
+        }
+        hay++;
+    }
+    return NULL;
+}
+
+/* Best rank of the query in one track's text, -1 if it does not occur */
+static int match_rank(const char *text, size_t len, const char *query, size_t query_len)
+{
+    int rank = -1;
+    const char *p = text;
+
+    while ((p = find_bytes(p, text + len - p, query, query_len)) != NULL) {
+        if (p == text) {
+            return RANK_TITLE;
+        }
+        if (is_word_start(text, p - text)) {
+            return RANK_WORD;
+        }
+        rank = RANK_ANYWHERE;
+        p++;
+    }
+    return rank;
+}
+
+static uint32_t bucket_size(const track_search_s *search, uint32_t bucket)
+{
+    return search->bucket_start[bucket + 1] - search->bucket_start[bucket];
+}
+
+/*
+ * Verify the tracks of one list, keeping those whose best match ranks from first to last.
+ * Stops once max results rank first or better, nothing later in the list can beat them
+ */
+static void collect(const track_search_s *search, uint32_t bucket, const char *query, size_t len, int first,
+                    int last, search_results_s *results)
+{
+    for (uint32_t k = search->bucket_start[bucket]; k < search->bucket_start[bucket + 1]; k++) {
+        int settled = 0;
+        for (int rank = 0; rank <= first; rank++) {
+            settled += results->count[rank];
+        }
+        if (settled >= results->max) {
+            return;
+        }
+
+        track_id_t id = search->postings[k];
+        const char *text = search->text + search->text_offset[id];
+        int rank = match_rank(text, search->text_offset[id + 1] - search->text_offset[id] - 1, query, len);
+        if (rank >= first && rank <= last && results->count[rank] < results->max) {
+            results->ids[rank][results->count[rank]++] = id;
+        }
+    }
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+int track_search_build(track_search_s *search, const track_store_s *store)
+{
+    memset(search, 0, sizeof(*search));
+    search->count = store->count;
+
+    // Folding never grows a string, size the text from the sources
+    size_t text_size = 0;
+    for (track_id_t id = 0; id < store->count; id++) {
+        text_size += strlen(track_store_name(store, id)) + strlen(track_store_artist(store, id)) +
+                     strlen(track_store_album(store, id)) + 3;
+    }
+    if (text_size >= UINT32_MAX) {
+        return -1;
+    }
+
+    search->text = malloc(text_size + 1);
+    search->text_offset = malloc(((size_t)store->count + 1) * sizeof(uint32_t));
+    if (!search->text || !search->text_offset) {
+        goto errout;
+    }
+
+    uint32_t pos = 0;
+    for (track_id_t id = 0; id < store->count; id++) {
+        search->text_offset[id] = pos;
+        pos += fold_append(search->text + pos, track_store_name(store, id));
+        search->text[pos++] = TRACK_SEARCH_FIELD_SEP;
+        pos += fold_append(search->text + pos, track_store_artist(store, id));
+        search->text[pos++] = TRACK_SEARCH_FIELD_SEP;
+        pos += fold_append(search->text + pos, track_store_album(store, id));
+        search->text[pos++] = '\0';
+    }
+    search->text_offset[store->count] = pos;
+    search->text_size = pos;
+
+    // About one bucket per track keeps collisions rare for typical tags
+    uint32_t bits = TRACK_SEARCH_MIN_BUCKETS_BITS;
+    while (bits < TRACK_SEARCH_MAX_BUCKETS_BITS && (1u << bits) < store->count) {
+        bits++;
+    }
+    search->bucket_count = 1u << bits;
+    search->bucket_shift = 32 - bits;
+
+    // last[] holds id + 1 of the latest track counted per bucket, listing each track once
+    search->bucket_start = calloc(search->bucket_count + 1, sizeof(uint32_t));
+    uint32_t *last = calloc(search->bucket_count, sizeof(uint32_t));
+    if (!search->bucket_start || !last) {
+        free(last);
+        goto errout;
+    }
+
+    for (int pass = 0; pass < 2; pass++) {
+        uint32_t *slot = search->bucket_start;
+        if (pass == 1) {
+            // Prefix sums, then count up to the final starts while filling
+            uint32_t total = 0;
+            for (uint32_t b = 0; b <= search->bucket_count; b++) {
+                uint32_t n = slot[b];
+                slot[b] = total;
+                total += n;
+            }
+            search->postings = malloc((size_t)(total ? total : 1) * sizeof(uint32_t));
+            if (!search->postings) {
+                free(last);
+                goto errout;
+            }
+            memset(last, 0, search->bucket_count * sizeof(uint32_t));
+        }
+
+        for (track_id_t id = 0; id < store->count; id++) {
+            index_track(search, last, slot, pass == 1, id);
+        }
+    }
+    free(last);
+
+    // Filling advanced every start to the next bucket's, shift them back
+    memmove(search->bucket_start + 1, search->bucket_start, search->bucket_count * sizeof(uint32_t));
+    search->bucket_start[0] = 0;
+    return 0;
+
+errout:
+    track_search_deinit(search);
+    return -1;
+}
+
+void track_search_deinit(track_search_s *search)
+{
+    free(search->text);
+    free(search->text_offset);
+    free(search->bucket_start);
+    free(search->postings);
+    memset(search, 0, sizeof(*search));
+}
+
+int track_search_query(const track_search_s *search, const char *query, track_id_t *results, int max)
+{
+    char folded[TRACK_SEARCH_QUERY_MAX + 4];
+    search_results_s found;
+    char key[3];
+
+    // Leading blanks cannot start a word
+    size_t len = track_search_fold(query, folded, sizeof(folded));
+    char *q = folded;
+    while (*q == ' ') {
+        q++;
+        len--;
+    }
+    if (len == 0 || max <= 0 || search->count == 0) {
+        return 0;
+    }
+
+    found.count[0] = found.count[1] = found.count[2] = 0;
+    found.max = max < TRACK_SEARCH_RESULTS_MAX ? max : TRACK_SEARCH_RESULTS_MAX;
+
+    prefix_key(key, KEY_TITLE, q, len);
+    uint32_t title = trigram_bucket(search, key);
+    prefix_key(key, KEY_WORD, q, len);
+    uint32_t word = trigram_bucket(search, key);
+
+    // Every match contains every query trigram, the rarest one has the fewest candidates
+    uint32_t rarest = 0;
+    uint32_t rarest_size = UINT32_MAX;
+    for (size_t i = 0; i + 3 <= len; i++) {
+        uint32_t b = trigram_bucket(search, q + i);
+        if (bucket_size(search, b) < rarest_size) {
+            rarest = b;
+            rarest_size = bucket_size(search, b);
+        }
+    }
+
+    if (rarest_size < bucket_size(search, title) + bucket_size(search, word)) {
+        // Rare query, ranking all its candidates is cheaper than walking the prefix lists
+        collect(search, rarest, q, len, RANK_TITLE, RANK_ANYWHERE, &found);
+    } else {
+        collect(search, title, q, len, RANK_TITLE, RANK_TITLE, &found);
+        collect(search, word, q, len, RANK_WORD, RANK_WORD, &found);
+        if (len >= 3) {
+            collect(search, rarest, q, len, RANK_ANYWHERE, RANK_ANYWHERE, &found);
+        }
+    }
+
+    int count = 0;
+    for (int rank = 0; rank < 3; rank++) {
+        for (int i = 0; i < found.count[rank] && count < found.max; i++) {
+            results[count++] = found.ids[rank][i];
+        }
+    }
+    return count;
+}
+
+size_t track_search_fold(const char *str, char *out, size_t size)
+{
+    char buf[4];
+    size_t len = 0;
+
+    if (size == 0) {
+        return 0;
+    }
+
+    // Stop before a character that does not fit, never split one
+    while (*str) {
+        size_t n = fold_char(utf8_next(&str), buf);
+        if (len + n >= size) {
+            break;
+        }
+        memcpy(out + len, buf, n);
+        len += n;
+    }
+    out[len] = '\0';
+    return len;
+}
+
+size_t track_search_memory(const track_search_s *search)
+{
+    if (!search->text) {
+        return 0;
+    }
+    return search->text_size + ((size_t)search->count + 1) * sizeof(uint32_t) +
+           ((size_t)search->bucket_count + 1) * sizeof(uint32_t) +
+           (size_t)search->bucket_start[search->bucket_count] * sizeof(uint32_t);
+}
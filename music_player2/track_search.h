@@ -0,0 +1,99 @@
+/**
+ * Track Search Header
+ * Substring search over title, artist and album: the strings are folded
+ * (case, Latin diacritics, full-width forms) and every byte trigram of the
+ * folded text points to the tracks containing it
+ */
+
+#ifndef TRACK_SEARCH_H
+#define TRACK_SEARCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "track_store.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define TRACK_SEARCH_RESULTS_MAX 64      // Largest top-N of a query
+#define TRACK_SEARCH_QUERY_MAX   128     // Folded query bytes considered
+#define TRACK_SEARCH_FIELD_SEP   '\x1f'  // Between the fields of one track
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+typedef struct {
+    uint32_t count;              // Tracks indexed
+
+    // Folded "title<SEP>artist<SEP>album" per track, NUL-terminated, back to back
+    char *text;
+    uint32_t *text_offset;       // count + 1 entries
+    uint32_t text_size;
+
+    // Hash buckets of trigrams and title/word prefixes, each a sorted list of track ids in postings
+    uint32_t *bucket_start;      // bucket_count + 1 entries
+    uint32_t *postings;
+    uint32_t bucket_count;       // Power of two
+    uint32_t bucket_shift;
+} track_search_s;
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Index every track of a store
+ * @param search Output
+ * @param store Track store, only read; the index does not follow later changes
+ * @return 0 on success, -1 on allocation failure
+ */
+int track_search_build(track_search_s *search, const track_store_s *store);
+
+/**
+ * @brief Free an index
+ * @param search Index, may be zeroed
+ */
+void track_search_deinit(track_search_s *search);
+
+/**
+ * @brief Find the best matches of a query
+ * @param search Index
+ * @param query UTF-8 text, folded like the index
+ * @param results Output track ids, best first: titles starting with the query,
+ *                then matches at a word start, then anywhere, each in id order;
+ *                queries shorter than three bytes only match at word starts
+ * @param max Size of results, at most TRACK_SEARCH_RESULTS_MAX
+ * @return Number of results, 0 for an empty query
+ */
+int track_search_query(const track_search_s *search, const char *query, track_id_t *results, int max);
+
+/**
+ * @brief Fold a string for comparison: lower case, Latin letters without diacritics,
+ *        full-width ASCII as ASCII; other characters (e.g. CJK) are kept
+ * @param str UTF-8 input
+ * @param out Output, always NUL-terminated
+ * @param size Output size
+ * @return Length of the output
+ */
+size_t track_search_fold(const char *str, char *out, size_t size);
+
+/**
+ * @brief Get the heap memory used by an index
+ * @param search Index
+ * @return Bytes
+ */
+size_t track_search_memory(const track_search_s *search);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* TRACK_SEARCH_H */
@@ -0,0 +1,652 @@
+/**
+ * Track Store
+ * Columns grow by doubling; strings are interned through an FNV-1a hash
+ * so repeated artists, albums and covers are stored once
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <lvgl.h>
+
+#include "track_store.h"
+#include "track_order.h"
+
+#define TRACK_STORE_MIN_TRACKS 16
+#define TRACK_STORE_MIN_ARENA  1024
+
+// Functions
+static uint32_t str_hash(const char *str, size_t len);
+static int columns_grow(track_store_s *store, uint32_t capacity);
+static int arena_grow(track_store_s *store, uint32_t needed);
+static int intern_grow(track_store_s *store);
+static uint32_t arena_append(track_store_s *store, const char *str, size_t len);
+static void intern_insert(track_store_s *store, uint32_t offset);
+static void orders_free(track_store_s *store);
+static int path_index_build(track_store_s *store, uint32_t capacity);
+static void path_index_insert(track_store_s *store, track_id_t id);
+static void path_index_erase(track_store_s *store, track_id_t id);
+
+/* FNV-1a */
+static uint32_t str_hash(const char *str, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int columns_grow(track_store_s *store, uint32_t capacity)
+{
+    uint32_t **columns[] = {
+        &store->path, &store->name, &store->artist, &store->album,
+        &store->cover, &store->duration_ms, &store->color,
+    };
+
+    for (size_t i = 0; i < sizeof(columns) / sizeof(columns[0]); i++) {
+        uint32_t *column = realloc(*columns[i], capacity * sizeof(uint32_t));
+        if (!column) {
+            // Columns already grown stay larger, capacity is only raised on success
+            return -1;
+        }
+        *columns[i] = column;
+    }
+
+    // Built orders have a slot per track of capacity
+    for (int i = 0; i < TRACK_ORDER_COUNT; i++) {
+        if (store->order[i]) {
+            track_id_t *order = realloc(store->order[i], capacity * sizeof(track_id_t));
+            if (!order) {
+                return -1;
+            }
+            store->order[i] = order;
+        }
+    }
+
+    store->capacity = capacity;
+    return 0;
+}
+
+static int arena_grow(track_store_s *store, uint32_t needed)
+{
+    uint32_t capacity = store->arena_capacity ? store->arena_capacity : TRACK_STORE_MIN_ARENA;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+
+    char *arena = realloc(store->arena, capacity);
+    if (!arena) {
+        return -1;
+    }
+
+    store->arena = arena;
+    store->arena_capacity = capacity;
+    return 0;
+}
+
+static int intern_grow(track_store_s *store)
+{
+    uint32_t capacity = store->intern_capacity ? store->intern_capacity * 2 : 256;
+    uint32_t *table = calloc(capacity, sizeof(uint32_t));
+    if (!table) {
+        return -1;
+    }
+
+    // Rehash existing strings
+    for (uint32_t i = 0; i < store->intern_capacity; i++) {
+        uint32_t entry = store->intern[i];
+        if (entry == 0) {
+            continue;
+        }
+        const char *str = store->arena + entry - 1;
+        uint32_t slot = str_hash(str, strlen(str)) & (capacity - 1);
+        while (table[slot] != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        table[slot] = entry;
+    }
+
+    free(store->intern);
+    store->intern = table;
+    store->intern_capacity = capacity;
+    return 0;
+}
+
+static uint32_t arena_append(track_store_s *store, const char *str, size_t len)
+{
+    if (store->arena_size + len + 1 > store->arena_capacity &&
+        arena_grow(store, store->arena_size + len + 1) != 0) {
+        return TRACK_STR_EMPTY;
+    }
+
+    uint32_t offset = store->arena_size;
+    memcpy(store->arena + offset, str, len);
+    store->arena[offset + len] = '\0';
+    store->arena_size += len + 1;
+    return offset;
+}
+
+/* Register an arena string that is known not to be interned yet */
+static void intern_insert(track_store_s *store, uint32_t offset)
+{
+    const char *str = store->arena + offset;
+    uint32_t mask = store->intern_capacity - 1;
+    uint32_t slot = str_hash(str, strlen(str)) & mask;
+
+    while (store->intern[slot] != 0) {
+        if (store->intern[slot] == offset + 1) {
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+    store->intern[slot] = offset + 1;
+    store->intern_count++;
+}
+
+static void orders_free(track_store_s *store)
+{
+    for (int i = 0; i < TRACK_ORDER_COUNT; i++) {
+        if (!store->order_borrowed) {
+            free(store->order[i]);
+        }
+        store->order[i] = NULL;
+    }
+    store->order_borrowed = false;
+}
+
+static int path_index_build(track_store_s *store, uint32_t capacity)
+{
+    uint32_t *table = calloc(capacity, sizeof(uint32_t));
+    if (!table) {
+        return -1;
+    }
+
+    free(store->path_index);
+    store->path_index = table;
+    store->path_index_capacity = capacity;
+    for (track_id_t id = 0; id < store->count; id++) {
+        path_index_insert(store, id);
+    }
+    return 0;
+}
+
+static void path_index_insert(track_store_s *store, track_id_t id)
+{
+    const char *path = track_store_path(store, id);
+    uint32_t mask = store->path_index_capacity - 1;
+    uint32_t slot = str_hash(path, strlen(path)) & mask;
+
+    while (store->path_index[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    store->path_index[slot] = id + 1;
+}
+
+/* Linear probing delete: pull later entries of the cluster back into the hole */
+static void path_index_erase(track_store_s *store, track_id_t id)
+{
+    const char *path = track_store_path(store, id);
+    uint32_t mask = store->path_index_capacity - 1;
+    uint32_t slot = str_hash(path, strlen(path)) & mask;
+
+    while (store->path_index[slot] != id + 1) {
+        if (store->path_index[slot] == 0) {
+            return;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    uint32_t hole = slot;
+    for (;;) {
+        store->path_index[hole] = 0;
+        uint32_t next = hole;
+        for (;;) {
+            next = (next + 1) & mask;
+            uint32_t entry = store->path_index[next];
+            if (entry == 0) {
+                return;
+            }
+            const char *other = track_store_path(store, entry - 1);
+            uint32_t home = str_hash(other, strlen(other)) & mask;
+            // Move the entry unless its home lies cyclically in (hole, next]
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                store->path_index[hole] = entry;
+                hole = next;
+                break;
+            }
+        }
+    }
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+int track_store_init(track_store_s *store, const char *root)
+{
+    memset(store, 0, sizeof(*store));
+
+    if (root) {
+        snprintf(store->root, sizeof(store->root), "%s", root);
+    }
+
+    // Offset 0 is the shared empty string
+    if (arena_grow(store, TRACK_STORE_MIN_ARENA) != 0) {
+        return -1;
+    }
+    store->arena[0] = '\0';
+    store->arena_size = 1;
+    return 0;
+}
+
+void track_store_deinit(track_store_s *store)
+{
+    if (store->borrowed) {
+        free(store->intern);
+        free(store->path_index);
+        orders_free(store);
+        if (store->release) {
+            store->release(store->owner);
+        }
+        memset(store, 0, sizeof(*store));
+        return;
+    }
+
+    free(store->path);
+    free(store->name);
+    free(store->artist);
+    free(store->album);
+    free(store->cover);
+    free(store->duration_ms);
+    free(store->color);
+    free(store->arena);
+    free(store->intern);
+    free(store->path_index);
+    orders_free(store);
+    memset(store, 0, sizeof(*store));
+}
+
+void track_store_clear(track_store_s *store)
+{
+    if (store->borrowed) {
+        // Forget the external memory and start over with an own arena
+        char root[TRACK_ROOT_MAX];
+        memcpy(root, store->root, sizeof(root));
+        track_store_deinit(store);
+        track_store_init(store, NULL);
+        memcpy(store->root, root, sizeof(root));
+        return;
+    }
+
+    store->count = 0;
+    store->arena_size = store->arena ? 1 : 0;
+    store->intern_count = 0;
+    if (store->intern) {
+        memset(store->intern, 0, store->intern_capacity * sizeof(uint32_t));
+    }
+    free(store->path_index);
+    store->path_index = NULL;
+    store->path_index_capacity = 0;
+    orders_free(store);
+}
+
+int track_store_reserve(track_store_s *store, uint32_t capacity)
+{
+    if (capacity <= store->capacity) {
+        return 0;
+    }
+    return columns_grow(store, capacity);
+}
+
+void track_store_attach(track_store_s *store, uint32_t count, uint32_t *const columns[],
+                        char *arena, uint32_t arena_size, track_id_t *const orders[],
+                        track_store_release_cb_t release, void *owner)
+{
+    char root[TRACK_ROOT_MAX];
+    memcpy(root, store->root, sizeof(root));
+    track_store_deinit(store);
+    memcpy(store->root, root, sizeof(root));
+
+    store->path = columns[0];
+    store->name = columns[1];
+    store->artist = columns[2];
+    store->album = columns[3];
+    store->cover = columns[4];
+    store->duration_ms = columns[5];
+    store->color = columns[6];
+    store->count = count;
+    store->capacity = count;
+    store->arena = arena;
+    store->arena_size = arena_size;
+    store->arena_capacity = arena_size;
+    store->borrowed = true;
+    store->release = release;
+    store->owner = owner;
+
+    if (orders) {
+        memcpy(store->order, orders, sizeof(store->order));
+        store->order_borrowed = true;
+    }
+}
+
+int track_store_make_writable(track_store_s *store)
+{
+    if (!store->borrowed) {
+        return 0;
+    }
+
+    track_store_s copy;
+    memset(&copy, 0, sizeof(copy));
+    memcpy(copy.root, store->root, sizeof(copy.root));
+
+    if (columns_grow(&copy, store->count > 0 ? store->count : TRACK_STORE_MIN_TRACKS) != 0 ||
+        arena_grow(&copy, store->arena_size) != 0) {
+        track_store_deinit(&copy);
+        return -1;
+    }
+
+    for (int i = 0; i < TRACK_STORE_COLUMNS; i++) {
+        memcpy(track_store_column(&copy, i), track_store_column(store, i), store->count * sizeof(uint32_t));
+    }
+    memcpy(copy.arena, store->arena, store->arena_size);
+    copy.arena_size = store->arena_size;
+    copy.count = store->count;
+
+    for (int i = 0; i < TRACK_ORDER_COUNT && store->order[i]; i++) {
+        copy.order[i] = malloc(copy.capacity * sizeof(track_id_t));
+        if (!copy.order[i]) {
+            track_store_deinit(&copy);
+            return -1;
+        }
+        memcpy(copy.order[i], store->order[i], store->count * sizeof(track_id_t));
+    }
+
+    // Rebuild the intern table from the string columns (paths are not interned)
+    for (uint32_t id = 0; id < copy.count; id++) {
+        uint32_t offsets[] = { copy.name[id], copy.artist[id], copy.album[id], copy.cover[id] };
+        for (int i = 0; i < 4; i++) {
+            if (offsets[i] == TRACK_STR_EMPTY) {
+                continue;
+            }
+            if ((copy.intern_count + 1) * 2 > copy.intern_capacity && intern_grow(&copy) != 0) {
+                track_store_deinit(&copy);
+                return -1;
+            }
+            intern_insert(&copy, offsets[i]);
+        }
+    }
+
+    copy.path_index = store->path_index;
+    copy.path_index_capacity = store->path_index_capacity;
+    free(store->intern);
+    orders_free(store);
+    if (store->release) {
+        store->release(store->owner);
+    }
+    *store = copy;
+    return 0;
+}
+
+int track_store_copy(track_store_s *dst, const track_store_s *src)
+{
+    uint32_t *columns[TRACK_STORE_COLUMNS];
+
+    // Borrow the source without an owner, then copy it like a mapped index
+    memset(dst, 0, sizeof(*dst));
+    memcpy(dst->root, src->root, sizeof(dst->root));
+    for (int i = 0; i < TRACK_STORE_COLUMNS; i++) {
+        columns[i] = track_store_column(src, i);
+    }
+    track_store_attach(dst, src->count, columns, src->arena, src->arena_size,
+                       src->order[0] ? src->order : NULL, NULL, NULL);
+
+    if (track_store_make_writable(dst) != 0) {
+        memset(dst, 0, sizeof(*dst));
+        return -1;
+    }
+    return 0;
+}
+
+uint32_t *track_store_column(const track_store_s *store, int index)
+{
+    uint32_t *const columns[TRACK_STORE_COLUMNS] = {
+        store->path, store->name, store->artist, store->album,
+        store->cover, store->duration_ms, store->color,
+    };
+    return columns[index];
+}
+
+void track_store_shrink(track_store_s *store)
+{
+    if (store->borrowed) {
+        return;
+    }
+
+    if (store->count > 0 && store->count < store->capacity) {
+        columns_grow(store, store->count);
+    }
+
+    if (store->arena_size < store->arena_capacity) {
+        char *arena = realloc(store->arena, store->arena_size);
+        if (arena) {
+            store->arena = arena;
+            store->arena_capacity = store->arena_size;
+        }
+    }
+}
+
+uint32_t track_store_intern(track_store_s *store, const char *str)
+{
+    if (!str || str[0] == '\0') {
+        return TRACK_STR_EMPTY;
+    }
+
+    if (store->borrowed && track_store_make_writable(store) != 0) {
+        return TRACK_STR_EMPTY;
+    }
+
+    // Keep the load factor at or below 1/2
+    if ((store->intern_count + 1) * 2 > store->intern_capacity && intern_grow(store) != 0) {
+        return TRACK_STR_EMPTY;
+    }
+
+    size_t len = strlen(str);
+    uint32_t mask = store->intern_capacity - 1;
+    uint32_t slot = str_hash(str, len) & mask;
+
+    while (store->intern[slot] != 0) {
+        const char *candidate = store->arena + store->intern[slot] - 1;
+        if (strcmp(candidate, str) == 0) {
+            return store->intern[slot] - 1;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    uint32_t offset = arena_append(store, str, len);
+    if (offset == TRACK_STR_EMPTY) {
+        return TRACK_STR_EMPTY;
+    }
+
+    store->intern[slot] = offset + 1;
+    store->intern_count++;
+    return offset;
+}
+
+track_id_t track_store_add(track_store_s *store, const track_info_s *info)
+{
+    if (store->borrowed && track_store_make_writable(store) != 0) {
+        return TRACK_ID_INVALID;
+    }
+
+    if (store->count == UINT32_MAX - 1) {
+        return TRACK_ID_INVALID;
+    }
+
+    if (store->count == store->capacity) {
+        uint32_t capacity = store->capacity ? store->capacity * 2 : TRACK_STORE_MIN_TRACKS;
+        if (columns_grow(store, capacity) != 0) {
+            LV_LOG_ERROR("Track store allocation failed at %lu tracks", (unsigned long)store->count);
+            return TRACK_ID_INVALID;
+        }
+    }
+
+    track_id_t id = store->count;
+
+    // Paths are unique, so they skip the intern table. The row only counts
+    // once count is bumped, so a path that does not fit leaves nothing behind
+    uint32_t path = TRACK_STR_EMPTY;
+    if (info->path && info->path[0] != '\0') {
+        path = arena_append(store, info->path, strlen(info->path));
+        if (path == TRACK_STR_EMPTY) {
+            LV_LOG_ERROR("Track store allocation failed for path: %s", info->path);
+            return TRACK_ID_INVALID;
+        }
+    }
+
+    store->path[id] = path;
+    store->name[id] = track_store_intern(store, info->name);
+    store->artist[id] = track_store_intern(store, info->artist);
+    store->album[id] = track_store_intern(store, info->album);
+    store->cover[id] = track_store_intern(store, info->cover);
+    store->duration_ms[id] = info->duration_ms;
+    store->color[id] = info->color;
+
+    store->count++;
+
+    if (store->order[0]) {
+        track_order_insert(store, id, store->count - 1);
+    }
+
+    // Keep the path table, when built, at or below 1/2 load
+    if (store->path_index) {
+        if (store->count * 2 > store->path_index_capacity) {
+            if (path_index_build(store, store->path_index_capacity * 2) != 0) {
+                free(store->path_index);
+                store->path_index = NULL;
+                store->path_index_capacity = 0;
+            }
+        } else {
+            path_index_insert(store, id);
+        }
+    }
+    return id;
+}
+
+int track_store_update(track_store_s *store, track_id_t id, const track_info_s *info)
+{
+    if (!track_store_valid(store, id) || track_store_make_writable(store) != 0) {
+        return -1;
+    }
+
+    // Leave the orders while the old fields still locate the track
+    if (store->order[0]) {
+        track_order_erase(store, id, store->count);
+    }
+
+    store->name[id] = track_store_intern(store, info->name);
+    store->artist[id] = track_store_intern(store, info->artist);
+    store->album[id] = track_store_intern(store, info->album);
+    store->cover[id] = track_store_intern(store, info->cover);
+    store->duration_ms[id] = info->duration_ms;
+    store->color[id] = info->color;
+
+    if (store->order[0]) {
+        track_order_insert(store, id, store->count - 1);
+    }
+    return 0;
+}
+
+track_id_t track_store_remove(track_store_s *store, track_id_t id)
+{
+    if (!track_store_valid(store, id) || track_store_make_writable(store) != 0) {
+        return TRACK_ID_INVALID;
+    }
+
+    track_id_t last = store->count - 1;
+    if (store->path_index) {
+        path_index_erase(store, id);
+        if (last != id) {
+            path_index_erase(store, last);
+        }
+    }
+
+    if (store->order[0]) {
+        track_order_erase(store, id, store->count);
+    }
+
+    if (last != id) {
+        for (int i = 0; i < TRACK_STORE_COLUMNS; i++) {
+            uint32_t *column = track_store_column(store, i);
+            column[id] = column[last];
+        }
+    }
+    store->count--;
+
+    if (store->order[0] && last != id) {
+        track_order_rename(store, last, id, store->count);
+    }
+
+    if (store->path_index && last != id) {
+        path_index_insert(store, id);
+    }
+    return last != id ? last : TRACK_ID_INVALID;
+}
+
+track_id_t track_store_find(track_store_s *store, const char *path)
+{
+    if (!store->path_index) {
+        uint32_t capacity = 64;
+        while (capacity < store->count * 2) {
+            capacity *= 2;
+        }
+        if (path_index_build(store, capacity) != 0) {
+            return TRACK_ID_INVALID;
+        }
+    }
+
+    uint32_t mask = store->path_index_capacity - 1;
+    uint32_t slot = str_hash(path, strlen(path)) & mask;
+
+    while (store->path_index[slot] != 0) {
+        track_id_t id = store->path_index[slot] - 1;
+        if (strcmp(track_store_path(store, id), path) == 0) {
+            return id;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return TRACK_ID_INVALID;
+}
+
+int track_store_full_path(const track_store_s *store, track_id_t id, char *buf, size_t size)
+{
+    if (!track_store_valid(store, id)) {
+        return -1;
+    }
+
+    int len = snprintf(buf, size, "%s/%s", store->root, store->arena + store->path[id]);
+    return (len < 0 || (size_t)len >= size) ? -1 : len;
+}
+
+int track_store_full_cover(const track_store_s *store, track_id_t id, char *buf, size_t size)
+{
+    if (!track_store_valid(store, id) || store->cover[id] == TRACK_STR_EMPTY) {
+        return -1;
+    }
+
+    int len = snprintf(buf, size, "%s/%s", store->root, store->arena + store->cover[id]);
+    return (len < 0 || (size_t)len >= size) ? -1 : len;
+}
+
+size_t track_store_memory(const track_store_s *store)
+{
+    size_t tables = ((size_t)store->intern_capacity + store->path_index_capacity) * sizeof(uint32_t);
+    if (store->order[0] && !store->order_borrowed) {
+        tables += (size_t)store->capacity * TRACK_ORDER_COUNT * sizeof(track_id_t);
+    }
+    if (store->borrowed) {
+        return tables;
+    }
+    return (size_t)store->capacity * TRACK_STORE_COLUMNS * sizeof(uint32_t) + store->arena_capacity + tables;
+}
@@ -0,0 +1,287 @@
+/**
+ * Track Store Header
+ * Column-oriented library storage: one array per field indexed by track
+ * id, strings interned in a single arena and referenced by offset
+ */
+
+#ifndef TRACK_STORE_H
+#define TRACK_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define TRACK_ID_INVALID UINT32_MAX
+
+/* Offset of the empty string, every arena starts with it */
+#define TRACK_STR_EMPTY  0
+
+#define TRACK_ROOT_MAX   128
+
+/* Number of uint32_t columns, in track_store_s declaration order */
+#define TRACK_STORE_COLUMNS 7
+
+/*********************
+ *      TYPEDEFS
+ *********************/
+
+typedef uint32_t track_id_t;
+
+/* Browsing orders, see track_order.h */
+typedef enum {
+    TRACK_ORDER_TITLE,           // Title, artist, album
+    TRACK_ORDER_ARTIST,          // Artist, album, title
+    TRACK_ORDER_ALBUM,           // Album, artist, title
+    TRACK_ORDER_COUNT,
+} track_order_t;
+
+/**
+ * Owner callback of attached memory
+ * @param owner Pointer given to track_store_attach()
+ */
+typedef void (*track_store_release_cb_t)(void *owner);
+
+/* Input for track_store_add(), paths relative to the store root */
+typedef struct {
+    const char *path;
+    const char *name;
+    const char *artist;
+    const char *album;
+    const char *cover;
+    uint32_t duration_ms;
+    uint32_t color;          // 0xRRGGBB
+} track_info_s;
+
+/* Structure of arrays, all columns hold count valid entries */
+typedef struct {
+    uint32_t count;
+    uint32_t capacity;
+
+    // Columns, indexed by track id
+    uint32_t *path;          // Arena offsets
+    uint32_t *name;
+    uint32_t *artist;
+    uint32_t *album;
+    uint32_t *cover;
+    uint32_t *duration_ms;
+    uint32_t *color;
+
+    // String arena, NUL-terminated strings back to back
+    char *arena;
+    uint32_t arena_size;
+    uint32_t arena_capacity;
+
+    // Open-addressing intern table of arena offsets + 1, 0 marks a free slot
+    uint32_t *intern;
+    uint32_t intern_capacity;
+    uint32_t intern_count;
+
+    // Open-addressing table of track ids + 1 keyed by path, built on first lookup
+    uint32_t *path_index;
+    uint32_t path_index_capacity;
+
+    // Track ids per order with capacity entries, NULL until track_order_build()
+    track_id_t *order[TRACK_ORDER_COUNT];
+    bool order_borrowed;         // Orders point into attached memory
+
+    // Prefix shared by every path and cover, stored once
+    char root[TRACK_ROOT_MAX];
+
+    // Columns and arena point into memory owned by someone else (library index)
+    bool borrowed;
+    track_store_release_cb_t release;    // Called once the borrowed memory is no longer used
+    void *owner;
+} track_store_s;
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Initialize an empty store
+ * @param store Track store
+ * @param root Directory prepended to relative paths (e.g. MUSICS_ROOT)
+ * @return 0 on success, -1 on failure
+ */
+int track_store_init(track_store_s *store, const char *root);
+
+/**
+ * @brief Free all memory of a store
+ * @param store Track store
+ */
+void track_store_deinit(track_store_s *store);
+
+/**
+ * @brief Drop all tracks and strings, keeping the root and the allocations
+ * @param store Track store
+ */
+void track_store_clear(track_store_s *store);
+
+/**
+ * @brief Reserve room for a number of tracks
+ * @param store Track store
+ * @param capacity Total track count to hold without reallocating
+ * @return 0 on success, -1 on failure
+ */
+int track_store_reserve(track_store_s *store, uint32_t capacity);
+
+/**
+ * @brief Release unused column and arena capacity once loading is done
+ * @param store Track store
+ */
+void track_store_shrink(track_store_s *store);
+
+/**
+ * @brief Use external read-only columns and arena in place, dropping current contents
+ * @param store Track store
+ * @param count Number of tracks
+ * @param columns TRACK_STORE_COLUMNS arrays of count entries, in declaration order
+ * @param arena String arena, starting with the empty string
+ * @param arena_size Arena bytes
+ * @param orders TRACK_ORDER_COUNT arrays of count track ids, NULL if the memory holds no orders
+ * @param release Called when the store stops using the memory, may be NULL
+ * @param owner Passed to release
+ * @note Without release, the memory must outlive the store or the next track_store_clear()
+ */
+void track_store_attach(track_store_s *store, uint32_t count, uint32_t *const columns[],
+                        char *arena, uint32_t arena_size, track_id_t *const orders[],
+                        track_store_release_cb_t release, void *owner);
+
+/**
+ * @brief Copy borrowed columns and arena to the heap so the store can be modified
+ * @param store Track store
+ * @return 0 on success, -1 on failure
+ */
+int track_store_make_writable(track_store_s *store);
+
+/**
+ * @brief Make an independent, writable copy of a store
+ * @param dst Output, initialized by this call
+ * @param src Track store, only read
+ * @return 0 on success, -1 on failure
+ */
+int track_store_copy(track_store_s *dst, const track_store_s *src);
+
+/**
+ * @brief Get a column by index
+ * @param store Track store
+ * @param index Column index below TRACK_STORE_COLUMNS
+ * @return Column array
+ */
+uint32_t *track_store_column(const track_store_s *store, int index);
+
+/**
+ * @brief Append a track
+ * @param store Track store
+ * @param info Track fields, NULL strings are stored as empty
+ * @note A borrowed store is made writable first
+ * @return New track id, TRACK_ID_INVALID on allocation failure
+ */
+track_id_t track_store_add(track_store_s *store, const track_info_s *info);
+
+/**
+ * @brief Replace the fields of a track, keeping its id and path
+ * @param store Track store
+ * @param id Track id
+ * @param info New fields, info->path is ignored
+ * @note Replaced strings stay in the arena until the next clear
+ * @return 0 on success, -1 if the id is invalid or on allocation failure
+ */
+int track_store_update(track_store_s *store, track_id_t id, const track_info_s *info);
+
+/**
+ * @brief Remove a track, the last track takes over its id
+ * @param store Track store
+ * @param id Track id
+ * @return Former id of the track now at id, TRACK_ID_INVALID if none moved or on failure
+ */
+track_id_t track_store_remove(track_store_s *store, track_id_t id);
+
+/**
+ * @brief Find a track by path
+ * @param store Track store
+ * @param path Path relative to the root
+ * @note The first call builds the path table in one pass over the store
+ * @return Track id, TRACK_ID_INVALID if not found or on allocation failure
+ */
+track_id_t track_store_find(track_store_s *store, const char *path);
+
+/**
+ * @brief Store a string in the arena, reusing an identical one when present
+ * @param store Track store
+ * @param str String to intern
+ * @return Arena offset, TRACK_STR_EMPTY for NULL or "" or on allocation failure
+ */
+uint32_t track_store_intern(track_store_s *store, const char *str);
+
+/**
+ * @brief Build the absolute path of a track
+ * @param store Track store
+ * @param id Track id
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @return Length of the path, -1 if the id is invalid or the buffer too small
+ */
+int track_store_full_path(const track_store_s *store, track_id_t id, char *buf, size_t size);
+
+/**
+ * @brief Build the absolute cover path of a track
+ * @param store Track store
+ * @param id Track id
+ * @param buf Output buffer
+ * @param size Buffer size
+ * @return Length of the path, -1 if the id is invalid, the track has no cover or the buffer is too small
+ */
+int track_store_full_cover(const track_store_s *store, track_id_t id, char *buf, size_t size);
+
+/**
+ * @brief Get memory allocated by the store
+ * @param store Track store
+ * @return Bytes allocated for columns, arena and lookup tables
+ */
+size_t track_store_memory(const track_store_s *store);
+
+/* Field accessors, id must be below store->count. Returned strings move when the arena grows */
+static inline const char *track_store_str(const track_store_s *store, uint32_t offset)
+{
+    return store->arena + offset;
+}
+
+static inline const char *track_store_name(const track_store_s *store, track_id_t id)
+{
+    return store->arena + store->name[id];
+}
+
+static inline const char *track_store_artist(const track_store_s *store, track_id_t id)
+{
+    return store->arena + store->artist[id];
+}
+
+static inline const char *track_store_album(const track_store_s *store, track_id_t id)
+{
+    return store->arena + store->album[id];
+}
+
+static inline const char *track_store_path(const track_store_s *store, track_id_t id)
+{
+    return store->arena + store->path[id];
+}
+
+static inline bool track_store_valid(const track_store_s *store, track_id_t id)
+{
+    return id < store->count;
+}
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* TRACK_STORE_H */
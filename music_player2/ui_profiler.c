@@ -0,0 +1,329 @@
+/**
+ * UI Profiler
+ * A frame runs from one LV_EVENT_REFR_READY to the next, so it also holds
+ * the invalidations made by timers and input before the refresh. LVGL
+ * updates the layout right after LV_EVENT_REFR_START: resizes between
+ * REFR_START and REFR_READY belong to that layout pass, resizes anywhere
+ * else come from lv_obj_update_layout() or lv_obj_refr_size() called by
+ * the application. Forced resizes within the same millisecond are
+ * counted as one pass. Frames close, with their refresh time, in the
+ * frame_timing callback at REFR_READY
+ */
+
+#include <string.h>
+
+#include "ui_profiler.h"
+#include "frame_timing.h"
+
+/* Counters of one frame, or of a whole report period */
+typedef struct {
+    uint32_t layout_passes;          // Display layout pass with resizes, plus forced passes
+    uint32_t forced_passes;
+    uint32_t resizes;
+    uint32_t forced_resizes;
+    uint32_t areas;                  // Invalidated areas, before LVGL joins them
+    uint64_t pixels;
+    uint64_t refresh_us;             // REFR_START to REFR_READY
+} ui_profiler_stats_s;
+
+/* Object resized during the period */
+typedef struct {
+    lv_obj_t *obj;
+    uint32_t resizes;
+    uint32_t forced_resizes;
+} ui_profiler_offender_s;
+
+// Variables
+static struct {
+    lv_display_t *disp;
+    lv_timer_t *timer;
+    bool running;
+    bool in_refresh;
+    bool refresh_resized;            // The current display layout pass resized something
+    bool forced_open;
+    uint32_t forced_tick;            // Tick of the open forced pass
+    uint32_t frames;
+    ui_profiler_stats_s frame;
+    ui_profiler_stats_s total;
+    ui_profiler_stats_s worst;
+    ui_profiler_offender_s offenders[UI_PROFILER_OFFENDERS];
+} prof;
+
+// Functions
+static bool stats_worse(const ui_profiler_stats_s *a, const ui_profiler_stats_s *b);
+static void offender_count(lv_obj_t *obj, bool forced);
+static void offender_remove(lv_obj_t *obj);
+static void display_event_cb(lv_event_t *e);
+static void frame_timing_cb(uint32_t us, bool rendered, void *user_data);
+static void obj_event_cb(lv_event_t *e);
+static void watch_obj(lv_obj_t *obj);
+static void report_timer_cb(lv_timer_t *timer);
+
+/* Frames forcing layout on the input path rank first, then layout work, then redraw */
+static bool stats_worse(const ui_profiler_stats_s *a, const ui_profiler_stats_s *b)
+{
+    if (a->forced_passes != b->forced_passes) {
+        return a->forced_passes > b->forced_passes;
+    }
+    if (a->resizes != b->resizes) {
+        return a->resizes > b->resizes;
+    }
+    return a->pixels > b->pixels;
+}
+
+/* Space-saving count: a new object takes the slot of the least resized one */
+static void offender_count(lv_obj_t *obj, bool forced)
+{
+    ui_profiler_offender_s *slot = NULL;
+
+    for (int i = 0; i < UI_PROFILER_OFFENDERS; i++) {
+        ui_profiler_offender_s *o = &prof.offenders[i];
+        if (o->obj == obj) {
+            slot = o;
+            break;
+        }
+        if (!slot || o->resizes < slot->resizes) {
+            slot = o;
+        }
+    }
+
+    if (slot->obj != obj) {
+        slot->obj = obj;
+        slot->forced_resizes = 0;
+    }
+    slot->resizes++;
+    if (forced) {
+        slot->forced_resizes++;
+    }
+}
+
+static void offender_remove(lv_obj_t *obj)
+{
+    for (int i = 0; i < UI_PROFILER_OFFENDERS; i++) {
+        if (prof.offenders[i].obj == obj) {
+            memset(&prof.offenders[i], 0, sizeof(prof.offenders[i]));
+        }
+    }
+}
+
+static void display_event_cb(lv_event_t *e)
+{
+    if (!prof.running) {
+        return;
+    }
+
+    switch (lv_event_get_code(e)) {
+    case LV_EVENT_REFR_START:
+        prof.in_refresh = true;
+        prof.refresh_resized = false;
+        prof.forced_open = false;
+        break;
+    case LV_EVENT_INVALIDATE_AREA: {
+        const lv_area_t *area = lv_event_get_param(e);
+        prof.frame.areas++;
+        prof.frame.pixels += lv_area_get_size(area);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/* Every refresh closes a frame, idle ones included: they still run the layout */
+static void frame_timing_cb(uint32_t us, bool rendered, void *user_data)
+{
+    LV_UNUSED(rendered);
+    LV_UNUSED(user_data);
+
+    if (!prof.running) {
+        return;
+    }
+
+    ui_profiler_stats_s *f = &prof.frame;
+    f->refresh_us = us;
+    if (prof.refresh_resized) {
+        f->layout_passes++;
+    }
+
+    prof.frames++;
+    prof.total.layout_passes += f->layout_passes;
+    prof.total.forced_passes += f->forced_passes;
+    prof.total.resizes += f->resizes;
+    prof.total.forced_resizes += f->forced_resizes;
+    prof.total.areas += f->areas;
+    prof.total.pixels += f->pixels;
+    prof.total.refresh_us += f->refresh_us;
+    if (prof.frames == 1 || stats_worse(f, &prof.worst)) {
+        prof.worst = *f;
+    }
+
+    memset(f, 0, sizeof(*f));
+    prof.in_refresh = false;
+    prof.forced_open = false;
+}
+
+static void obj_event_cb(lv_event_t *e)
+{
+    lv_event_code_t code = lv_event_get_code(e);
+
+    if (code == LV_EVENT_CHILD_CREATED) {
+        lv_obj_t *child = lv_event_get_param(e);
+        if (child && lv_obj_get_parent(child) == lv_event_get_current_target(e)) {
+            watch_obj(child);
+        }
+        return;
+    }
+
+    lv_obj_t *obj = lv_event_get_current_target(e);
+    if (code == LV_EVENT_DELETE) {
+        offender_remove(obj);
+        return;
+    }
+
+    if (code != LV_EVENT_SIZE_CHANGED || !prof.running) {
+        return;
+    }
+
+    bool forced = !prof.in_refresh;
+    prof.frame.resizes++;
+    if (forced) {
+        uint32_t now = lv_tick_get();
+        if (!prof.forced_open || prof.forced_tick != now) {
+            prof.forced_open = true;
+            prof.forced_tick = now;
+            prof.frame.forced_passes++;
+            prof.frame.layout_passes++;
+        }
+        prof.frame.forced_resizes++;
+    } else {
+        prof.refresh_resized = true;
+    }
+    offender_count(obj, forced);
+}
+
+static void watch_obj(lv_obj_t *obj)
+{
+    lv_obj_add_event_cb(obj, obj_event_cb, LV_EVENT_SIZE_CHANGED, NULL);
+    lv_obj_add_event_cb(obj, obj_event_cb, LV_EVENT_CHILD_CREATED, NULL);
+    lv_obj_add_event_cb(obj, obj_event_cb, LV_EVENT_DELETE, NULL);
+
+    uint32_t count = lv_obj_get_child_count(obj);
+    for (uint32_t i = 0; i < count; i++) {
+        watch_obj(lv_obj_get_child(obj, i));
+    }
+}
+
+static void report_timer_cb(lv_timer_t *timer)
+{
+    LV_UNUSED(timer);
+
+    ui_profiler_report();
+}
+
+/*********************
+ * GLOBAL FUNCTIONS
+ *********************/
+
+int ui_profiler_init(lv_display_t *disp, uint32_t period_ms)
+{
+    if (prof.running) {
+        return -1;
+    }
+
+    if (!disp) {
+        disp = lv_display_get_default();
+    }
+    if (!disp) {
+        return -1;
+    }
+
+    memset(&prof, 0, sizeof(prof));
+    prof.disp = disp;
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_REFR_START, NULL);
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_INVALIDATE_AREA, NULL);
+    if (frame_timing_subscribe(disp, frame_timing_cb, NULL) != 0) {
+        lv_display_remove_event_cb_with_user_data(disp, display_event_cb, NULL);
+        return -1;
+    }
+    prof.timer = lv_timer_create(report_timer_cb, period_ms, NULL);
+    prof.running = true;
+
+    LV_LOG_USER("UI profiler: reporting every %lu ms", (unsigned long)period_ms);
+    return 0;
+}
+
+void ui_profiler_deinit(void)
+{
+    if (!prof.running) {
+        return;
+    }
+
+    lv_display_remove_event_cb_with_user_data(prof.disp, display_event_cb, NULL);
+    frame_timing_unsubscribe(frame_timing_cb, NULL);
+    if (prof.timer) {
+        lv_timer_delete(prof.timer);
+    }
+    memset(&prof, 0, sizeof(prof));
+}
+
+void ui_profiler_watch(lv_obj_t *root)
+{
+    if (root) {
+        watch_obj(root);
+    }
+}
+
+void ui_profiler_report(void)
+{
+    if (!prof.running) {
+        return;
+    }
+
+    if (prof.frames == 0) {
+        LV_LOG_USER("UI profiler: no frames");
+    } else {
+        const ui_profiler_stats_s *t = &prof.total;
+        const ui_profiler_stats_s *w = &prof.worst;
+        LV_LOG_USER("UI profiler: %lu frames, %lu layout passes (%lu forced), "
+                    "%lu resizes (%lu forced), %lu areas, %lu px/frame, %lu us refresh/frame",
+                    (unsigned long)prof.frames, (unsigned long)t->layout_passes,
+                    (unsigned long)t->forced_passes, (unsigned long)t->resizes,
+                    (unsigned long)t->forced_resizes, (unsigned long)t->areas,
+                    (unsigned long)(t->pixels / prof.frames),
+                    (unsigned long)(t->refresh_us / prof.frames));
+        LV_LOG_USER("UI profiler: worst frame %lu layout passes (%lu forced), "
+                    "%lu resizes, %lu areas, %lu px, %lu us refresh",
+                    (unsigned long)w->layout_passes, (unsigned long)w->forced_passes,
+                    (unsigned long)w->resizes, (unsigned long)w->areas,
+                    (unsigned long)w->pixels, (unsigned long)w->refresh_us);
+        LV_UNUSED(t);
+        LV_UNUSED(w);
+    }
+
+    // Most resized objects first, by position as pointers alone say little
+    for (int n = 0; n < UI_PROFILER_OFFENDERS_LOG; n++) {
+        ui_profiler_offender_s *top = NULL;
+        for (int i = 0; i < UI_PROFILER_OFFENDERS; i++) {
+            ui_profiler_offender_s *o = &prof.offenders[i];
+            if (o->obj && o->resizes > 0 && (!top || o->resizes > top->resizes)) {
+                top = o;
+            }
+        }
+        if (!top) {
+            break;
+        }
+
+        lv_area_t area;
+        lv_obj_get_coords(top->obj, &area);
+        LV_LOG_USER("UI profiler:   %p %ldx%ld at %ld,%ld, %lu resizes (%lu forced)",
+                    (void *)top->obj, (long)lv_area_get_width(&area), (long)lv_area_get_height(&area),
+                    (long)area.x1, (long)area.y1,
+                    (unsigned long)top->resizes, (unsigned long)top->forced_resizes);
+        top->resizes = 0;
+    }
+
+    prof.frames = 0;
+    memset(&prof.total, 0, sizeof(prof.total));
+    memset(&prof.worst, 0, sizeof(prof.worst));
+    memset(prof.offenders, 0, sizeof(prof.offenders));
+}
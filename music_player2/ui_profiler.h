@@ -0,0 +1,65 @@
+/**
+ * UI Profiler Header
+ * Debug counters for layout and redraw work per display frame: layout
+ * passes, objects resized, invalidated areas and pixels. Layout that
+ * runs outside the display refresh was forced synchronously by the
+ * code that changed the widgets, the objects it resized are logged as
+ * the worst offenders
+ */
+
+#ifndef UI_PROFILER_H
+#define UI_PROFILER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <lvgl.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      DEFINES
+ *********************/
+
+#define UI_PROFILER_OFFENDERS     8   // Objects tracked per report
+#define UI_PROFILER_OFFENDERS_LOG 5   // Objects logged per report
+
+/*********************
+ * GLOBAL PROTOTYPES
+ *********************/
+
+/**
+ * @brief Start counting on a display and log a report periodically
+ * @note LVGL thread only. Register it after other LV_EVENT_REFR_START handlers,
+ *       so layout they force is reported as forced
+ * @param disp Display to profile, NULL for the default display
+ * @param period_ms Report period
+ * @return 0 on success, -1 if already running or without a display
+ */
+int ui_profiler_init(lv_display_t *disp, uint32_t period_ms);
+
+/**
+ * @brief Stop counting and remove the display handlers
+ * @note Watched objects keep their handlers, which then do nothing
+ */
+void ui_profiler_deinit(void);
+
+/**
+ * @brief Count resizes of an object tree, children created later included
+ * @note Adds event handlers to every object of the tree, for debugging only
+ * @param root Root of the tree, such as a screen or a layer
+ */
+void ui_profiler_watch(lv_obj_t *root);
+
+/**
+ * @brief Log the report now and start a new period
+ */
+void ui_profiler_report(void);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /* UI_PROFILER_H */
@@ -0,0 +1,54 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Vela Music Player Benchmark Script
+# Builds the NuttX sim board, a Linux host process, with music_player_bench
+# and runs the scripted benchmark once. Report lines start with [bench].
+
+# Resolve repo root
+ROOT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")"/.. && pwd)"
+BOARD="${BENCH_BOARD:-sim:nsh}"
+DEFCONFIG="$ROOT_DIR/nuttx/boards/sim/sim/sim/configs/${BOARD#sim:}/defconfig"
+LOG="${BENCH_LOG:-$ROOT_DIR/music_player_bench.log}"
+
+echo "[run] repo root: $ROOT_DIR"
+
+# Configure defconfig
+ensure_cfg() {
+    local line="$1"
+    local key="${line%%=*}"
+    key="${key#\# }"
+    key="${key%% is not set}"
+    sed -i -e "/^${key}=.*/d" -e "/^# ${key} is not set/d" "$DEFCONFIG" || true
+    echo "$line" >> "$DEFCONFIG"
+}
+
+echo "[run] Updating defconfig for music_player_bench and NSH builtins..."
+ensure_cfg "CONFIG_BUILTIN=y"
+ensure_cfg "CONFIG_NSH_LIBRARY=y"
+ensure_cfg "CONFIG_NSH_BUILTIN_APPS=y"
+ensure_cfg "CONFIG_SYSTEM_NSH=y"
+ensure_cfg "CONFIG_LVX_USE_DEMO_VELA_AUDIO=y"
+ensure_cfg "CONFIG_LVX_MUSIC_PLAYER_BENCH=y"
+ensure_cfg "CONFIG_LVX_MUSIC_PLAYER_DATA_ROOT=\"/data\""
+
+# Host files mounted at /data, audio into the null sink
+ensure_cfg "CONFIG_FS_HOSTFS=y"
+ensure_cfg "CONFIG_SIM_HOSTFS=y"
+ensure_cfg "CONFIG_LVX_MUSIC_PLAYER_SINK_NULL=y"
+
+# Enable LVGL support, the benchmark brings its own display and input
+ensure_cfg "CONFIG_LVGL=y"
+ensure_cfg "# CONFIG_LV_USE_SDL is not set"
+ensure_cfg "# CONFIG_LV_USE_FBDEV is not set"
+
+echo "[run] Building..."
+cd "$ROOT_DIR/nuttx"
+./tools/configure.sh -l "$BOARD"
+make olddefconfig
+make -j$(nproc)
+
+echo "[run] Running benchmark, log: $LOG"
+printf 'mount -t hostfs -o fs=%s /data\nmusic_player_bench %s\npoweroff\n' \
+    "$ROOT_DIR/music_player2" "${BENCH_ARGS:-}" | ./nuttx | tee "$LOG"
+grep '^\[bench\]' "$LOG" || true